@@ -164,6 +164,41 @@ bool AssignFilter::processOne(PointRef& point)
 }
 
 
+// Apply each assignment to the whole batch in turn.  Since points are
+// independent, this gives the same result as processOne().
+point_count_t AssignFilter::processBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    std::vector<PointId> ids;
+
+    PointRef point(table, begin);
+    const bool conditional =
+        (m_args->m_condition.m_id != Dimension::Id::Unknown);
+    for (PointId idx = begin; idx < end; ++idx)
+    {
+        if (table.skip(idx))
+            continue;
+        if (conditional)
+        {
+            point.setPointId(idx);
+            double condVal = point.getFieldAs<double>(m_args->m_condition.m_id);
+            if (!m_args->m_condition.valuePasses(condVal))
+                continue;
+        }
+        ids.push_back(idx);
+    }
+
+    for (AssignRange& r : m_args->m_assignments)
+        for (PointId idx : ids)
+        {
+            point.setPointId(idx);
+            if (r.valuePasses(point.getFieldAs<double>(r.m_id)))
+                point.setField(r.m_id, r.m_value);
+        }
+    return end - begin;
+}
+
+
 void AssignFilter::filter(PointView& view)
 {
     PointRef point(view, 0);
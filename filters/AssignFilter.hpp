@@ -54,6 +54,8 @@ private:
     virtual void addArgs(ProgramArgs& args);
     virtual void prepared(PointTableRef table);
     virtual bool processOne(PointRef& point);
+    virtual point_count_t processBatch(StreamPointTable& table,
+        PointId begin, PointId end);
     virtual void filter(PointView& view);
 
     AssignFilter& operator=(const AssignFilter&) = delete;
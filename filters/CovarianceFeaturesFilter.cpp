@@ -41,6 +41,7 @@
 #include <pdal/EigenUtils.hpp>
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include <Eigen/Dense>
 
@@ -68,7 +69,8 @@ std::string CovarianceFeaturesFilter::getName() const
 void CovarianceFeaturesFilter::addArgs(ProgramArgs& args)
 {
     args.add("knn", "k-Nearest neighbors", m_knn, 10);
-    args.add("threads", "Number of threads used to run this filter", m_threads, 1);
+    args.add("threads", "Maximum number of threads used to run this filter "
+        "(0 for the shared thread limit)", m_threads, 0);
     args.add("feature_set", "Set of features to be computed", m_featureSet, "Dimensionality");
     args.add("stride", "Compute features on strided neighbors", m_stride, size_t(1));
 }
@@ -87,20 +89,11 @@ void CovarianceFeaturesFilter::filter(PointView& view)
 
     KD3Index& kdi = view.build3dIndex();
 
-    point_count_t nloops = view.size();
-    std::vector<std::thread> threadList(m_threads);
-    for(int t = 0;t<m_threads;t++)
-    {
-        threadList[t] = std::thread(std::bind(
-                [&](const PointId start, const PointId end)
-                {
-                    for(PointId i = start;i<end;i++)
-                        setDimensionality(view, i, kdi);
-                },
-                t*nloops/m_threads,(t+1)==m_threads?nloops:(t+1)*nloops/m_threads));
-    }
-    for (auto &t: threadList)
-        t.join();
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
+        {
+            for (PointId i = begin; i < end; ++i)
+                setDimensionality(view, i, kdi);
+        }, m_threads);
 }
 
 void CovarianceFeaturesFilter::setDimensionality(PointView &view, const PointId &id, const KD3Index &kid)
@@ -34,8 +34,6 @@
 
 #pragma once
 
-#include <thread>
-
 #include <pdal/Filter.hpp>
 
 namespace pdal {
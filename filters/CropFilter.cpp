@@ -171,6 +171,66 @@ bool CropFilter::processOne(PointRef& point)
 }
 
 
+// Fetch the coordinates of the points in the batch once and test each
+// geometry against all of them.  As in processOne(), a point is kept if
+// any geometry keeps it.
+point_count_t CropFilter::processBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    std::vector<PointId> ids;
+    std::vector<double> xs, ys, zs;
+
+    PointRef point(table, begin);
+    for (PointId idx = begin; idx < end; ++idx)
+    {
+        if (table.skip(idx))
+            continue;
+        point.setPointId(idx);
+        ids.push_back(idx);
+        xs.push_back(point.getFieldAs<double>(Dimension::Id::X));
+        ys.push_back(point.getFieldAs<double>(Dimension::Id::Y));
+        zs.push_back(point.getFieldAs<double>(Dimension::Id::Z));
+    }
+
+    const size_t count = ids.size();
+    std::vector<char> keep(count, 0);
+    for (auto& g : m_geoms)
+        for (auto& gridPnp : g.m_gridPnps)
+            for (size_t i = 0; i < count; ++i)
+                if (!keep[i])
+                    keep[i] = (m_args->m_cropOutside !=
+                        gridPnp->inside(xs[i], ys[i]));
+
+    for (auto& box : m_boxes)
+        if (box.is3d())
+        {
+            const BOX3D b(box.to3d());
+            for (size_t i = 0; i < count; ++i)
+                if (!keep[i])
+                    keep[i] = (m_args->m_cropOutside !=
+                        b.contains(xs[i], ys[i], zs[i]));
+        }
+        else
+        {
+            const BOX2D b(box.to2d());
+            for (size_t i = 0; i < count; ++i)
+                if (!keep[i])
+                    keep[i] = (m_args->m_cropOutside !=
+                        b.contains(xs[i], ys[i]));
+        }
+
+    for (auto& center : m_args->m_centers)
+        for (size_t i = 0; i < count; ++i)
+            if (!keep[i])
+                keep[i] = crop(xs[i], ys[i], zs[i], center);
+
+    for (size_t i = 0; i < count; ++i)
+        if (!keep[i])
+            table.setSkip(ids[i]);
+    return end - begin;
+}
+
+
 void CropFilter::spatialReferenceChanged(const SpatialReference& srs)
 {
     transform(srs);
@@ -236,6 +296,7 @@ PointViewSet CropFilter::run(PointViewPtr view)
     {
         PointViewPtr outView = view->makeNew();
         crop(geom, *view, *outView);
+        outView->inheritProducts(*view);
         viewSet.insert(outView);
     }
 
@@ -243,6 +304,7 @@ PointViewSet CropFilter::run(PointViewPtr view)
     {
         PointViewPtr outView = view->makeNew();
         crop(box, *view, *outView);
+        outView->inheritProducts(*view);
         viewSet.insert(outView);
     }
 
@@ -250,6 +312,7 @@ PointViewSet CropFilter::run(PointViewPtr view)
     {
         PointViewPtr outView = view->makeNew();
         crop(point, *view, *outView);
+        outView->inheritProducts(*view);
         viewSet.insert(outView);
     }
 
@@ -335,7 +398,15 @@ bool CropFilter::crop(const PointRef& point, const filter::Point& center)
 {
     double x = point.getFieldAs<double>(Dimension::Id::X);
     double y = point.getFieldAs<double>(Dimension::Id::Y);
+    double z = center.is3d() ? point.getFieldAs<double>(Dimension::Id::Z) : 0;
+
+    return crop(x, y, z, center);
+}
+
 
+bool CropFilter::crop(double x, double y, double z,
+    const filter::Point& center)
+{
     x = std::abs(x - center.x());
     y = std::abs(y - center.y());
     if (x > m_args->m_distance || y > m_args->m_distance)
@@ -344,7 +415,6 @@ bool CropFilter::crop(const PointRef& point, const filter::Point& center)
     bool inside;
     if (center.is3d())
     {
-        double z = point.getFieldAs<double>(Dimension::Id::Z);
         z = std::abs(z - center.z());
         if (z > m_args->m_distance)
             return (m_args->m_cropOutside);
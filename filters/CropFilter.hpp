@@ -84,6 +84,8 @@ private:
     virtual void ready(PointTableRef table);
     virtual void spatialReferenceChanged(const SpatialReference& srs);
     virtual bool processOne(PointRef& point);
+    virtual point_count_t processBatch(StreamPointTable& table,
+        PointId begin, PointId end);
     virtual PointViewSet run(PointViewPtr view);
     bool crop(const PointRef& point, const BOX2D& box);
     bool crop(const PointRef& point, const BOX3D& box);
@@ -93,6 +95,7 @@ private:
     bool crop(const PointRef& point, GridPnp& g);
     void crop(const ViewGeom& g, PointView& input, PointView& output);
     bool crop(const PointRef& point, const filter::Point& center);
+    bool crop(double x, double y, double z, const filter::Point& center);
     void crop(const filter::Point& center, PointView& input,
         PointView& output);
     void transform(const SpatialReference& srs);
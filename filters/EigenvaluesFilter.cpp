@@ -37,6 +37,7 @@
 #include <pdal/EigenUtils.hpp>
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include <Eigen/Dense>
 
@@ -79,32 +80,35 @@ void EigenvaluesFilter::filter(PointView& view)
 {
     using namespace Eigen;
 
-    KD3Index& kdi = view.build3dIndex();
-
-    for (PointId i = 0; i < view.size(); ++i)
-    {
-        // find the k-nearest neighbors
-        auto ids = kdi.neighbors(i, m_knn);
-
-        // compute covariance of the neighborhood
-        auto B = computeCovariance(view, ids);
-
-        // perform the eigen decomposition
-        SelfAdjointEigenSolver<Matrix3d> solver(B);
-        if (solver.info() != Success)
-            throwError("Cannot perform eigen decomposition.");
-        auto ev = solver.eigenvalues();
-
-        if (m_normalize)
+    // find the k-nearest neighbors
+    KnnGraph graph = view.buildKnnGraph(m_knn);
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
         {
-            double sum = ev[0] + ev[1] + ev[2];
-            ev /= sum;
-        }
-
-        view.setField(m_e0, i, ev[0]);
-        view.setField(m_e1, i, ev[1]);
-        view.setField(m_e2, i, ev[2]);
-    }
+            PointIdList ids;
+            for (PointId i = begin; i < end; ++i)
+            {
+                graph.neighbors(i, ids);
+
+                // compute covariance of the neighborhood
+                auto B = computeCovariance(view, ids);
+
+                // perform the eigen decomposition
+                SelfAdjointEigenSolver<Matrix3d> solver(B);
+                if (solver.info() != Success)
+                    throwError("Cannot perform eigen decomposition.");
+                auto ev = solver.eigenvalues();
+
+                if (m_normalize)
+                {
+                    double sum = ev[0] + ev[1] + ev[2];
+                    ev /= sum;
+                }
+
+                view.setField(m_e0, i, ev[0]);
+                view.setField(m_e1, i, ev[1]);
+                view.setField(m_e2, i, ev[2]);
+            }
+        });
 }
 
 } // namespace pdal
@@ -37,6 +37,7 @@
 #include <pdal/EigenUtils.hpp>
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include <string>
 #include <vector>
@@ -73,15 +74,17 @@ void EstimateRankFilter::addDimensions(PointLayoutPtr layout)
 
 void EstimateRankFilter::filter(PointView& view)
 {
-    KD3Index& kdi = view.build3dIndex();
-
-    for (PointId i = 0; i < view.size(); ++i)
-    {
-        // find the k-nearest neighbors
-        auto ids = kdi.neighbors(i, m_knn);
-
-        view.setField(m_rank, i, computeRank(view, ids, m_thresh));
-    }
+    // find the k-nearest neighbors
+    KnnGraph graph = view.buildKnnGraph(m_knn);
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
+        {
+            PointIdList ids;
+            for (PointId i = begin; i < end; ++i)
+            {
+                graph.neighbors(i, ids);
+                view.setField(m_rank, i, computeRank(view, ids, m_thresh));
+            }
+        });
 }
 
 } // namespace pdal
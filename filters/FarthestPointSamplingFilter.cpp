@@ -34,12 +34,14 @@
 
 #include "FarthestPointSamplingFilter.hpp"
 
-#include <pdal/KDIndex.hpp>
+#include <pdal/EigenUtils.hpp>
+#include <pdal/GridIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
-#include <numeric>
 #include <string>
 #include <vector>
 
@@ -51,6 +53,244 @@ static PluginInfo const s_info{"filters.fps", "Farthest point sampling filter",
 
 CREATE_STATIC_STAGE(FarthestPointSamplingFilter, s_info)
 
+namespace
+{
+
+// Average number of points in a cell of the sampling grid.
+const point_count_t PointsPerCell = 64;
+// Number of points to update before the update is split among threads.
+const point_count_t ParallelPoints = 65536;
+const size_t NoPos = (std::numeric_limits<size_t>::max)();
+
+// The squared distance from each point of a view to the nearest sample.
+// Points are stored by cell of a grid index, along with the bounds of the
+// points of each cell and a tree of the farthest point of each cell.  When
+// a sample is added, only the cells that may hold points nearer to the
+// sample than to the other samples are updated: those within the distance
+// of the farthest point, and whose points can be nearer than the farthest
+// point of the cell.
+class SampleGrid
+{
+public:
+    SampleGrid(const PointView& view);
+
+    // Position of the point farthest from the samples.  Of points that are
+    // equally far, the one that comes first in the view is chosen.
+    size_t farthest() const
+        { return m_tree[1]; }
+    PointId id(size_t pos) const
+        { return m_ids[pos]; }
+    double sqrDist(size_t pos) const
+        { return m_dist[pos]; }
+    void addSample(size_t pos);
+
+private:
+    const GridIndex m_grid;
+    std::vector<PointId> m_ids;
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
+    std::vector<double> m_dist;
+    // Position of the first point of each cell, followed by the number of
+    // points.
+    std::vector<size_t> m_offsets;
+    std::vector<BOX3D> m_bounds;
+    // Binary tree of the farthest point of each cell.  Node 1 is the root,
+    // the children of node i are 2i and 2i + 1 and the leaves start at
+    // m_leaves.
+    std::vector<size_t> m_tree;
+    size_t m_leaves;
+    std::vector<size_t> m_touched;
+
+    static double cellSize(const PointView& view);
+    bool farther(size_t pos1, size_t pos2) const
+    {
+        if (pos2 == NoPos)
+            return pos1 != NoPos;
+        if (pos1 == NoPos)
+            return false;
+        return m_dist[pos1] > m_dist[pos2] ||
+            (m_dist[pos1] == m_dist[pos2] && m_ids[pos1] < m_ids[pos2]);
+    }
+    void updateCell(size_t cell, double x, double y, double z);
+    void updateTree(size_t cell);
+};
+
+
+SampleGrid::SampleGrid(const PointView& view) :
+    m_grid(view, cellSize(view))
+{
+    const size_t cells = m_grid.cols() * m_grid.rows();
+    const PointId *base = m_grid.points(0, 0).begin();
+    m_offsets.resize(cells + 1);
+    for (size_t row = 0; row < m_grid.rows(); ++row)
+        for (size_t col = 0; col < m_grid.cols(); ++col)
+        {
+            const size_t cell = row * m_grid.cols() + col;
+            GridIndex::Cell c = m_grid.points(col, row);
+            m_offsets[cell] = c.begin() - base;
+            m_offsets[cell + 1] = c.end() - base;
+        }
+    m_ids.assign(base, base + view.size());
+
+    // Copy the positions of the points in cell order so that the distances
+    // of the points of a cell are computed from contiguous memory.
+    const size_t n = view.size();
+    m_x.resize(n);
+    m_y.resize(n);
+    m_z.resize(n);
+    m_dist.assign(n, (std::numeric_limits<double>::max)());
+    m_bounds.resize(cells);
+    parallelFor(0, cells, [this, &view](size_t begin, size_t end)
+        {
+            for (size_t cell = begin; cell < end; ++cell)
+                for (size_t p = m_offsets[cell]; p < m_offsets[cell + 1]; ++p)
+                {
+                    m_x[p] = view.getFieldAs<double>(Dimension::Id::X,
+                        m_ids[p]);
+                    m_y[p] = view.getFieldAs<double>(Dimension::Id::Y,
+                        m_ids[p]);
+                    m_z[p] = view.getFieldAs<double>(Dimension::Id::Z,
+                        m_ids[p]);
+                    m_bounds[cell].grow(m_x[p], m_y[p], m_z[p]);
+                }
+        });
+
+    m_leaves = 1;
+    while (m_leaves < cells)
+        m_leaves *= 2;
+    m_tree.assign(2 * m_leaves, NoPos);
+}
+
+
+// Size of the cells of a grid that holds about PointsPerCell points in
+// each cell if the points are spread evenly.
+double SampleGrid::cellSize(const PointView& view)
+{
+    BOX2D bounds;
+    calculateBounds(view, bounds);
+    const double width = bounds.maxx - bounds.minx;
+    const double height = bounds.maxy - bounds.miny;
+    const double cells = (std::max)(1.0, (double)view.size() / PointsPerCell);
+
+    // Cells no smaller than those of a single row or column keep a thin
+    // extent from producing too many cells.
+    const double size = (std::max)(std::sqrt(width * height / cells),
+        (std::max)(width, height) / cells);
+    return (size > 0) ? size : 1.0;
+}
+
+
+void SampleGrid::addSample(size_t pos)
+{
+    const double x = m_x[pos];
+    const double y = m_y[pos];
+    const double z = m_z[pos];
+
+    // No point is farther from the samples than the new sample, so only
+    // points within that distance of the new sample can move nearer.  The
+    // window is padded by a cell to allow for rounding.  The first sample
+    // has no distance and updates every cell.
+    size_t col0 = 0;
+    size_t col1 = m_grid.cols() - 1;
+    size_t row0 = 0;
+    size_t row1 = m_grid.rows() - 1;
+    const BOX2D& bounds = m_grid.bounds();
+    const double radius = std::sqrt(m_dist[pos]);
+    if (x - radius > bounds.minx)
+        col0 = (std::max)(m_grid.col(x - radius), size_t(1)) - 1;
+    if (x + radius < bounds.maxx)
+        col1 = (std::min)(m_grid.col(x + radius) + 1, col1);
+    if (y - radius > bounds.miny)
+        row0 = (std::max)(m_grid.row(y - radius), size_t(1)) - 1;
+    if (y + radius < bounds.maxy)
+        row1 = (std::min)(m_grid.row(y + radius) + 1, row1);
+
+    m_touched.clear();
+    point_count_t count = 0;
+    for (size_t row = row0; row <= row1; ++row)
+        for (size_t col = col0; col <= col1; ++col)
+        {
+            const size_t cell = row * m_grid.cols() + col;
+            if (m_offsets[cell] == m_offsets[cell + 1])
+                continue;
+
+            // Skip the cell if no point in its bounds is nearer to the
+            // sample than its farthest point is to the other samples.
+            const size_t far = m_tree[m_leaves + cell];
+            if (far != NoPos)
+            {
+                const BOX3D& b = m_bounds[cell];
+                const double dx = (std::max)((std::max)(b.minx - x,
+                    x - b.maxx), 0.0);
+                const double dy = (std::max)((std::max)(b.miny - y,
+                    y - b.maxy), 0.0);
+                const double dz = (std::max)((std::max)(b.minz - z,
+                    z - b.maxz), 0.0);
+                if (dx * dx + dy * dy + dz * dz >= m_dist[far])
+                    continue;
+            }
+            m_touched.push_back(cell);
+            count += m_offsets[cell + 1] - m_offsets[cell];
+        }
+
+    auto update = [this, x, y, z](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            updateCell(m_touched[i], x, y, z);
+    };
+    if (count < ParallelPoints)
+        update(0, m_touched.size());
+    else
+        parallelFor(0, m_touched.size(), update);
+
+    for (size_t cell : m_touched)
+        updateTree(cell);
+}
+
+
+// Reduce the distances of the points of a cell to those to a new sample
+// and find the farthest point of the cell.
+void SampleGrid::updateCell(size_t cell, double x, double y, double z)
+{
+    const size_t begin = m_offsets[cell];
+    const size_t end = m_offsets[cell + 1];
+    const double *xs = m_x.data();
+    const double *ys = m_y.data();
+    const double *zs = m_z.data();
+    double *dist = m_dist.data();
+    for (size_t p = begin; p < end; ++p)
+    {
+        const double dx = xs[p] - x;
+        const double dy = ys[p] - y;
+        const double dz = zs[p] - z;
+        const double d = dx * dx + dy * dy + dz * dz;
+        dist[p] = (d < dist[p]) ? d : dist[p];
+    }
+
+    // IDs within a cell are in view order, so the first of the farthest
+    // points is kept.
+    size_t far = begin;
+    for (size_t p = begin + 1; p < end; ++p)
+        if (dist[p] > dist[far])
+            far = p;
+    m_tree[m_leaves + cell] = far;
+}
+
+
+void SampleGrid::updateTree(size_t cell)
+{
+    for (size_t node = (m_leaves + cell) / 2; node; node /= 2)
+    {
+        const size_t left = m_tree[2 * node];
+        const size_t right = m_tree[2 * node + 1];
+        m_tree[node] = farther(right, left) ? right : left;
+    }
+}
+
+} // unnamed namespace
+
+
 std::string FarthestPointSamplingFilter::getName() const
 {
     return s_info.name;
@@ -76,48 +316,37 @@ PointViewSet FarthestPointSamplingFilter::run(PointViewPtr inView)
     // Otherwise, make a new output PointView.
     PointViewPtr outView = inView->makeNew();
 
-    // Construct a KD-tree of the input view.
-    KD3Index& kdi = inView->build3dIndex();
+    // Index the input view by grid cell.  Each point's distance to the
+    // nearest sample is updated as samples are added, rather than searching
+    // the whole view for each sample.
+    SampleGrid grid(*inView);
 
     // Seed the output view with the first point in the current sorting.
     PointId seedId(0);
     outView->appendPoint(*inView, seedId);
-
-    // Compute distances from seedId to all other points.
-    PointIdList indices(inView->size());
-    std::vector<double> sqr_dists(inView->size());
-    kdi.knnSearch(seedId, inView->size(), &indices, &sqr_dists);
-
-    // Sort distances by PointId.
-    std::vector<double> min_dists(inView->size());
-    for (PointId i = 0; i < inView->size(); ++i)
-        min_dists[indices[i]] = sqr_dists[i];
+    size_t pos = 0;
+    while (grid.id(pos) != seedId)
+        pos++;
+    grid.addSample(pos);
 
     // Proceed until we have m_count points in the output PointView.
     for (PointId i = 1; i < m_count; ++i)
     {
-        // Find the max distance in min_dists, this is the farthest point from
-        // any point currently in the output PointView.
-        auto it = std::max_element(min_dists.begin(), min_dists.end());
+        // Find the farthest point from any point currently in the output
+        // PointView.
+        pos = grid.farthest();
 
         // Record the PointId of the farthest point and add it to the output
         // PointView.
-        PointId idx(it - min_dists.begin());
+        PointId idx = grid.id(pos);
         outView->appendPoint(*inView, idx);
 
         log()->get(LogLevel::Debug)
             << "Adding PointId " << idx << " with distance "
-            << std::sqrt(min_dists[idx]) << std::endl;
-
-        // Compute distances from idx to all other points.
-        kdi.knnSearch(idx, inView->size(), &indices, &sqr_dists);
+            << std::sqrt(grid.sqrDist(pos)) << std::endl;
 
         // Update distances.
-        for (PointId j = 0; j < inView->size(); ++j)
-        {
-            if (sqr_dists[j] < min_dists[indices[j]])
-                min_dists[indices[j]] = sqr_dists[j];
-        }
+        grid.addSample(pos);
     }
 
     viewSet.insert(outView);
@@ -35,6 +35,7 @@
 #include "LOFFilter.hpp"
 
 #include <pdal/KDIndex.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include <string>
 #include <vector>
@@ -73,22 +74,22 @@ void LOFFilter::filter(PointView& view)
 {
     using namespace Dimension;
 
-    KD3Index& index = view.build3dIndex();
-
-    // Increment the minimum number of points, as knnSearch will be returning
-    // the neighbors along with the query point.
-    m_minpts++;
+    // Request one more neighbor than the minimum number of points, as the
+    // neighbors include the query point.
+    KnnGraph graph = view.buildKnnGraph(m_minpts + 1);
 
     // First pass: Compute the k-distance for each point.
     // The k-distance is the Euclidean distance to k-th nearest neighbor.
     log()->get(LogLevel::Debug) << "Computing k-distances...\n";
-    for (PointId i = 0; i < view.size(); ++i)
-    {
-        PointIdList indices(m_minpts);
-        std::vector<double> sqr_dists(m_minpts);
-        index.knnSearch(i, m_minpts, &indices, &sqr_dists);
-        view.setField(m_kdist, i, std::sqrt(sqr_dists[m_minpts-1]));
-    }
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
+        {
+            for (PointId i = begin; i < end; ++i)
+            {
+                size_t n = graph.count(i);
+                const double *sqr_dists = graph.distances(i);
+                view.setField(m_kdist, i, std::sqrt(sqr_dists[n - 1]));
+            }
+        });
 
     // Second pass: Compute the local reachability distance for each point.
     // For each neighbor point, the reachability distance is the maximum value
@@ -96,39 +97,43 @@ void LOFFilter::filter(PointView& view)
     // the current point. The lrd is the inverse of the mean of the reachability
     // distances.
     log()->get(LogLevel::Debug) << "Computing lrd...\n";
-    for (PointId i = 0; i < view.size(); ++i)
-    {
-        PointIdList indices(m_minpts);
-        std::vector<double> sqr_dists(m_minpts);
-        index.knnSearch(i, m_minpts, &indices, &sqr_dists);
-        double M1 = 0.0;
-        point_count_t n = 0;
-        for (PointId j = 0; j < indices.size(); ++j)
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
         {
-            double k = view.getFieldAs<double>(m_kdist, indices[j]);
-            double reachdist = (std::max)(k, std::sqrt(sqr_dists[j]));
-            M1 += (reachdist - M1) / ++n;
-        }
-        view.setField(m_lrd, i, 1.0 / M1);
-    }
+            for (PointId i = begin; i < end; ++i)
+            {
+                const PointId *indices = graph.neighbors(i);
+                const double *sqr_dists = graph.distances(i);
+                double M1 = 0.0;
+                point_count_t n = 0;
+                for (PointId j = 0; j < graph.count(i); ++j)
+                {
+                    double k = view.getFieldAs<double>(m_kdist, indices[j]);
+                    double reachdist = (std::max)(k, std::sqrt(sqr_dists[j]));
+                    M1 += (reachdist - M1) / ++n;
+                }
+                view.setField(m_lrd, i, 1.0 / M1);
+            }
+        });
 
     // Third pass: Compute the local outlier factor for each point.
     // The LOF is the average of the lrd's for a neighborhood of points.
     log()->get(LogLevel::Debug) << "Computing LOF...\n";
-    for (PointId i = 0; i < view.size(); ++i)
-    {
-        double lrdp = view.getFieldAs<double>(m_lrd, i);
-        PointIdList indices(m_minpts);
-        std::vector<double> sqr_dists(m_minpts);
-        index.knnSearch(i, m_minpts, &indices, &sqr_dists);
-        double M1 = 0.0;
-        point_count_t n = 0;
-        for (auto const& j : indices)
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
         {
-            M1 += (view.getFieldAs<double>(m_lrd, j) / lrdp - M1) / ++n;
-        }
-        view.setField(m_lof, i, M1);
-    }
+            for (PointId i = begin; i < end; ++i)
+            {
+                double lrdp = view.getFieldAs<double>(m_lrd, i);
+                const PointId *indices = graph.neighbors(i);
+                double M1 = 0.0;
+                point_count_t n = 0;
+                for (PointId j = 0; j < graph.count(i); ++j)
+                {
+                    double lrd = view.getFieldAs<double>(m_lrd, indices[j]);
+                    M1 += (lrd / lrdp - M1) / ++n;
+                }
+                view.setField(m_lof, i, M1);
+            }
+        });
 }
 
 } // namespace pdal
@@ -41,12 +41,12 @@
 
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include "private/miniball/Seb.h"
 
 #include <cmath>
 #include <string>
-#include <thread>
 #include <vector>
 
 namespace pdal
@@ -71,8 +71,8 @@ std::string MiniballFilter::getName() const
 void MiniballFilter::addArgs(ProgramArgs& args)
 {
     args.add("knn", "k-Nearest neighbors", m_knn, 8);
-    args.add("threads", "Number of threads used to run this filter", m_threads,
-             1);
+    args.add("threads", "Maximum number of threads used to run this filter "
+        "(0 for the shared thread limit)", m_threads, 0);
 }
 
 void MiniballFilter::addDimensions(PointLayoutPtr layout)
@@ -85,20 +85,11 @@ void MiniballFilter::filter(PointView& view)
 {
     KD3Index& kdi = view.build3dIndex();
 
-    point_count_t nloops = view.size();
-    std::vector<std::thread> threadList(m_threads);
-    for (int t = 0; t < m_threads; t++)
-    {
-        threadList[t] = std::thread(std::bind(
-            [&](const PointId start, const PointId end) {
-                for (PointId i = start; i < end; i++)
-                    setMiniball(view, i, kdi);
-            },
-            t * nloops / m_threads,
-            (t + 1) == m_threads ? nloops : (t + 1) * nloops / m_threads));
-    }
-    for (auto& t : threadList)
-        t.join();
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
+        {
+            for (PointId i = begin; i < end; ++i)
+                setMiniball(view, i, kdi);
+        }, m_threads);
 }
 
 void MiniballFilter::setMiniball(PointView& view, const PointId& i,
@@ -35,11 +35,13 @@
 #include "MortonOrderFilter.hpp"
 
 #include <pdal/EigenUtils.hpp>
+#include <pdal/private/CurveKey.hpp>
+#include <pdal/private/RadixSort.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
-#include <climits>
+#include <cmath>
 #include <iostream>
 #include <limits>
-#include <map>
 
 namespace pdal
 {
@@ -59,41 +61,24 @@ std::string MortonOrderFilter::getName() const { return s_info.name; }
 void MortonOrderFilter::addArgs(ProgramArgs& args)
 {
     args.add("reverse", "Reverse Morton", m_reverse, false);
+    args.add("curve", "Space-filling curve used to order points: 'morton' "
+        "or 'hilbert'", m_curve, "morton");
+    args.add("compact", "Copy the points so that they're stored in curve "
+        "order", m_compact, false);
 }
 
-//This used to be a lambda, but the VS compiler exploded, I guess.
-typedef std::pair<double, double> Coord;
-namespace
-{
-bool less_msb(const int& x, const int& y)
+void MortonOrderFilter::initialize()
 {
-    return x < y && x < (x ^ y);
+    m_curve = Utils::tolower(m_curve);
+    if (m_curve != "morton" && m_curve != "hilbert")
+        throwError("Invalid curve '" + m_curve + "'.  Must be 'morton' or "
+            "'hilbert'.");
+    if (m_reverse && m_curve == "hilbert")
+        throwError("Option 'reverse' can only be used with the Morton curve.");
 }
 
-class CmpZOrder
+namespace
 {
-public:
-    bool operator()(const Coord& c1, const Coord& c2) const
-    {
-        int a[2] = {(int)(c1.first * INT_MAX), (int)(c1.second * INT_MAX)};
-        int b[2] = {(int)(c2.first * INT_MAX), (int)(c2.second * INT_MAX)};
-
-        int j = 0;
-        int x = 0;
-
-        for (int k = 0; k < 2; k++)
-        {
-            int y = a[k] ^ b[k];
-            if (less_msb(x, y))
-            {
-                j = k;
-                x = y;
-            }
-        }
-        return (a[j] - b[j]) < 0;
-    };
-};
-}
 
 class ReverseZOrder
 {
@@ -135,13 +120,34 @@ private:
     }
 };
 
-PointViewSet MortonOrderFilter::reverseMorton(PointViewPtr inView)
+// Compute the sort key of each point in parallel.  The function is called
+// with the X and Y of a point and returns its key.
+template<typename KEY>
+void computeKeys(const PointView& view, SortEntries& entries, KEY key)
 {
-    const int32_t cell = static_cast<int32_t>(sqrt(inView->size()));
+    const point_count_t ChunkSize = 4096;
+
+    entries.resize(view.size());
+    parallelFor(0, view.size(), [&view, &entries, &key](PointId begin,
+        PointId end)
+        {
+            std::vector<double> x(end - begin);
+            std::vector<double> y(end - begin);
+            view.getFieldRange(Dimension::Id::X, begin, end - begin, x.data());
+            view.getFieldRange(Dimension::Id::Y, begin, end - begin, y.data());
+            for (PointId idx = begin; idx < end; ++idx)
+                entries[idx] = SortEntry(key(x[idx - begin], y[idx - begin]),
+                    idx);
+        }, 0, ChunkSize);
+}
+
+void reverseMorton(const PointView& view, SortEntries& entries)
+{
+    const int32_t cell = static_cast<int32_t>(sqrt(view.size()));
 
     // compute range
     BOX2D buffer_bounds;
-    calculateBounds(*inView, buffer_bounds);
+    calculateBounds(view, buffer_bounds);
     const double xrange = buffer_bounds.maxx - buffer_bounds.minx;
     const double yrange = buffer_bounds.maxy - buffer_bounds.miny;
 
@@ -149,84 +155,70 @@ PointViewSet MortonOrderFilter::reverseMorton(PointViewPtr inView)
     const double cell_height = yrange / cell;
 
     // compute reverse morton code for each point
-    std::multimap<uint32_t, PointId> codes;
-    for (PointId idx = 0; idx < inView->size(); idx++)
-    {
-        const double x = inView->getFieldAs<double>(Dimension::Id::X, idx);
-        const int32_t xpos =
-            static_cast<int32_t>(std::floor((x - buffer_bounds.minx) /
-                cell_width));
-
-        const double y = inView->getFieldAs<double>(Dimension::Id::Y, idx);
-        const int32_t ypos =
-            static_cast<int32_t>(std::floor((y - buffer_bounds.miny) /
-                cell_height));
-
-        const uint32_t code = ReverseZOrder::encode_morton(xpos, ypos);
-        const uint32_t reverse = ReverseZOrder::reverse_morton( code );
-
-        codes.insert( std::pair<uint32_t, PointId>(reverse, idx) );
-    }
-
-    // a map is yet order by key so its naturally ordered by lod
-    std::multimap<uint32_t, PointId>::iterator it;
-    PointViewPtr outView = inView->makeNew();
-    for (it = codes.begin(); it != codes.end(); ++it)
-    {
-        outView->appendPoint(*inView, it->second);
-    }
+    computeKeys(view, entries, [&](double x, double y)
+        {
+            const int32_t xpos =
+                static_cast<int32_t>(std::floor((x - buffer_bounds.minx) /
+                    cell_width));
+            const int32_t ypos =
+                static_cast<int32_t>(std::floor((y - buffer_bounds.miny) /
+                    cell_height));
+
+            const uint32_t code = ReverseZOrder::encode_morton(xpos, ypos);
+            return (uint64_t)ReverseZOrder::reverse_morton(code);
+        });
+}
 
-    // build output view
-    PointViewSet viewSet;
-    viewSet.insert(outView);
+void curveOrder(const PointView& view, const std::string& curve,
+    SortEntries& entries)
+{
+    BOX2D bounds;
+    calculateBounds(view, bounds);
 
-    return viewSet;
+    const CurveKey key(bounds, curve == "hilbert" ?
+        CurveKey::Curve::Hilbert : CurveKey::Curve::Morton);
+    computeKeys(view, entries, key);
 }
 
-PointViewSet MortonOrderFilter::morton(PointViewPtr inView)
+} // unnamed namespace
+
+PointViewSet MortonOrderFilter::run(PointViewPtr inView)
 {
     PointViewSet viewSet;
-    if (!inView->size())
-        return viewSet;
-    CmpZOrder compare;
-    std::multimap<Coord, PointId, CmpZOrder> sorted(compare);
-
-    BOX2D buffer_bounds;
-    calculateBounds(*inView, buffer_bounds);
-    double xrange = buffer_bounds.maxx - buffer_bounds.minx;
-    double yrange = buffer_bounds.maxy - buffer_bounds.miny;
 
-    for (PointId idx = 0; idx < inView->size(); idx++)
-    {
-        double xpos = (inView->getFieldAs<double>(Dimension::Id::X, idx) -
-            buffer_bounds.minx) / xrange;
-        double ypos = (inView->getFieldAs<double>(Dimension::Id::Y, idx) -
-            buffer_bounds.miny) / yrange;
-        Coord loc(xpos, ypos);
-        sorted.insert(std::make_pair(loc, idx));
-    }
+    SortEntries entries;
+    if (m_reverse)
+        reverseMorton(*inView, entries);
+    else
+        curveOrder(*inView, m_curve, entries);
+    radixSort(entries);
 
     PointViewPtr outView = inView->makeNew();
-    std::multimap<Coord, PointId, CmpZOrder>::iterator pos;
-    for (pos = sorted.begin(); pos != sorted.end(); ++pos)
+    if (m_compact)
     {
-        outView->appendPoint(*inView, pos->second);
+        // Add new points to the table in curve order and copy the data
+        // of the input points to them, so that neighboring points along the
+        // curve are near each other in memory.
+        outView->addPoints(entries.size());
+        const DimTypeList dims = inView->dimTypes();
+        const size_t pointSize = inView->layout()->pointSize();
+        parallelFor(0, entries.size(), [&](PointId begin, PointId end)
+            {
+                std::vector<char> buf(pointSize);
+                for (PointId idx = begin; idx < end; ++idx)
+                {
+                    inView->getPackedPoint(dims, entries[idx].second,
+                        buf.data());
+                    outView->setPackedPoint(dims, idx, buf.data());
+                }
+            });
     }
+    else
+        for (const SortEntry& e : entries)
+            outView->appendPoint(*inView, e.second);
     viewSet.insert(outView);
 
     return viewSet;
 }
 
-PointViewSet MortonOrderFilter::run(PointViewPtr inView)
-{
-    if ( m_reverse )
-    {
-        return reverseMorton( inView );
-    }
-    else
-    {
-        return morton( inView );
-    }
-}
-
 } // pdal
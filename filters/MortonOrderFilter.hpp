@@ -51,12 +51,12 @@ public:
 
 private:
     virtual void addArgs(ProgramArgs& args);
+    virtual void initialize();
     virtual PointViewSet run(PointViewPtr view);
 
-    PointViewSet reverseMorton(PointViewPtr view);
-    PointViewSet morton(PointViewPtr view);
-
     bool m_reverse = false;
+    std::string m_curve;
+    bool m_compact = false;
 };
 
 } // namespace pdal
@@ -38,6 +38,7 @@
 #include <vector>
 
 #include <pdal/KDIndex.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 namespace pdal
 {
@@ -107,35 +108,37 @@ void NNDistanceFilter::filter(PointView& view)
 {
     using namespace Dimension;
 
-    // Build the 3D KD-tree.
-    KD3Index& index = view.build3dIndex();
-
     // Increment the minimum number of points, as knnSearch will be returning
     // the query point along with the neighbors.
     size_t k = m_k + 1;
 
     // Compute the k-distance for each point. The k-distance is the Euclidean
     // distance to k-th nearest neighbor.
+    KnnGraph graph = view.buildKnnGraph(k);
     log()->get(LogLevel::Debug) << "Computing k-distances...\n";
-    for (PointId idx = 0; idx < view.size(); ++idx)
-    {
-        PointIdList indices(k);
-        std::vector<double> sqr_dists(k);
-        index.knnSearch(idx, k, &indices, &sqr_dists);
-        double val;
-        if (m_mode == Mode::Kth)
-            val = std::sqrt(sqr_dists[k - 1]);
-        else // m_mode == Mode::Average
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
         {
-            val = 0;
-
-            // We start at 1 since index 0 is the test point.
-            for (size_t i = 1; i < k; ++i)
-                val += std::sqrt(sqr_dists[i]);
-            val /= (k - 1);
-        }
-        view.setField(Dimension::Id::NNDistance, idx, val);
-    }
+            for (PointId idx = begin; idx < end; ++idx)
+            {
+                size_t n = graph.count(idx);
+                const double *sqr_dists = graph.distances(idx);
+                double val;
+                if (m_mode == Mode::Kth)
+                    val = std::sqrt(sqr_dists[n - 1]);
+                else // m_mode == Mode::Average
+                {
+                    val = 0;
+
+                    // We start at 1 since index 0 is the test point.  Views
+                    // with fewer than k points have fewer neighbors.
+                    for (size_t i = 1; i < n; ++i)
+                        val += std::sqrt(sqr_dists[i]);
+                    if (n > 1)
+                        val /= (n - 1);
+                }
+                view.setField(Dimension::Id::NNDistance, idx, val);
+            }
+        });
 }
 
 } // namespace pdal
@@ -46,6 +46,7 @@
 #include <pdal/EigenUtils.hpp>
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include <Eigen/Dense>
 
@@ -124,56 +125,67 @@ void NormalFilter::prepared(PointTableRef table)
     ++m_args->m_knn;
 }
 
-void NormalFilter::compute(PointView& view, KD3Index& kdi)
+void NormalFilter::compute(PointView& view, const KnnGraph& graph)
 {
     log()->get(LogLevel::Debug) << "Computing normal vectors\n";
-    for (auto&& p : view)
-    {
-        // Perform eigen decomposition of covariance matrix computed from
-        // neighborhood composed of k-nearest neighbors.
-        PointIdList neighbors = kdi.neighbors(p.pointId(), m_args->m_knn);
-        auto B = computeCovariance(view, neighbors);
-        SelfAdjointEigenSolver<Matrix3d> solver(B);
-        if (solver.info() != Success)
-            throwError("Cannot perform eigen decomposition.");
-
-        // The curvature is computed as the ratio of the first (smallest)
-        // eigenvalue to the sum of all eigenvalues.
-        auto eval = solver.eigenvalues();
-        double sum = eval[0] + eval[1] + eval[2];
-        double curvature = sum ? std::fabs(eval[0] / sum) : 0;
-
-        // The normal is defined by the eigenvector corresponding to the
-        // smallest eigenvalue.
-        Vector3d normal = solver.eigenvectors().col(0);
-
-        if (m_viewpointArg->set())
-        {
-            // If a viewpoint has been specified, orient the normals to face the
-            // viewpoint by taking the dot product of the vector connecting the
-            // point with the viewpoint and the normal. Flip the normal, where
-            // the dot product is negative.
-            double dx = m_args->m_viewpoint.x() - p.getFieldAs<double>(Id::X);
-            double dy = m_args->m_viewpoint.y() - p.getFieldAs<double>(Id::Y);
-            double dz = m_args->m_viewpoint.z() - p.getFieldAs<double>(Id::Z);
-            Vector3d vp(dx, dy, dz);
-            if (vp.dot(normal) < 0)
-                normal *= -1.0;
-        }
-        else if (m_args->m_up)
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
         {
-            // If normals are expected to be upward facing, invert them when the
-            // Z component is negative.
-            if (normal[2] < 0)
-                normal *= -1.0;
-        }
+            PointIdList ids;
+            for (PointId i = begin; i < end; ++i)
+            {
+                PointRef p(view, i);
+                graph.neighbors(i, ids);
+                compute(view, ids, p);
+            }
+        });
+}
 
-        // Set the computed normal and curvature dimensions.
-        p.setField(Id::NormalX, normal[0]);
-        p.setField(Id::NormalY, normal[1]);
-        p.setField(Id::NormalZ, normal[2]);
-        p.setField(Id::Curvature, curvature);
+void NormalFilter::compute(PointView& view, const PointIdList& neighbors,
+    PointRef& p)
+{
+    // Perform eigen decomposition of covariance matrix computed from
+    // neighborhood composed of k-nearest neighbors.
+    auto B = computeCovariance(view, neighbors);
+    SelfAdjointEigenSolver<Matrix3d> solver(B);
+    if (solver.info() != Success)
+        throwError("Cannot perform eigen decomposition.");
+
+    // The curvature is computed as the ratio of the first (smallest)
+    // eigenvalue to the sum of all eigenvalues.
+    auto eval = solver.eigenvalues();
+    double sum = eval[0] + eval[1] + eval[2];
+    double curvature = sum ? std::fabs(eval[0] / sum) : 0;
+
+    // The normal is defined by the eigenvector corresponding to the
+    // smallest eigenvalue.
+    Vector3d normal = solver.eigenvectors().col(0);
+
+    if (m_viewpointArg->set())
+    {
+        // If a viewpoint has been specified, orient the normals to face the
+        // viewpoint by taking the dot product of the vector connecting the
+        // point with the viewpoint and the normal. Flip the normal, where
+        // the dot product is negative.
+        double dx = m_args->m_viewpoint.x() - p.getFieldAs<double>(Id::X);
+        double dy = m_args->m_viewpoint.y() - p.getFieldAs<double>(Id::Y);
+        double dz = m_args->m_viewpoint.z() - p.getFieldAs<double>(Id::Z);
+        Vector3d vp(dx, dy, dz);
+        if (vp.dot(normal) < 0)
+            normal *= -1.0;
     }
+    else if (m_args->m_up)
+    {
+        // If normals are expected to be upward facing, invert them when the
+        // Z component is negative.
+        if (normal[2] < 0)
+            normal *= -1.0;
+    }
+
+    // Set the computed normal and curvature dimensions.
+    p.setField(Id::NormalX, normal[0]);
+    p.setField(Id::NormalY, normal[1]);
+    p.setField(Id::NormalZ, normal[2]);
+    p.setField(Id::Curvature, curvature);
 }
 
 void NormalFilter::update(
@@ -281,7 +293,7 @@ void NormalFilter::filter(PointView& view)
 
     // Compute the normal/curvature and optionally orient toward viewpoint or
     // positive Z.
-    compute(view, kdi);
+    compute(view, view.buildKnnGraph(m_args->m_knn));
 
     // If requested, refine normals through minimum spanning tree propagation.
     if (m_args->m_refine)
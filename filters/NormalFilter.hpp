@@ -43,6 +43,7 @@
 namespace pdal
 {
 
+class KnnGraph;
 class Options;
 class PointLayout;
 class PointView;
@@ -88,7 +89,8 @@ private:
     point_count_t m_count;
     Arg* m_viewpointArg;
 
-    void compute(PointView& view, KD3Index& kdi);
+    void compute(PointView& view, const KnnGraph& graph);
+    void compute(PointView& view, const PointIdList& neighbors, PointRef& p);
     void refine(PointView& view, KD3Index& kdi);
     void
     update(PointView& view, KD3Index& kdi, std::vector<bool> inMST,
@@ -36,6 +36,7 @@
 
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 #include <pdal/util/Utils.hpp>
 
 #include <string>
@@ -83,10 +84,18 @@ Indices OutlierFilter::processRadius(PointViewPtr inView)
 
     PointIdList inliers, outliers;
 
+    std::vector<char> isInlier(np);
+    parallelFor(0, np, [&](PointId begin, PointId end)
+        {
+            NeighborList neighbors;
+            index.batchRadius(begin, end, m_radius, neighbors);
+            for (PointId i = begin; i < end; ++i)
+                isInlier[i] = neighbors.count(i - begin) > size_t(m_minK);
+        });
+
     for (PointId i = 0; i < np; ++i)
     {
-        auto ids = index.radius(i, m_radius);
-        if (ids.size() > size_t(m_minK))
+        if (isInlier[i])
             inliers.push_back(i);
         else
             outliers.push_back(i);
@@ -97,9 +106,6 @@ Indices OutlierFilter::processRadius(PointViewPtr inView)
 
 Indices OutlierFilter::processStatistical(PointViewPtr inView)
 {
-    KD3Index index(*inView);
-    index.build();
-
     point_count_t np = inView->size();
 
     PointIdList inliers, outliers;
@@ -109,21 +115,19 @@ Indices OutlierFilter::processStatistical(PointViewPtr inView)
     // we increase the count by one because the query point itself will
     // be included with a distance of 0
     point_count_t count = m_meanK + 1;
-    PointIdList indices(count);
-    std::vector<double> sqr_dists(count);
-    for (PointId i = 0; i < np; ++i)
-    {
-
-        index.knnSearch(i, count, &indices, &sqr_dists);
-
-        for (size_t j = 1; j < count; ++j)
+    KnnGraph graph = inView->buildKnnGraph(count);
+    parallelFor(0, np, [&](PointId begin, PointId end)
         {
-            double delta = std::sqrt(sqr_dists[j]) - distances[i];
-            distances[i] += (delta / j);
-        }
-        indices.clear(); indices.resize(count);
-        sqr_dists.clear(); sqr_dists.resize(count);
-    }
+            for (PointId i = begin; i < end; ++i)
+            {
+                const double *sqr_dists = graph.distances(i);
+                for (size_t j = 1; j < graph.count(i); ++j)
+                {
+                    double delta = std::sqrt(sqr_dists[j]) - distances[i];
+                    distances[i] += (delta / j);
+                }
+            }
+        });
 
     size_t n(0);
     double M1(0.0);
@@ -42,6 +42,7 @@
 #include <pdal/EigenUtils.hpp>
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include "private/DimRange.hpp"
 #include "private/Segmentation.hpp"
@@ -269,24 +270,28 @@ void PMFFilter::processGround(PointViewPtr view)
     KD2Index& kdi = temp->build2dIndex();
 
     // loop through all cells, and for each NaN, replace with elevation of
-    // nearest neighbor
+    // nearest neighbor.  Columns are filled in parallel.
     std::vector<double> out = ZImin;
-    for (size_t c = 0; c < cols; ++c)
+    parallelFor(0, cols, [&](size_t begin, size_t end)
     {
-        for (size_t r = 0; r < rows; ++r)
+        for (size_t c = begin; c < end; ++c)
         {
-            size_t idx = c * rows + r;
-            if (!std::isnan(out[idx]))
-                continue;
-            double x = bounds.minx + (c + 0.5) * m_args->m_cellSize;
-            double y = bounds.miny + (r + 0.5) * m_args->m_cellSize;
-            int k = 1;
-            PointIdList neighbors(k);
-            std::vector<double> sqr_dists(k);
-            kdi.knnSearch(x, y, k, &neighbors, &sqr_dists);
-            out[idx] = temp->getFieldAs<double>(Dimension::Id::Z, neighbors[0]);
+            for (size_t r = 0; r < rows; ++r)
+            {
+                size_t idx = c * rows + r;
+                if (!std::isnan(out[idx]))
+                    continue;
+                double x = bounds.minx + (c + 0.5) * m_args->m_cellSize;
+                double y = bounds.miny + (r + 0.5) * m_args->m_cellSize;
+                int k = 1;
+                PointIdList neighbors(k);
+                std::vector<double> sqr_dists(k);
+                kdi.knnSearch(x, y, k, &neighbors, &sqr_dists);
+                out[idx] = temp->getFieldAs<double>(Dimension::Id::Z,
+                    neighbors[0]);
+            }
         }
-    }
+    });
 
     ZImin.swap(out);
 
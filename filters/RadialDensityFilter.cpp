@@ -35,6 +35,7 @@
 #include "RadialDensityFilter.hpp"
 
 #include <pdal/KDIndex.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include <string>
 #include <vector>
@@ -79,11 +80,13 @@ void RadialDensityFilter::filter(PointView& view)
     // of the search sphere and recorded as the density.
     log()->get(LogLevel::Debug) << "Computing densities...\n";
     double factor = 1.0 / ((4.0 / 3.0) * 3.14159 * (m_rad * m_rad * m_rad));
-    for (PointId i = 0; i < view.size(); ++i)
-    {
-        PointIdList pts = index.radius(i, m_rad);
-        view.setField(m_rdens, i, pts.size() * factor);
-    }
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
+        {
+            NeighborList neighbors;
+            index.batchRadius(begin, end, m_rad, neighbors);
+            for (PointId i = begin; i < end; ++i)
+                view.setField(m_rdens, i, neighbors.count(i - begin) * factor);
+        });
 }
 
 } // namespace pdal
@@ -39,6 +39,7 @@
 
 #include "private/DimRange.hpp"
 
+#include <algorithm>
 #include <cctype>
 #include <limits>
 #include <map>
@@ -102,6 +103,59 @@ bool RangeFilter::processOne(PointRef& point)
 }
 
 
+// Test a block of points, fetching the values of each dimension at once
+// with 'fetch'.  As in processOne(), ranges of the same dimension are ORed
+// and ranges of different dimensions are ANDed.  On return m_passes[i] is
+// set for each point in the block that passes.
+template<typename FETCH>
+void RangeFilter::evaluate(point_count_t count, FETCH fetch)
+{
+    if (m_values.size() < count)
+    {
+        m_values.resize(count);
+        m_passes.resize(count);
+        m_dimPasses.resize(count);
+    }
+    std::fill(m_passes.begin(), m_passes.begin() + count, 1);
+
+    auto r = m_ranges.begin();
+    while (r != m_ranges.end())
+    {
+        Dimension::Id id = r->m_id;
+        fetch(id, m_values.data());
+        std::fill(m_dimPasses.begin(), m_dimPasses.begin() + count, 0);
+        for (; r != m_ranges.end() && r->m_id == id; ++r)
+            for (point_count_t i = 0; i < count; ++i)
+                if (!m_dimPasses[i])
+                    m_dimPasses[i] = r->valuePasses(m_values[i]);
+        for (point_count_t i = 0; i < count; ++i)
+            m_passes[i] &= m_dimPasses[i];
+    }
+}
+
+
+point_count_t RangeFilter::processBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    point_count_t count = end - begin;
+    PointRef point(table, begin);
+
+    evaluate(count, [&](Dimension::Id id, double *values)
+    {
+        for (point_count_t i = 0; i < count; ++i)
+        {
+            point.setPointId(begin + i);
+            values[i] = point.getFieldAs<double>(id);
+        }
+    });
+
+    for (point_count_t i = 0; i < count; ++i)
+        if (!m_passes[i])
+            table.setSkip(begin + i);
+    return count;
+}
+
+
 PointViewSet RangeFilter::run(PointViewPtr inView)
 {
     PointViewSet viewSet;
@@ -110,12 +164,20 @@ PointViewSet RangeFilter::run(PointViewPtr inView)
 
     PointViewPtr outView = inView->makeNew();
 
-    for (PointId i = 0; i < inView->size(); ++i)
+    const point_count_t BlockSize = 4096;
+    for (PointId begin = 0; begin < inView->size(); begin += BlockSize)
     {
-        PointRef point = inView->point(i);
-        if (processOne(point))
-            outView->appendPoint(*inView, i);
+        point_count_t count = (std::min)(BlockSize, inView->size() - begin);
+        evaluate(count, [&](Dimension::Id id, double *values)
+        {
+            inView->getFieldRange(id, begin, count, values);
+        });
+
+        for (point_count_t i = 0; i < count; ++i)
+            if (m_passes[i])
+                outView->appendPoint(*inView, begin + i);
     }
+    outView->inheritProducts(*inView);
 
     viewSet.insert(outView);
     return viewSet;
@@ -56,12 +56,20 @@ public:
 
 private:
     std::vector<DimRange> m_ranges;
+    std::vector<double> m_values;
+    std::vector<char> m_passes;
+    std::vector<char> m_dimPasses;
 
     virtual void addArgs(ProgramArgs& args);
     virtual void prepared(PointTableRef table);
     virtual bool processOne(PointRef& point);
+    virtual point_count_t processBatch(StreamPointTable& table,
+        PointId begin, PointId end);
     virtual PointViewSet run(PointViewPtr view);
 
+    template<typename FETCH>
+    void evaluate(point_count_t count, FETCH fetch);
+
     RangeFilter& operator=(const RangeFilter&) = delete;
     RangeFilter(const RangeFilter&) = delete;
 };
@@ -41,9 +41,9 @@
 
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include <string>
-#include <thread>
 #include <vector>
 
 namespace pdal
@@ -67,8 +67,8 @@ std::string ReciprocityFilter::getName() const
 void ReciprocityFilter::addArgs(ProgramArgs& args)
 {
     args.add("knn", "k-Nearest neighbors", m_knn, 8);
-    args.add("threads", "Number of threads used to run this filter", m_threads,
-             1);
+    args.add("threads", "Maximum number of threads used to run this filter "
+        "(0 for the shared thread limit)", m_threads, 0);
 }
 
 void ReciprocityFilter::addDimensions(PointLayoutPtr layout)
@@ -81,20 +81,11 @@ void ReciprocityFilter::filter(PointView& view)
 {
     KD3Index& kdi = view.build3dIndex();
 
-    point_count_t nloops = view.size();
-    std::vector<std::thread> threadList(m_threads);
-    for (int t = 0; t < m_threads; t++)
-    {
-        threadList[t] = std::thread(std::bind(
-            [&](const PointId start, const PointId end) {
-                for (PointId i = start; i < end; i++)
-                    setReciprocity(view, i, kdi);
-            },
-            t * nloops / m_threads,
-            (t + 1) == m_threads ? nloops : (t + 1) * nloops / m_threads));
-    }
-    for (auto& t : threadList)
-        t.join();
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
+        {
+            for (PointId i = begin; i < end; ++i)
+                setReciprocity(view, i, kdi);
+        }, m_threads);
 }
 
 void ReciprocityFilter::setReciprocity(PointView& view, const PointId& i,
@@ -196,4 +196,42 @@ bool ReprojectionFilter::processOne(PointRef& point)
     return ok;
 }
 
+
+// Transform all the points in a batch with a single call to the
+// coordinate transformation.  Points that fail to transform are skipped.
+point_count_t ReprojectionFilter::processBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    std::vector<PointId> ids;
+    std::vector<double> xs, ys, zs;
+    std::vector<int> ok;
+
+    PointRef point(table, begin);
+    for (PointId idx = begin; idx < end; ++idx)
+    {
+        if (table.skip(idx))
+            continue;
+        point.setPointId(idx);
+        ids.push_back(idx);
+        xs.push_back(point.getFieldAs<double>(Dimension::Id::X));
+        ys.push_back(point.getFieldAs<double>(Dimension::Id::Y));
+        zs.push_back(point.getFieldAs<double>(Dimension::Id::Z));
+    }
+
+    m_transform->transform(xs, ys, zs, ok);
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (!ok[i])
+        {
+            table.setSkip(ids[i]);
+            continue;
+        }
+        point.setPointId(ids[i]);
+        point.setField(Dimension::Id::X, xs[i]);
+        point.setField(Dimension::Id::Y, ys[i]);
+        point.setField(Dimension::Id::Z, zs[i]);
+    }
+    return end - begin;
+}
+
 } // namespace pdal
@@ -60,6 +60,8 @@ private:
     virtual void initialize();
     virtual PointViewSet run(PointViewPtr view);
     virtual bool processOne(PointRef& point);
+    virtual point_count_t processBatch(StreamPointTable& table,
+        PointId begin, PointId end);
     virtual void spatialReferenceChanged(const SpatialReference& srs);
     virtual void prepared(PointTableRef table);
 
@@ -43,6 +43,7 @@
 #include <pdal/KDIndex.hpp>
 #include <pdal/util/FileUtils.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include "private/DimRange.hpp"
 #include "private/Segmentation.hpp"
@@ -603,34 +604,37 @@ std::vector<double> SMRFilter::knnfill(PointViewPtr view,
 
     // Where the raster has voids (i.e., NaN), we search for that cell's eight
     // nearest neighbors, and fill the void with the average value of the
-    // neighbors.
+    // neighbors.  Columns are filled in parallel.
     std::vector<double> out = cz;
-    for (int c = 0; c < m_cols; ++c)
+    parallelFor(0, (size_t)m_cols, [&](size_t begin, size_t end)
     {
-        for (int r = 0; r < m_rows; ++r)
+        for (int c = (int)begin; c < (int)end; ++c)
         {
-            if (!std::isnan(out[c * m_rows + r]))
-                continue;
-
-            double x = m_bounds.minx + (c + 0.5) * m_args->m_cell;
-            double y = m_bounds.miny + (r + 0.5) * m_args->m_cell;
-            int k = 8;
-            PointIdList neighbors(k);
-            std::vector<double> sqr_dists(k);
-            kdi.knnSearch(x, y, k, &neighbors, &sqr_dists);
-
-            double M1(0.0);
-            size_t j(0);
-            for (auto const& n : neighbors)
+            for (int r = 0; r < m_rows; ++r)
             {
-                j++;
-                double delta = temp->getFieldAs<double>(Id::Z, n) - M1;
-                M1 += (delta / j);
-            }
+                if (!std::isnan(out[c * m_rows + r]))
+                    continue;
+
+                double x = m_bounds.minx + (c + 0.5) * m_args->m_cell;
+                double y = m_bounds.miny + (r + 0.5) * m_args->m_cell;
+                int k = 8;
+                PointIdList neighbors(k);
+                std::vector<double> sqr_dists(k);
+                kdi.knnSearch(x, y, k, &neighbors, &sqr_dists);
+
+                double M1(0.0);
+                size_t j(0);
+                for (auto const& n : neighbors)
+                {
+                    j++;
+                    double delta = temp->getFieldAs<double>(Id::Z, n) - M1;
+                    M1 += (delta / j);
+                }
 
-            out[c * m_rows + r] = M1;
+                out[c * m_rows + r] = M1;
+            }
         }
-    }
+    });
 
     return out;
 }
@@ -661,7 +665,7 @@ std::vector<int> SMRFilter::progressiveFilter(std::vector<double> const& ZImin,
             erodeDiamond(prevErosion, m_rows, m_cols, 1);
         std::vector<double> curOpening =
             dilateDiamond(curErosion, m_rows, m_cols, radius);
-        prevErosion = curErosion;
+        prevErosion.swap(curErosion);
 
         // "An elevation threshold is then calculated, where the value is equal
         // to the supplied slope tolerance parameter multiplied by the product
@@ -671,27 +675,17 @@ std::vector<int> SMRFilter::progressiveFilter(std::vector<double> const& ZImin,
         // "This elevation threshold is applied to the difference of the minimum
         // and the opened surfaces."
 
-        // Need to provide means of diffing two vectors.
-        std::vector<double> diff;
-        std::transform(prevSurface.begin(), prevSurface.end(),
-                       curOpening.begin(), std::back_inserter(diff),
-                       [&](double l, double r) { return std::fabs(l - r); });
-
         // "Any grid cell with a difference value exceeding the calculated
         // elevation threshold for the iteration is then flagged as an OBJ
         // cell."
-        std::vector<int> foo;
-        std::transform(diff.begin(), diff.end(), std::back_inserter(foo),
-                       [threshold](double x) {
-                           return (x > threshold) ? int(1) : int(0);
-                       });
-        std::transform(Obj.begin(), Obj.end(), foo.begin(), Obj.begin(),
-                       [](int a, int b) { return (std::max)(a, b); });
+        for (size_t i = 0; i < Obj.size(); ++i)
+            if (std::fabs(prevSurface[i] - curOpening[i]) > threshold)
+                Obj[i] = 1;
 
         // "The algorithm then proceeds to the next window radius (up to the
         // maximum), and proceeds as above with the last opened surface acting
         // as the minimum surface for the next difference calculation."
-        prevSurface = curOpening;
+        prevSurface.swap(curOpening);
 
         size_t ng = std::count(Obj.begin(), Obj.end(), 1);
         size_t g(Obj.size() - ng);
@@ -34,6 +34,11 @@
 
 #include "SortFilter.hpp"
 
+#include <cstring>
+
+#include <pdal/private/RadixSort.hpp>
+#include <pdal/util/ThreadPool.hpp>
+
 namespace pdal
 {
 
@@ -50,28 +55,117 @@ std::string SortFilter::getName() const { return s_info.name; }
 
 void SortFilter::addArgs(ProgramArgs& args)
 {
-    args.add("dimension", "Dimension on which to sort", m_dimName).
-        setPositional();
-    args.add("order", "Sort order ASC(ending) or DESC(ending)", m_order,
-        SortOrder::ASC);
+    args.add("dimension", "Dimension(s) on which to sort, most significant "
+        "first", m_dimNames).setPositional();
+    args.add("order", "Sort order(s) ASC(ending) or DESC(ending)", m_orders,
+        { SortOrder::ASC });
+}
+
+void SortFilter::initialize()
+{
+    if (m_orders.size() != 1 && m_orders.size() != m_dimNames.size())
+        throwError("Option 'order' must have one value or one value for "
+            "each dimension.");
 }
 
 void SortFilter::prepared(PointTableRef table)
 {
-    m_dim = table.layout()->findDim(m_dimName);
-    if (m_dim == Dimension::Id::Unknown)
-        throwError("Dimension '" + m_dimName + "' not found.");
+    m_dims.clear();
+    for (const std::string& name : m_dimNames)
+    {
+        Dimension::Id dim = table.layout()->findDim(name);
+        if (dim == Dimension::Id::Unknown)
+            throwError("Dimension '" + name + "' not found.");
+        m_dims.push_back(dim);
+    }
+}
+
+namespace
+{
+
+const uint64_t SignBit = (uint64_t)1 << 63;
+
+// Map a floating-point value to an unsigned key with the same order.
+uint64_t floatKey(double d)
+{
+    // Make -0 equal to 0.
+    if (d == 0)
+        d = 0;
+
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return (bits & SignBit) ? ~bits : (bits | SignBit);
 }
 
+// Extract the sort key of each point for a dimension in parallel.  Keys are
+// unsigned integers whose order is the sort order of the dimension values.
+void extractKeys(const PointView& view, Dimension::Id dim, SortOrder order,
+    std::vector<uint64_t>& keys)
+{
+    const point_count_t ChunkSize = 65536;
+    const Dimension::BaseType base =
+        Dimension::base(view.layout()->dimType(dim));
+
+    keys.resize(view.size());
+    parallelFor(0, view.size(), [&](PointId begin, PointId end)
+        {
+            const point_count_t count = end - begin;
+            uint64_t *out = keys.data() + begin;
+            if (base == Dimension::BaseType::Floating)
+            {
+                std::vector<double> vals(count);
+                view.getFieldRange(dim, begin, count, vals.data());
+                for (PointId i = 0; i < count; ++i)
+                    out[i] = floatKey(vals[i]);
+            }
+            else if (base == Dimension::BaseType::Signed)
+            {
+                std::vector<int64_t> vals(count);
+                view.getFieldRange(dim, begin, count, vals.data());
+                for (PointId i = 0; i < count; ++i)
+                    out[i] = (uint64_t)vals[i] ^ SignBit;
+            }
+            else
+                view.getFieldRange(dim, begin, count, out);
+            if (order == SortOrder::DESC)
+                for (PointId i = 0; i < count; ++i)
+                    out[i] = ~out[i];
+        }, 0, ChunkSize);
+}
+
+} // unnamed namespace
+
 void SortFilter::filter(PointView& view)
 {
-    auto cmp = [this](const PointRef& p1, const PointRef& p2)
+    const point_count_t ChunkSize = 65536;
+
+    SortEntries entries(view.size());
+    for (PointId idx = 0; idx < view.size(); ++idx)
+        entries[idx].second = idx;
+
+    // Sort on the least significant dimension first.  The sort is stable,
+    // so each pass keeps the order of the previous passes among points
+    // with equal keys.
+    std::vector<uint64_t> keys;
+    for (size_t i = m_dims.size(); i-- > 0;)
     {
-        bool result = p1.compare(m_dim, p2);
-        return (m_order == SortOrder::ASC) ? result : !result;
-    };
+        SortOrder order = m_orders.size() == 1 ? m_orders[0] : m_orders[i];
+        extractKeys(view, m_dims[i], order, keys);
+        parallelFor(0, entries.size(), [&entries, &keys](PointId begin,
+            PointId end)
+            {
+                for (PointId idx = begin; idx < end; ++idx)
+                    entries[idx].first = keys[entries[idx].second];
+            }, 0, ChunkSize);
+        radixSort(entries);
+    }
+    keys = std::vector<uint64_t>();
 
-    std::stable_sort(view.begin(), view.end(), cmp);
+    std::vector<PointId> ids(entries.size());
+    for (PointId idx = 0; idx < entries.size(); ++idx)
+        ids[idx] = entries[idx].second;
+    entries = SortEntries();
+    view.reorder(ids);
 }
 
 std::istream& operator >> (std::istream& in, SortOrder& order)
@@ -95,8 +189,10 @@ std::ostream& operator<<(std::ostream& out, const SortOrder& order)
     {
     case SortOrder::ASC:
         out << "ASC";
+        break;
     case SortOrder::DESC:
         out << "DESC";
+        break;
     }
     return out;
 }
@@ -59,15 +59,16 @@ public:
     std::string getName() const;
 
 private:
-    // Dimension on which to sort.
-    Dimension::Id m_dim;
-    // Dimension name.
-    std::string m_dimName;
+    // Dimensions on which to sort, most significant first.
+    std::vector<Dimension::Id> m_dims;
+    // Dimension names.
+    StringList m_dimNames;
 
-    // Sort order.
-    SortOrder m_order;
+    // Sort order of each dimension.  A single order applies to all.
+    std::vector<SortOrder> m_orders;
 
     virtual void addArgs(ProgramArgs& args);
+    virtual void initialize();
     virtual void prepared(PointTableRef table);
     virtual void filter(PointView& view);
 
@@ -147,11 +147,19 @@ bool StatsFilter::processOne(PointRef& point)
 
 void StatsFilter::filter(PointView& view)
 {
-    PointRef point(view, 0);
-    for (PointId idx = 0; idx < view.size(); ++idx)
+    // Fetch the values of each dimension a block at a time.
+    const point_count_t BlockSize = 4096;
+    std::vector<double> values((std::min)(BlockSize, view.size()));
+    for (PointId begin = 0; begin < view.size(); begin += BlockSize)
     {
-        point.setPointId(idx);
-        processOne(point);
+        point_count_t count = (std::min)(BlockSize, view.size() - begin);
+        for (auto p = m_stats.begin(); p != m_stats.end(); ++p)
+        {
+            Summary& c = p->second;
+            view.getFieldRange(p->first, begin, count, values.data());
+            for (point_count_t i = 0; i < count; ++i)
+                c.insert(values[i]);
+        }
     }
 }
 
@@ -0,0 +1,468 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include "TiledFilter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#include <nlohmann/json.hpp>
+
+#include <pdal/PDALUtils.hpp>
+#include <pdal/StageFactory.hpp>
+#include <pdal/StageWrapper.hpp>
+#include <pdal/util/FileUtils.hpp>
+#include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
+#include <pdal/util/Utils.hpp>
+
+namespace pdal
+{
+
+static StaticPluginInfo const s_info
+{
+    "filters.tiled",
+    "Run a filter on buffered tiles of the input to limit memory use.",
+    "http://pdal.io/stages/filters.tiled.html"
+};
+
+CREATE_STATIC_STAGE(TiledFilter, s_info)
+
+namespace
+{
+
+// Point table over the points of a tile, loaded from the tile's temporary
+// file.  The layout is shared with the table of the pipeline.
+class TileTable : public SimplePointTable
+{
+public:
+    TileTable(PointLayout& layout, std::vector<char>& data) :
+        SimplePointTable(layout), m_numPoints(0)
+    { m_data.swap(data); }
+
+    virtual bool supportsView() const
+        { return true; }
+
+protected:
+    // Points are added over the loaded data, so a view that adds all
+    // of the table's points refers to the points of the tile.
+    virtual PointId addPoint()
+    {
+        if (pointsToBytes(m_numPoints + 1) > m_data.size())
+            m_data.resize(pointsToBytes(m_numPoints + 1));
+        return m_numPoints++;
+    }
+
+    virtual char *getPoint(PointId idx)
+        { return m_data.data() + pointsToBytes(idx); }
+
+private:
+    std::vector<char> m_data;
+    point_count_t m_numPoints;
+};
+
+} // unnamed namespace
+
+
+TiledFilter::TiledFilter() : m_factory(new StageFactory), m_buffered(0),
+    m_flushing(false), m_outPos(0)
+{}
+
+
+TiledFilter::~TiledFilter()
+{
+    cleanup();
+}
+
+
+std::string TiledFilter::getName() const { return s_info.name; }
+
+
+void TiledFilter::addArgs(ProgramArgs& args)
+{
+    args.add("filter", "Filter to run on each tile: a filter name or a JSON "
+        "object with the filter type and options", m_filter).setPositional();
+    args.add("length", "Edge length of tile", m_length, 1000.0);
+    args.add("buffer", "Size of buffer (overlap) of neighboring points to "
+        "include around each tile", m_buffer, 0.0);
+    args.add("origin_x", "X origin for a tile", m_xOrigin,
+        std::numeric_limits<double>::quiet_NaN());
+    args.add("origin_y", "Y origin for a tile", m_yOrigin,
+        std::numeric_limits<double>::quiet_NaN());
+    args.add("threads", "Maximum number of tiles to filter at once "
+        "(0 for the shared thread limit)", m_threads, 0);
+    args.add("spill_count", "Number of points held in memory before "
+        "they're written to temporary tile files", m_spillCount,
+        (point_count_t)10000000);
+    args.add("temp_dir", "Directory for temporary tile files", m_tempDir);
+}
+
+
+void TiledFilter::initialize()
+{
+    if (m_length <= 0)
+        throwError("Option 'length' must be greater than 0.");
+    if (m_buffer < 0 || m_buffer >= m_length)
+        throwError("Option 'buffer' must be at least 0 and less than "
+            "'length'.");
+    if (m_threads < 0)
+        throwError("Option 'threads' must not be negative.");
+    if (m_spillCount == 0)
+        throwError("Option 'spill_count' must be greater than 0.");
+
+    // The filter is given by name or as a JSON object like a stage in a
+    // pipeline.
+    std::string spec(m_filter);
+    Utils::trim(spec);
+    NL::json filterSpec;
+    if (spec.size() && spec.front() == '{')
+    {
+        try
+        {
+            filterSpec = NL::json::parse(spec);
+        }
+        catch (NL::json::exception& err)
+        {
+            throwError("Unable to parse option 'filter': " +
+                std::string(err.what()));
+        }
+    }
+    else
+        filterSpec = NL::json::object({ { "type", spec } });
+
+    auto ti = filterSpec.find("type");
+    if (ti == filterSpec.end() || !ti->is_string() ||
+            ti->get<std::string>().empty())
+        throwError("Option 'filter' must be a filter name or a JSON object "
+            "with a 'type' member naming the filter.");
+    m_filterType = ti->get<std::string>();
+    m_filterOptions = Options();
+    for (auto& it : filterSpec.items())
+    {
+        if (it.key() == "type")
+            continue;
+        const NL::json& val = it.value();
+        m_filterOptions.add(it.key(),
+            val.is_string() ? val.get<std::string>() : val.dump());
+    }
+}
+
+
+void TiledFilter::prepared(PointTableRef table)
+{
+    // Each tile that is filtered at once gets its own instance of the
+    // filter, as filters keep state while they run.
+    size_t threads = m_threads ? (size_t)m_threads :
+        ThreadPool::threadLimit();
+    for (Filter *f : m_filters)
+        m_factory->destroyStage(f);
+    m_filters.clear();
+    for (size_t i = 0; i < threads; ++i)
+    {
+        Stage *s = m_factory->createStage(m_filterType);
+        if (!s)
+            throwError("Unable to create stage '" + m_filterType + "'.");
+        Filter *f = dynamic_cast<Filter *>(s);
+        if (!f)
+            throwError("Stage '" + m_filterType + "' is not a filter.");
+        f->setLog(log());
+        f->setOptions(m_filterOptions);
+        f->prepare(table);
+        m_filters.push_back(f);
+    }
+}
+
+
+void TiledFilter::ready(PointTableRef table)
+{
+    m_layout = table.layout();
+
+    // Tile data is kept in the order of the dimensions in a point so
+    // that loaded tiles can be used as table storage.
+    m_dims = m_layout->dimTypes();
+    std::sort(m_dims.begin(), m_dims.end(),
+        [this](const DimType& d1, const DimType& d2)
+        {
+            return m_layout->dimOffset(d1.m_id) < m_layout->dimOffset(d2.m_id);
+        });
+    m_point.resize(m_layout->pointSize());
+    m_flushing = false;
+}
+
+
+void TiledFilter::spatialReferenceChanged(const SpatialReference& srs)
+{
+    m_srs = srs;
+}
+
+
+TiledFilter::Coord TiledFilter::tileOf(double x, double y) const
+{
+    return Coord((int)std::floor((x - m_xOrigin) / m_length),
+        (int)std::floor((y - m_yOrigin) / m_length));
+}
+
+
+bool TiledFilter::bufferContains(const Coord& c, double x, double y) const
+{
+    double minx = m_xOrigin + c.first * m_length - m_buffer;
+    double miny = m_yOrigin + c.second * m_length - m_buffer;
+    double maxx = minx + m_length + 2 * m_buffer;
+    double maxy = miny + m_length + 2 * m_buffer;
+
+    return x >= minx && x < maxx && y >= miny && y < maxy;
+}
+
+
+// Add a point to the tile it falls in and to the buffers of neighboring
+// tiles.  The buffer is less than the tile length, so only adjacent tiles
+// need to be checked.
+bool TiledFilter::processOne(PointRef& point)
+{
+    double x = point.getFieldAs<double>(Dimension::Id::X);
+    double y = point.getFieldAs<double>(Dimension::Id::Y);
+    if (std::isnan(m_xOrigin))
+        m_xOrigin = x;
+    if (std::isnan(m_yOrigin))
+        m_yOrigin = y;
+
+    point.getPackedData(m_dims, m_point.data());
+    Coord c = tileOf(x, y);
+    addToTile(c, m_point.data(), true);
+    if (m_buffer > 0)
+        for (int i = c.first - 1; i <= c.first + 1; ++i)
+            for (int j = c.second - 1; j <= c.second + 1; ++j)
+            {
+                Coord n(i, j);
+                if (n != c && bufferContains(n, x, y))
+                    addToTile(n, m_point.data(), false);
+            }
+
+    // Points are passed on when they're flushed.
+    return false;
+}
+
+
+void TiledFilter::addToTile(const Coord& c, const char *buf, bool core)
+{
+    Tile& tile = m_tiles[c];
+    tile.buf.insert(tile.buf.end(), buf, buf + m_point.size());
+    tile.count++;
+    if (core)
+        tile.coreCount++;
+    if (++m_buffered >= m_spillCount)
+        spill();
+}
+
+
+// Append the points held in memory to the temporary files of their tiles.
+void TiledFilter::spill()
+{
+    if (m_dir.empty())
+    {
+        m_dir = Utils::createTempDirectory(m_tempDir, "pdal_tiled_");
+        if (m_dir.empty())
+            throwError("Unable to create temporary directory.");
+    }
+
+    for (auto& tp : m_tiles)
+    {
+        Tile& tile = tp.second;
+        if (tile.buf.empty())
+            continue;
+        if (tile.filename.empty())
+            tile.filename = m_dir + "/" + std::to_string(tp.first.first) +
+                "_" + std::to_string(tp.first.second) + ".tile";
+        std::ofstream out(tile.filename,
+            std::ios::binary | std::ios::app | std::ios::out);
+        out.write(tile.buf.data(), tile.buf.size());
+        if (!out)
+            throwError("Unable to write temporary tile file '" +
+                tile.filename + "'.");
+        std::vector<char>().swap(tile.buf);
+    }
+    m_buffered = 0;
+}
+
+
+// Filter the next group of tiles, one tile for each instance of the filter,
+// and collect the points in the cores of the tiles.  Returns false when
+// there are no more tiles.
+bool TiledFilter::processTiles()
+{
+    m_out.clear();
+    m_outPos = 0;
+
+    // Tiles with only buffer points have no points to pass on.
+    std::vector<TileMap::iterator> group;
+    while (m_nextTile != m_tiles.end() && group.size() < m_filters.size())
+    {
+        auto ti = m_nextTile++;
+        if (ti->second.coreCount)
+            group.push_back(ti);
+        else
+        {
+            if (ti->second.filename.size())
+                FileUtils::deleteFile(ti->second.filename);
+            m_tiles.erase(ti);
+        }
+    }
+    if (group.empty())
+        return false;
+
+    std::vector<std::vector<char>> outs(group.size());
+    parallelFor(0, group.size(), [this, &group, &outs](size_t begin,
+        size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                processTile(*m_filters[i], group[i]->first, group[i]->second,
+                    outs[i]);
+        }, group.size(), 1);
+    for (auto& out : outs)
+        m_out.insert(m_out.end(), out.begin(), out.end());
+    for (auto& ti : group)
+        m_tiles.erase(ti);
+    return true;
+}
+
+
+void TiledFilter::processTile(Filter& filter, const Coord& c, Tile& tile,
+    std::vector<char>& out)
+{
+    std::vector<char> data;
+    if (tile.filename.size())
+    {
+        std::ifstream in(tile.filename, std::ios::binary | std::ios::in);
+        data.assign(std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>());
+        if (in.bad())
+            throwError("Unable to read temporary tile file '" +
+                tile.filename + "'.");
+        in.close();
+        FileUtils::deleteFile(tile.filename);
+    }
+    data.insert(data.end(), tile.buf.begin(), tile.buf.end());
+    std::vector<char>().swap(tile.buf);
+
+    TileTable table(*m_layout, data);
+    PointViewPtr view(new PointView(table, m_srs));
+    view->addPoints(tile.count);
+
+    FilterWrapper::ready(filter, table);
+    PointViewSet views = FilterWrapper::run(filter, view);
+    FilterWrapper::done(filter, table);
+
+    for (const PointViewPtr& v : views)
+        for (PointId idx = 0; idx < v->size(); ++idx)
+        {
+            double x = v->getFieldAs<double>(Dimension::Id::X, idx);
+            double y = v->getFieldAs<double>(Dimension::Id::Y, idx);
+            if (tileOf(x, y) != c)
+                continue;
+            size_t pos = out.size();
+            out.resize(pos + m_point.size());
+            v->getPackedPoint(m_dims, idx, out.data() + pos);
+        }
+}
+
+
+point_count_t TiledFilter::flushBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    if (!m_flushing)
+    {
+        m_nextTile = m_tiles.begin();
+        m_flushing = true;
+    }
+
+    PointRef point(table, begin);
+    PointId idx = begin;
+    while (idx < end)
+    {
+        if (m_outPos == m_out.size())
+        {
+            if (!processTiles())
+                break;
+            continue;
+        }
+        point.setPointId(idx++);
+        point.setPackedData(m_dims, m_out.data() + m_outPos);
+        m_outPos += m_point.size();
+    }
+    return idx - begin;
+}
+
+
+PointViewSet TiledFilter::run(PointViewPtr view)
+{
+    m_srs = view->spatialReference();
+    PointRef point(*view, 0);
+    for (PointId idx = 0; idx < view->size(); ++idx)
+    {
+        point.setPointId(idx);
+        processOne(point);
+    }
+
+    PointViewPtr outView = view->makeNew();
+    m_nextTile = m_tiles.begin();
+    while (processTiles())
+        for (size_t pos = 0; pos < m_out.size(); pos += m_point.size())
+            outView->setPackedPoint(m_dims, outView->size(),
+                m_out.data() + pos);
+    cleanup();
+
+    PointViewSet viewSet;
+    viewSet.insert(outView);
+    return viewSet;
+}
+
+
+void TiledFilter::done(PointTableRef /*table*/)
+{
+    cleanup();
+}
+
+
+void TiledFilter::cleanup()
+{
+    m_tiles.clear();
+    m_buffered = 0;
+    std::vector<char>().swap(m_out);
+    m_outPos = 0;
+    if (m_dir.size())
+    {
+        FileUtils::deleteDirectory(m_dir);
+        m_dir.clear();
+    }
+}
+
+} // namespace pdal
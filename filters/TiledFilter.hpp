@@ -0,0 +1,121 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#pragma once
+
+#include <pdal/Filter.hpp>
+#include <pdal/Streamable.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pdal
+{
+
+class StageFactory;
+
+// Runs a filter that needs all points in memory (normal, outlier, etc.) on
+// square tiles of the input, each with a buffer of neighboring points.
+// Points are written to temporary files per tile as they arrive, so only
+// the tiles being filtered need to be held in memory.  Only the points in
+// the core of each tile are passed on.
+class PDAL_DLL TiledFilter : public Filter, public Streamable
+{
+public:
+    TiledFilter();
+    ~TiledFilter();
+    TiledFilter& operator=(const TiledFilter&) = delete;
+    TiledFilter(const TiledFilter&) = delete;
+
+    std::string getName() const;
+
+private:
+    typedef std::pair<int, int> Coord;
+    struct Tile
+    {
+        std::string filename;
+        std::vector<char> buf;
+        point_count_t count;
+        point_count_t coreCount;
+
+        Tile() : count(0), coreCount(0)
+        {}
+    };
+    typedef std::map<Coord, Tile> TileMap;
+
+    virtual void addArgs(ProgramArgs& args);
+    virtual void initialize();
+    virtual void prepared(PointTableRef table);
+    virtual void ready(PointTableRef table);
+    virtual void spatialReferenceChanged(const SpatialReference& srs);
+    virtual bool processOne(PointRef& point);
+    virtual point_count_t flushBatch(StreamPointTable& table,
+        PointId begin, PointId end);
+    virtual PointViewSet run(PointViewPtr view);
+    virtual void done(PointTableRef table);
+
+    Coord tileOf(double x, double y) const;
+    bool bufferContains(const Coord& c, double x, double y) const;
+    void addToTile(const Coord& c, const char *buf, bool core);
+    void spill();
+    bool processTiles();
+    void processTile(Filter& filter, const Coord& c, Tile& tile,
+        std::vector<char>& out);
+    void cleanup();
+
+    std::string m_filter;
+    std::string m_filterType;
+    Options m_filterOptions;
+    double m_length;
+    double m_buffer;
+    double m_xOrigin;
+    double m_yOrigin;
+    int m_threads;
+    point_count_t m_spillCount;
+    std::string m_tempDir;
+
+    std::unique_ptr<StageFactory> m_factory;
+    std::vector<Filter *> m_filters;
+    PointLayoutPtr m_layout;
+    DimTypeList m_dims;
+    std::vector<char> m_point;
+    SpatialReference m_srs;
+    std::string m_dir;
+    TileMap m_tiles;
+    TileMap::iterator m_nextTile;
+    point_count_t m_buffered;
+    bool m_flushing;
+    std::vector<char> m_out;
+    size_t m_outPos;
+};
+
+} // namespace pdal
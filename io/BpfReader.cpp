@@ -38,6 +38,7 @@
 
 #include <pdal/Options.hpp>
 #include <pdal/pdal_features.hpp>
+#include <pdal/util/Extractor.hpp>
 
 #ifdef PDAL_HAVE_ZLIB
 #include <zlib.h>
@@ -266,13 +267,16 @@ bool BpfReader::readPolarData()
 }
 
 
-void BpfReader::ready(PointTableRef)
+void BpfReader::ready(PointTableRef table)
 {
+    table.reserve((std::min)(numPoints(), m_count));
     m_istreamPtr = Utils::openFile(m_filename);
     m_stream = ILeStream(m_istreamPtr);
     m_stream.seek(m_header.m_len);
     m_index = 0;
     m_start = m_stream.position();
+    m_pointData = nullptr;
+    m_pointDataSize = 0;
 #ifdef PDAL_HAVE_ZLIB
     if (m_header.m_compression)
     {
@@ -284,19 +288,41 @@ void BpfReader::ready(PointTableRef)
             bytesRead = readBlock(m_deflateBuf, index);
             index += bytesRead;
         } while (bytesRead > 0 && index < m_deflateBuf.size());
-        m_charbuf.initialize(m_deflateBuf.data(), m_deflateBuf.size(), m_start);
-        m_stream.pushStream(new std::istream(&m_charbuf));
+        m_pointData = m_deflateBuf.data();
+        m_pointDataSize = m_deflateBuf.size();
     }
 #endif // PDAL_HAVE_ZLIB
+    if (!m_header.m_compression)
+    {
+        m_map = FileUtils::mapFile(m_filename);
+        if (m_map.addr() && m_map.size() > (uintmax_t)m_start)
+        {
+            m_pointData = (char *)m_map.addr() + m_start;
+            m_pointDataSize = m_map.size() - m_start;
+        }
+    }
+
+    // Read point data from memory rather than the file when we can.
+    if (m_pointData)
+    {
+        m_charbuf.initialize(m_pointData, m_pointDataSize, m_start);
+        m_stream.pushStream(new std::istream(&m_charbuf));
+    }
 }
 
 
 void BpfReader::done(PointTableRef)
 {
+    for (auto& stream : m_streams)
+        delete stream->popStream();
+    m_streams.clear();
+    m_charbufs.clear();
     if (auto s = m_stream.popStream())
         delete s;
     m_stream.close();
     Utils::closeFile(m_istreamPtr);
+    m_map = FileUtils::unmapFile(m_map);
+    m_pointData = nullptr;
 }
 
 
@@ -377,13 +403,25 @@ point_count_t BpfReader::readPointMajor(PointViewPtr view, point_count_t count)
     PointId idx = m_index;
     point_count_t numRead = 0;
     seekPointMajor(idx);
+
+    // When the point data is in memory, parse it in place.
+    const size_t offset = idx * sizeof(float) * m_dims.size();
+    const size_t size = (std::min)(count, numPoints() - idx) *
+        sizeof(float) * m_dims.size();
+    std::unique_ptr<LeExtractor> extractor;
+    if (m_pointData && offset + size <= m_pointDataSize)
+        extractor.reset(new LeExtractor(m_pointData + offset, size));
+
     while (numRead < count && idx < numPoints())
     {
         for (size_t d = 0; d < m_dims.size(); ++d)
         {
             float f;
 
-            m_stream >> f;
+            if (extractor)
+                *extractor >> f;
+            else
+                m_stream >> f;
             view->setField(m_dims[d].m_id, nextId, f + m_dims[d].m_offset);
         }
 
@@ -409,15 +447,9 @@ point_count_t BpfReader::readPointMajor(PointViewPtr view, point_count_t count)
 
 BpfReader::~BpfReader()
 {
-#ifdef PDAL_HAVE_ZLIB
-    if (m_header.m_compression)
-    {
-        for( auto& stream: m_streams )
-        {
-            delete stream->popStream();
-        }
-    }
-#endif
+    for (auto& stream : m_streams)
+        delete stream->popStream();
+    FileUtils::unmapFile(m_map);
 }
 
 void BpfReader::readDimMajor(PointRef& point)
@@ -431,17 +463,15 @@ void BpfReader::readDimMajor(PointRef& point)
             m_streams.emplace_back(new ILeStream());
             m_streams.back()->open(m_filename);
 
-#ifdef PDAL_HAVE_ZLIB
-            if (m_header.m_compression)
+            if (m_pointData)
             {
                 m_charbufs.emplace_back(new Charbuf());
                 m_charbufs.back()->initialize(
-                        m_deflateBuf.data(), m_deflateBuf.size(), m_start);
+                        m_pointData, m_pointDataSize, m_start);
 
                 m_streams.back()->pushStream(
                         new std::istream(m_charbufs.back().get()));
             }
-#endif // PDAL_HAVE_ZLIB
 
             m_streams.back()->seek(m_start + offset);
         }
@@ -476,44 +506,71 @@ void BpfReader::readDimMajor(PointRef& point)
 
 point_count_t BpfReader::readDimMajor(PointViewPtr data, point_count_t count)
 {
-    PointId idx(0);
     PointId startId = data->size();
-    point_count_t numRead = 0;
+    point_count_t numRead = (std::min)(count, numPoints() - m_index);
+
+    // Data for each dimension is contiguous, so read it into a buffer and
+    // set all the values at once.
+    std::vector<double> values(numRead);
     for (size_t d = 0; d < m_dims.size(); ++d)
     {
-        idx = m_index;
-        PointId nextId = startId;
-        numRead = 0;
-        seekDimMajor(d, idx);
-        for (; numRead < count && idx < numPoints(); idx++, numRead++, nextId++)
+        // When the point data is in memory, parse it in place.
+        const size_t offset = sizeof(float) * (d * numPoints() + m_index);
+        const size_t size = sizeof(float) * numRead;
+        if (m_pointData && offset + size <= m_pointDataSize)
         {
-            float f;
+            LeExtractor in(m_pointData + offset, size);
+            for (point_count_t i = 0; i < numRead; ++i)
+            {
+                float f;
 
-            m_stream >> f;
-            data->setField(m_dims[d].m_id, nextId, f + m_dims[d].m_offset);
+                in >> f;
+                values[i] = f + m_dims[d].m_offset;
+            }
         }
-    }
-    m_index = idx;
-
-    // Transformation only applies to X, Y and Z
-    for (PointId idx = startId; idx < data->size(); idx++)
-    {
-        double x = data->getFieldAs<double>(Dimension::Id::X, idx);
-        double y = data->getFieldAs<double>(Dimension::Id::Y, idx);
-        double z = data->getFieldAs<double>(Dimension::Id::Z, idx);
-        m_header.m_xform.apply(x, y, z);
-        data->setField(Dimension::Id::X, idx, x);
-        data->setField(Dimension::Id::Y, idx, y);
-        data->setField(Dimension::Id::Z, idx, z);
+        else
+        {
+            seekDimMajor(d, m_index);
+            for (point_count_t i = 0; i < numRead; ++i)
+            {
+                float f;
 
-        if (m_cb)
-            m_cb(*data, idx);
+                m_stream >> f;
+                values[i] = f + m_dims[d].m_offset;
+            }
+        }
+        data->setFieldRange(m_dims[d].m_id, startId, numRead, values.data());
     }
+    m_index += numRead;
 
+    transform(*data, startId, numRead);
     return numRead;
 }
 
 
+// Transformation only applies to X, Y and Z.  Callbacks are invoked once
+// the points are complete.
+void BpfReader::transform(PointView& view, PointId startId,
+    point_count_t count)
+{
+    std::vector<double> xs(count);
+    std::vector<double> ys(count);
+    std::vector<double> zs(count);
+    view.getFieldRange(Dimension::Id::X, startId, count, xs.data());
+    view.getFieldRange(Dimension::Id::Y, startId, count, ys.data());
+    view.getFieldRange(Dimension::Id::Z, startId, count, zs.data());
+    for (point_count_t i = 0; i < count; ++i)
+        m_header.m_xform.apply(xs[i], ys[i], zs[i]);
+    view.setFieldRange(Dimension::Id::X, startId, count, xs.data());
+    view.setFieldRange(Dimension::Id::Y, startId, count, ys.data());
+    view.setFieldRange(Dimension::Id::Z, startId, count, zs.data());
+
+    if (m_cb)
+        for (PointId idx = startId; idx < startId + count; idx++)
+            m_cb(view, idx);
+}
+
+
 void BpfReader::readByteMajor(PointRef& point)
 {
     // We need a temp buffer for the point data
@@ -568,6 +625,7 @@ point_count_t BpfReader::readByteMajor(PointViewPtr data, point_count_t count)
     };
     std::unique_ptr<union uu[]> uArr(
         new uu[(std::min)(count, numPoints() - m_index)]);
+    std::vector<float> values((std::min)(count, numPoints() - m_index));
 
     for (size_t d = 0; d < m_dims.size(); ++d)
     {
@@ -575,11 +633,9 @@ point_count_t BpfReader::readByteMajor(PointViewPtr data, point_count_t count)
         {
             idx = m_index;
             numRead = 0;
-            PointId nextId = startId;
             seekByteMajor(d, b, idx);
 
-            for (;numRead < count && idx < numPoints();
-                idx++, numRead++, nextId++)
+            for (;numRead < count && idx < numPoints(); idx++, numRead++)
             {
                 union uu& u = *(uArr.get() + numRead);
 
@@ -589,30 +645,15 @@ point_count_t BpfReader::readByteMajor(PointViewPtr data, point_count_t count)
                 m_stream >> u8;
                 u.u32 |= ((uint32_t)u8 << (b * CHAR_BIT));
                 if (b == 3)
-                {
-                    u.f += static_cast<float>(m_dims[d].m_offset);
-                    data->setField(m_dims[d].m_id, nextId, u.f);
-                }
+                    values[numRead] =
+                        u.f + static_cast<float>(m_dims[d].m_offset);
             }
         }
+        data->setFieldRange(m_dims[d].m_id, startId, numRead, values.data());
     }
     m_index = idx;
 
-    // Transformation only applies to X, Y and Z
-    for (PointId idx = startId; idx < data->size(); idx++)
-    {
-        double x = data->getFieldAs<double>(Dimension::Id::X, idx);
-        double y = data->getFieldAs<double>(Dimension::Id::Y, idx);
-        double z = data->getFieldAs<double>(Dimension::Id::Z, idx);
-        m_header.m_xform.apply(x, y, z);
-        data->setField(Dimension::Id::X, idx, x);
-        data->setField(Dimension::Id::Y, idx, y);
-        data->setField(Dimension::Id::Z, idx, z);
-
-        if (m_cb)
-            m_cb(*data, idx);
-    }
-
+    transform(*data, startId, numRead);
     return numRead;
 }
 
@@ -42,6 +42,7 @@
 #include <pdal/Reader.hpp>
 #include <pdal/Streamable.hpp>
 #include <pdal/util/Charbuf.hpp>
+#include <pdal/util/FileUtils.hpp>
 #include <pdal/util/IStream.hpp>
 #include <pdal/pdal_export.hpp>
 
@@ -77,8 +78,15 @@ private:
     point_count_t m_index;
     /// Buffer for deflated data.
     std::vector<char> m_deflateBuf;
-    /// Streambuf for deflated data.
+    /// Streambuf for point data held in memory.
     Charbuf m_charbuf;
+    /// Mapping of an uncompressed file.
+    FileUtils::MapContext m_map;
+    /// Point data in memory (inflated or mapped), or nullptr if points
+    /// are read from the file.
+    char *m_pointData;
+    /// Size of the point data in memory.
+    size_t m_pointDataSize;
 
     // For dimension-major point-at-a-time usage.
     std::vector<std::unique_ptr<ILeStream>> m_streams;
@@ -102,6 +110,7 @@ private:
     point_count_t readDimMajor(PointViewPtr data, point_count_t count);
     void readByteMajor(PointRef& point);
     point_count_t readByteMajor(PointViewPtr data, point_count_t count);
+    void transform(PointView& view, PointId startId, point_count_t count);
     size_t readBlock(std::vector<char>& outBuf, size_t index);
     bool eof();
     int inflate(char *inbuf, uint32_t insize, char *outbuf, uint32_t outsize);
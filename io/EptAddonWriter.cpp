@@ -96,7 +96,7 @@ void EptAddonWriter::prepared(PointTableRef table)
         log()->get(LogLevel::Warning) << "Using a large thread count: " <<
             threads << " threads" << std::endl;
     }
-    m_pool.reset(new Pool(threads));
+    m_pool.reset(new ThreadPool(threads));
 
     const PointLayout& layout(*table.layout());
     for (auto it : m_args->m_addons.items())
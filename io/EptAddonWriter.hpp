@@ -52,7 +52,7 @@ namespace arbiter
 class Addon;
 class EptInfo;
 class Key;
-class Pool;
+class ThreadPool;
 
 class PDAL_DLL EptAddonWriter : public Writer
 {
@@ -81,7 +81,7 @@ private:
     Dimension::Id m_pointIdDim = Dimension::Id::Unknown;
 
     std::unique_ptr<arbiter::Arbiter> m_arbiter;
-    std::unique_ptr<Pool> m_pool;
+    std::unique_ptr<ThreadPool> m_pool;
     std::unique_ptr<EptInfo> m_info;
     std::vector<std::unique_ptr<Addon>> m_addons;
     std::map<Key, uint64_t> m_hierarchy;
@@ -231,7 +231,7 @@ void EptReader::initialize()
         log()->get(LogLevel::Warning) << "Using a large thread count: " <<
             threads << " threads" << std::endl;
     }
-    m_pool.reset(new Pool(threads));
+    m_pool.reset(new ThreadPool(threads));
 
     debug << "Endpoint: " << m_ep->prefixedRoot() << std::endl;
     try
@@ -63,7 +63,7 @@ class Addon;
 class EptInfo;
 class FixedPointLayout;
 class Key;
-class Pool;
+class ThreadPool;
 class VectorPointTable;
 
 class PDAL_DLL EptReader : public Reader, public Streamable
@@ -143,7 +143,7 @@ private:
 
     BOX3D m_queryBounds;
     int64_t m_queryOriginId = -1;
-    std::unique_ptr<Pool> m_pool;
+    std::unique_ptr<ThreadPool> m_pool;
     std::vector<std::unique_ptr<Addon>> m_addons;
 
     using StringMap = std::map<std::string, std::string>;
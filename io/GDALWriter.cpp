@@ -60,6 +60,15 @@ std::string GDALWriter::getName() const
 }
 
 
+GDALWriter::GDALWriter() : m_outputTypes(0), m_expandByPoint(true),
+    m_inputOrder(InputOrder::None)
+{}
+
+
+GDALWriter::~GDALWriter()
+{}
+
+
 void GDALWriter::addArgs(ProgramArgs& args)
 {
     args.add("filename", "Output filename", m_filename).setPositional();
@@ -89,6 +98,11 @@ void GDALWriter::addArgs(ProgramArgs& args)
         m_width);
     m_heightArg = &args.add("height", "Number of cells in the Y direction.",
         m_height);
+    args.add("input_order", "Order of points in stream mode ('none', "
+        "'ascending_y' or 'descending_y').  Finished rows of the raster are "
+        "written as points arrive.", m_inputOrderString, "none");
+    args.add("order_tolerance", "Distance by which points may be out of "
+        "the order given by 'input_order'", m_orderTolerance, 0.0);
 }
 
 
@@ -153,6 +167,22 @@ void GDALWriter::initialize()
     // set later in writeView.
     m_expandByPoint = !m_fixedGrid;
 
+    if (m_inputOrderString == "none")
+        m_inputOrder = InputOrder::None;
+    else if (m_inputOrderString == "ascending_y")
+        m_inputOrder = InputOrder::AscendingY;
+    else if (m_inputOrderString == "descending_y")
+        m_inputOrder = InputOrder::DescendingY;
+    else
+        throwError("Invalid input order: '" + m_inputOrderString + "'.");
+    // Rows can only be written before all points have arrived if the size
+    // of the raster is known.
+    if (m_inputOrder != InputOrder::None && !m_fixedGrid)
+        throwError("Option 'input_order' requires 'bounds' or "
+            "'origin_x'/'origin_y'/'width'/'height' options.");
+    if (m_orderTolerance < 0)
+        throwError("Option 'order_tolerance' must not be negative.");
+
     gdal::registerDrivers();
 }
 
@@ -172,6 +202,13 @@ void GDALWriter::readyFile(const std::string& filename,
     m_outputFilename = filename;
     m_srs = srs;
     m_grid.reset();
+    m_raster.reset();
+    m_minY = (std::numeric_limits<double>::max)();
+    m_maxY = std::numeric_limits<double>::lowest();
+    m_finalRows = 0;
+    m_filledRows = 0;
+    m_writtenRows = 0;
+    m_releasedRows = 0;
     if (m_fixedGrid)
         createGrid(m_bounds.to2d());
 }
@@ -263,12 +300,228 @@ void GDALWriter::writeView(const PointViewPtr view)
             expandGrid(bounds);
     }
 
-    PointRef point(*view, 0);
-    for (PointId idx = 0; idx < view->size(); ++idx)
+    // Points are added to the grid in chunks, which bounds the memory
+    // used to hold their positions.
+    const point_count_t ChunkSize = 1 << 20;
+    for (PointId begin = 0; begin < view->size(); begin += ChunkSize)
+    {
+        point_count_t count = (std::min)(ChunkSize, view->size() - begin);
+        m_xs.resize(count);
+        m_ys.resize(count);
+        m_zs.resize(count);
+        view->getFieldRange(Dimension::Id::X, begin, count, m_xs.data());
+        view->getFieldRange(Dimension::Id::Y, begin, count, m_ys.data());
+        view->getFieldRange(m_interpDim, begin, count, m_zs.data());
+        addPoints();
+    }
+}
+
+
+// Add the points in m_xs/m_ys/m_zs to the grid.  The grid is updated in
+// parallel.
+void GDALWriter::addPoints()
+{
+    for (size_t i = 0; i < m_xs.size(); ++i)
+    {
+        m_xs[i] -= m_origin.x;
+        m_ys[i] -= m_origin.y;
+        m_minY = (std::min)(m_minY, m_ys[i]);
+        m_maxY = (std::max)(m_maxY, m_ys[i]);
+    }
+    try
+    {
+        m_grid->addPoints(m_xs.data(), m_ys.data(), m_zs.data(),
+            m_xs.size());
+    }
+    catch (const GDALGrid::error& err)
+    {
+        throwError(std::string(err.what()) + " Points must arrive in the "
+            "order given by 'input_order', within 'order_tolerance'.");
+    }
+    m_xs.clear();
+    m_ys.clear();
+    m_zs.clear();
+}
+
+
+// This is only called in stream mode.  The grid is expanded to hold all
+// the points of the batch before they're added.  If the input is ordered,
+// rows that are finished are written once the batch is added.
+point_count_t GDALWriter::processBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    PointRef point(table, begin);
+    BOX2D bounds;
+    for (PointId idx = begin; idx < end; ++idx)
     {
+        if (table.skip(idx))
+            continue;
         point.setPointId(idx);
-        processOne(point);
+        double x = point.getFieldAs<double>(Dimension::Id::X);
+        double y = point.getFieldAs<double>(Dimension::Id::Y);
+        m_xs.push_back(x);
+        m_ys.push_back(y);
+        m_zs.push_back(point.getFieldAs<double>(m_interpDim));
+
+        // The grid is aligned with the first point, as it is when points
+        // are processed one at a time.
+        if (m_expandByPoint && !m_grid)
+            createGrid(BOX2D(x, y, x, y));
+        bounds.grow(x, y);
     }
+    if (m_xs.empty())
+        return end - begin;
+
+    if (m_expandByPoint)
+    {
+        Cell low = cell(bounds.minx, bounds.miny);
+        Cell high = cell(bounds.maxx, bounds.maxy);
+        if (low.x < 0 || low.y < 0 || high.x >= width() ||
+                high.y >= height())
+            expandGrid(bounds);
+    }
+    addPoints();
+    sweep();
+    return end - begin;
+}
+
+
+// Write the rows of the raster that points yet to arrive can't affect.
+// Those points are no further than the tolerance behind the farthest
+// point seen so far in the direction of the input order.
+void GDALWriter::sweep()
+{
+    if (m_inputOrder == InputOrder::None || m_minY > m_maxY)
+        return;
+
+    long jMin, jMax;
+    size_t complete;
+    if (m_inputOrder == InputOrder::DescendingY)
+    {
+        m_grid->rowRange(m_minY + m_orderTolerance, jMin, jMax);
+        complete = (size_t)jMin;
+    }
+    else
+    {
+        m_grid->rowRange(m_maxY - m_orderTolerance, jMin, jMax);
+        complete = m_grid->height() - (size_t)(jMax + 1);
+    }
+    flushRows(complete);
+}
+
+
+// Finalize, fill, write and release rows of the grid.  'complete' is the
+// number of rows, counted from the edge of the raster where the input
+// starts, that no more points can affect.
+void GDALWriter::flushRows(size_t complete)
+{
+    const size_t height = m_grid->height();
+    const size_t window = m_windowSize;
+
+    // Convert counts of rows from the starting edge to a range of rows
+    // numbered from the top of the raster.
+    size_t begin;
+    size_t end;
+    auto rows = [this, height, &begin, &end](size_t from, size_t to)
+    {
+        if (m_inputOrder == InputOrder::AscendingY)
+        {
+            begin = height - to;
+            end = height - from;
+        }
+        else
+        {
+            begin = from;
+            end = to;
+        }
+    };
+
+    if (complete > m_finalRows)
+    {
+        rows(m_finalRows, complete);
+        m_grid->finalizeRows(begin, end);
+        m_finalRows = complete;
+    }
+
+    // Filling a row reads the rows within the window around it.
+    size_t filled = complete;
+    if (complete < height)
+        filled = complete > window ? complete - window : 0;
+    if (filled > m_filledRows)
+    {
+        rows(m_filledRows, filled);
+        m_grid->fillRows(begin, end);
+        m_filledRows = filled;
+    }
+    if (filled == m_writtenRows)
+        return;
+
+    // GDAL writes whole rows of blocks.  Blocks are aligned with the top
+    // of the raster and only the last row of blocks can be short.
+    if (!m_raster)
+        createRaster();
+    size_t written = filled;
+    if (filled < height)
+    {
+        size_t blockHeight = (size_t)m_raster->blockHeight();
+        if (m_inputOrder == InputOrder::AscendingY)
+        {
+            size_t top = (height - filled + blockHeight - 1) / blockHeight *
+                blockHeight;
+            written = height - (std::min)(top, height);
+        }
+        else
+            written = filled / blockHeight * blockHeight;
+    }
+    if (written > m_writtenRows)
+    {
+        rows(m_writtenRows, written);
+        gdal::GDALError err = gdal::GDALError::None;
+        double srcNoData = std::numeric_limits<double>::quiet_NaN();
+        int bandNum = 1;
+        for (std::string name :
+                { "min", "max", "mean", "idw", "count", "stdev" })
+        {
+            GDALGrid::BandIter src = m_grid->data(name);
+            if (src.valid() && err == gdal::GDALError::None)
+                err = m_raster->writeBand(src, srcNoData, bandNum++, name,
+                    begin, end);
+        }
+        if (err != gdal::GDALError::None)
+            throwError(m_raster->errorMsg());
+        m_writtenRows = written;
+    }
+
+    // Rows that have been written can be freed once they're no longer
+    // needed to fill other rows.
+    size_t released = (std::min)(written, filled > window ?
+        filled - window : 0);
+    if (released > m_releasedRows)
+    {
+        rows(m_releasedRows, released);
+        m_grid->releaseRows(begin, end);
+        m_releasedRows = released;
+    }
+}
+
+
+void GDALWriter::createRaster()
+{
+    std::array<double, 6> pixelToPos;
+
+    pixelToPos[0] = m_origin.x;
+    pixelToPos[1] = m_edgeLength;
+    pixelToPos[2] = 0;
+    pixelToPos[3] = m_origin.y + (m_edgeLength * m_grid->height());
+    pixelToPos[4] = 0;
+    pixelToPos[5] = -m_edgeLength;
+    m_raster.reset(new gdal::Raster(m_outputFilename, m_drivername, m_srs,
+        pixelToPos));
+
+    gdal::GDALError err = m_raster->open(m_grid->width(), m_grid->height(),
+        m_grid->numBands(), m_dataType, m_noData, m_options);
+    if (err != gdal::GDALError::None)
+        throwError(m_raster->errorMsg());
 }
 
 
@@ -301,48 +554,9 @@ void GDALWriter::doneFile()
         throw pdal_error("Unable to write GDAL data with no points "
             "for output.");
 
-    std::array<double, 6> pixelToPos;
-
-    pixelToPos[0] = m_origin.x;
-    pixelToPos[1] = m_edgeLength;
-    pixelToPos[2] = 0;
-    pixelToPos[3] = m_origin.y + (m_edgeLength * m_grid->height());
-    pixelToPos[4] = 0;
-    pixelToPos[5] = -m_edgeLength;
-    gdal::Raster raster(m_outputFilename, m_drivername, m_srs, pixelToPos);
-
-    m_grid->finalize();
-
-    gdal::GDALError err = raster.open(m_grid->width(), m_grid->height(),
-        m_grid->numBands(), m_dataType, m_noData, m_options);
-
-    if (err != gdal::GDALError::None)
-        throwError(raster.errorMsg());
-    int bandNum = 1;
-
-    // Perhaps the grid should return an iterator, which would work as well.
-    double *src;
-    src = m_grid->data("min");
-    double srcNoData = std::numeric_limits<double>::quiet_NaN();
-    if (src && err == gdal::GDALError::None)
-        err = raster.writeBand(src, srcNoData, bandNum++, "min");
-    src = m_grid->data("max");
-    if (src && err == gdal::GDALError::None)
-        err = raster.writeBand(src, srcNoData, bandNum++, "max");
-    src = m_grid->data("mean");
-    if (src && err == gdal::GDALError::None)
-        err = raster.writeBand(src, srcNoData, bandNum++, "mean");
-    src = m_grid->data("idw");
-    if (src && err == gdal::GDALError::None)
-        err = raster.writeBand(src, srcNoData, bandNum++, "idw");
-    src = m_grid->data("count");
-    if (src && err == gdal::GDALError::None)
-        err = raster.writeBand(src, srcNoData, bandNum++, "count");
-    src = m_grid->data("stdev");
-    if (src && err == gdal::GDALError::None)
-        err = raster.writeBand(src, srcNoData, bandNum++, "stdev");
-    if (err != gdal::GDALError::None)
-        throwError(raster.errorMsg());
+    // Write whatever hasn't been written and close the raster.
+    flushRows(m_grid->height());
+    m_raster.reset();
 
     getMetadata().addList("filename", m_filename);
 }
@@ -44,6 +44,7 @@ namespace pdal
 {
 
 class GDALGrid;
+namespace gdal { class Raster; }
 
 class PDAL_DLL GDALWriter : public FlexWriter, public Streamable
 {
@@ -57,12 +58,19 @@ class PDAL_DLL GDALWriter : public FlexWriter, public Streamable
         double x;
         double y;
     };
+    // Order in which points are expected to arrive in stream mode.
+    enum class InputOrder
+    {
+        None,
+        AscendingY,
+        DescendingY
+    };
 
 public:
     std::string getName() const;
 
-    GDALWriter() : m_outputTypes(0), m_expandByPoint(true)
-    {}
+    GDALWriter();
+    ~GDALWriter();
 
 private:
     virtual void addArgs(ProgramArgs& args);
@@ -72,9 +80,15 @@ private:
         const SpatialReference& srs);
     virtual void writeView(const PointViewPtr view);
     virtual bool processOne(PointRef& point);
+    virtual point_count_t processBatch(StreamPointTable& table,
+        PointId begin, PointId end);
     virtual void doneFile();
     void createGrid(BOX2D bounds);
     void expandGrid(BOX2D bounds);
+    void addPoints();
+    void sweep();
+    void flushRows(size_t complete);
+    void createRaster();
     Cell cell(double x, double y);
     long width() const;
     long height() const;
@@ -101,12 +115,30 @@ private:
     size_t m_windowSize;
     int m_outputTypes;
     std::unique_ptr<GDALGrid> m_grid;
+    // Positions and values of points waiting to be added to the grid.
+    std::vector<double> m_xs;
+    std::vector<double> m_ys;
+    std::vector<double> m_zs;
     double m_noData;
     Dimension::Id m_interpDim;
     std::string m_interpDimString;
     Dimension::Type m_dataType;
     bool m_expandByPoint;
     bool m_fixedGrid;
+    std::string m_inputOrderString;
+    InputOrder m_inputOrder;
+    double m_orderTolerance;
+    // Lowest and highest Y of the points added so far, relative to the
+    // origin.
+    double m_minY;
+    double m_maxY;
+    // Numbers of rows, counted from the edge of the raster where the input
+    // starts, that have been finalized, filled, written and released.
+    size_t m_finalRows;
+    size_t m_filledRows;
+    size_t m_writtenRows;
+    size_t m_releasedRows;
+    std::unique_ptr<gdal::Raster> m_raster;
 };
 
 }
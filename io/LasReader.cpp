@@ -36,6 +36,7 @@
 
 #include "LasReader.hpp"
 
+#include <atomic>
 #include <sstream>
 #include <string.h>
 
@@ -46,6 +47,7 @@
 #include <pdal/util/Extractor.hpp>
 #include <pdal/util/IStream.hpp>
 #include <pdal/util/ProgramArgs.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 #include "GeotiffSupport.hpp"
 #include "LasHeader.hpp"
@@ -65,7 +67,8 @@ struct invalid_stream : public std::runtime_error
 
 } // unnamed namespace
 
-LasReader::LasReader() : m_decompressor(nullptr), m_index(0)
+LasReader::LasReader() : m_decompressor(nullptr), m_readAhead(nullptr),
+    m_pointData(nullptr), m_mappedPoints(0), m_threads(1), m_index(0)
 {}
 
 
@@ -73,6 +76,7 @@ LasReader::~LasReader()
 {
 #ifdef PDAL_HAVE_LAZPERF
     delete m_decompressor;
+    delete m_readAhead;
 #endif
 }
 
@@ -85,6 +89,8 @@ void LasReader::addArgs(ProgramArgs& args)
     args.add("use_eb_vlr", "Use extra bytes VLR for 1.0 - 1.3 files",
         m_useEbVlr);
     args.add("ignore_vlr", "VLR userid/recordid to ignore", m_ignoreVLROption);
+    args.add("threads", "Number of threads used to decompress chunks of "
+        "compressed data", m_threads, (size_t)1);
 }
 
 
@@ -243,6 +249,7 @@ void LasReader::ready(PointTableRef table)
     std::istream *stream(m_streamIf->m_istream);
 
     m_index = 0;
+    table.reserve((std::min)(getNumPoints(), m_count));
     if (m_header.compressed())
     {
 #ifdef PDAL_HAVE_LASZIP
@@ -260,6 +267,8 @@ void LasReader::ready(PointTableRef table)
 #ifdef PDAL_HAVE_LAZPERF
         if (m_compression == "LAZPERF")
         {
+            delete m_readAhead;
+            m_readAhead = nullptr;
             delete m_decompressor;
 
             const LasVLR *vlr = m_header.findVlr(LASZIP_USER_ID,
@@ -278,7 +287,27 @@ void LasReader::ready(PointTableRef table)
 #endif
     }
     else
+    {
         stream->seekg(m_header.pointOffset());
+        m_pointBuf.resize(m_header.pointLen());
+
+        // Parse uncompressed points directly from a mapping of the file
+        // when possible, rather than copying them through the stream.
+        m_pointData = m_streamIf->map(m_filename);
+        m_mappedPoints = 0;
+        if (m_pointData)
+        {
+            uintmax_t size = m_streamIf->mapSize();
+            uintmax_t offset = m_header.pointOffset();
+            if (size > offset)
+                m_mappedPoints = (std::min)(getNumPoints(),
+                    (point_count_t)((size - offset) / m_header.pointLen()));
+            m_pointData += offset;
+        }
+        else
+            log()->get(LogLevel::Debug) << "Reading points through stream: " <<
+                "file not mapped." << std::endl;
+    }
 }
 
 
@@ -593,7 +622,12 @@ bool LasReader::processOne(PointRef& point)
 #ifdef PDAL_HAVE_LAZPERF
         if (m_compression == "LAZPERF")
         {
-            m_decompressor->decompress(m_decompressorBuf.data());
+            if (m_index == 0 && chunkedReadable(getNumPoints()))
+                startReadAhead();
+            if (m_readAhead)
+                m_readAhead->decompress(m_decompressorBuf.data());
+            else
+                m_decompressor->decompress(m_decompressorBuf.data());
             loadPoint(point, m_decompressorBuf.data(), pointLen);
         }
 #endif
@@ -602,18 +636,79 @@ bool LasReader::processOne(PointRef& point)
             "LAZperf decompression library.");
 #endif
     } // compression
+    else if (m_pointData)
+    {
+        if (m_index >= m_mappedPoints)
+            return false;
+        loadPoint(point, m_pointData + m_index * pointLen, pointLen);
+    }
     else
     {
-        std::vector<char> buf(m_header.pointLen());
-
-        m_streamIf->m_istream->read(buf.data(), pointLen);
-        loadPoint(point, buf.data(), pointLen);
+        m_streamIf->m_istream->read(m_pointBuf.data(), pointLen);
+        loadPoint(point, m_pointBuf.data(), pointLen);
     }
     m_index++;
     return true;
 }
 
 
+// Read a batch of points into a stream table.  Uncompressed points are
+// read with a single stream read rather than a read per point.
+point_count_t LasReader::processBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    point_count_t count = (std::min)((point_count_t)(end - begin),
+        getNumPoints() - m_index);
+
+    PointRef point(table, begin);
+    if (m_header.compressed())
+    {
+        for (PointId i = 0; i < count; ++i)
+        {
+            point.setPointId(begin + i);
+            LasReader::processOne(point);
+        }
+        return count;
+    }
+
+    size_t pointLen = m_header.pointLen();
+    if (m_pointData)
+    {
+        count = (std::min)(count, m_mappedPoints - m_index);
+        const char *pos = m_pointData + m_index * pointLen;
+        for (PointId i = 0; i < count; ++i)
+        {
+            point.setPointId(begin + i);
+            loadPoint(point, pos, pointLen);
+            pos += pointLen;
+        }
+        m_index += count;
+        return count;
+    }
+
+    m_batchBuf.resize(count * pointLen);
+
+    point_count_t numRead = 0;
+    try
+    {
+        if (count)
+            numRead = readFileBlock(m_batchBuf, count);
+    }
+    catch (invalid_stream&)
+    {}
+
+    char *pos = m_batchBuf.data();
+    for (PointId i = 0; i < numRead; ++i)
+    {
+        point.setPointId(begin + i);
+        loadPoint(point, pos, pointLen);
+        pos += pointLen;
+    }
+    m_index += numRead;
+    return numRead;
+}
+
+
 point_count_t LasReader::read(PointViewPtr view, point_count_t count)
 {
     size_t pointLen = m_header.pointLen();
@@ -625,13 +720,19 @@ point_count_t LasReader::read(PointViewPtr view, point_count_t count)
 #if defined(PDAL_HAVE_LAZPERF) || defined(PDAL_HAVE_LASZIP)
         if (m_compression == "LASZIP" || m_compression == "LAZPERF")
         {
-            for (i = 0; i < count; i++)
+            if (m_index == 0 && count == getNumPoints() &&
+                chunkedReadable(count))
+                i = readChunked(view, count);
+            if (i == 0)
             {
-                PointRef point = view->point(i);
-                PointId id = view->size();
-                processOne(point);
-                if (m_cb)
-                    m_cb(*view, id);
+                for (i = 0; i < count; i++)
+                {
+                    PointRef point = view->point(i);
+                    PointId id = view->size();
+                    processOne(point);
+                    if (m_cb)
+                        m_cb(*view, id);
+                }
             }
         }
 #else
@@ -639,6 +740,20 @@ point_count_t LasReader::read(PointViewPtr view, point_count_t count)
             "LAZperf decompression library.");
 #endif
     }
+    else if (m_pointData)
+    {
+        count = (std::min)(count, m_mappedPoints - m_index);
+        const char *pos = m_pointData + m_index * pointLen;
+        for (i = 0; i < count; i++)
+        {
+            PointId id = view->size();
+            PointRef point = view->point(id);
+            loadPoint(point, pos, pointLen);
+            if (m_cb)
+                m_cb(*view, id);
+            pos += pointLen;
+        }
+    }
     else
     {
         point_count_t remaining = count;
@@ -699,6 +814,193 @@ point_count_t LasReader::readFileBlock(std::vector<char>& buf,
 }
 
 
+// Get the number of points in each chunk of compressed data from the
+// laszip VLR.  Returns 0 if it can't be determined.
+uint32_t LasReader::chunkSize() const
+{
+    const LasVLR *vlr = m_header.findVlr(LASZIP_USER_ID, LASZIP_RECORD_ID);
+    if (!vlr || vlr->dataLen() < 16)
+        return 0;
+
+    // Skip compressor, coder, version and options.
+    LeExtractor in(vlr->data() + 12, 4);
+    uint32_t chunkSize;
+    in >> chunkSize;
+    return chunkSize;
+}
+
+
+// Determine if 'count' points of compressed data can be read a chunk at
+// a time by several threads.  Files with variable-sized chunks (a chunk
+// size of 0xFFFFFFFF) are read serially.
+bool LasReader::chunkedReadable(point_count_t count) const
+{
+    if (m_threads < 2 || !m_header.compressed())
+        return false;
+    uint32_t size = chunkSize();
+    return size && size != (std::numeric_limits<uint32_t>::max)() &&
+        count > size;
+}
+
+
+// Decompress whole chunks on separate threads, each with its own stream,
+// loading points directly into a view that has been sized up front.
+// Returns 0 without reading if the chunk table can't be used.
+point_count_t LasReader::readChunked(PointViewPtr view, point_count_t count)
+{
+    const point_count_t size = chunkSize();
+    const point_count_t numChunks = (count + size - 1) / size;
+    const size_t numThreads =
+        (size_t)(std::min)((point_count_t)m_threads, numChunks);
+    const PointId start = view->size();
+
+#ifdef PDAL_HAVE_LAZPERF
+    std::vector<std::streamoff> offsets;
+    const LasVLR *vlr = m_header.findVlr(LASZIP_USER_ID, LASZIP_RECORD_ID);
+    if (m_compression == "LAZPERF")
+    {
+        std::unique_ptr<LasStreamIf> streamIf(createWorkerStream());
+        LazPerfVlrDecompressor decompressor(*streamIf->m_istream,
+            vlr->data(), m_header.pointOffset());
+        offsets = decompressor.chunkOffsets();
+        if (offsets.size() < numChunks)
+        {
+            log()->get(LogLevel::Debug) << getName() << ": Chunk table "
+                "of compressed data is unusable.  Reading serially." <<
+                std::endl;
+            return 0;
+        }
+    }
+#endif
+
+    // Add the points so that threads need only set their values.
+    view->addPoints(count);
+
+    std::atomic<point_count_t> nextChunk(0);
+
+    // Each worker claims the next chunk until there are none left.
+    auto work = [&]()
+    {
+        try
+        {
+            std::unique_ptr<LasStreamIf> streamIf(createWorkerStream());
+            if (!streamIf->m_istream)
+                throwError("Unable to open stream for '" + m_filename + "'.");
+            std::istream& stream(*streamIf->m_istream);
+            point_count_t chunk;
+
+#ifdef PDAL_HAVE_LASZIP
+            if (m_compression == "LASZIP")
+            {
+                laszip_POINTER laszip;
+                laszip_point_struct *laszipPoint;
+                laszip_BOOL compressed;
+
+                auto handle = [this, &laszip](int result)
+                {
+                    if (result)
+                    {
+                        char *buf;
+                        laszip_get_error(laszip, &buf);
+                        throwError(buf);
+                    }
+                };
+
+                handle(laszip_create(&laszip));
+                // Close and destroy the reader however the worker ends.
+                // Errors doing so don't matter once the points are read.
+                auto release = [](laszip_POINTER p)
+                {
+                    laszip_close_reader(p);
+                    laszip_destroy(p);
+                };
+                std::unique_ptr<void, decltype(release)> guard(laszip,
+                    release);
+                handle(laszip_open_reader_stream(laszip, stream,
+                    &compressed));
+                handle(laszip_get_point_pointer(laszip, &laszipPoint));
+                while ((chunk = nextChunk++) < numChunks)
+                {
+                    PointId first = chunk * size;
+                    PointId last = (std::min)(first + size, count);
+                    handle(laszip_seek_point(laszip, first));
+                    for (PointId idx = first; idx < last; ++idx)
+                    {
+                        handle(laszip_read_point(laszip));
+                        PointRef point(*view, start + idx);
+                        loadPoint(point, *laszipPoint);
+                    }
+                }
+            }
+#endif
+
+#ifdef PDAL_HAVE_LAZPERF
+            if (m_compression == "LAZPERF")
+            {
+                LazPerfVlrDecompressor decompressor(stream, vlr->data(),
+                    m_header.pointOffset());
+                std::vector<char> buf(decompressor.pointSize());
+                while ((chunk = nextChunk++) < numChunks)
+                {
+                    PointId first = chunk * size;
+                    PointId last = (std::min)(first + size, count);
+                    decompressor.seekChunk(offsets[chunk]);
+                    for (PointId idx = first; idx < last; ++idx)
+                    {
+                        decompressor.decompress(buf.data());
+                        PointRef point(*view, start + idx);
+                        loadPoint(point, buf.data(), buf.size());
+                    }
+                }
+            }
+#endif
+            (void)chunk;
+        }
+        catch (...)
+        {
+            // Keep other workers from starting more work.
+            nextChunk = numChunks;
+            throw;
+        }
+    };
+
+    // Run the workers on the shared pool so that decompression counts
+    // against the process-wide thread limit.
+    parallelFor(0, numThreads, [&work](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                work();
+        }, numThreads, 1);
+
+    if (m_cb)
+        for (PointId idx = start; idx < start + count; ++idx)
+            m_cb(*view, idx);
+    return count;
+}
+
+
+// In stream mode points are handed out one at a time, so decompress
+// chunks on several threads ahead of their consumption.
+void LasReader::startReadAhead()
+{
+#ifdef PDAL_HAVE_LAZPERF
+    if (m_readAhead)
+        return;
+
+    const LasVLR *vlr = m_header.findVlr(LASZIP_USER_ID, LASZIP_RECORD_ID);
+    auto open = [this]()
+    {
+        std::shared_ptr<LasStreamIf> streamIf(createWorkerStream());
+        if (!streamIf->m_istream)
+            throwError("Unable to open stream for '" + m_filename + "'.");
+        return std::shared_ptr<std::istream>(streamIf, streamIf->m_istream);
+    };
+    m_readAhead = new LazPerfVlrReadAhead(open, vlr->data(),
+        m_header.pointOffset(), getNumPoints(), m_threads);
+#endif
+}
+
+
 #ifdef PDAL_HAVE_LASZIP
 void LasReader::loadPoint(PointRef& point, laszip_point& p)
 {
@@ -710,7 +1012,8 @@ void LasReader::loadPoint(PointRef& point, laszip_point& p)
 #endif // PDAL_HAVE_LASZIP
 
 
-void LasReader::loadPoint(PointRef& point, char *buf, size_t bufsize)
+void LasReader::loadPoint(PointRef& point, const char *buf,
+    size_t bufsize)
 {
     if (m_header.has14Format())
         loadPointV14(point, buf, bufsize);
@@ -761,7 +1064,8 @@ void LasReader::loadPointV10(PointRef& point, laszip_point& p)
 }
 #endif // PDAL_HAVE_LASZIP
 
-void LasReader::loadPointV10(PointRef& point, char *buf, size_t bufsize)
+void LasReader::loadPointV10(PointRef& point, const char *buf,
+    size_t bufsize)
 {
     LeExtractor istream(buf, bufsize);
 
@@ -870,7 +1174,8 @@ void LasReader::loadPointV14(PointRef& point, laszip_point& p)
 #endif  // PDAL_HAVE_LASZIP
 
 
-void LasReader::loadPointV14(PointRef& point, char *buf, size_t bufsize)
+void LasReader::loadPointV14(PointRef& point, const char *buf,
+    size_t bufsize)
 {
     LeExtractor istream(buf, bufsize);
 
@@ -974,6 +1279,7 @@ void LasReader::done(PointTableRef)
         handleLaszip(laszip_destroy(m_laszip));
     }
 #endif
+    m_pointData = nullptr;
     m_streamIf.reset();
 }
 
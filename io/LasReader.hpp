@@ -39,6 +39,7 @@
 #include <pdal/PDALUtils.hpp>
 #include <pdal/Reader.hpp>
 #include <pdal/Streamable.hpp>
+#include <pdal/util/FileUtils.hpp>
 
 #ifdef PDAL_HAVE_LASZIP
 #include <laszip/laszip_api.h>
@@ -60,6 +61,7 @@ class LasHeader;
 class LeExtractor;
 class PointDimensions;
 class LazPerfVlrDecompressor;
+class LazPerfVlrReadAhead;
 
 class PDAL_DLL LasReader : public Reader, public Streamable
 {
@@ -67,20 +69,50 @@ protected:
     class LasStreamIf
     {
     protected:
-        LasStreamIf()
+        LasStreamIf() : m_istream(nullptr), m_offset(0)
         {}
 
     public:
-        LasStreamIf(const std::string& filename)
+        LasStreamIf(const std::string& filename) : m_offset(0)
             { m_istream = Utils::openFile(filename); }
 
         virtual ~LasStreamIf()
         {
+            unmap();
             if (m_istream)
                 Utils::closeFile(m_istream);
         }
 
+        // Map the file to memory.  Returns a pointer to the start of the
+        // LAS data or nullptr if the file can't be mapped.
+        const char *map(const std::string& filename)
+        {
+            m_map = FileUtils::mapFile(filename);
+            if (m_map.addr() && m_map.size() < m_offset)
+                unmap();
+            if (!m_map.addr())
+                return nullptr;
+            return (const char *)m_map.addr() + m_offset;
+        }
+
+        // Number of bytes of LAS data that have been mapped.
+        uintmax_t mapSize() const
+            { return m_map.addr() ? m_map.size() - m_offset : 0; }
+
+        void unmap()
+        {
+            if (m_map.addr())
+                m_map = FileUtils::unmapFile(m_map);
+        }
+
         std::istream *m_istream;
+
+    protected:
+        // Position of the LAS data in the file.
+        uint64_t m_offset;
+
+    private:
+        FileUtils::MapContext m_map;
     };
 
     friend class NitfReader;
@@ -110,6 +142,11 @@ protected:
         }
     }
 
+    // Open an additional, independent stream on the input.  Used by
+    // threads that decompress chunks of point data.
+    virtual LasStreamIf *createWorkerStream()
+        { return new LasStreamIf(m_filename); }
+
     std::unique_ptr<LasStreamIf> m_streamIf;
 
 private:
@@ -120,7 +157,13 @@ private:
     laszip_point_struct *m_laszipPoint;
 
     LazPerfVlrDecompressor *m_decompressor;
+    LazPerfVlrReadAhead *m_readAhead;
     std::vector<char> m_decompressorBuf;
+    std::vector<char> m_batchBuf;
+    std::vector<char> m_pointBuf;
+    const char *m_pointData;
+    point_count_t m_mappedPoints;
+    size_t m_threads;
     point_count_t m_index;
     StringList m_extraDimSpec;
     std::vector<ExtraDim> m_extraDims;
@@ -138,6 +181,8 @@ private:
     virtual void ready(PointTableRef table);
     virtual point_count_t read(PointViewPtr view, point_count_t count);
     virtual bool processOne(PointRef& point);
+    virtual point_count_t processBatch(StreamPointTable& table,
+        PointId begin, PointId end);
     virtual void done(PointTableRef table);
     virtual bool eof()
         { return m_index >= getNumPoints(); }
@@ -150,12 +195,16 @@ private:
     void loadPoint(PointRef& point, laszip_point& p);
     void loadPointV10(PointRef& point, laszip_point& p);
     void loadPointV14(PointRef& point, laszip_point& p);
-    void loadPoint(PointRef& point, char *buf, size_t bufsize);
-    void loadPointV10(PointRef& point, char *buf, size_t bufsize);
-    void loadPointV14(PointRef& point, char *buf, size_t bufsize);
+    void loadPoint(PointRef& point, const char *buf, size_t bufsize);
+    void loadPointV10(PointRef& point, const char *buf, size_t bufsize);
+    void loadPointV14(PointRef& point, const char *buf, size_t bufsize);
     void loadExtraDims(LeExtractor& istream, PointRef& data);
     point_count_t readFileBlock(std::vector<char>& buf,
         point_count_t maxPoints);
+    uint32_t chunkSize() const;
+    bool chunkedReadable(point_count_t count) const;
+    point_count_t readChunked(PointViewPtr view, point_count_t count);
+    void startReadAhead();
     void handleLaszip(int result);
 
     LasReader& operator=(const LasReader&); // not implemented
@@ -146,6 +146,8 @@ void LasWriter::addArgs(ProgramArgs& args)
     args.add("offset_y", "Y offset", m_offsetY);
     args.add("offset_z", "Z offset", m_offsetZ);
     args.add("vlrs", "List of VLRs to set", m_userVLRs);
+    args.add("threads", "Number of threads used to compress LAZ output "
+        "with LAZperf", m_threads, (size_t)1);
 }
 
 void LasWriter::initialize()
@@ -165,6 +167,10 @@ void LasWriter::initialize()
         setSpatialReference(m_aSrs);
     if (m_compression != LasCompression::None)
         m_lasHeader.setCompressed(true);
+    if (m_threads > 1 && m_compression == LasCompression::LasZip)
+        log()->get(LogLevel::Warning) << "Option 'threads' only applies "
+            "to LAZperf compression.  Compressing with LASzip serially." <<
+            std::endl;
 #if !defined(PDAL_HAVE_LASZIP) && !defined(PDAL_HAVE_LAZPERF)
     if (m_compression != LasCompression::None)
         throwError("Can't write LAZ output.  PDAL not built with "
@@ -726,7 +732,7 @@ void LasWriter::readyLazPerfCompression()
 
     delete m_compressor;
     m_compressor = new LazPerfVlrCompressor(*m_ostream, schema,
-        zipvlr.chunk_size);
+        zipvlr.chunk_size, (std::max)(m_threads, (size_t)1));
 #endif
 }
 
@@ -746,40 +752,106 @@ bool LasWriter::processOne(PointRef& point)
 {
     if (m_firstPoint)
     {
-        auto doScale = [this](const XForm::XFormComponent& scale,
-            const std::string& name)
-        {
-            if (scale.m_auto)
-                log()->get(LogLevel::Warning) << "Auto scale for " << name <<
-                "requested in stream mode.  Using value of 1.0." << std::endl;
-        };
+        setStreamXForm(point);
+        m_firstPoint = false;
+    }
+    return processPoint(point);
+}
 
-        doScale(m_scaling.m_xXform.m_scale, "X");
-        doScale(m_scaling.m_yXform.m_scale, "Y");
-        doScale(m_scaling.m_zXform.m_scale, "Z");
 
-        auto doOffset = [this](XForm::XFormComponent& offset, double val,
-            const std::string name)
+// This is only called in stream mode.  Unless compressing with LASzip,
+// the fields of the points in the batch are fetched and packed into a
+// buffer that's written (or compressed) at once.
+point_count_t LasWriter::processBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    std::vector<PointId> ids;
+    for (PointId idx = begin; idx < end; ++idx)
+        if (!table.skip(idx))
+            ids.push_back(idx);
+    if (ids.empty())
+        return end - begin;
+
+    PointRef point(table, ids[0]);
+    if (m_firstPoint)
+    {
+        setStreamXForm(point);
+        m_firstPoint = false;
+    }
+
+    if (m_compression == LasCompression::LasZip)
+    {
+        for (PointId idx : ids)
         {
-            if (offset.m_auto)
-            {
-                offset.m_val = val;
-                log()->get(LogLevel::Warning) << "Auto offset for " << name <<
-                    "requested in stream mode.  Using value of " <<
-                    offset.m_val << "." << std::endl;
-            }
-        };
+            point.setPointId(idx);
+            if (!processPoint(point))
+                table.setSkip(idx);
+        }
+        return end - begin;
+    }
 
-        doOffset(m_scaling.m_xXform.m_offset,
-            point.getFieldAs<double>(Dimension::Id::X), "X");
-        doOffset(m_scaling.m_yXform.m_offset,
-            point.getFieldAs<double>(Dimension::Id::Y), "Y");
-        doOffset(m_scaling.m_zXform.m_offset,
-            point.getFieldAs<double>(Dimension::Id::Z), "Z");
+    const size_t pointLen = m_lasHeader.pointLen();
+    m_fields.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        point.setPointId(ids[i]);
+        fetchFields(point, i);
+    }
 
-        m_firstPoint = false;
+    m_batchBuf.resize(ids.size() * pointLen);
+    LeInserter ostream(m_batchBuf.data(), m_batchBuf.size());
+    point_count_t filled = 0;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        point.setPointId(ids[i]);
+        if (packPoint(point, i, ostream))
+            filled++;
+        else
+            table.setSkip(ids[i]);
     }
-    return processPoint(point);
+
+    if (m_compression == LasCompression::LazPerf)
+        writeLazPerfBuf(m_batchBuf.data(), pointLen, filled);
+    else
+        m_ostream->write(m_batchBuf.data(), filled * pointLen);
+    return end - begin;
+}
+
+
+// Auto scale isn't available in stream mode and auto offsets are taken
+// from the first point written.
+void LasWriter::setStreamXForm(PointRef& point)
+{
+    auto doScale = [this](const XForm::XFormComponent& scale,
+        const std::string& name)
+    {
+        if (scale.m_auto)
+            log()->get(LogLevel::Warning) << "Auto scale for " << name <<
+            "requested in stream mode.  Using value of 1.0." << std::endl;
+    };
+
+    doScale(m_scaling.m_xXform.m_scale, "X");
+    doScale(m_scaling.m_yXform.m_scale, "Y");
+    doScale(m_scaling.m_zXform.m_scale, "Z");
+
+    auto doOffset = [this](XForm::XFormComponent& offset, double val,
+        const std::string name)
+    {
+        if (offset.m_auto)
+        {
+            offset.m_val = val;
+            log()->get(LogLevel::Warning) << "Auto offset for " << name <<
+                "requested in stream mode.  Using value of " <<
+                offset.m_val << "." << std::endl;
+        }
+    };
+
+    doOffset(m_scaling.m_xXform.m_offset,
+        point.getFieldAs<double>(Dimension::Id::X), "X");
+    doOffset(m_scaling.m_yXform.m_offset,
+        point.getFieldAs<double>(Dimension::Id::Y), "Y");
+    doOffset(m_scaling.m_zXform.m_offset,
+        point.getFieldAs<double>(Dimension::Id::Z), "Z");
 }
 
 
@@ -1008,7 +1080,136 @@ void LasWriter::writeLazPerfBuf(char *pos, size_t pointLen,
 }
 
 
+void LasWriter::FieldBuf::resize(point_count_t count)
+{
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    intensity.resize(count);
+    returnNumber.resize(count);
+    numberOfReturns.resize(count);
+    scanChannel.resize(count);
+    scanDirectionFlag.resize(count);
+    edgeOfFlightLine.resize(count);
+    classFlags.resize(count);
+    classification.resize(count);
+    userData.resize(count);
+    scanAngle.resize(count);
+    scanAngleRank.resize(count);
+    pointSourceId.resize(count);
+    gpsTime.resize(count);
+    red.resize(count);
+    green.resize(count);
+    blue.resize(count);
+    infrared.resize(count);
+}
+
+
+// Fetch the fields of a single point into position 'i' of the field buffer.
+void LasWriter::fetchFields(PointRef& point, size_t i)
+{
+    using namespace Dimension;
+
+    FieldBuf& f = m_fields;
+    f.x[i] = point.getFieldAs<double>(Id::X);
+    f.y[i] = point.getFieldAs<double>(Id::Y);
+    f.z[i] = point.getFieldAs<double>(Id::Z);
+    f.intensity[i] = point.getFieldAs<uint16_t>(Id::Intensity);
+    f.returnNumber[i] = point.hasDim(Id::ReturnNumber) ?
+        point.getFieldAs<uint8_t>(Id::ReturnNumber) : 1;
+    f.numberOfReturns[i] = point.hasDim(Id::NumberOfReturns) ?
+        point.getFieldAs<uint8_t>(Id::NumberOfReturns) : 1;
+    f.scanChannel[i] = point.getFieldAs<uint8_t>(Id::ScanChannel);
+    f.scanDirectionFlag[i] = point.getFieldAs<uint8_t>(Id::ScanDirectionFlag);
+    f.edgeOfFlightLine[i] = point.getFieldAs<uint8_t>(Id::EdgeOfFlightLine);
+    f.classification[i] = point.getFieldAs<uint8_t>(Id::Classification);
+    f.userData[i] = point.getFieldAs<uint8_t>(Id::UserData);
+    f.pointSourceId[i] = point.getFieldAs<uint16_t>(Id::PointSourceId);
+    if (m_lasHeader.has14Format())
+    {
+        f.classFlags[i] = point.getFieldAs<uint8_t>(Id::ClassFlags);
+        f.scanAngle[i] = point.getFieldAs<float>(Id::ScanAngleRank);
+    }
+    else
+        f.scanAngleRank[i] = point.getFieldAs<int8_t>(Id::ScanAngleRank);
+    if (m_lasHeader.hasTime())
+        f.gpsTime[i] = point.getFieldAs<double>(Id::GpsTime);
+    if (m_lasHeader.hasColor())
+    {
+        f.red[i] = point.getFieldAs<uint16_t>(Id::Red);
+        f.green[i] = point.getFieldAs<uint16_t>(Id::Green);
+        f.blue[i] = point.getFieldAs<uint16_t>(Id::Blue);
+    }
+    if (m_lasHeader.hasInfrared())
+        f.infrared[i] = point.getFieldAs<uint16_t>(Id::Infrared);
+}
+
+
+// Fetch the fields of a range of points, a dimension at a time.
+void LasWriter::fetchFields(const PointView& view, PointId start,
+    point_count_t count)
+{
+    using namespace Dimension;
+
+    FieldBuf& f = m_fields;
+    f.resize(count);
+    view.getFieldRange(Id::X, start, count, f.x.data());
+    view.getFieldRange(Id::Y, start, count, f.y.data());
+    view.getFieldRange(Id::Z, start, count, f.z.data());
+    view.getFieldRange(Id::Intensity, start, count, f.intensity.data());
+    if (view.hasDim(Id::ReturnNumber))
+        view.getFieldRange(Id::ReturnNumber, start, count,
+            f.returnNumber.data());
+    else
+        std::fill(f.returnNumber.begin(), f.returnNumber.end(), 1);
+    if (view.hasDim(Id::NumberOfReturns))
+        view.getFieldRange(Id::NumberOfReturns, start, count,
+            f.numberOfReturns.data());
+    else
+        std::fill(f.numberOfReturns.begin(), f.numberOfReturns.end(), 1);
+    view.getFieldRange(Id::ScanChannel, start, count, f.scanChannel.data());
+    view.getFieldRange(Id::ScanDirectionFlag, start, count,
+        f.scanDirectionFlag.data());
+    view.getFieldRange(Id::EdgeOfFlightLine, start, count,
+        f.edgeOfFlightLine.data());
+    view.getFieldRange(Id::Classification, start, count,
+        f.classification.data());
+    view.getFieldRange(Id::UserData, start, count, f.userData.data());
+    view.getFieldRange(Id::PointSourceId, start, count,
+        f.pointSourceId.data());
+    if (m_lasHeader.has14Format())
+    {
+        view.getFieldRange(Id::ClassFlags, start, count, f.classFlags.data());
+        view.getFieldRange(Id::ScanAngleRank, start, count,
+            f.scanAngle.data());
+    }
+    else
+        view.getFieldRange(Id::ScanAngleRank, start, count,
+            f.scanAngleRank.data());
+    if (m_lasHeader.hasTime())
+        view.getFieldRange(Id::GpsTime, start, count, f.gpsTime.data());
+    if (m_lasHeader.hasColor())
+    {
+        view.getFieldRange(Id::Red, start, count, f.red.data());
+        view.getFieldRange(Id::Green, start, count, f.green.data());
+        view.getFieldRange(Id::Blue, start, count, f.blue.data());
+    }
+    if (m_lasHeader.hasInfrared())
+        view.getFieldRange(Id::Infrared, start, count, f.infrared.data());
+}
+
+
 bool LasWriter::fillPointBuf(PointRef& point, LeInserter& ostream)
+{
+    m_fields.resize(1);
+    fetchFields(point, 0);
+    return packPoint(point, 0, ostream);
+}
+
+
+// Write the point at position 'i' of the field buffer to the output.
+// 'point' refers to the same point and is used to fetch extra dimensions.
+bool LasWriter::packPoint(PointRef& point, size_t i, LeInserter& ostream)
 {
     bool has14Format = m_lasHeader.has14Format();
     static const size_t maxReturnCount = m_lasHeader.maxReturnCount();
@@ -1016,12 +1217,9 @@ bool LasWriter::fillPointBuf(PointRef& point, LeInserter& ostream)
     // we always write the base fields
     using namespace Dimension;
 
-    uint8_t returnNumber(1);
-    uint8_t numberOfReturns(1);
-    if (point.hasDim(Id::ReturnNumber))
-        returnNumber = point.getFieldAs<uint8_t>(Id::ReturnNumber);
-    if (point.hasDim(Id::NumberOfReturns))
-        numberOfReturns = point.getFieldAs<uint8_t>(Id::NumberOfReturns);
+    const FieldBuf& f = m_fields;
+    uint8_t returnNumber = f.returnNumber[i];
+    uint8_t numberOfReturns = f.numberOfReturns[i];
     if (numberOfReturns > maxReturnCount)
     {
         if (m_discardHighReturnNumbers)
@@ -1045,9 +1243,9 @@ bool LasWriter::fillPointBuf(PointRef& point, LeInserter& ostream)
         return i;
     };
 
-    double xOrig = point.getFieldAs<double>(Id::X);
-    double yOrig = point.getFieldAs<double>(Id::Y);
-    double zOrig = point.getFieldAs<double>(Id::Z);
+    double xOrig = f.x[i];
+    double yOrig = f.y[i];
+    double zOrig = f.z[i];
     double x = m_scaling.m_xXform.toScaled(xOrig);
     double y = m_scaling.m_yXform.toScaled(yOrig);
     double z = m_scaling.m_zXform.toScaled(zOrig);
@@ -1056,20 +1254,18 @@ bool LasWriter::fillPointBuf(PointRef& point, LeInserter& ostream)
     ostream << converter(y, Id::Y);
     ostream << converter(z, Id::Z);
 
-    ostream << point.getFieldAs<uint16_t>(Id::Intensity);
+    ostream << f.intensity[i];
 
-    uint8_t scanChannel = point.getFieldAs<uint8_t>(Id::ScanChannel);
-    uint8_t scanDirectionFlag =
-        point.getFieldAs<uint8_t>(Id::ScanDirectionFlag);
-    uint8_t edgeOfFlightLine =
-        point.getFieldAs<uint8_t>(Id::EdgeOfFlightLine);
+    uint8_t scanChannel = f.scanChannel[i];
+    uint8_t scanDirectionFlag = f.scanDirectionFlag[i];
+    uint8_t edgeOfFlightLine = f.edgeOfFlightLine[i];
 
     if (has14Format)
     {
         uint8_t bits = returnNumber | (numberOfReturns << 4);
         ostream << bits;
 
-        uint8_t classFlags = point.getFieldAs<uint8_t>(Id::ClassFlags);
+        uint8_t classFlags = f.classFlags[i];
         bits = (classFlags & 0x0F) |
             ((scanChannel & 0x03) << 4) |
             ((scanDirectionFlag & 0x01) << 6) |
@@ -1083,37 +1279,36 @@ bool LasWriter::fillPointBuf(PointRef& point, LeInserter& ostream)
         ostream << bits;
     }
 
-    ostream << point.getFieldAs<uint8_t>(Id::Classification);
+    ostream << f.classification[i];
 
-    uint8_t userData = point.getFieldAs<uint8_t>(Id::UserData);
+    uint8_t userData = f.userData[i];
     if (has14Format)
     {
          // Guaranteed to fit if scan angle rank isn't wonky.
         int16_t scanAngleRank =
-            static_cast<int16_t>(std::round(
-                point.getFieldAs<float>(Id::ScanAngleRank) / .006f));
+            static_cast<int16_t>(std::round(f.scanAngle[i] / .006f));
         ostream << userData << scanAngleRank;
     }
     else
     {
-        int8_t scanAngleRank = point.getFieldAs<int8_t>(Id::ScanAngleRank);
+        int8_t scanAngleRank = f.scanAngleRank[i];
         ostream << scanAngleRank << userData;
     }
 
-    ostream << point.getFieldAs<uint16_t>(Id::PointSourceId);
+    ostream << f.pointSourceId[i];
 
     if (m_lasHeader.hasTime())
-        ostream << point.getFieldAs<double>(Id::GpsTime);
+        ostream << f.gpsTime[i];
 
     if (m_lasHeader.hasColor())
     {
-        ostream << point.getFieldAs<uint16_t>(Id::Red);
-        ostream << point.getFieldAs<uint16_t>(Id::Green);
-        ostream << point.getFieldAs<uint16_t>(Id::Blue);
+        ostream << f.red[i];
+        ostream << f.green[i];
+        ostream << f.blue[i];
     }
 
     if (m_lasHeader.hasInfrared())
-        ostream << point.getFieldAs<uint16_t>(Id::Infrared);
+        ostream << f.infrared[i];
 
     Everything e;
     for (auto& dim : m_extraDims)
@@ -1132,14 +1327,15 @@ point_count_t LasWriter::fillWriteBuf(const PointView& view,
 {
     point_count_t blocksize = buf.size() / m_lasHeader.pointLen();
     blocksize = (std::min)(blocksize, view.size() - startId);
-    PointId lastId = startId + blocksize;
+
+    fetchFields(view, startId, blocksize);
 
     LeInserter ostream(buf.data(), buf.size());
     PointRef point = (const_cast<PointView&>(view)).point(0);
-    for (PointId idx = startId; idx < lastId; idx++)
+    for (point_count_t i = 0; i < blocksize; i++)
     {
-        point.setPointId(idx);
-        fillPointBuf(point, ostream);
+        point.setPointId(startId + i);
+        packPoint(point, i, ostream);
     }
     return blocksize;
 }
@@ -102,6 +102,34 @@ private:
     bool m_forwardVlrs = false;
     LasCompression m_compression;
     std::vector<char> m_pointBuf;
+    std::vector<char> m_batchBuf;
+
+    // Values of the standard point fields for a block of points.
+    struct FieldBuf
+    {
+        void resize(point_count_t count);
+
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<double> z;
+        std::vector<uint16_t> intensity;
+        std::vector<uint8_t> returnNumber;
+        std::vector<uint8_t> numberOfReturns;
+        std::vector<uint8_t> scanChannel;
+        std::vector<uint8_t> scanDirectionFlag;
+        std::vector<uint8_t> edgeOfFlightLine;
+        std::vector<uint8_t> classFlags;
+        std::vector<uint8_t> classification;
+        std::vector<uint8_t> userData;
+        std::vector<float> scanAngle;
+        std::vector<int8_t> scanAngleRank;
+        std::vector<uint16_t> pointSourceId;
+        std::vector<double> gpsTime;
+        std::vector<uint16_t> red;
+        std::vector<uint16_t> green;
+        std::vector<uint16_t> blue;
+        std::vector<uint16_t> infrared;
+    };
     SpatialReference m_aSrs;
     int m_srsCnt;
 
@@ -129,6 +157,8 @@ private:
     bool m_writePDALMetadata;
     std::vector<ExtLasVLR> m_userVLRs;
     bool m_firstPoint;
+    FieldBuf m_fields;
+    size_t m_threads;
 
     virtual void addArgs(ProgramArgs& args);
     virtual void initialize();
@@ -141,6 +171,8 @@ private:
     void prerunFile(const PointViewSet& pvSet);
     virtual void writeView(const PointViewPtr view);
     virtual bool processOne(PointRef& point);
+    virtual point_count_t processBatch(StreamPointTable& table,
+        PointId begin, PointId end);
     void spatialReferenceChanged(const SpatialReference& srs);
     virtual void doneFile();
 
@@ -153,6 +185,10 @@ private:
     void handleHeaderForwards(MetadataNode& forward);
     void fillHeader();
     bool fillPointBuf(PointRef& point, LeInserter& ostream);
+    bool packPoint(PointRef& point, size_t i, LeInserter& ostream);
+    void fetchFields(PointRef& point, size_t i);
+    void fetchFields(const PointView& view, PointId start,
+        point_count_t count);
     point_count_t fillWriteBuf(const PointView& view, PointId startId,
         std::vector<char>& buf);
     bool writeLasZipBuf(PointRef& point);
@@ -177,6 +213,7 @@ private:
     void finishLasZipOutput();
     void finishLazPerfOutput();
     bool processPoint(PointRef& point);
+    void setStreamXForm(PointRef& point);
 
     LasWriter& operator=(const LasWriter&); // not implemented
     LasWriter(const LasWriter&); // not implemented
@@ -36,6 +36,7 @@
 #include "SbetCommon.hpp"
 
 #include <pdal/PointRef.hpp>
+#include <pdal/util/Extractor.hpp>
 #include <pdal/util/FileUtils.hpp>
 
 #define _USE_MATH_DEFINES
@@ -67,21 +68,36 @@ void SbetReader::addDimensions(PointLayoutPtr layout)
 }
 
 
-void SbetReader::ready(PointTableRef)
+void SbetReader::ready(PointTableRef table)
 {
     size_t fileSize = FileUtils::fileSize(m_filename);
-    size_t pointSize = sbet::fileDimensions().size() * sizeof(double);
-    if (fileSize % pointSize != 0)
+    m_pointSize = sbet::fileDimensions().size() * sizeof(double);
+    if (fileSize % m_pointSize != 0)
         throwError("Invalid file size.");
-    m_numPts = fileSize / pointSize;
+    m_numPts = fileSize / m_pointSize;
+    table.reserve((std::min)(m_numPts, m_count));
     m_index = 0;
     m_stream.reset(new ILeStream(m_filename));
     m_dims = sbet::fileDimensions();
     seek(m_index);
+
+    // The file is nothing but points, so parse them directly from a
+    // mapping of the file when possible.
+    m_map = FileUtils::mapFile(m_filename);
+    m_pointData = (const char *)m_map.addr();
 }
 
 
-bool SbetReader::processOne(PointRef& point)
+void SbetReader::done(PointTableRef)
+{
+    m_map = FileUtils::unmapFile(m_map);
+    m_pointData = nullptr;
+    m_stream.reset();
+}
+
+
+template<typename SOURCE>
+void SbetReader::loadPoint(PointRef& point, SOURCE& in)
 {
     auto radiansToDegrees = [](double radians) {
         return radians * 180.0 / M_PI;
@@ -89,13 +105,28 @@ bool SbetReader::processOne(PointRef& point)
     for (auto di = m_dims.begin(); di != m_dims.end(); ++di)
     {
         double d;
-        *m_stream >> d;
+        in >> d;
         Dimension::Id dim = *di;
         if (m_anglesAsDegrees && sbet::isAngularDimension(dim)) {
             d = radiansToDegrees(d);
         }
         point.setField(dim, d);
     }
+}
+
+
+bool SbetReader::processOne(PointRef& point)
+{
+    if (m_pointData)
+    {
+        if (m_index >= m_numPts)
+            return false;
+        LeExtractor in(m_pointData + m_index * m_pointSize, m_pointSize);
+        loadPoint(point, in);
+        m_index++;
+        return true;
+    }
+    loadPoint(point, *m_stream);
     return (m_stream->good());
 }
 
@@ -105,11 +136,18 @@ point_count_t SbetReader::read(PointViewPtr view, point_count_t count)
     PointId nextId = view->size();
     PointId idx = m_index;
     point_count_t numRead = 0;
-    seek(idx);
+    if (!m_pointData)
+        seek(idx);
     while (numRead < count && idx < m_numPts)
     {
         PointRef point = view->point(nextId);
-        processOne(point);
+        if (m_pointData)
+        {
+            LeExtractor in(m_pointData + idx * m_pointSize, m_pointSize);
+            loadPoint(point, in);
+        }
+        else
+            loadPoint(point, *m_stream);
         if (m_cb)
             m_cb(*view, nextId);
 
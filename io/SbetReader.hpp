@@ -37,6 +37,7 @@
 #include <pdal/PointView.hpp>
 #include <pdal/Reader.hpp>
 #include <pdal/Streamable.hpp>
+#include <pdal/util/FileUtils.hpp>
 #include <pdal/util/IStream.hpp>
 #include <pdal/util/ProgramArgs.hpp>
 
@@ -46,8 +47,10 @@ namespace pdal
 class PDAL_DLL SbetReader : public Reader, public Streamable
 {
 public:
-    SbetReader() : Reader()
+    SbetReader() : Reader(), m_pointData(nullptr), m_pointSize(0)
         {}
+    ~SbetReader()
+        { FileUtils::unmapFile(m_map); }
 
     std::string getName() const;
 
@@ -58,14 +61,21 @@ private:
     point_count_t m_index;
     Dimension::IdList m_dims;
     bool m_anglesAsDegrees;
+    // Mapping of the file, from which points are parsed when available.
+    FileUtils::MapContext m_map;
+    const char *m_pointData;
+    size_t m_pointSize;
 
     virtual bool processOne(PointRef& point);
     virtual void addArgs(ProgramArgs& args);
     virtual void addDimensions(PointLayoutPtr layout);
     virtual void ready(PointTableRef table);
     virtual point_count_t read(PointViewPtr view, point_count_t count);
+    virtual void done(PointTableRef table);
     virtual bool eof();
 
+    template<typename SOURCE>
+    void loadPoint(PointRef& point, SOURCE& in);
     void seek(PointId idx);
 };
 
@@ -39,22 +39,40 @@
 #include <limits>
 #include <iostream>
 #include <pdal/pdal_types.hpp>
+#include <pdal/private/RadixSort.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 namespace pdal
 {
 
-//ABELL - In the beginning this data needed to be contiguous, as it was passed
-//  directly to GDAL to write.  Since we started supporting various data types
-//  in GDAL output, we end up copying/casting data to a block for output,
-//  so there's no reason that we must have contiguous data -- we just need
-//  an iterator that allows traversal of the data in row-major order.  So,
-//  this should probably be re-implemented in some way that doesn't require
-//  moving data around every time the grid is resized.
+namespace
+{
+
+// Integer division that rounds toward negative infinity.
+long floorDiv(long a, long b)
+{
+    return (a >= 0) ? a / b : -((b - 1 - a) / b);
+}
+
+// Clamp a (possibly huge or NaN) cell position to [low, high].
+long clampIndex(double v, long low, long high)
+{
+    if (!(v >= low))
+        return low;
+    if (!(v <= high))
+        return high;
+    return static_cast<long>(v);
+}
+
+} // unnamed namespace
+
 
 GDALGrid::GDALGrid(size_t width, size_t height, double edgeLength,
         double radius, int outputTypes, size_t windowSize, double power) :
     m_width(width), m_height(height), m_windowSize(windowSize),
-    m_edgeLength(edgeLength), m_radius(radius), m_power(power), m_outputTypes(outputTypes)
+    m_edgeLength(edgeLength), m_radius(radius), m_power(power),
+    m_outputTypes(outputTypes), m_xShift(0), m_yShift(0), m_tileCol0(0),
+    m_tileRow0(0), m_tileCols(0), m_tileRows(0), m_closedRows(0)
 {
     if (width > (size_t)(std::numeric_limits<int>::max)() ||
         height > (size_t)(std::numeric_limits<int>::max)())
@@ -65,27 +83,25 @@ GDALGrid::GDALGrid(size_t width, size_t height, double edgeLength,
             "Try setting bounds or increasing resolution.";
         throw error(oss.str());
     }
-    size_t size(width * height);
 
-    m_count.reset(new DataVec(size));
-    if (m_outputTypes & statMin)
-        m_min.reset(new DataVec(size, (std::numeric_limits<double>::max)()));
-    if (m_outputTypes & statMax)
-        m_max.reset(new DataVec(size, std::numeric_limits<double>::lowest()));
-    if (m_outputTypes & statIdw)
-    {
-        m_idw.reset(new DataVec(size));
-        m_idwDist.reset(new DataVec(size));
-    }
-    if ((m_outputTypes & statMean) || (m_outputTypes & statStdDev))
-        m_mean.reset(new DataVec(size));
-    if (m_outputTypes & statStdDev)
-        m_stdDev.reset(new DataVec(size));
+    m_bands[Count] = true;
+    m_bands[Min] = (m_outputTypes & statMin);
+    m_bands[Max] = (m_outputTypes & statMax);
+    m_bands[Mean] = (m_outputTypes & statMean) || (m_outputTypes & statStdDev);
+    m_bands[StdDev] = (m_outputTypes & statStdDev);
+    m_bands[Idw] = (m_outputTypes & statIdw);
+    m_bands[IdwDist] = (m_outputTypes & statIdw);
+    m_rowState.assign(m_height, Open);
+    resizeTiles();
 }
 
 
+GDALGrid::~GDALGrid()
+{}
+
+
 /**
-  Expand the grid to a new size.
+  Expand the grid to a new size.  No cell data is moved.
 
   /param width
 */
@@ -102,45 +118,112 @@ void GDALGrid::expand(size_t width, size_t height, size_t xshift, size_t yshift)
             "during expansion.");
     if (width == m_width && height == m_height)
         return;
+    if (m_closedRows)
+        throw error("Can't expand a grid after rows have been finalized.");
 
     // Grid (raster) works upside down from standard X/Y.
-    yshift = height - (m_height + yshift);
-    auto moveVec = [=](DataPtr& src, double initializer)
-    {
-        // Compute an index in the destination given source index coords.
-        auto dstIndex = [width, xshift, yshift](size_t i, size_t j)
-        {
-            return ((yshift + j) * width) + i + xshift;
-        };
+    m_xShift += xshift;
+    m_yShift += height - (m_height + yshift);
+    m_width = width;
+    m_height = height;
+    m_rowState.assign(m_height, Open);
+    resizeTiles();
+}
+
+
+long GDALGrid::tileCol(long i) const
+{
+    return floorDiv(i - (long)m_xShift, (long)TileSize);
+}
 
-        size_t size(width * height);
-        DataPtr dst(new DataVec(size, initializer));
-        for (size_t j = 0; j < m_height; ++j)
+
+long GDALGrid::tileRow(long j) const
+{
+    return floorDiv(j - (long)m_yShift, (long)TileSize);
+}
+
+
+void GDALGrid::resizeTiles()
+{
+    long col0 = tileCol(0);
+    long row0 = tileRow(0);
+    size_t cols = tileCol(m_width - 1) - col0 + 1;
+    size_t rows = tileRow(m_height - 1) - row0 + 1;
+
+    // The grid only grows, so existing tiles are all kept.
+    std::vector<std::unique_ptr<Tile>> tiles(cols * rows);
+    for (size_t row = 0; row < m_tileRows; ++row)
+        for (size_t col = 0; col < m_tileCols; ++col)
         {
-            size_t srcPos = index(0, j);
-            size_t dstPos = dstIndex(0, j);
-            std::copy(src->begin() + srcPos, src->begin() + srcPos + m_width,
-                dst->begin() + dstPos);
+            std::unique_ptr<Tile>& t = m_tiles[row * m_tileCols + col];
+            if (t)
+                tiles[(m_tileRow0 + row - row0) * cols +
+                    (m_tileCol0 + col - col0)] = std::move(t);
         }
-        src = std::move(dst);
-    };
+    m_tiles = std::move(tiles);
+    m_tileCol0 = col0;
+    m_tileRow0 = row0;
+    m_tileCols = cols;
+    m_tileRows = rows;
+}
 
-    moveVec(m_count, 0);
-    if (m_outputTypes & statMin)
-        moveVec(m_min, (std::numeric_limits<double>::max)());
-    if (m_outputTypes & statMax)
-        moveVec(m_max, std::numeric_limits<double>::lowest());
-    if (m_outputTypes & statIdw)
+
+// Return the cells covered by a tile.  The range may extend past the
+// edges of the grid.
+GDALGrid::CellRange GDALGrid::tileCells(size_t tileIdx) const
+{
+    long col = m_tileCol0 + (long)(tileIdx % m_tileCols);
+    long row = m_tileRow0 + (long)(tileIdx / m_tileCols);
+
+    CellRange cells;
+    cells.iMin = col * (long)TileSize + (long)m_xShift;
+    cells.iMax = cells.iMin + TileSize - 1;
+    cells.jMin = row * (long)TileSize + (long)m_yShift;
+    cells.jMax = cells.jMin + TileSize - 1;
+    return cells;
+}
+
+
+GDALGrid::Tile *GDALGrid::cell(size_t i, size_t j, size_t& offset) const
+{
+    long col = tileCol(i);
+    long row = tileRow(j);
+    long ii = (long)i - (long)m_xShift - col * (long)TileSize;
+    long jj = (long)j - (long)m_yShift - row * (long)TileSize;
+    offset = jj * TileSize + ii;
+    return m_tiles[tileIndex(col, row)].get();
+}
+
+
+GDALGrid::Tile& GDALGrid::tile(size_t tileIdx)
+{
+    std::unique_ptr<Tile>& t = m_tiles[tileIdx];
+    if (!t)
     {
-        moveVec(m_idw, 0);
-        moveVec(m_idwDist, 0);
+        const size_t size = TileSize * TileSize;
+
+        t.reset(new Tile);
+        for (int band = 0; band < NumBands; ++band)
+            if (m_bands[band])
+                t->bands[band].resize(size);
+        if (m_bands[Min])
+            t->bands[Min].assign(size, (std::numeric_limits<double>::max)());
+        if (m_bands[Max])
+            t->bands[Max].assign(size, std::numeric_limits<double>::lowest());
+
+        // Cells of rows that have already been filled have no data.
+        if (m_closedRows)
+        {
+            CellRange cells = tileCells(tileIdx);
+            long jMin = (std::max)(cells.jMin, 0L);
+            long jMax = (std::min)(cells.jMax, (long)m_height - 1);
+            for (long j = jMin; j <= jMax; ++j)
+                if (m_rowState[j] == Filled || m_rowState[j] == Released)
+                    for (size_t i = 0; i < TileSize; ++i)
+                        fillNodata(*t, (j - cells.jMin) * TileSize + i);
+        }
     }
-    if ((m_outputTypes & statMean) || (m_outputTypes & statStdDev))
-        moveVec(m_mean, 0);
-    if (m_outputTypes & statStdDev)
-        moveVec(m_stdDev, 0);
-    m_width = width;
-    m_height = height;
+    return *t;
 }
 
 
@@ -164,211 +247,156 @@ int GDALGrid::numBands() const
 }
 
 
-double *GDALGrid::data(const std::string& name)
+GDALGrid::BandIter GDALGrid::data(const std::string& name) const
 {
     if (name == "count" && (m_outputTypes & statCount))
-        return m_count->data();
+        return BandIter(this, Count, 0);
     if (name == "min" && (m_outputTypes & statMin))
-        return m_min->data();
+        return BandIter(this, Min, 0);
     if (name == "max" && (m_outputTypes & statMax))
-        return m_max->data();
+        return BandIter(this, Max, 0);
     if (name == "mean" && (m_outputTypes & statMean))
-        return m_mean->data();
+        return BandIter(this, Mean, 0);
     if (name == "idw" && (m_outputTypes & statIdw))
-         return m_idw->data();
+        return BandIter(this, Idw, 0);
     if (name == "stdev" && (m_outputTypes & statStdDev))
-        return m_stdDev->data();
-    return nullptr;
+        return BandIter(this, StdDev, 0);
+    return BandIter();
 }
 
 
-void GDALGrid::addPoint(double x, double y, double z)
+// Every cell whose center is less than the radius from a point is updated
+// with the point's value.  The range returned includes a margin so that
+// no such cell is missed because of rounding.
+GDALGrid::CellRange GDALGrid::cellRange(double x, double y) const
 {
-    // Here's the logic... we divide the cells around the subject cell
-    // (at iOrigin, jOrigin) into four quadrants.  We move outward from the
-    // subject cell, checking distance until we find that we're farther than
-    // permitted by the radius, then we move up (down, over, whatever) a row
-    // or column and do it again until we find a case where there's not a
-    // single cell in the row that meets our criteria.
-    // There are easier ways to figure out which cells will be close enough,
-    // be we need the precise distance for all those cells that we already
-    // know will qualify, so I don't think there's much overhead here that
-    // we can avoid.
-
-    // The four quadrant cases could certainly be merged into one, but I
-    // think it would be harder to follow and there's really not that
-    // much code here.
-
-    // The quadrants are the standard mathematical ones.  Here's a picture
-    // of how things kind of work.  At the end we update the central cell.
-
-    //            ^ ->
-    //          ^ | -->
-    //        ^ | | --->
-    //      ^ | | | ---->
-    //   <------- X ------>
-    //    <------ | | | v
-    //     <----- | | v
-    //       <--- | v
-    //         <- v
-
-    updateFirstQuadrant(x, y, z);
-    updateSecondQuadrant(x, y, z);
-    updateThirdQuadrant(x, y, z);
-    updateFourthQuadrant(x, y, z);
-
-    int iOrigin = horizontalIndex(x);
-    int jOrigin = verticalIndex(y);
-
-    // This is a questionable case.  If a point is in a cell, shouldn't
-    // it just be counted?
-    double d = distance(iOrigin, jOrigin, x, y);
-    if (d < m_radius &&
-        iOrigin >= 0 && jOrigin >= 0 &&
-        iOrigin < (int)m_width && jOrigin < (int)m_height)
-        update(iOrigin, jOrigin, z, d);
+    const long maxI = (long)m_width - 1;
+    const long maxJ = (long)m_height - 1;
+
+    CellRange cells;
+    cells.iMin = clampIndex(std::floor((x - m_radius) / m_edgeLength) - 1,
+        0, maxI + 1);
+    cells.iMax = clampIndex(std::floor((x + m_radius) / m_edgeLength) + 1,
+        -1, maxI);
+    // Rows are numbered from the top.
+    cells.jMin = clampIndex(maxJ -
+        (std::floor((y + m_radius) / m_edgeLength) + 1), 0, maxJ + 1);
+    cells.jMax = clampIndex(maxJ -
+        (std::floor((y - m_radius) / m_edgeLength) - 1), -1, maxJ);
+    return cells;
 }
 
 
-void GDALGrid::updateFirstQuadrant(double x, double y, double z)
+void GDALGrid::rowRange(double y, long& jMin, long& jMax) const
 {
-    int i, j;
-    int iStart;
-    int iOrigin = horizontalIndex(x);
-    int jOrigin = verticalIndex(y);
+    CellRange cells = cellRange(0, y);
+    jMin = cells.jMin;
+    jMax = cells.jMax;
+}
 
-    i = iStart = (std::max)(0, iOrigin + 1);
-    j = (std::min)(jOrigin, int(m_height - 1));
 
-    if (iStart >= (int)m_width)
+void GDALGrid::checkOpen(const CellRange& cells) const
+{
+    if (!m_closedRows)
         return;
-
-    while (j >= 0)
-    {
-        double d = distance(i, j, x, y);
-        if (d < m_radius)
-        {
-            update(i, j, z, d);
-            i++;
-            if (i < (int)m_width)
-                continue;
-        }
-
-        // Either d >= m_radius or we've hit the end of a row (i == m_width),
-        // so move to the next row.
-        if (i == iStart)
-            break;
-        i = iStart;
-        j--;
-    }
+    for (long j = cells.jMin; j <= cells.jMax; ++j)
+        if (m_rowState[j] != Open)
+            throw error("Point affects cells of the grid that have already "
+                "been finalized.");
 }
 
 
-void GDALGrid::updateSecondQuadrant(double x, double y, double z)
+void GDALGrid::addPoint(double x, double y, double z)
 {
-    int i, j;
-    int jStart;
-    int iOrigin = horizontalIndex(x);
-    int jOrigin = verticalIndex(y);
-
-    i = (std::min)(iOrigin, int(m_width - 1));
-    j = jStart = (std::min)(jOrigin - 1, int(m_height - 1));
-
-    if (jStart < 0)
+    CellRange cells = cellRange(x, y);
+    if (cells.empty())
         return;
+    checkOpen(cells);
 
-    while (i >= 0)
-    {
-        double d = distance(i, j, x, y);
-        if (d < m_radius)
+    for (long row = tileRow(cells.jMin); row <= tileRow(cells.jMax); ++row)
+        for (long col = tileCol(cells.iMin); col <= tileCol(cells.iMax);
+                ++col)
         {
-            update(i, j, z, d);
-            j--;
-            if (j >= 0)
-                continue;
+            size_t tileIdx = tileIndex(col, row);
+            tile(tileIdx);
+            addPoint(tileIdx, x, y, z);
         }
-
-        // Either d >= m_radius or we've hit the end of a column (j < 0),
-        // so move to the next column.
-        if (j == jStart)
-            break;
-        j = jStart;
-        i--;
-    }
 }
 
 
-void GDALGrid::updateThirdQuadrant(double x, double y, double z)
+void GDALGrid::addPoints(const double *x, const double *y, const double *z,
+    size_t count)
 {
-    int i, j;
-    int iStart;
-    int iOrigin = horizontalIndex(x);
-    int jOrigin = verticalIndex(y);
-
-    i = iStart = (std::min)(iOrigin - 1, int(m_width - 1));
-    j = (std::max)(jOrigin, 0);
-
-    if (iStart < 0)
-        return;
-
-    while (j < (int)m_height)
+    // Group the points by the tiles they affect.  A point near the edge
+    // of a tile is added to each neighboring tile within its radius.  The
+    // sort is stable, so each tile gets its points in the order given.
+    SortEntries entries;
+    entries.reserve(count);
+    for (size_t idx = 0; idx < count; ++idx)
     {
-        double d = distance(i, j, x, y);
-        if (d < m_radius)
+        CellRange cells = cellRange(x[idx], y[idx]);
+        if (cells.empty())
+            continue;
+        checkOpen(cells);
+        for (long row = tileRow(cells.jMin); row <= tileRow(cells.jMax);
+                ++row)
+            for (long col = tileCol(cells.iMin);
+                    col <= tileCol(cells.iMax); ++col)
+                entries.push_back(SortEntry(tileIndex(col, row), idx));
+    }
+    radixSort(entries);
+
+    // Tiles are allocated up front so that threads only update cells.
+    std::vector<size_t> groups;
+    for (size_t i = 0; i < entries.size(); ++i)
+        if (i == 0 || entries[i].first != entries[i - 1].first)
         {
-            update(i, j, z, d);
-            i--;
-            if (i >= 0)
-                continue;
+            groups.push_back(i);
+            tile(entries[i].first);
         }
+    groups.push_back(entries.size());
 
-        // Either d >= m_radius or we've hit the end of a row (i < 0),
-        // so move to the next row.
-        if (i == iStart)
-            break;
-        i = iStart;
-        j++;
-    }
+    parallelFor(0, groups.size() - 1,
+        [this, &groups, &entries, x, y, z](size_t begin, size_t end)
+        {
+            for (size_t group = begin; group < end; ++group)
+                for (size_t i = groups[group]; i < groups[group + 1]; ++i)
+                {
+                    size_t idx = entries[i].second;
+                    addPoint(entries[i].first, x[idx], y[idx], z[idx]);
+                }
+        }, 0, 1);
 }
 
 
-void GDALGrid::updateFourthQuadrant(double x, double y, double z)
+void GDALGrid::addPoint(size_t tileIdx, double x, double y, double z)
 {
-
-    int i, j;
-    int jStart;
-    int iOrigin = horizontalIndex(x);
-    int jOrigin = verticalIndex(y);
-
-    i = (std::max)(iOrigin, 0);
-    j = jStart = (std::max)(jOrigin + 1, 0);
-
-    if (jStart >= (int)m_height)
-        return;
-
-    while (i < (int)m_width)
+    CellRange cells = cellRange(x, y);
+    CellRange tileCells = this->tileCells(tileIdx);
+    Tile& t = *m_tiles[tileIdx];
+
+    long iMin = (std::max)(cells.iMin, tileCells.iMin);
+    long iMax = (std::min)(cells.iMax, tileCells.iMax);
+    long jMin = (std::max)(cells.jMin, tileCells.jMin);
+    long jMax = (std::min)(cells.jMax, tileCells.jMax);
+    for (long j = jMin; j <= jMax; ++j)
     {
-        double d = distance(i, j, x, y);
-        if (d < m_radius)
+        // The distance to a cell is at least the vertical distance.
+        if (std::abs(verticalPos(j) - y) >= m_radius)
+            continue;
+        size_t offset = (j - tileCells.jMin) * TileSize +
+            (iMin - tileCells.iMin);
+        for (long i = iMin; i <= iMax; ++i, ++offset)
         {
-            update(i, j, z, d);
-            j++;
-            if (j < (int)m_height)
-                continue;
+            double d = distance(i, j, x, y);
+            if (d < m_radius)
+                update(t, offset, z, d);
         }
-
-
-        // Either d >= m_radius or we've hit the end of a column (j == m_height)
-        // so move to the next row.
-        if (j == jStart)
-            break;
-        j = jStart;
-        i++;
     }
 }
 
 
-void GDALGrid::update(size_t i, size_t j, double val, double dist)
+void GDALGrid::update(Tile& tile, size_t offset, double val, double dist)
 {
     // Once we determine that a point is close enough to a cell to count it,
     // this function does the actual math.  We use the value of the
@@ -380,40 +408,38 @@ void GDALGrid::update(size_t i, size_t j, double val, double dist)
     // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance
     // https://en.wikipedia.org/wiki/Inverse_distance_weighting
 
-    size_t offset = index(i, j);
-
-    double& count = (*m_count)[offset];
+    double& count = tile.bands[Count][offset];
     count++;
 
-    if (m_min)
+    if (m_bands[Min])
     {
-        double& min = (*m_min)[offset];
+        double& min = tile.bands[Min][offset];
         min = (std::min)(val, min);
     }
 
-    if (m_max)
+    if (m_bands[Max])
     {
-        double& max = (*m_max)[offset];
+        double& max = tile.bands[Max][offset];
         max = (std::max)(val, max);
     }
 
-    if (m_mean)
+    if (m_bands[Mean])
     {
-        double& mean = (*m_mean)[offset];
+        double& mean = tile.bands[Mean][offset];
         double delta = val - mean;
 
         mean += delta / count;
-        if (m_stdDev)
+        if (m_bands[StdDev])
         {
-            double& stdDev = (*m_stdDev)[offset];
+            double& stdDev = tile.bands[StdDev][offset];
             stdDev += delta * (val - mean);
         }
     }
 
-    if (m_idw)
+    if (m_bands[Idw])
     {
-        double& idw = (*m_idw)[offset];
-        double& idwDist = (*m_idwDist)[offset];
+        double& idw = tile.bands[Idw][offset];
+        double& idwDist = tile.bands[IdwDist][offset];
 
         // If the distance is 0, we set the idwDist to nan to signal that
         // we should ignore the distance and take the value as is.
@@ -434,49 +460,182 @@ void GDALGrid::update(size_t i, size_t j, double val, double dist)
 }
 
 void GDALGrid::finalize()
+{
+    finalizeRows(0, m_height);
+    fillRows(0, m_height);
+}
+
+
+void GDALGrid::finalizeRows(size_t begin, size_t end)
+{
+    std::vector<size_t> rows;
+    for (size_t j = begin; j < end; ++j)
+        if (m_rowState[j] == Open)
+        {
+            m_rowState[j] = Closed;
+            m_closedRows++;
+            rows.push_back(j);
+        }
+
+    parallelFor(0, rows.size(), [this, &rows](size_t first, size_t last)
+    {
+        for (size_t r = first; r < last; ++r)
+        {
+            long j = (long)rows[r];
+            long row = tileRow(j);
+            for (long col = tileCol(0); col <= tileCol(m_width - 1); ++col)
+            {
+                Tile *t = tileAt(col, row);
+                if (!t)
+                    continue;
+                CellRange cells = tileCells(tileIndex(col, row));
+                long iMin = (std::max)(cells.iMin, 0L);
+                long iMax = (std::min)(cells.iMax, (long)m_width - 1);
+                size_t offset = (j - cells.jMin) * TileSize +
+                    (iMin - cells.iMin);
+                for (long i = iMin; i <= iMax; ++i, ++offset)
+                    if (!empty(*t, offset))
+                        finalizeCell(*t, offset);
+            }
+        }
+    });
+}
+
+
+void GDALGrid::finalizeCell(Tile& tile, size_t offset)
 {
     // See
     // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance
     // https://en.wikipedia.org/wiki/Inverse_distance_weighting
-    if (m_stdDev)
-        for (size_t i = 0; i < m_count->size(); ++i)
-            if (!empty(i))
-                (*m_stdDev)[i] = sqrt((*m_stdDev)[i] / (*m_count)[i]);
-
-    if (m_idw)
-        for (size_t i = 0; i < m_count->size(); ++i)
-            if (!empty(i))
+    if (m_bands[StdDev])
+        tile.bands[StdDev][offset] =
+            sqrt(tile.bands[StdDev][offset] / tile.bands[Count][offset]);
+    if (m_bands[Idw])
+    {
+        double& distSum = tile.bands[IdwDist][offset];
+        if (!std::isnan(distSum))
+            tile.bands[Idw][offset] /= distSum;
+    }
+}
+
+
+void GDALGrid::fillRows(size_t begin, size_t end)
+{
+    if (begin >= end)
+        return;
+
+    // Empty cells within the window of a cell with data get filled, so
+    // allocate the tiles of the rows that are near existing tiles.
+    const long window = (long)m_windowSize;
+    if (window > 0)
+    {
+        std::vector<size_t> needed;
+        for (long row = tileRow(begin); row <= tileRow(end - 1); ++row)
+            for (long col = tileCol(0); col <= tileCol(m_width - 1); ++col)
             {
-                double& distSum = (*m_idwDist)[i];
-                if (!std::isnan(distSum))
-                    (*m_idw)[i] /= distSum;
+                size_t tileIdx = tileIndex(col, row);
+                if (m_tiles[tileIdx])
+                    continue;
+                CellRange cells = tileCells(tileIdx);
+                long iMin = (std::max)(cells.iMin - window, 0L);
+                long iMax = (std::min)(cells.iMax + window,
+                    (long)m_width - 1);
+                long jMin = (std::max)(cells.jMin - window, 0L);
+                long jMax = (std::min)(cells.jMax + window,
+                    (long)m_height - 1);
+                bool near = false;
+                for (long r = tileRow(jMin); r <= tileRow(jMax); ++r)
+                    for (long c = tileCol(iMin); c <= tileCol(iMax); ++c)
+                        near = near || tileAt(c, r);
+                if (near)
+                    needed.push_back(tileIdx);
             }
+        for (size_t tileIdx : needed)
+            tile(tileIdx);
+    }
+    for (size_t j = begin; j < end; ++j)
+        if (m_rowState[j] == Closed)
+            m_rowState[j] = Filled;
 
-    if (m_windowSize > 0)
-        windowFill();
-    else
-        for (size_t i = 0; i < m_count->size(); ++i)
-            if (empty(i))
-                fillNodata(i);
+    // Filling only writes empty cells and only reads cells with data, so
+    // rows can be filled at the same time.
+    parallelFor(begin, end, [this](size_t first, size_t last)
+    {
+        for (long j = (long)first; j < (long)last; ++j)
+        {
+            long row = tileRow(j);
+            for (long col = tileCol(0); col <= tileCol(m_width - 1); ++col)
+            {
+                Tile *t = tileAt(col, row);
+                if (!t)
+                    continue;
+                CellRange cells = tileCells(tileIndex(col, row));
+                long iMin = (std::max)(cells.iMin, 0L);
+                long iMax = (std::min)(cells.iMax, (long)m_width - 1);
+                size_t offset = (j - cells.jMin) * TileSize +
+                    (iMin - cells.iMin);
+                for (long i = iMin; i <= iMax; ++i, ++offset)
+                {
+                    if (!empty(*t, offset))
+                        continue;
+                    if (m_windowSize > 0)
+                        windowFill(*t, i, j, offset);
+                    else
+                        fillNodata(*t, offset);
+                }
+            }
+        }
+    });
+}
+
+
+void GDALGrid::releaseRows(size_t begin, size_t end)
+{
+    if (begin >= end)
+        return;
+
+    for (size_t j = begin; j < end; ++j)
+    {
+        if (m_rowState[j] == Open)
+            m_closedRows++;
+        m_rowState[j] = Released;
+    }
+
+    // Free the tiles of tile rows whose rows have all been released.
+    for (long row = tileRow(begin); row <= tileRow(end - 1); ++row)
+    {
+        CellRange cells = tileCells(tileIndex(tileCol(0), row));
+        long jMin = (std::max)(cells.jMin, 0L);
+        long jMax = (std::min)(cells.jMax, (long)m_height - 1);
+        bool released = true;
+        for (long j = jMin; j <= jMax; ++j)
+            released = released && (m_rowState[j] == Released);
+        if (released)
+            for (long col = tileCol(0); col <= tileCol(m_width - 1); ++col)
+                m_tiles[tileIndex(col, row)].reset();
+    }
 }
 
 
-void GDALGrid::fillNodata(size_t i)
+void GDALGrid::fillNodata(Tile& tile, size_t offset)
 {
-    if (m_min)
-        (*m_min)[i] = std::numeric_limits<double>::quiet_NaN();
-    if (m_max)
-        (*m_max)[i] = std::numeric_limits<double>::quiet_NaN();
-    if (m_mean)
-        (*m_mean)[i] = std::numeric_limits<double>::quiet_NaN();
-    if (m_idw)
-        (*m_idw)[i] = std::numeric_limits<double>::quiet_NaN();
-    if (m_stdDev)
-        (*m_stdDev)[i] = std::numeric_limits<double>::quiet_NaN();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    if (m_bands[Min])
+        tile.bands[Min][offset] = nan;
+    if (m_bands[Max])
+        tile.bands[Max][offset] = nan;
+    if (m_bands[Mean])
+        tile.bands[Mean][offset] = nan;
+    if (m_bands[Idw])
+        tile.bands[Idw][offset] = nan;
+    if (m_bands[StdDev])
+        tile.bands[StdDev][offset] = nan;
 }
 
 
-void GDALGrid::windowFill(size_t dstI, size_t dstJ)
+void GDALGrid::windowFill(Tile& tile, size_t dstI, size_t dstJ,
+    size_t dstOffset)
 {
     size_t istart = dstI > m_windowSize ? dstI - m_windowSize : (size_t)0;
     size_t iend = (std::min)(width(), dstI + m_windowSize + 1);
@@ -484,60 +643,73 @@ void GDALGrid::windowFill(size_t dstI, size_t dstJ)
     size_t jend = (std::min)(height(), dstJ + m_windowSize + 1);
 
     double distSum = 0;
-    size_t dstIdx = index(dstI, dstJ);
 
     // Initialize to 0 (rather than numeric_limits::max/lowest) since we're
     // going to accumulate and average.
-    if (m_min)
-        (*m_min)[dstIdx] = 0;
-    if (m_max)
-        (*m_max)[dstIdx] = 0;
+    if (m_bands[Min])
+        tile.bands[Min][dstOffset] = 0;
+    if (m_bands[Max])
+        tile.bands[Max][dstOffset] = 0;
 
     for (size_t i = istart; i < iend; ++i)
         for (size_t j = jstart; j < jend; ++j)
         {
-            size_t srcIdx = index(i, j);
-            if ((srcIdx == dstIdx) || empty(srcIdx))
+            size_t srcOffset;
+            const Tile *src = cell(i, j, srcOffset);
+            if ((i == dstI && j == dstJ) || !src || empty(*src, srcOffset))
                 continue;
             // The ternaries just avoid underflow UB.  We're just trying to
             // find the distance from j to dstJ or i to dstI.
             double distance = (double)(std::max)(j > dstJ ? j - dstJ : dstJ - j,
                 i > dstI ? i - dstI : dstI - i);
-            windowFillCell(srcIdx, dstIdx, distance);
+            windowFillCell(*src, srcOffset, tile, dstOffset, distance);
             distSum += (1 / distance);
         }
 
     // Divide summed values by the (inverse) distance sum.
     if (distSum > 0)
     {
-        if (m_min)
-            (*m_min)[dstIdx] /= distSum;
-        if (m_max)
-            (*m_max)[dstIdx] /= distSum;
-        if (m_mean)
-            (*m_mean)[dstIdx] /= distSum;
-        if (m_idw)
-            (*m_idw)[dstIdx] /= distSum;
-        if (m_stdDev)
-            (*m_stdDev)[dstIdx] /= distSum;
+        if (m_bands[Min])
+            tile.bands[Min][dstOffset] /= distSum;
+        if (m_bands[Max])
+            tile.bands[Max][dstOffset] /= distSum;
+        if (m_bands[Mean])
+            tile.bands[Mean][dstOffset] /= distSum;
+        if (m_bands[Idw])
+            tile.bands[Idw][dstOffset] /= distSum;
+        if (m_bands[StdDev])
+            tile.bands[StdDev][dstOffset] /= distSum;
     }
     else
-        fillNodata(dstIdx);
+        fillNodata(tile, dstOffset);
+}
+
+
+void GDALGrid::windowFillCell(const Tile& src, size_t srcOffset, Tile& dst,
+    size_t dstOffset, double distance)
+{
+    for (int band : { Min, Max, Mean, Idw, StdDev })
+        if (m_bands[band])
+            dst.bands[band][dstOffset] +=
+                src.bands[band][srcOffset] / distance;
 }
 
 
-void GDALGrid::windowFillCell(size_t srcIdx, size_t dstIdx, double distance)
+void GDALGrid::BandIter::locate() const
 {
-    if (m_min)
-        (*m_min)[dstIdx] += (*m_min)[srcIdx] / distance;
-    if (m_max)
-        (*m_max)[dstIdx] += (*m_max)[srcIdx] / distance;
-    if (m_mean)
-        (*m_mean)[dstIdx] += (*m_mean)[srcIdx] / distance;
-    if (m_idw)
-        (*m_idw)[dstIdx] += (*m_idw)[srcIdx] / distance;
-    if (m_stdDev)
-        (*m_stdDev)[dstIdx] += (*m_stdDev)[srcIdx] / distance;
+    const size_t i = m_pos % m_grid->m_width;
+    const size_t j = m_pos / m_grid->m_width;
+
+    // The run of cells ends at the edge of the tile or of the grid.
+    size_t offset;
+    const Tile *tile = m_grid->cell(i, j, offset);
+    long tileEnd = (m_grid->tileCol(i) + 1) * (long)TileSize +
+        (long)m_grid->m_xShift;
+    size_t runLength = (std::min)((size_t)tileEnd, m_grid->m_width) - i;
+
+    m_runBegin = m_pos;
+    m_runEnd = m_pos + runLength;
+    m_run = tile ? tile->bands[m_band].data() + offset : nullptr;
 }
 
 } //namespace pdal
@@ -33,6 +33,8 @@
 ****************************************************************************/
 
 #include <math.h>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -43,9 +45,20 @@
 namespace pdal
 {
 
+// The grid is stored as square tiles of cells that are allocated when
+// points first land in them, so that sparse rasters take little memory
+// and expanding the grid doesn't move any data.  Points added in batches
+// are grouped by tile and the tiles are updated in parallel.  Each tile is
+// updated by a single thread in the order the points were added, so the
+// results don't depend on the number of threads.
+//
+// Rows can be finalized, filled and released a range at a time, so that
+// when points arrive in order, the finished part of the grid can be
+// written and its memory freed before all points have been added.
 class GDALGrid
 {
     FRIEND_TEST(GDALWriterTest, issue_2095);
+    struct Tile;
 public:
     static const int statCount = 1;
     static const int statMin = 2;
@@ -60,23 +73,49 @@ public:
         {}
     };
 
+    class BandIter;
+
     // Exported for testing.
     PDAL_DLL GDALGrid(size_t width, size_t height,
         double edgeLength, double radius, int outputTypes, size_t windowSize, double power);
+    PDAL_DLL ~GDALGrid();
 
     void expand(size_t width, size_t height, size_t xshift, size_t yshift);
 
     // Get the number of bands represented by this grid.
     int numBands() const;
 
-    // Return a pointer to the data in a raster band, row-major ordered.
-    double *data(const std::string& name);
+    // Return an iterator to the first cell of a raster band, traversing the
+    // band in row-major order, or an iterator for which valid() is false
+    // if the band isn't being produced.
+    PDAL_DLL BandIter data(const std::string& name) const;
 
     // Add a point to the raster grid.
     void addPoint(double x, double y, double z);
 
+    // Add points to the raster grid.
+    PDAL_DLL void addPoints(const double *x, const double *y, const double *z,
+        size_t count);
+
     // Compute final values after all points have been added.
-    void finalize();
+    PDAL_DLL void finalize();
+
+    // Get the rows (numbered from the top) that a point at vertical
+    // position y may affect.  The range is empty if jMin > jMax.
+    void rowRange(double y, long& jMin, long& jMax) const;
+
+    // Compute the final values of the cells in rows [begin, end).  Rows
+    // that are already finalized are skipped.  Adding a point that affects
+    // a finalized row is an error.
+    void finalizeRows(size_t begin, size_t end);
+
+    // Fill the empty cells of rows [begin, end).  The rows within the
+    // window size of the range must be finalized.
+    void fillRows(size_t begin, size_t end);
+
+    // Note that rows [begin, end) are no longer needed.  A tile is freed
+    // once all of its rows have been released.
+    void releaseRows(size_t begin, size_t end);
 
     size_t width() const
         { return m_width; }
@@ -85,36 +124,79 @@ public:
         { return m_height; }
 
 private:
+    // Cells along each side of a tile.
+    static const size_t TileSize = 256;
+
+    enum Band
+    {
+        Count,
+        Min,
+        Max,
+        Mean,
+        StdDev,
+        Idw,
+        IdwDist,
+        NumBands
+    };
+
+    // State of a row of cells.
+    enum RowState : char
+    {
+        Open,
+        Closed,
+        Filled,
+        Released
+    };
+
+    typedef std::vector<double> DataVec;
+    struct Tile
+    {
+        // Values of each band, or empty if the band isn't used.  Cells are
+        // stored in row-major order.
+        DataVec bands[NumBands];
+    };
+
     size_t m_width;
     size_t m_height;
     size_t m_windowSize;
     double m_edgeLength;
     double m_radius;
     double m_power;
+    int m_outputTypes;
 
-    typedef std::vector<double> DataVec;
-    typedef std::unique_ptr<DataVec> DataPtr;
-    DataPtr m_count;
-    DataPtr m_min;
-    DataPtr m_max;
-    DataPtr m_mean;
-    DataPtr m_stdDev;
-    DataPtr m_idw;
-    DataPtr m_idwDist;
+    // Bands that are computed.
+    bool m_bands[NumBands];
 
-    int m_outputTypes;
+    // Cells added to the left and top of the grid by expansion.  Tiles are
+    // positioned relative to the original top-left cell.
+    size_t m_xShift;
+    size_t m_yShift;
 
-    // Find an index into the actual storage given a grid coordinate.
-    size_t index(size_t i, size_t j) const
-        { return (j * m_width) + i; }
+    // Tiles that cover the grid, in row-major order, starting with the tile
+    // at tile column m_tileCol0 and tile row m_tileRow0.  Tiles are null
+    // until points land in them.
+    std::vector<std::unique_ptr<Tile>> m_tiles;
+    long m_tileCol0;
+    long m_tileRow0;
+    size_t m_tileCols;
+    size_t m_tileRows;
 
-    // Determine if a cell i, j has no associated points.
-    bool empty(size_t i, size_t j) const
-        { return empty(index(i, j)); }
+    // State of each row of the grid and the number of rows that are no
+    // longer open.
+    std::vector<RowState> m_rowState;
+    size_t m_closedRows;
 
-    // Determine if a cell with index \c idx has no associated points.
-    bool empty(size_t idx) const
-        { return ((*m_count)[idx] <= 0); }
+    // Cell range of the grid affected by a point.
+    struct CellRange
+    {
+        long iMin;
+        long iMax;
+        long jMin;
+        long jMax;
+
+        bool empty() const
+            { return iMin > iMax || jMin > jMax; }
+    };
 
     // Convert an absolute X position to a horizontal cell index.
     int horizontalIndex(double x) const
@@ -143,35 +225,130 @@ private:
         return sqrt(pow(x1 - x, 2) + pow(y1 - y, 2));
     }
 
-    // Update cells in the Nth quadrant about point at (x, y, z)
-    void updateFirstQuadrant(double x, double y, double z);
-    void updateSecondQuadrant(double x, double y, double z);
-    void updateThirdQuadrant(double x, double y, double z);
-    void updateFourthQuadrant(double x, double y, double z);
+    // Tile column or row of a cell column or row.
+    long tileCol(long i) const;
+    long tileRow(long j) const;
+    // Index in m_tiles of the tile at a tile column and row.
+    size_t tileIndex(long tileCol, long tileRow) const
+        { return (tileRow - m_tileRow0) * m_tileCols + (tileCol - m_tileCol0); }
+    // Cell range of the grid covered by a tile.
+    CellRange tileCells(size_t tileIdx) const;
+    // Find the tile holding cell i, j and the offset of the cell in the
+    // tile.  Returns null if the tile hasn't been allocated.
+    Tile *cell(size_t i, size_t j, size_t& offset) const;
+    // Make sure a tile is allocated.
+    Tile& tile(size_t tileIdx);
+    // Update the tile table after the grid has changed size.
+    void resizeTiles();
+    // Tile at a tile column and row, or null if it isn't allocated.
+    Tile *tileAt(long tileCol, long tileRow) const
+        { return m_tiles[tileIndex(tileCol, tileRow)].get(); }
 
-    // Update cell at i, j with value at a distance.
-    void update(size_t i, size_t j, double val, double dist);
+    // Cells that may be within the radius of a point.
+    CellRange cellRange(double x, double y) const;
 
-    // Fill cell at index \c i with the nondata value.
-    void fillNodata(size_t i);
+    // Make sure that no cells in a range are in closed rows.
+    void checkOpen(const CellRange& cells) const;
 
-    // Fill an empty cell with a value inverse-distance averaged from
-    // surrounding cells.
-    void windowFill()
-    {
-        for (size_t i = 0; i < width(); ++i)
-            for (size_t j = 0; j < height(); ++j)
-                if (empty(i, j))
-                    windowFill(i, j);
-    }
+    // Update the cells of a tile within the radius of a point.
+    void addPoint(size_t tileIdx, double x, double y, double z);
+
+    // Update cell at an offset in a tile with value at a distance.
+    void update(Tile& tile, size_t offset, double val, double dist);
+
+    // Determine if a cell at an offset in a tile has no associated points.
+    bool empty(const Tile& tile, size_t offset) const
+        { return tile.bands[Count][offset] <= 0; }
+
+    // Compute the final values of the cell at an offset in a tile.
+    void finalizeCell(Tile& tile, size_t offset);
+
+    // Fill cell at an offset in a tile with the nodata value.
+    void fillNodata(Tile& tile, size_t offset);
 
     // Fill empty cell at dstI, dstJ with inverse-distance weighted values
     // from neighboring cells.
-    void windowFill(size_t dstI, size_t dstJ);
+    void windowFill(Tile& tile, size_t dstI, size_t dstJ, size_t dstOffset);
 
     // Cumulate data from a source cell to a destination cell when doing
     // a window fill.
-    void windowFillCell(size_t srcIdx, size_t dstIdx, double distance);
+    void windowFillCell(const Tile& src, size_t srcOffset, Tile& dst,
+        size_t dstOffset, double distance);
+};
+
+
+// Iterator over the cells of a band of a grid, in row-major order.  The
+// iterator supports what GDAL's block writer needs: advancing by a number
+// of cells and reading values one after another.  Cells of tiles that
+// were never allocated have no data.
+class GDALGrid::BandIter
+{
+public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef double value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const double *pointer;
+    typedef double reference;
+
+    BandIter() : m_grid(nullptr), m_band(Count), m_pos(0), m_runBegin(0),
+        m_runEnd(0), m_run(nullptr)
+    {}
+
+    BandIter(const GDALGrid *grid, Band band, size_t pos) : m_grid(grid),
+        m_band(band), m_pos(pos), m_runBegin(0), m_runEnd(0), m_run(nullptr)
+    {}
+
+    bool valid() const
+        { return m_grid; }
+
+    double operator*() const
+    {
+        if (m_pos < m_runBegin || m_pos >= m_runEnd)
+            locate();
+        if (m_run)
+            return m_run[m_pos - m_runBegin];
+        return (m_band == Count) ? 0 :
+            std::numeric_limits<double>::quiet_NaN();
+    }
+
+    BandIter& operator++()
+    {
+        m_pos++;
+        return *this;
+    }
+
+    BandIter operator++(int)
+    {
+        BandIter it(*this);
+        m_pos++;
+        return it;
+    }
+
+    BandIter operator+(size_t n) const
+    {
+        BandIter it(*this);
+        it.m_pos += n;
+        return it;
+    }
+
+    bool operator==(const BandIter& other) const
+        { return m_pos == other.m_pos; }
+    bool operator!=(const BandIter& other) const
+        { return m_pos != other.m_pos; }
+
+private:
+    const GDALGrid *m_grid;
+    Band m_band;
+    size_t m_pos;
+
+    // Positions of a run of cells in a row of the same tile, and the
+    // tile's values for the first cell of the run (null if the tile
+    // doesn't exist).
+    mutable size_t m_runBegin;
+    mutable size_t m_runEnd;
+    mutable const double *m_run;
+
+    void locate() const;
 };
 
 } //namespace pdal
@@ -58,6 +58,8 @@ std::string MergeKernel::getName() const
 void MergeKernel::addSwitches(ProgramArgs& args)
 {
     args.add("files,f", "input/output files", m_files).setPositional();
+    args.add("threads", "Maximum number of input files to read at once",
+        m_threads, (size_t)1);
 }
 
 
@@ -84,7 +86,7 @@ int MergeKernel::execute()
 
     Stage& writer = makeWriter(m_outputFile, filter, "");
     writer.prepare(table);
-    writer.execute(table);
+    writer.execute(table, m_threads);
     return 0;
 }
 
@@ -51,6 +51,7 @@ private:
 
     StringList m_files;
     std::string m_outputFile;
+    std::size_t m_threads;
 };
 
 } // namespace pdal
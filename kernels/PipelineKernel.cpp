@@ -57,7 +57,8 @@ CREATE_STATIC_KERNEL(PipelineKernel, s_info)
 
 std::string PipelineKernel::getName() const { return s_info.name; }
 
-PipelineKernel::PipelineKernel() : m_validate(false), m_progressFd(-1)
+PipelineKernel::PipelineKernel() : m_validate(false), m_progressFd(-1),
+    m_threads(1)
 {}
 
 
@@ -105,6 +106,9 @@ void PipelineKernel::addSwitches(ProgramArgs& args)
     args.add("stream", "Run in stream mode.  Error if not streamable.",
         m_stream);
     args.add("nostream", "Run in standard mode.", m_noStream);
+    args.add("threads", "Maximum number of threads used to run independent "
+        "pipeline branches in standard mode or pipelined stages in stream "
+        "mode.", m_threads, (size_t)1);
     args.add("metadata", "Metadata filename", m_metadataFile);
 }
 
@@ -144,6 +148,7 @@ int PipelineKernel::execute()
     }
 
     m_manager.readPipeline(m_inputFile);
+    m_manager.setThreads(m_threads);
     if (m_manager.execute(m_mode).m_mode == ExecMode::None)
         throw pdal_error("Couldn't run pipeline in requested execution mode.");
 
@@ -64,6 +64,7 @@ private:
     bool m_usestdin;
     bool m_stream;
     bool m_noStream;
+    std::size_t m_threads;
     ExecMode m_mode;
 };
 
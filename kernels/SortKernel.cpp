@@ -35,6 +35,10 @@
 #include "SortKernel.hpp"
 
 #include <pdal/Stage.hpp>
+#include <pdal/Streamable.hpp>
+#include <filters/StreamCallbackFilter.hpp>
+
+#include "private/sort/ExternalSortFilter.hpp"
 
 namespace pdal
 {
@@ -54,7 +58,8 @@ std::string SortKernel::getName() const
 }
 
 
-SortKernel::SortKernel() : m_bCompress(false), m_bForwardMetadata(false)
+SortKernel::SortKernel() : m_bCompress(false), m_bForwardMetadata(false),
+    m_memoryLimit(0)
 {}
 
 
@@ -67,24 +72,86 @@ void SortKernel::addSwitches(ProgramArgs& args)
     args.add("metadata,m",
         "Forward metadata (VLRs, header entries, etc) from previous stages",
         m_bForwardMetadata);
+    args.add("memory_limit", "Memory (in MB) for holding points while "
+        "sorting.  If set, points are sorted in runs that fit in memory, "
+        "written to temporary files and merged.", m_memoryLimit);
+    args.add("temp_dir", "Directory for temporary files when 'memory_limit' "
+        "is set", m_tempDir);
+}
+
+
+// Find the bounds of the input from its header if possible.  Otherwise
+// stream the input once to compute them.
+BOX2D SortKernel::inputBounds(Stage& reader)
+{
+    QuickInfo qi = reader.preview();
+    if (qi.valid() && qi.m_bounds.valid())
+        return qi.m_bounds.to2d();
+
+    BOX2D bounds;
+    Stage& boundsReader = makeReader(m_inputFile, m_driverOverride);
+    StreamCallbackFilter& f = dynamic_cast<StreamCallbackFilter&>(
+        makeFilter("filters.streamcallback", boundsReader));
+    f.setCallback([&bounds](PointRef& point)
+        {
+            bounds.grow(point.getFieldAs<double>(Dimension::Id::X),
+                point.getFieldAs<double>(Dimension::Id::Y));
+            return false;
+        });
+
+    FixedPointTable table(10000);
+    f.prepare(table);
+    f.execute(table);
+    return bounds;
 }
 
 
 int SortKernel::execute()
 {
     Stage& readerStage = makeReader(m_inputFile, m_driverOverride);
-    Stage& sortStage = makeFilter("filters.mortonorder", readerStage);
+
+    // With a memory limit the points are sorted out of core.  This only
+    // works in streaming mode, and the curve must cover the bounds of all
+    // of the input before any point is sorted.
+    std::unique_ptr<ExternalSortFilter> externalSort;
+    Stage *sortStage;
+    if (m_memoryLimit)
+    {
+        if (!readerStage.pipelineStreamable())
+            throw pdal_error("Unable to sort out of core: reader for '" +
+                m_inputFile + "' doesn't support streaming.");
+        externalSort.reset(new ExternalSortFilter(inputBounds(readerStage),
+            CurveKey::Curve::Morton, m_memoryLimit * 1024 * 1024,
+            m_tempDir));
+        externalSort->setLog(readerStage.log());
+        externalSort->setInput(readerStage);
+        sortStage = externalSort.get();
+    }
+    else
+        sortStage = &makeFilter("filters.mortonorder", readerStage);
 
     Options writerOptions;
     if (m_bCompress)
         writerOptions.add("compression", true);
     if (m_bForwardMetadata)
         writerOptions.add("forward_metadata", true);
-    Stage& writer = makeWriter(m_outputFile, sortStage, "", writerOptions);
-
-    PointTable table;
-    writer.prepare(table);
-    writer.execute(table);
+    Stage& writer = makeWriter(m_outputFile, *sortStage, "", writerOptions);
+
+    if (m_memoryLimit)
+    {
+        if (!writer.pipelineStreamable())
+            throw pdal_error("Unable to sort out of core: writer for '" +
+                m_outputFile + "' doesn't support streaming.");
+        FixedPointTable table(10000);
+        writer.prepare(table);
+        writer.execute(table);
+    }
+    else
+    {
+        PointTable table;
+        writer.prepare(table);
+        writer.execute(table);
+    }
 
     return 0;
 }
@@ -48,11 +48,14 @@ public:
 
 private:
     void addSwitches(ProgramArgs& args);
+    BOX2D inputBounds(Stage& reader);
 
     std::string m_inputFile;
     std::string m_outputFile;
     bool m_bCompress;
     bool m_bForwardMetadata;
+    size_t m_memoryLimit;
+    std::string m_tempDir;
 };
 
 } // namespace pdal
@@ -34,10 +34,14 @@
 
 #include "TileKernel.hpp"
 
+#include <thread>
+
+#include <pdal/PDALUtils.hpp>
 #include <pdal/StageFactory.hpp>
 #include <pdal/StageWrapper.hpp>
 #include <pdal/Writer.hpp>
 #include <pdal/util/FileUtils.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 namespace pdal
 {
@@ -51,7 +55,40 @@ static StaticPluginInfo const s_info
 
 CREATE_STATIC_KERNEL(TileKernel, s_info)
 
-TileKernel::TileKernel() : m_table(10000), m_repro(nullptr)
+namespace
+{
+
+// Number of points of a tile that are collected before they're queued for
+// writing.
+const point_count_t TilePoints = 10000;
+// Number of points that may wait to be written before reading pauses.
+const point_count_t MaxQueued = 5000000;
+
+// Storage for the points handled by a reading or writing thread.  All of
+// the tables share the layout of the kernel's table.
+class ThreadPointTable : public StreamPointTable
+{
+public:
+    ThreadPointTable(PointLayout& layout, point_count_t capacity) :
+        StreamPointTable(layout, capacity),
+        m_buf(pointsToBytes(capacity + 1))
+    {}
+
+protected:
+    virtual void reset()
+        { std::fill(m_buf.begin(), m_buf.end(), 0); }
+
+    virtual char *getPoint(PointId idx)
+        { return m_buf.data() + pointsToBytes(idx); }
+
+private:
+    std::vector<char> m_buf;
+};
+
+} // unnamed namespace
+
+TileKernel::TileKernel() : m_table(10000), m_queued(0), m_numWriters(0),
+    m_readDone(false), m_aborted(false)
 {}
 
 
@@ -75,6 +112,11 @@ void TileKernel::addSwitches(ProgramArgs& args)
         m_buffer);
     args.add("out_srs", "Output SRS to which points will be reprojected",
         m_outSrs);
+    args.add("threads", "Maximum number of input files to read at once, "
+        "and number of threads writing tiles", m_threads, (size_t)1);
+    args.add("max_open", "Maximum number of files open at once, including "
+        "input files and temporary files", m_maxOpen, (size_t)500);
+    args.add("temp_dir", "Directory for temporary tile files", m_tempDir);
 }
 
 
@@ -84,6 +126,13 @@ void TileKernel::validateSwitches(ProgramArgs& args)
     if (m_hashPos == std::string::npos)
         throw pdal_error("Output filename must contain a single '#' "
             "template placeholder.");
+    if (m_threads == 0)
+        throw pdal_error("Option 'threads' must be greater than 0.");
+    // Once all input is read, each thread writing a spilled tile has the
+    // tile's temporary file and its output file open.
+    if (m_maxOpen < 2 * m_threads)
+        throw pdal_error("Option 'max_open' must be at least twice the "
+            "value of 'threads'.");
 }
 
 
@@ -98,8 +147,8 @@ int TileKernel::execute()
     for (auto&& file : files)
         readers[file] = prepareReader(file);
     checkReaders(readers);
-    if (m_repro)
-        m_repro->prepare(m_table);
+    for (auto&& rp : m_repros)
+        rp.second->prepare(m_table);
     Options opts;
     opts.add("length", m_length);
     opts.add("buffer", m_buffer);
@@ -107,10 +156,8 @@ int TileKernel::execute()
     m_splitter.prepare(m_table);
 
     m_table.finalize();
+    m_dims = m_table.layout()->dimTypes();
     process(readers);
-    StageWrapper::done(m_splitter, m_table);
-    for (auto&& wp : m_writers)
-        StageWrapper::done(*wp.second, m_table);
     return 0;
 }
 
@@ -163,14 +210,18 @@ void TileKernel::checkReaders(const Readers& readers)
     if (!m_outSrs.empty() && srs != m_outSrs)
         needRepro = true;
 
+    // Input files are read on several threads, so each file gets its own
+    // reprojection filter.
     if (needRepro)
     {
         Options opts;
         opts.add("out_srs", m_outSrs);
 
-        m_repro = dynamic_cast<Streamable *>(
-            &m_manager.makeFilter("filters.reprojection", opts));
+        for (auto& rp : readers)
+            m_repros[rp.first] = dynamic_cast<Streamable *>(
+                &m_manager.makeFilter("filters.reprojection", opts));
     }
+    m_srs = m_outSrs.empty() ? srs : m_outSrs;
 }
 
 
@@ -192,128 +243,446 @@ Streamable *TileKernel::prepareReader(const std::string& filename)
 }
 
 
-// We calculate the origin specially in order to avoid a "first point"
-// check for every point iteration, seeing as we might have BILLIONS
-// of points to process.
-void TileKernel::process(const Readers& readers)
+// If no origin was given, the first point of the first file with points
+// is used.  It's found before any file is read so that files can be read
+// in any order.
+void TileKernel::findOrigin(const Readers& readers)
 {
-    using std::placeholders::_1;
-    using std::placeholders::_2;
-    using std::placeholders::_3;
-    SplitterFilter::PointAdder adder =
-        std::bind(&TileKernel::adder, this, _1, _2, _3);
+    if (!std::isnan(m_xOrigin) && !std::isnan(m_yOrigin))
+    {
+        m_splitter.setOrigin(m_xOrigin, m_yOrigin);
+        return;
+    }
 
-    bool haveOrigin(false);
-    StageWrapper::ready(m_splitter, m_table);
+    ThreadPointTable table(*m_table.layout(), 1);
+    PointRef point(table, 0);
     for (auto&& rp : readers)
     {
         Streamable& r = *(rp.second);
-        std::vector<bool> skips(m_table.capacity());
-        PointId idx(0);
-        PointRef point(m_table, idx);
-
-        StreamableWrapper::ready(r, m_table);
-        if (m_repro)
-            StreamableWrapper::spatialReferenceChanged(*m_repro,
-                r.getSpatialReference());
 
-        // Read first point.
-        bool finished(false);
-        finished = !StreamableWrapper::processOne(r, point);
-        if (!haveOrigin && !finished)
+        StreamableWrapper::ready(r, table);
+        bool found = StreamableWrapper::processOne(r, point);
+        StreamableWrapper::done(r, table);
+        if (found)
         {
             if (std::isnan(m_xOrigin))
                 m_xOrigin = point.getFieldAs<double>(Dimension::Id::X);
             if (std::isnan(m_yOrigin))
                 m_yOrigin = point.getFieldAs<double>(Dimension::Id::Y);
             m_splitter.setOrigin(m_xOrigin, m_yOrigin);
-            haveOrigin = true;
+            return;
+        }
+    }
+}
+
+
+// Input files are read on up to 'threads' threads.  The points of each
+// tile are collected in a queue, and the queued tiles are written by
+// 'threads' other threads.  Of the 'max_open' files that may be open at
+// once, 'threads' are left for the input files.  The rest are shared by
+// the output files of tiles written directly and the temporary files to
+// which the points of other tiles are appended.  Temporary files are
+// written to output once all input is read.
+void TileKernel::process(const Readers& readers)
+{
+    std::vector<std::pair<std::string, Streamable *>> inputs(
+        readers.begin(), readers.end());
+
+    findOrigin(readers);
+    StageWrapper::ready(m_splitter, m_table);
+
+    std::vector<std::thread> writers;
+    for (size_t i = 0; i < m_threads; ++i)
+        writers.push_back(std::thread([this](){ writeTiles(); }));
+
+    parallelFor(0, inputs.size(), [this, &inputs](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                readFile(inputs[i].first, *inputs[i].second);
+        }, m_threads, 1);
+
+    // Write the points left in every tile's queue.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_readDone = true;
+        for (auto& tp : m_tiles)
+            if (tp.second.count)
+                enqueue(tp.first, tp.second);
+        m_cv.notify_all();
+    }
+    for (std::thread& t : writers)
+        t.join();
+
+    try
+    {
+        std::vector<std::pair<Coord, Tile *>> spilled;
+        for (auto& tp : m_tiles)
+        {
+            Tile& tile = tp.second;
+            if (tile.writer && !m_error)
+                StageWrapper::done(*tile.writer, m_table);
+            tile.spill.reset();
+            if (tile.filename.size())
+                spilled.push_back({ tp.first, &tile });
         }
+        m_spills.clear();
+
+        if (!m_error)
+            parallelFor(0, spilled.size(),
+                [this, &spilled](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                        writeSpilled(spilled[i].first, *spilled[i].second);
+                }, m_threads, 1);
+    }
+    catch (...)
+    {
+        fail();
+    }
+
+    StageWrapper::done(m_splitter, m_table);
+    cleanup();
+    if (m_error)
+        std::rethrow_exception(m_error);
+}
+
+
+// Read the points of a file, reproject them if necessary, and add them
+// to the queues of the tiles that contain them.
+void TileKernel::readFile(const std::string& filename, Streamable& reader)
+{
+    try
+    {
+        ThreadPointTable table(*m_table.layout(), m_table.capacity());
+        const size_t pointSize = m_table.layout()->pointSize();
+
+        auto ri = m_repros.find(filename);
+        Streamable *repro = (ri == m_repros.end()) ? nullptr : ri->second;
+
+        StreamableWrapper::ready(reader, table);
+        if (repro)
+            StreamableWrapper::spatialReferenceChanged(*repro,
+                reader.getSpatialReference());
+
+        std::map<Coord, std::vector<char>> points;
+        SplitterFilter::PointAdder adder =
+            [this, &points, pointSize](PointRef& point, int xpos, int ypos)
+            {
+                std::vector<char>& buf = points[Coord(xpos, ypos)];
+                buf.resize(buf.size() + pointSize);
+                point.getPackedData(m_dims, buf.data() + buf.size() -
+                    pointSize);
+            };
 
-        idx++;
+        bool finished(false);
         while (!finished)
         {
-            // Read subsequent points.
-            while (true)
+            point_count_t count = StreamableWrapper::processBatch(reader,
+                table, 0, table.capacity());
+            finished = (count < table.capacity());
+            if (repro)
+                StreamableWrapper::processBatch(*repro, table, 0, count);
+
+            PointRef point(table, 0);
+            for (PointId idx = 0; idx < count; ++idx)
             {
+                if (table.skip(idx))
+                    continue;
                 point.setPointId(idx);
-                finished = !StreamableWrapper::processOne(r, point);
-                idx++;
-                if (idx == m_table.capacity() || finished)
-                    break;
+                m_splitter.processPoint(point, adder);
             }
-            PointId last = idx - 1;
+            table.clear(count);
+            if (!queuePoints(points))
+                return;
+        }
+        StreamableWrapper::done(reader, table);
+        if (repro)
+            StreamableWrapper::done(*repro, table);
+    }
+    catch (...)
+    {
+        fail();
+    }
+}
+
+
+// Move points read by a thread to the queues of their tiles.  Tiles with
+// enough points are queued for writing.  If too many points are waiting
+// to be written, every tile with points is queued and reading waits until
+// the writing threads catch up.  Returns false if processing failed.
+bool TileKernel::queuePoints(std::map<Coord, std::vector<char>>& points)
+{
+    const size_t pointSize = m_table.layout()->pointSize();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (auto& pp : points)
+    {
+        Tile& tile = m_tiles[pp.first];
+        const std::vector<char>& buf = pp.second;
+        const point_count_t count = buf.size() / pointSize;
+        tile.buf.insert(tile.buf.end(), buf.begin(), buf.end());
+        tile.count += count;
+        m_queued += count;
+        if (tile.count >= TilePoints)
+            enqueue(pp.first, tile);
+    }
+    points.clear();
+
+    if (m_queued >= MaxQueued)
+        for (auto& tp : m_tiles)
+            if (tp.second.count)
+                enqueue(tp.first, tp.second);
+    m_cv.notify_all();
+    m_cv.wait(lock, [this]() { return m_aborted || m_queued < MaxQueued; });
+    return !m_aborted;
+}
+
 
-            SpatialReference srs = r.getSpatialReference();
-            if (!srs.empty())
-                m_table.setSpatialReference(srs);
-            // Reproject if necessary.
-            if (m_repro)
+// Queue a tile for writing unless it's queued or being written already.
+// Called with m_mutex locked.
+void TileKernel::enqueue(const Coord& c, Tile& tile)
+{
+    if (tile.queued || tile.busy)
+        return;
+    tile.queued = true;
+    m_queue.push_back(c);
+}
+
+
+// Take tiles from the queue and write their points until all input is
+// read and the queue is empty.
+void TileKernel::writeTiles()
+{
+    ThreadPointTable table(*m_table.layout(), m_table.capacity());
+    table.setSpatialReference(m_srs);
+    std::vector<char> buf;
+
+    try
+    {
+        while (true)
+        {
+            Coord c;
+            Tile *tile;
+            point_count_t count;
             {
-                for (idx = 0; idx < last; ++idx)
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]()
+                    { return m_aborted || m_readDone || m_queue.size(); });
+                if (m_aborted || m_queue.empty())
+                    return;
+
+                c = m_queue.front();
+                m_queue.pop_front();
+                tile = &m_tiles[c];
+                tile->queued = false;
+                tile->busy = true;
+                buf.swap(tile->buf);
+                std::vector<char>().swap(tile->buf);
+                count = tile->count;
+                tile->count = 0;
+                m_queued -= count;
+
+                // A tile gets an output file if one is available the first
+                // time it's written.  Otherwise its points are appended to
+                // a temporary file.  Output files are never closed early,
+                // so one temporary file per writing thread is kept
+                // available.
+                if (!tile->writer)
                 {
-                    point.setPointId(idx);
-                    if (!StreamableWrapper::processOne(*m_repro, point))
-                        skips[idx] = true;
+                    if (tile->filename.empty() &&
+                            m_numWriters + m_threads < maxOutputs() &&
+                            m_numWriters + m_spills.size() < maxOutputs())
+                        m_numWriters++;
+                    else
+                        openSpill(c, *tile);
                 }
-                SpatialReference srs = r.getSpatialReference();
-                if (!srs.empty())
-                    m_table.setSpatialReference(srs);
+                m_cv.notify_all();
             }
 
-            // Split and write.
-            for (idx = 0; idx < last; ++idx)
-            {
-                if (skips[idx])
-                    continue;
-
-                point.setPointId(idx);
-                m_splitter.processPoint(point, adder);
+            writeTile(c, *tile, table, buf, count);
 
+            std::lock_guard<std::mutex> lock(m_mutex);
+            tile->busy = false;
+            if (tile->count && (tile->count >= TilePoints || m_readDone ||
+                    m_queued >= MaxQueued))
+            {
+                enqueue(c, *tile);
+                m_cv.notify_all();
             }
-            for (size_t i = 0; i < skips.size(); ++i)
-                skips[i] = false;
-            idx = 0;
         }
-        StreamableWrapper::done(r, m_table);
-        if (m_repro)
-            StreamableWrapper::done(*m_repro, m_table);
     }
+    catch (...)
+    {
+        fail();
+    }
+}
+
+
+void TileKernel::writeTile(const Coord& c, Tile& tile,
+    StreamPointTable& table, std::vector<char>& buf, point_count_t count)
+{
+    if (tile.spill)
+    {
+        tile.spill->write(buf.data(), buf.size());
+        if (!*tile.spill)
+            throw pdal_error("Unable to write temporary tile file '" +
+                tile.filename + "'.");
+        return;
+    }
+
+    if (!tile.writer)
+        tile.writer = createWriter(c, table);
+    writePoints(*tile.writer, table, buf, count);
 }
 
 
-void TileKernel::adder(PointRef& point, int xpos, int ypos)
+// Pass packed points to a writer a table full at a time.
+void TileKernel::writePoints(Streamable& writer, StreamPointTable& table,
+    const std::vector<char>& buf, point_count_t count)
 {
-    Coord loc(xpos, ypos);
+    const size_t pointSize = m_table.layout()->pointSize();
+
+    PointRef point(table, 0);
+    for (PointId begin = 0; begin < count; begin += table.capacity())
+    {
+        const PointId end = (std::min)(begin + table.capacity(), count);
+        for (PointId idx = begin; idx < end; ++idx)
+        {
+            point.setPointId(idx - begin);
+            point.setPackedData(m_dims, buf.data() + idx * pointSize);
+        }
+        StreamableWrapper::processBatch(writer, table, 0, end - begin);
+        table.clear(end - begin);
+    }
+}
 
-    Stage *w;
-    Streamable *sw;
 
-    auto wi = m_writers.find(loc);
-    if (wi == m_writers.end())
+// Write a tile whose points were appended to a temporary file.
+void TileKernel::writeSpilled(const Coord& c, Tile& tile)
+{
+    ThreadPointTable table(*m_table.layout(), m_table.capacity());
+    table.setSpatialReference(m_srs);
+    const size_t pointSize = m_table.layout()->pointSize();
+
+    std::ifstream in(tile.filename, std::ios::binary | std::ios::in);
+    if (!in)
+        throw pdal_error("Unable to open temporary tile file '" +
+            tile.filename + "'.");
+
+    Streamable *writer = createWriter(c, table);
+    std::vector<char> buf(table.capacity() * pointSize);
+    while (in)
     {
-        std::string filename(m_outputFile);
-        std::string xname(std::to_string(xpos));
-        std::string yname(std::to_string(ypos));
-        filename.replace(m_hashPos, 1, (xname + "_" + yname));
+        in.read(buf.data(), buf.size());
+        point_count_t count = in.gcount() / pointSize;
+        writePoints(*writer, table, buf, count);
+    }
+    StageWrapper::done(*writer, table);
+    in.close();
+    FileUtils::deleteFile(tile.filename);
+}
+
 
-        w = &m_manager.makeWriter(filename, "");
+Streamable *TileKernel::createWriter(const Coord& c, StreamPointTable& table)
+{
+    std::string filename(m_outputFile);
+    std::string xname(std::to_string(c.first));
+    std::string yname(std::to_string(c.second));
+    filename.replace(m_hashPos, 1, (xname + "_" + yname));
+
+    Streamable *sw;
+    {
+        // The stage manager isn't thread-safe.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stage *w = &m_manager.makeWriter(filename, "");
         if (!w)
             throw pdal_error("Couldn't create writer for output file '" +
                 m_outputFile + "'.");
         sw = dynamic_cast<Streamable *>(w);
         if (!sw)
             throw pdal_error("Driver '" + w->getName() + "' for input file '" +
-                m_outputFile + "' is not streamable.");  
-        m_writers[loc] = sw;
-
+                m_outputFile + "' is not streamable.");
         sw->prepare(m_table);
-        StreamableWrapper::spatialReferenceChanged(*sw, m_outSrs);
-        StreamableWrapper::ready(*sw, m_table);
     }
-    else
-        sw = wi->second;
-    StreamableWrapper::processOne(*sw, point);
+
+    StreamableWrapper::spatialReferenceChanged(*sw, m_outSrs);
+    StreamableWrapper::ready(*sw, table);
+    return sw;
+}
+
+
+// Open a tile's temporary file for appending.  If too many output and
+// temporary files are open, the temporary file of the least recently
+// written tile that isn't being written is closed.  There's always one,
+// as at most 'threads' tiles are written at once and output files leave
+// room for that many temporary files.  It's reopened for appending if the
+// tile gets more points.  Called with m_mutex locked.
+void TileKernel::openSpill(const Coord& c, Tile& tile)
+{
+    if (tile.spill)
+    {
+        m_spills.splice(m_spills.end(), m_spills, tile.spillPos);
+        return;
+    }
+
+    if (m_dir.empty())
+    {
+        m_dir = Utils::createTempDirectory(m_tempDir, "pdal_tile_");
+        if (m_dir.empty())
+            throw pdal_error("Unable to create temporary directory.");
+    }
+    if (tile.filename.empty())
+        tile.filename = m_dir + "/" + std::to_string(c.first) + "_" +
+            std::to_string(c.second) + ".tile";
+
+    if (m_numWriters + m_spills.size() >= maxOutputs())
+        for (auto it = m_spills.begin(); it != m_spills.end(); ++it)
+        {
+            Tile& lru = m_tiles[*it];
+            if (lru.busy)
+                continue;
+            lru.spill.reset();
+            m_spills.erase(it);
+            break;
+        }
+
+    tile.spill.reset(new std::ofstream(tile.filename,
+        std::ios::binary | std::ios::app | std::ios::out));
+    if (!*tile.spill)
+        throw pdal_error("Unable to open temporary tile file '" +
+            tile.filename + "'.");
+    tile.spillPos = m_spills.insert(m_spills.end(), c);
+}
+
+
+// Number of output and temporary files that may be open while input files
+// are read.
+size_t TileKernel::maxOutputs() const
+{
+    return m_maxOpen - m_threads;
+}
+
+
+// Record the current exception and stop the reading and writing threads.
+void TileKernel::fail()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_error)
+        m_error = std::current_exception();
+    m_aborted = true;
+    m_cv.notify_all();
+}
+
+
+void TileKernel::cleanup()
+{
+    m_spills.clear();
+    m_tiles.clear();
+    if (m_dir.size())
+    {
+        FileUtils::deleteDirectory(m_dir);
+        m_dir.clear();
+    }
 }
 
 } // namespace pdal
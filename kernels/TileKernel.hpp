@@ -34,7 +34,14 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 
 #include <pdal/Kernel.hpp>
 #include <filters/SplitterFilter.hpp>
@@ -47,6 +54,25 @@ class PDAL_DLL TileKernel : public Kernel
     using Coord = std::pair<int, int>;
     using Readers = std::map<std::string, Streamable *>;
 
+    // Points of a tile waiting to be written, and where they're written.
+    // Tiles that can't get an output file within the 'max_open' limit are
+    // written to a temporary file and passed to a writer once all input is
+    // read.
+    struct Tile
+    {
+        std::vector<char> buf;
+        point_count_t count;
+        Streamable *writer;
+        std::string filename;
+        std::unique_ptr<std::ofstream> spill;
+        std::list<Coord>::iterator spillPos;
+        bool queued;
+        bool busy;
+
+        Tile() : count(0), writer(nullptr), queued(false), busy(false)
+        {}
+    };
+
 public:
     TileKernel();
     std::string getName() const;
@@ -58,7 +84,21 @@ private:
     Streamable *prepareReader(const std::string& filename);
     void process(const Readers& readers);
     void checkReaders(const Readers& readers);
-    void adder(PointRef& point, int xpos, int ypos);
+    void findOrigin(const Readers& readers);
+    void readFile(const std::string& filename, Streamable& reader);
+    bool queuePoints(std::map<Coord, std::vector<char>>& points);
+    void writeTiles();
+    void writeTile(const Coord& c, Tile& tile, StreamPointTable& table,
+        std::vector<char>& buf, point_count_t count);
+    void writePoints(Streamable& writer, StreamPointTable& table,
+        const std::vector<char>& buf, point_count_t count);
+    void writeSpilled(const Coord& c, Tile& tile);
+    Streamable *createWriter(const Coord& c, StreamPointTable& table);
+    void openSpill(const Coord& c, Tile& tile);
+    size_t maxOutputs() const;
+    void enqueue(const Coord& c, Tile& tile);
+    void fail();
+    void cleanup();
 
     std::string m_inputFile;
     std::string m_outputFile;
@@ -66,12 +106,29 @@ private:
     double m_xOrigin;
     double m_yOrigin;
     double m_buffer;
-    std::map<Coord, Streamable *> m_writers;
+    size_t m_threads;
+    size_t m_maxOpen;
+    std::string m_tempDir;
     FixedPointTable m_table;
     SplitterFilter m_splitter;
-    Streamable *m_repro;
+    std::map<std::string, Streamable *> m_repros;
     SpatialReference m_outSrs;
+    SpatialReference m_srs;
     std::string::size_type m_hashPos;
+    DimTypeList m_dims;
+
+    // State shared by the reading and writing threads, guarded by m_mutex.
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::map<Coord, Tile> m_tiles;
+    std::deque<Coord> m_queue;
+    std::list<Coord> m_spills;
+    point_count_t m_queued;
+    size_t m_numWriters;
+    bool m_readDone;
+    bool m_aborted;
+    std::exception_ptr m_error;
+    std::string m_dir;
 };
 
 } // namespace pdal
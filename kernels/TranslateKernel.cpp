@@ -89,6 +89,8 @@ void TranslateKernel::addSwitches(ProgramArgs& args)
     args.add("writer,w", "Writer type", m_writerType);
     args.add("nostream", "Run in standard mode", m_noStream);
     args.add("stream", "Run in stream mode.  Error if not possible.", m_stream);
+    args.add("threads", "Maximum number of threads used to pipeline stages "
+        "in stream mode.", m_threads, (size_t)1);
 }
 
 
@@ -223,6 +225,7 @@ int TranslateKernel::execute()
         return 0;
     }
 
+    m_manager.setThreads(m_threads);
     if (m_manager.execute(m_mode).m_mode == ExecMode::None)
         throw pdal_error("Couldn't run translation pipeline in requested "
             "execution mode.");
@@ -68,6 +68,7 @@ private:
     std::string m_metadataFile;
     bool m_noStream;
     bool m_stream;
+    size_t m_threads;
     ExecMode m_mode;
 };
 
@@ -0,0 +1,418 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include "ExternalSortFilter.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+#include <pdal/PDALUtils.hpp>
+#include <pdal/util/FileUtils.hpp>
+
+namespace pdal
+{
+
+namespace
+{
+
+// Each point in a run file is preceded by its sort key.
+const size_t KeySize = sizeof(uint64_t);
+
+// Number of points written to a run file at a time.
+const point_count_t WriteCount = 4096;
+
+// Most runs merged at once, which keeps the number of open files well
+// under the usual limits.
+const size_t MaxMergeRuns = 64;
+
+typedef std::greater<std::pair<uint64_t, size_t>> HeapOrder;
+
+} // unnamed namespace
+
+
+// A sorted run of points in a temporary file.  The points are read back a
+// buffer at a time while the runs are merged.
+struct ExternalSortFilter::Run
+{
+    std::string filename;
+    std::ifstream in;
+    // Number of points not yet read from the file.
+    point_count_t remaining;
+    std::vector<char> buf;
+    // Position of the current point in the buffer.
+    size_t pos;
+
+    uint64_t key() const
+    {
+        uint64_t k;
+        std::memcpy(&k, buf.data() + pos, KeySize);
+        return k;
+    }
+};
+
+
+ExternalSortFilter::ExternalSortFilter(const BOX2D& bounds,
+        CurveKey::Curve curve, size_t memoryLimit,
+        const std::string& tempDir) :
+    m_key(bounds, curve), m_memoryLimit(memoryLimit), m_tempDir(tempDir),
+    m_pointSize(0), m_runCount(0), m_runFiles(0), m_bufCount(0),
+    m_merging(false), m_pos(0)
+{}
+
+
+ExternalSortFilter::~ExternalSortFilter()
+{
+    cleanup();
+}
+
+
+void ExternalSortFilter::ready(PointTableRef table)
+{
+    cleanup();
+
+    m_dims = table.layout()->dimTypes();
+    m_pointSize = table.layout()->pointSize();
+
+    // A point in a run takes its data and two sort entries (one for the
+    // radix sort's scratch space).
+    m_runCount = (std::max)(m_memoryLimit /
+        (m_pointSize + 2 * sizeof(SortEntry)), (size_t)1);
+    m_merging = false;
+}
+
+
+bool ExternalSortFilter::processOne(PointRef& point)
+{
+    if (m_points.empty())
+        m_points.reserve(m_runCount * m_pointSize);
+
+    double x = point.getFieldAs<double>(Dimension::Id::X);
+    double y = point.getFieldAs<double>(Dimension::Id::Y);
+    m_entries.push_back(SortEntry(m_key(x, y), m_entries.size()));
+
+    size_t pos = m_points.size();
+    m_points.resize(pos + m_pointSize);
+    point.getPackedData(m_dims, m_points.data() + pos);
+
+    if (m_entries.size() >= m_runCount)
+        spill();
+
+    // Points are passed on once all of them have been sorted.
+    return false;
+}
+
+
+// Sort the points held in memory and write them to a new run file.
+void ExternalSortFilter::spill()
+{
+    if (m_entries.empty())
+        return;
+
+    if (m_dir.empty())
+    {
+        m_dir = Utils::createTempDirectory(m_tempDir, "pdal_sort_");
+        if (m_dir.empty())
+            throwError("Unable to create temporary directory.");
+    }
+
+    radixSort(m_entries);
+
+    std::unique_ptr<Run> run(new Run);
+    run->filename = m_dir + "/" + std::to_string(m_runFiles++) + ".run";
+    run->remaining = m_entries.size();
+
+    std::ofstream out(run->filename, std::ios::binary | std::ios::out);
+    const size_t recordSize = KeySize + m_pointSize;
+    std::vector<char> buf(WriteCount * recordSize);
+    size_t pos = 0;
+    for (const SortEntry& e : m_entries)
+    {
+        std::memcpy(buf.data() + pos, &e.first, KeySize);
+        std::memcpy(buf.data() + pos + KeySize,
+            m_points.data() + e.second * m_pointSize, m_pointSize);
+        pos += recordSize;
+        if (pos == buf.size())
+        {
+            out.write(buf.data(), pos);
+            pos = 0;
+        }
+    }
+    out.write(buf.data(), pos);
+    out.close();
+    if (!out)
+        throwError("Unable to write temporary sort file '" +
+            run->filename + "'.");
+
+    m_runs.push_back(std::move(run));
+    m_entries.clear();
+    m_points.clear();
+}
+
+
+void ExternalSortFilter::startMerge()
+{
+    m_merging = true;
+    m_pos = 0;
+
+    // If all the points fit in memory there's nothing to merge.
+    if (m_runs.empty())
+    {
+        radixSort(m_entries);
+        return;
+    }
+
+    spill();
+    SortEntries().swap(m_entries);
+    std::vector<char>().swap(m_points);
+
+    // Merge consecutive groups of runs until few enough are left.  Runs
+    // stay in input order, so the sort remains stable.
+    while (m_runs.size() > MaxMergeRuns)
+    {
+        std::vector<std::unique_ptr<Run>> merged;
+        for (size_t first = 0; first < m_runs.size(); first += MaxMergeRuns)
+        {
+            const size_t last = (std::min)(first + MaxMergeRuns,
+                m_runs.size());
+            if (last - first == 1)
+            {
+                merged.push_back(std::move(m_runs[first]));
+                continue;
+            }
+            std::unique_ptr<Run> run(new Run);
+            mergeRuns(first, last, *run);
+            merged.push_back(std::move(run));
+        }
+        m_runs.swap(merged);
+    }
+
+    // Share the memory limit among the read buffers of the runs.
+    const size_t recordSize = KeySize + m_pointSize;
+    m_bufCount = (std::max)(m_memoryLimit / (m_runs.size() * recordSize),
+        (size_t)1);
+
+    m_heap.clear();
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        Run& run = *m_runs[i];
+        run.in.open(run.filename, std::ios::binary | std::ios::in);
+        if (fill(run))
+            m_heap.push_back(std::make_pair(run.key(), i));
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), HeapOrder());
+    m_pos = m_runs.size();
+}
+
+
+// Merge the runs in [first, last) into a new run file.  The merged runs'
+// files are removed.
+void ExternalSortFilter::mergeRuns(size_t first, size_t last, Run& out)
+{
+    // Share the memory limit among the read buffers of the runs and the
+    // write buffer.
+    const size_t recordSize = KeySize + m_pointSize;
+    m_bufCount = (std::max)(m_memoryLimit /
+        ((last - first + 1) * recordSize), (size_t)1);
+
+    out.filename = m_dir + "/" + std::to_string(m_runFiles++) + ".run";
+    out.remaining = 0;
+
+    std::vector<std::pair<uint64_t, size_t>> heap;
+    for (size_t i = first; i < last; ++i)
+    {
+        Run& run = *m_runs[i];
+        out.remaining += run.remaining;
+        run.in.open(run.filename, std::ios::binary | std::ios::in);
+        if (fill(run))
+            heap.push_back(std::make_pair(run.key(), i));
+    }
+    std::make_heap(heap.begin(), heap.end(), HeapOrder());
+
+    std::ofstream of(out.filename, std::ios::binary | std::ios::out);
+    std::vector<char> buf(m_bufCount * recordSize);
+    size_t pos = 0;
+    while (heap.size())
+    {
+        // Ties go to the earliest run.
+        std::pop_heap(heap.begin(), heap.end(), HeapOrder());
+        Run& run = *m_runs[heap.back().second];
+        std::memcpy(buf.data() + pos, run.buf.data() + run.pos, recordSize);
+        pos += recordSize;
+        if (pos == buf.size())
+        {
+            of.write(buf.data(), pos);
+            pos = 0;
+        }
+
+        run.pos += recordSize;
+        if (run.pos < run.buf.size() || fill(run))
+        {
+            heap.back().first = run.key();
+            std::push_heap(heap.begin(), heap.end(), HeapOrder());
+        }
+        else
+            heap.pop_back();
+    }
+    of.write(buf.data(), pos);
+    of.close();
+    if (!of)
+        throwError("Unable to write temporary sort file '" +
+            out.filename + "'.");
+}
+
+
+// Read the next buffer of points of a run.  Returns false if the run has
+// no more points.
+bool ExternalSortFilter::fill(Run& run)
+{
+    if (run.remaining == 0)
+    {
+        run.in.close();
+        FileUtils::deleteFile(run.filename);
+        std::vector<char>().swap(run.buf);
+        return false;
+    }
+
+    const point_count_t count = (std::min)(run.remaining, m_bufCount);
+    run.buf.resize(count * (KeySize + m_pointSize));
+    run.in.read(run.buf.data(), run.buf.size());
+    if (!run.in)
+        throwError("Unable to read temporary sort file '" +
+            run.filename + "'.");
+    run.remaining -= count;
+    run.pos = 0;
+    return true;
+}
+
+
+// Get the packed data of the next point in sorted order, or null if there
+// are no more points.  The data is valid until the next call.
+const char *ExternalSortFilter::nextPoint()
+{
+    if (!m_merging)
+        startMerge();
+
+    if (m_runs.empty())
+    {
+        if (m_pos == m_entries.size())
+            return nullptr;
+        return m_points.data() + m_entries[m_pos++].second * m_pointSize;
+    }
+
+    // Move past the point returned by the previous call.  m_pos is the
+    // run of that point.
+    if (m_pos < m_runs.size())
+    {
+        Run& run = *m_runs[m_pos];
+        run.pos += KeySize + m_pointSize;
+        if (run.pos < run.buf.size() || fill(run))
+        {
+            m_heap.push_back(std::make_pair(run.key(), m_pos));
+            std::push_heap(m_heap.begin(), m_heap.end(), HeapOrder());
+        }
+    }
+    if (m_heap.empty())
+    {
+        m_pos = m_runs.size();
+        return nullptr;
+    }
+
+    // Ties go to the earliest run, which keeps the sort stable.
+    std::pop_heap(m_heap.begin(), m_heap.end(), HeapOrder());
+    m_pos = m_heap.back().second;
+    m_heap.pop_back();
+
+    const Run& run = *m_runs[m_pos];
+    return run.buf.data() + run.pos + KeySize;
+}
+
+
+point_count_t ExternalSortFilter::flushBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    PointRef point(table, begin);
+    PointId idx = begin;
+    for (; idx < end; ++idx)
+    {
+        const char *data = nextPoint();
+        if (!data)
+            break;
+        point.setPointId(idx);
+        point.setPackedData(m_dims, data);
+    }
+    return idx - begin;
+}
+
+
+PointViewSet ExternalSortFilter::run(PointViewPtr view)
+{
+    PointRef point(*view, 0);
+    for (PointId idx = 0; idx < view->size(); ++idx)
+    {
+        point.setPointId(idx);
+        processOne(point);
+    }
+
+    PointViewPtr outView = view->makeNew();
+    while (const char *data = nextPoint())
+        outView->setPackedPoint(m_dims, outView->size(), data);
+    cleanup();
+
+    PointViewSet viewSet;
+    viewSet.insert(outView);
+    return viewSet;
+}
+
+
+void ExternalSortFilter::done(PointTableRef /*table*/)
+{
+    cleanup();
+}
+
+
+void ExternalSortFilter::cleanup()
+{
+    m_runs.clear();
+    m_runFiles = 0;
+    m_heap.clear();
+    SortEntries().swap(m_entries);
+    std::vector<char>().swap(m_points);
+    m_merging = false;
+    m_pos = 0;
+    if (m_dir.size())
+    {
+        FileUtils::deleteDirectory(m_dir);
+        m_dir.clear();
+    }
+}
+
+} // namespace pdal
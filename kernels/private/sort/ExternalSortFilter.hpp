@@ -0,0 +1,98 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#pragma once
+
+#include <pdal/Filter.hpp>
+#include <pdal/Streamable.hpp>
+#include <pdal/private/CurveKey.hpp>
+#include <pdal/private/RadixSort.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pdal
+{
+
+// Orders points along a space-filling curve without holding all of them in
+// memory.  Points are collected in runs that fit in the memory limit.  Each
+// run is sorted and written to a temporary file.  Once all points have
+// arrived the runs are merged as the points are passed on.  If there are
+// too many runs to have all of their files open at once, groups of runs
+// are first merged into longer runs.  The curve covers bounds that are
+// fixed up front, so that the keys of all runs agree.
+class PDAL_DLL ExternalSortFilter : public Filter, public Streamable
+{
+public:
+    ExternalSortFilter(const BOX2D& bounds, CurveKey::Curve curve,
+        size_t memoryLimit, const std::string& tempDir);
+    ~ExternalSortFilter();
+    ExternalSortFilter& operator=(const ExternalSortFilter&) = delete;
+    ExternalSortFilter(const ExternalSortFilter&) = delete;
+
+    std::string getName() const
+        { return "filters.externalsort"; }
+
+private:
+    struct Run;
+
+    virtual void ready(PointTableRef table);
+    virtual bool processOne(PointRef& point);
+    virtual point_count_t flushBatch(StreamPointTable& table,
+        PointId begin, PointId end);
+    virtual PointViewSet run(PointViewPtr view);
+    virtual void done(PointTableRef table);
+
+    void spill();
+    void startMerge();
+    void mergeRuns(size_t first, size_t last, Run& out);
+    bool fill(Run& run);
+    const char *nextPoint();
+    void cleanup();
+
+    CurveKey m_key;
+    size_t m_memoryLimit;
+    std::string m_tempDir;
+    std::string m_dir;
+    DimTypeList m_dims;
+    size_t m_pointSize;
+    point_count_t m_runCount;
+    std::vector<char> m_points;
+    SortEntries m_entries;
+    std::vector<std::unique_ptr<Run>> m_runs;
+    size_t m_runFiles;
+    std::vector<std::pair<uint64_t, size_t>> m_heap;
+    point_count_t m_bufCount;
+    bool m_merging;
+    size_t m_pos;
+};
+
+} // namespace pdal
@@ -35,6 +35,7 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <pdal/util/Utils.hpp>
@@ -183,6 +184,19 @@ inline Type type(const std::string& baseType, size_t size)
     return static_cast<Type>((size_t)(base) | size);
 }
 
+/// Get the type corresponding to an arithmetic C++ type.
+/// \return  Corresponding type enumeration value.
+template<typename T>
+inline Type type()
+{
+    static_assert(std::is_arithmetic<T>::value,
+        "Dimension types must be arithmetic.");
+
+    BaseType base = std::is_floating_point<T>::value ? BaseType::Floating :
+        (std::is_signed<T>::value ? BaseType::Signed : BaseType::Unsigned);
+    return type(toName(base), sizeof(T));
+}
+
 /// Extract a dimension name of a string.  Dimension names start with an alpha
 /// and continue with numbers or underscores.
 /// \param s  String from which to extract dimension name.
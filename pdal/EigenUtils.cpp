@@ -37,9 +37,14 @@
 #include <pdal/PointView.hpp>
 #include <pdal/SpatialReference.hpp>
 #include <pdal/util/Bounds.hpp>
+#include <pdal/util/ThreadPool.hpp>
 #include <pdal/util/Utils.hpp>
 
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
+#include <functional>
+#include <limits>
 #include <numeric>
 #include <vector>
 
@@ -51,6 +56,26 @@ namespace pdal
 
 void calculateBounds(const PointView& view, BOX2D& output)
 {
+    const double *xs = view.dimensionData<double>(Dimension::Id::X);
+    const double *ys = view.dimensionData<double>(Dimension::Id::Y);
+    if (view.size() && xs && ys)
+    {
+        double minx = xs[0];
+        double maxx = xs[0];
+        double miny = ys[0];
+        double maxy = ys[0];
+        for (PointId idx = 1; idx < view.size(); idx++)
+        {
+            minx = (std::min)(minx, xs[idx]);
+            maxx = (std::max)(maxx, xs[idx]);
+            miny = (std::min)(miny, ys[idx]);
+            maxy = (std::max)(maxy, ys[idx]);
+        }
+        output.grow(minx, miny);
+        output.grow(maxx, maxy);
+        return;
+    }
+
     for (PointId idx = 0; idx < view.size(); idx++)
     {
         double x = view.getFieldAs<double>(Dimension::Id::X, idx);
@@ -63,6 +88,31 @@ void calculateBounds(const PointView& view, BOX2D& output)
 
 void calculateBounds(const PointView& view, BOX3D& output)
 {
+    const double *xs = view.dimensionData<double>(Dimension::Id::X);
+    const double *ys = view.dimensionData<double>(Dimension::Id::Y);
+    const double *zs = view.dimensionData<double>(Dimension::Id::Z);
+    if (view.size() && xs && ys && zs)
+    {
+        double minx = xs[0];
+        double maxx = xs[0];
+        double miny = ys[0];
+        double maxy = ys[0];
+        double minz = zs[0];
+        double maxz = zs[0];
+        for (PointId idx = 1; idx < view.size(); idx++)
+        {
+            minx = (std::min)(minx, xs[idx]);
+            maxx = (std::max)(maxx, xs[idx]);
+            miny = (std::min)(miny, ys[idx]);
+            maxy = (std::max)(maxy, ys[idx]);
+            minz = (std::min)(minz, zs[idx]);
+            maxz = (std::max)(maxz, zs[idx]);
+        }
+        output.grow(minx, miny, minz);
+        output.grow(maxx, maxy, maxz);
+        return;
+    }
+
     for (PointId idx = 0; idx < view.size(); idx++)
     {
         double x = view.getFieldAs<double>(Dimension::Id::X, idx);
@@ -275,78 +325,195 @@ Eigen::MatrixXd extendedLocalMinimum(const PointView& view, int rows, int cols,
     return ZImin;
 }
 
-std::vector<double> dilateDiamond(std::vector<double> data, size_t rows, size_t cols, int iterations)
+namespace
 {
-    std::vector<double> out(data.size(), std::numeric_limits<double>::lowest());
-    std::vector<size_t> idx(5);
 
-    for (int iter = 0; iter < iterations; ++iter)
+// Morphological filters with a diamond (city block) structuring element.
+// Better is std::greater for dilation and std::less for erosion, and
+// 'worst' is the value that never wins (lowest or max).  NaN values are
+// ignored.  A cell with only NaNs within the element gets 'worst'.
+template<typename Better>
+class DiamondFilter
+{
+public:
+    DiamondFilter(size_t rows, size_t cols, double worst) :
+        m_rows(rows), m_cols(cols), m_worst(worst)
+    {}
+
+    // Filter a raster in column major order with a diamond of a radius.
+    //
+    // A diamond with an odd radius 2a+1 is a square of side 2a+1 rotated
+    // 45 degrees (cells whose distance has even parity) followed by a
+    // cross of radius 1, which adds the cells with odd parity.  A diamond
+    // with an even radius 2a is a rotated square of side 2a-1 followed by
+    // two crosses.  The rotated square separates into lines along the
+    // diagonals, and each of those is filtered with the van Herk/Gil-Werman
+    // algorithm, which takes three comparisons per cell regardless of the
+    // length of the line.  The result is exactly that of applying the
+    // cross 'radius' times.
+    std::vector<double> filter(std::vector<double> data, int radius)
+    {
+        if (radius <= 0)
+            return data;
+
+        size_t a = (radius % 2) ? (radius - 1) / 2 : radius / 2 - 1;
+        int crosses = (radius % 2) ? 1 : 2;
+        if (a > 0)
+            data = rotatedSquare(data, a);
+        for (int i = 0; i < crosses; ++i)
+            data = cross(data);
+        return data;
+    }
+
+private:
+    size_t m_rows;
+    size_t m_cols;
+    double m_worst;
+    Better m_better;
+
+    double best(double a, double b) const
+        { return m_better(b, a) ? b : a; }
+
+    double value(double v) const
+        { return std::isnan(v) ? m_worst : v; }
+
+    // Replace each value of a line with the best value within 'radius'
+    // positions along the line.  Values beyond the ends of the line are
+    // 'worst'.  'g' and 'h' are scratch space for the running values from
+    // the start and end of each block of 2 * radius + 1 values.
+    void filterLine(std::vector<double>& line, size_t radius,
+        std::vector<double>& g, std::vector<double>& h) const
+    {
+        const size_t n = line.size();
+        const size_t w = 2 * radius + 1;
+        const size_t m = n + 2 * radius;
+
+        auto padded = [&line, radius, n, this](size_t k)
+        {
+            return (k < radius || k >= radius + n) ? m_worst :
+                line[k - radius];
+        };
+
+        g.resize(m);
+        h.resize(m);
+        for (size_t k = 0; k < m; ++k)
+            g[k] = (k % w == 0) ? padded(k) : best(g[k - 1], padded(k));
+        for (size_t k = m; k-- > 0;)
+            h[k] = (k % w == w - 1 || k == m - 1) ? padded(k) :
+                best(h[k + 1], padded(k));
+        for (size_t i = 0; i < n; ++i)
+            line[i] = best(h[i], g[i + w - 1]);
+    }
+
+    // Filter with the cells (dr, dc) where |dr + dc| and |dr - dc| are at
+    // most 2a and even.  The first pass filters along the lines where
+    // row - col is constant, over the raster extended by 'a' cells on
+    // each side so that no cell is lost at the edges.  The second pass
+    // filters the result along the lines where row + col is constant.
+    std::vector<double> rotatedSquare(const std::vector<double>& data,
+        size_t a)
     {
-        for (size_t col = 0; col < cols; ++col)
+        const long rows = (long)(m_rows + 2 * a);
+        const long cols = (long)(m_cols + 2 * a);
+        const long pad = (long)a;
+        std::vector<double> ext((size_t)(rows * cols));
+
+        parallelFor(0, (size_t)(rows + cols - 1),
+            [&](size_t begin, size_t end)
         {
-            size_t index = col*rows;
-            for (size_t row = 0; row < rows; ++row)
+            std::vector<double> line, g, h;
+            for (size_t d = begin; d < end; ++d)
             {
-                // Find the index into the vector of the current cell.  Then
-                // find the index of the cells to the right/left/above/below
-                // if they exist.
-                size_t j = 0;
-                idx[j++] = index+row;
-                if (row > 0)
-                    idx[j++] = idx[0]-1;
-                if (row < rows-1)
-                    idx[j++] = idx[0]+1;
-                if (col > 0)
-                    idx[j++] = idx[0]-rows;
-                if (col < cols-1)
-                    idx[j++] = idx[0]+rows;
-                // If the data at the test cell pos is greater than that
-                // from the last iteration, set the value to the maximum of
-                // the value of those cells.
-                for (size_t i = 0; i < j; ++i)
+                // Diagonal starting at the left or top edge.
+                long r0 = (long)d < rows ? rows - 1 - (long)d : 0;
+                long c0 = (long)d < rows ? 0 : (long)d - rows + 1;
+                long n = (std::min)(rows - r0, cols - c0);
+                line.resize((size_t)n);
+                for (long k = 0; k < n; ++k)
                 {
-                    if (data[idx[i]] > out[index+row])
-                        out[index+row] = data[idx[i]];
+                    long r = r0 + k - pad;
+                    long c = c0 + k - pad;
+                    line[k] = (r < 0 || c < 0 || r >= (long)m_rows ||
+                        c >= (long)m_cols) ? m_worst :
+                        value(data[c * m_rows + r]);
                 }
+                filterLine(line, a, g, h);
+                for (long k = 0; k < n; ++k)
+                    ext[(c0 + k) * rows + (r0 + k)] = line[k];
             }
-        }
-        data.swap(out);
-    }
-    return data;
-}
+        });
 
-std::vector<double> erodeDiamond(std::vector<double> data, size_t rows, size_t cols, int iterations)
-{
-    std::vector<double> out(data.size(), (std::numeric_limits<double>::max)());
-    std::vector<size_t> idx(5);
+        std::vector<double> out(data.size());
+        parallelFor(0, (size_t)(rows + cols - 1),
+            [&](size_t begin, size_t end)
+        {
+            std::vector<double> line, g, h;
+            for (size_t s = begin; s < end; ++s)
+            {
+                // Anti-diagonal starting at the top or right edge.
+                long r0 = (long)s < cols ? 0 : (long)s - cols + 1;
+                long c0 = (long)s < cols ? (long)s : cols - 1;
+                long n = (std::min)(rows - r0, c0 + 1);
+                line.resize((size_t)n);
+                for (long k = 0; k < n; ++k)
+                    line[k] = ext[(c0 - k) * rows + (r0 + k)];
+                filterLine(line, a, g, h);
+                for (long k = 0; k < n; ++k)
+                {
+                    long r = r0 + k - pad;
+                    long c = c0 - k - pad;
+                    if (r >= 0 && c >= 0 && r < (long)m_rows &&
+                            c < (long)m_cols)
+                        out[c * m_rows + r] = line[k];
+                }
+            }
+        });
+        return out;
+    }
 
-    for (int iter = 0; iter < iterations; ++iter)
+    // Filter with a cross of radius 1 (a cell and its four neighbors).
+    std::vector<double> cross(const std::vector<double>& data)
     {
-        for (size_t col = 0; col < cols; ++col)
+        std::vector<double> out(data.size());
+        parallelFor(0, m_cols, [&](size_t begin, size_t end)
         {
-            size_t index = col*rows;
-            for (size_t row = 0; row < rows; ++row)
+            for (size_t col = begin; col < end; ++col)
             {
-                size_t j = 0;
-                idx[j++] = index+row;
-                if (row > 0)
-                    idx[j++] = idx[0]-1;
-                if (row < rows-1)
-                    idx[j++] = idx[0]+1;
-                if (col > 0)
-                    idx[j++] = idx[0]-rows;
-                if (col < cols-1)
-                    idx[j++] = idx[0]+rows;
-                for (size_t i = 0; i < j; ++i)
+                size_t index = col * m_rows;
+                for (size_t row = 0; row < m_rows; ++row)
                 {
-                    if (data[idx[i]] < out[index+row])
-                        out[index+row] = data[idx[i]];
+                    size_t i = index + row;
+                    double v = value(data[i]);
+                    if (row > 0)
+                        v = best(v, value(data[i - 1]));
+                    if (row < m_rows - 1)
+                        v = best(v, value(data[i + 1]));
+                    if (col > 0)
+                        v = best(v, value(data[i - m_rows]));
+                    if (col < m_cols - 1)
+                        v = best(v, value(data[i + m_rows]));
+                    out[i] = v;
                 }
             }
-        }
-        data.swap(out);
+        });
+        return out;
     }
-    return data;
+};
+
+} // unnamed namespace
+
+std::vector<double> dilateDiamond(std::vector<double> data, size_t rows, size_t cols, int iterations)
+{
+    DiamondFilter<std::greater<double>> f(rows, cols,
+        std::numeric_limits<double>::lowest());
+    return f.filter(std::move(data), iterations);
+}
+
+std::vector<double> erodeDiamond(std::vector<double> data, size_t rows, size_t cols, int iterations)
+{
+    DiamondFilter<std::less<double>> f(rows, cols,
+        (std::numeric_limits<double>::max)());
+    return f.filter(std::move(data), iterations);
 }
 
 Eigen::MatrixXd pointViewToEigen(const PointView& view)
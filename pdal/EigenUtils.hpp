@@ -184,15 +184,15 @@ PDAL_DLL Eigen::MatrixXd extendedLocalMinimum(const PointView& view, int rows,
   Perform a morphological dilation of the input raster.
 
   Performs a morphological dilation of the input raster using a diamond
-  structuring element. Larger structuring elements are approximated by applying
-  multiple iterations of the opening operation. The input and output rasters are
-  stored in column major order.
+  structuring element. The result is the same as applying a diamond of
+  radius one 'iterations' times, but is computed with line filters whose cost
+  doesn't depend on the radius. The input and output rasters are stored in
+  column major order.
 
   \param data the input raster.
   \param rows the number of rows.
   \param cols the number of cols.
-  \param iterations the number of iterations used to approximate a larger
-         structuring element.
+  \param iterations the radius (in cells) of the diamond structuring element.
   \return the morphological dilation of the input raster.
 */
 PDAL_DLL std::vector<double> dilateDiamond(std::vector<double> data,
@@ -203,15 +203,15 @@ PDAL_DLL std::vector<double> dilateDiamond(std::vector<double> data,
   Perform a morphological erosion of the input raster.
 
   Performs a morphological erosion of the input raster using a diamond
-  structuring element. Larger structuring elements are approximated by applying
-  multiple iterations of the opening operation. The input and output rasters are
-  stored in column major order.
+  structuring element. The result is the same as applying a diamond of
+  radius one 'iterations' times, but is computed with line filters whose cost
+  doesn't depend on the radius. The input and output rasters are stored in
+  column major order.
 
   \param data the input raster.
   \param rows the number of rows.
   \param cols the number of cols.
-  \param iterations the number of iterations used to approximate a larger
-         structuring element.
+  \param iterations the radius (in cells) of the diamond structuring element.
   \return the morphological erosion of the input raster.
 */
 PDAL_DLL std::vector<double> erodeDiamond(std::vector<double> data,
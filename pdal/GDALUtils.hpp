@@ -34,8 +34,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <functional>
+#include <limits>
 #include <mutex>
 #include <sstream>
 #include <vector>
@@ -459,16 +461,29 @@ private:
     }
 
     /*
-      Write linearized data pointed to by \c data into the band.
+      Write linearized data pointed to by \c data into the band.  Only
+      the rows of blocks that lie entirely within [rowBegin, rowEnd) are
+      written.
 
       \param data  Pointer to beginning of band
+      \param rowBegin  First row to write.
+      \param rowEnd  Row past the last row to write.
     */
     template <typename SOURCE_ITER>
-    void write(SOURCE_ITER si, ITER_VAL<SOURCE_ITER> srcNoData)
+    void write(SOURCE_ITER si, ITER_VAL<SOURCE_ITER> srcNoData,
+        size_t rowBegin = 0,
+        size_t rowEnd = (std::numeric_limits<size_t>::max)())
     {
         for (size_t y = 0; y < m_yBlockCnt; ++y)
+        {
+            size_t blockBegin = y * m_yBlockSize;
+            size_t blockEnd = (std::min)(blockBegin + m_yBlockSize,
+                m_yTotalSize);
+            if (blockBegin < rowBegin || blockEnd > rowEnd)
+                continue;
             for (size_t x = 0; x < m_xBlockCnt; ++x)
                 writeBlock(x, y, si, srcNoData);
+        }
     }
 
     T getNoData() const
@@ -656,16 +671,22 @@ public:
     }
 
     /**
-      Write an entire raster band (layer) into raster to be written with GDAL.
+      Write a raster band (layer) into raster to be written with GDAL.
+      By default the entire band is written.  If a range of rows is
+      given, only the rows of blocks that lie entirely within the range
+      are written (see blockHeight()).
 
       \param data  Linearized raster data to be written.
       \param noData  No-data value in the source data.
       \param nBand  Band number to write.
       \param name  Name of the raster band.
+      \param rowBegin  First row to write.
+      \param rowEnd  Row past the last row to write.
     */
     template<typename SOURCE_ITER>
     GDALError writeBand(SOURCE_ITER si, ITER_VAL<SOURCE_ITER> srcNoData,
-        int nBand, const std::string& name = "")
+        int nBand, const std::string& name = "", size_t rowBegin = 0,
+        size_t rowEnd = (std::numeric_limits<size_t>::max)())
     {
         try
         {
@@ -673,43 +694,43 @@ public:
             {
             case Dimension::Type::Unsigned8:
                 Band<uint8_t>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Signed8:
                 Band<int8_t>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Unsigned16:
                 Band<uint16_t>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Signed16:
                 Band<int16_t>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Unsigned32:
                 Band<uint32_t>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Signed32:
                 Band<int32_t>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Unsigned64:
                 Band<uint64_t>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Signed64:
                 Band<int64_t>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Float:
                 Band<float>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::Double:
                 Band<double>(m_ds, nBand, m_dstNoData, name).
-                    write(si, srcNoData);
+                    write(si, srcNoData, rowBegin, rowEnd);
                 break;
             case Dimension::Type::None:
                 throw CantWriteBlock();
@@ -797,6 +818,19 @@ public:
     int height() const
         { return m_height; }
 
+    /**
+      Get the height, in rows, of the blocks in which a band is stored.
+      GDAL writes a band a block at a time.
+
+      \param nBand  Band number.  Band numbers start at 1.
+    */
+    int blockHeight(int nBand = 1) const
+    {
+        int xSize, ySize;
+        m_ds->GetRasterBand(nBand)->GetBlockSize(&xSize, &ySize);
+        return ySize;
+    }
+
     std::string const& filename() { return m_filename; }
 
     void statistics(int nBand, double* minimum, double* maximum, double* mean,
@@ -0,0 +1,244 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+#include <pdal/GridIndex.hpp>
+#include <pdal/PointView.hpp>
+#include <pdal/private/RadixSort.hpp>
+#include <pdal/util/ThreadPool.hpp>
+
+namespace pdal
+{
+
+namespace
+{
+
+const point_count_t ChunkSize = 4096;
+
+// Limit on the number of cells, each of which takes an offset, so that a
+// small cell size doesn't ask for more memory than can be had.
+const double MaxCells = (double)((std::size_t)1 << 28);
+
+} // unnamed namespace
+
+GridIndex::GridIndex(const PointView& view, double cellSize)
+{
+    if (cellSize <= 0)
+        throw pdal_error("GridIndex cell size must be positive.");
+
+    std::vector<double> x;
+    std::vector<double> y;
+    readPoints(view, x, y);
+
+    std::mutex mutex;
+    parallelFor(0, x.size(), [&x, &y, &mutex, this](std::size_t begin,
+        std::size_t end)
+        {
+            BOX2D box;
+            for (std::size_t i = begin; i < end; ++i)
+                box.grow(x[i], y[i]);
+            std::lock_guard<std::mutex> lock(mutex);
+            m_bounds.grow(box);
+        }, 0, ChunkSize);
+
+    if (x.empty())
+    {
+        m_cols = 1;
+        m_rows = 1;
+    }
+    else
+    {
+        const double cols =
+            std::floor((m_bounds.maxx - m_bounds.minx) / cellSize) + 1;
+        const double rows =
+            std::floor((m_bounds.maxy - m_bounds.miny) / cellSize) + 1;
+        if (!(cols * rows <= MaxCells))
+            throw pdal_error("GridIndex cell size is too small for the "
+                "bounds of the points.");
+        m_cols = (std::size_t)cols;
+        m_rows = (std::size_t)rows;
+        m_bounds.maxx = m_bounds.minx + m_cols * cellSize;
+        m_bounds.maxy = m_bounds.miny + m_rows * cellSize;
+    }
+    build(x, y);
+}
+
+
+GridIndex::GridIndex(const PointView& view, const BOX2D& bounds,
+        std::size_t cols, std::size_t rows) :
+    m_bounds(bounds), m_cols(cols), m_rows(rows)
+{
+    if (cols == 0 || rows == 0)
+        throw pdal_error("GridIndex must have at least one row and column.");
+    if ((double)cols * (double)rows > MaxCells)
+        throw pdal_error("GridIndex has too many cells.");
+
+    std::vector<double> x;
+    std::vector<double> y;
+    readPoints(view, x, y);
+    build(x, y);
+}
+
+
+void GridIndex::readPoints(const PointView& view, std::vector<double>& x,
+    std::vector<double>& y) const
+{
+    x.resize(view.size());
+    y.resize(view.size());
+    parallelFor(0, view.size(), [&view, &x, &y](PointId begin, PointId end)
+        {
+            view.getFieldRange(Dimension::Id::X, begin, end - begin,
+                x.data() + begin);
+            view.getFieldRange(Dimension::Id::Y, begin, end - begin,
+                y.data() + begin);
+        }, 0, ChunkSize);
+}
+
+
+// Sort the points by cell and find where the points of each cell start.
+void GridIndex::build(const std::vector<double>& x,
+    const std::vector<double>& y)
+{
+    const double width = m_bounds.maxx - m_bounds.minx;
+    const double height = m_bounds.maxy - m_bounds.miny;
+    m_xScale = (width > 0) ? m_cols / width : 0;
+    m_yScale = (height > 0) ? m_rows / height : 0;
+
+    const std::size_t n = x.size();
+    SortEntries entries(n);
+    parallelFor(0, n, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                entries[i] = SortEntry(row(y[i]) * m_cols + col(x[i]), i);
+        }, 0, ChunkSize);
+    radixSort(entries);
+
+    m_ids.resize(n);
+    m_x.resize(n);
+    m_y.resize(n);
+    parallelFor(0, n, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const PointId id = entries[i].second;
+                m_ids[i] = id;
+                m_x[i] = x[id];
+                m_y[i] = y[id];
+            }
+        }, 0, ChunkSize);
+
+    const std::size_t cells = m_cols * m_rows;
+    m_offsets.resize(cells + 1);
+    parallelFor(0, cells + 1, [&](std::size_t begin, std::size_t end)
+        {
+            auto it = std::lower_bound(entries.begin(), entries.end(),
+                SortEntry(begin, 0));
+            for (std::size_t cell = begin; cell < end; ++cell)
+            {
+                while (it != entries.end() && it->first < cell)
+                    ++it;
+                m_offsets[cell] = it - entries.begin();
+            }
+        }, 0, ChunkSize);
+}
+
+
+std::size_t GridIndex::col(double x) const
+{
+    const double pos = (x - m_bounds.minx) * m_xScale;
+    if (pos <= 0)
+        return 0;
+    return (std::min)((std::size_t)pos, m_cols - 1);
+}
+
+
+std::size_t GridIndex::row(double y) const
+{
+    const double pos = (y - m_bounds.miny) * m_yScale;
+    if (pos <= 0)
+        return 0;
+    return (std::min)((std::size_t)pos, m_rows - 1);
+}
+
+
+// Call a function with the position in m_ids of each point in the cells
+// that overlap a box.
+template<typename F>
+void GridIndex::visit(const BOX2D& box, F f) const
+{
+    if (box.maxx < box.minx || box.maxy < box.miny)
+        return;
+
+    const std::size_t col0 = col(box.minx);
+    const std::size_t col1 = col(box.maxx);
+    const std::size_t row0 = row(box.miny);
+    const std::size_t row1 = row(box.maxy);
+    for (std::size_t r = row0; r <= row1; ++r)
+    {
+        // The cells of a row are contiguous.
+        const std::size_t begin = m_offsets[r * m_cols + col0];
+        const std::size_t end = m_offsets[r * m_cols + col1 + 1];
+        for (std::size_t i = begin; i < end; ++i)
+            f(i);
+    }
+}
+
+
+PointIdList GridIndex::boxQuery(const BOX2D& box) const
+{
+    PointIdList ids;
+    visit(box, [this, &box, &ids](std::size_t i)
+        {
+            if (box.contains(m_x[i], m_y[i]))
+                ids.push_back(m_ids[i]);
+        });
+    return ids;
+}
+
+
+PointIdList GridIndex::radius(double x, double y, double radius) const
+{
+    PointIdList ids;
+    const double sqRadius = radius * radius;
+    visit(BOX2D(x - radius, y - radius, x + radius, y + radius),
+        [this, x, y, sqRadius, &ids](std::size_t i)
+        {
+            const double dx = m_x[i] - x;
+            const double dy = m_y[i] - y;
+            if (dx * dx + dy * dy <= sqRadius)
+                ids.push_back(m_ids[i]);
+        });
+    return ids;
+}
+
+} // namespace pdal
@@ -0,0 +1,164 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include <pdal/pdal_types.hpp>
+#include <pdal/util/Bounds.hpp>
+
+namespace pdal
+{
+
+class PointView;
+
+/**
+  A uniform grid of cells over the XY extent of the points of a view.  The
+  IDs of the points are bucketed by cell and stored contiguously in cell
+  order, along with the offset of the first ID of each cell.  The points
+  of a cell or a window of cells are found without searching a tree or
+  copying.  The index is built in parallel.
+*/
+class PDAL_DLL GridIndex
+{
+public:
+    /**
+      IDs of the points in a cell.
+    */
+    class Cell
+    {
+    public:
+        Cell(const PointId *begin, const PointId *end) :
+            m_begin(begin), m_end(end)
+        {}
+
+        const PointId *begin() const
+            { return m_begin; }
+        const PointId *end() const
+            { return m_end; }
+        std::size_t size() const
+            { return m_end - m_begin; }
+        bool empty() const
+            { return m_begin == m_end; }
+
+    private:
+        const PointId *m_begin;
+        const PointId *m_end;
+    };
+
+    /**
+      Build an index of square cells that cover the bounds of the points.
+
+      \param view  Points to index.
+      \param cellSize  Edge length of a cell.
+    */
+    GridIndex(const PointView& view, double cellSize);
+
+    /**
+      Build an index of cells that divide a bounding box.  Points outside
+      of the box are placed in the cells at its edges.
+
+      \param view  Points to index.
+      \param bounds  Box covered by the grid.
+      \param cols  Number of cells in the X direction.
+      \param rows  Number of cells in the Y direction.
+    */
+    GridIndex(const PointView& view, const BOX2D& bounds, std::size_t cols,
+        std::size_t rows);
+
+    const BOX2D& bounds() const
+        { return m_bounds; }
+    std::size_t cols() const
+        { return m_cols; }
+    std::size_t rows() const
+        { return m_rows; }
+
+    /**
+      Column of the cell that contains an X position.
+    */
+    std::size_t col(double x) const;
+
+    /**
+      Row of the cell that contains a Y position.
+    */
+    std::size_t row(double y) const;
+
+    /**
+      Get the IDs of the points in a cell, in the order of the points in
+      the view.
+    */
+    Cell points(std::size_t col, std::size_t row) const
+    {
+        const std::size_t cell = row * m_cols + col;
+        return Cell(m_ids.data() + m_offsets[cell],
+            m_ids.data() + m_offsets[cell + 1]);
+    }
+
+    /**
+      Find the points inside a box, edges included.
+
+      \param box  Query box.
+      \return  IDs of the points, ordered by cell.
+    */
+    PointIdList boxQuery(const BOX2D& box) const;
+
+    /**
+      Find the points within a distance of a position.
+
+      \param x  X position.
+      \param y  Y position.
+      \param radius  Distance from the position.
+      \return  IDs of the points, ordered by cell.
+    */
+    PointIdList radius(double x, double y, double radius) const;
+
+private:
+    BOX2D m_bounds;
+    std::size_t m_cols;
+    std::size_t m_rows;
+    double m_xScale;
+    double m_yScale;
+    // Position in m_ids of the first point of each cell, followed by the
+    // number of points.
+    std::vector<std::size_t> m_offsets;
+    std::vector<PointId> m_ids;
+    // Positions of the points, in the order of m_ids.
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+
+    void readPoints(const PointView& view, std::vector<double>& x,
+        std::vector<double>& y) const;
+    void build(const std::vector<double>& x, const std::vector<double>& y);
+    template<typename F>
+    void visit(const BOX2D& box, F f) const;
+};
+
+} // namespace pdal
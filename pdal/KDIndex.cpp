@@ -0,0 +1,65 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <pdal/KDIndex.hpp>
+
+#include <pdal/private/CurveKey.hpp>
+#include <pdal/private/RadixSort.hpp>
+
+namespace pdal
+{
+
+// Sort the query points by the Morton code of their position.
+template<int DIM>
+void KDIndex<DIM>::spatialOrder(PointId begin, PointId end,
+    NeighborList& out) const
+{
+    out.order.clear();
+    for (PointId idx = begin; idx < end; ++idx)
+    {
+        const double *p = coords(idx);
+        uint64_t code = 0;
+        for (int i = 0; i < DIM; ++i)
+        {
+            uint64_t cell = (uint64_t)((p[i] - m_origin[i]) * m_scale[i]);
+            code |= (DIM == 2 ? CurveKey::part1_by1(cell) :
+                CurveKey::part1_by2(cell)) << i;
+        }
+        out.order.emplace_back(code, idx);
+    }
+    radixSort(out.order);
+}
+
+template void KDIndex<2>::spatialOrder(PointId, PointId,
+    NeighborList&) const;
+template void KDIndex<3>::spatialOrder(PointId, PointId,
+    NeighborList&) const;
+
+} // namespace pdal
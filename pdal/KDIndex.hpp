@@ -34,12 +34,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 
 #include <nanoflann/nanoflann.hpp>
 
 #include <pdal/EigenUtils.hpp>
 #include <pdal/PointView.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 namespace nanoflann
 {
@@ -53,6 +56,75 @@ namespace nanoflann
 namespace pdal
 {
 
+/**
+  Neighbors found by a batch query of a KD index, stored contiguously.
+  The neighbors of the i'th query point are at positions offsets[i]
+  through offsets[i + 1] - 1 of ids and sqrDists, nearest first.
+  Reusing a list for several queries avoids reallocating its storage.
+*/
+struct NeighborList
+{
+    std::vector<std::size_t> offsets;
+    PointIdList ids;
+    std::vector<double> sqrDists;
+
+    // Number of query points.
+    std::size_t size() const
+        { return offsets.size() ? offsets.size() - 1 : 0; }
+    // Number of neighbors of query point i.
+    std::size_t count(std::size_t i) const
+        { return offsets[i + 1] - offsets[i]; }
+    const PointId *neighbors(std::size_t i) const
+        { return ids.data() + offsets[i]; }
+    const double *distances(std::size_t i) const
+        { return sqrDists.data() + offsets[i]; }
+    // Copy the neighbors of query point i to a list.
+    void neighbors(std::size_t i, PointIdList& list) const
+        { list.assign(ids.begin() + offsets[i], ids.begin() + offsets[i + 1]); }
+
+    // Scratch space for queries.
+    std::vector<std::pair<uint64_t, PointId>> order;
+    std::vector<std::pair<std::size_t, double>> matches;
+    std::vector<std::size_t> starts;
+    PointIdList scratchIds;
+    std::vector<double> scratchDists;
+};
+
+/**
+  The k nearest neighbors of every point in a view, nearest first.
+  Each point is its own nearest neighbor.  See PointView::buildKnnGraph().
+*/
+class KnnGraph
+{
+public:
+    KnnGraph(std::shared_ptr<const NeighborList> list, point_count_t k) :
+        m_list(list), m_k(k)
+    {}
+
+    // Number of neighbors of each point.
+    point_count_t k() const
+        { return m_k; }
+    // Number of neighbors of a point.  This is less than k() only if the
+    // view has fewer than k() points.
+    std::size_t count(PointId idx) const
+        { return (std::min)(m_list->count(idx), (std::size_t)m_k); }
+    const PointId *neighbors(PointId idx) const
+        { return m_list->neighbors(idx); }
+    const double *distances(PointId idx) const
+        { return m_list->distances(idx); }
+    // Copy the neighbors of a point to a list.
+    void neighbors(PointId idx, PointIdList& list) const
+    {
+        const PointId *start = neighbors(idx);
+        list.assign(start, start + count(idx));
+    }
+
+private:
+    // The list may hold more than k neighbors for each point.
+    std::shared_ptr<const NeighborList> m_list;
+    point_count_t m_k;
+};
+
 template<int DIM>
 class PDAL_DLL KDIndex
 {
@@ -67,17 +139,105 @@ public:
     std::size_t kdtree_get_point_count() const
         { return m_buf.size(); }
 
-    double kdtree_get_pt(const PointId idx, int dim) const;
+    double kdtree_get_pt(const PointId idx, int dim) const
+        { return m_coords[idx * DIM + dim]; }
     double kdtree_distance(const double *p1, const PointId p2_idx,
         size_t /*numDims*/) const;
     template <class BBOX> bool kdtree_get_bbox(BBOX& bb) const;
+
+    // The coordinates of the points are copied into a packed array when the
+    // index is built so that searches don't go through the point view.
+    // The subtrees of large nodes are built by parallelFor() loops, so
+    // index builds share the thread limit with other parallel work.
     void build()
     {
-        m_index.reset(new my_kd_tree_t(DIM, *this,
-            nanoflann::KDTreeSingleIndexAdaptorParams(100)));
+        cacheCoords();
+
+        nanoflann::KDTreeSingleIndexAdaptorParams params(100);
+        if (m_buf.size() >= ConcurrentBuildSize)
+        {
+            params.build_invoke = [](const std::function<void()>& left,
+                const std::function<void()>& right)
+            {
+                parallelFor(0, 2, [&left, &right](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                        if (i == 0)
+                            left();
+                        else
+                            right();
+                }, 2, 1);
+            };
+            params.build_invoke_size = ConcurrentBuildSize / 4;
+        }
+        m_index.reset(new my_kd_tree_t(DIM, *this, params));
         m_index->buildIndex();
     }
 
+    /**
+      Build the index of a view whose points are a subset of the points of
+      another, indexed view.  The tree of the other view's index is copied
+      without the points that aren't in this view, which is much faster
+      than build().  Queries may be a little slower than with an index made
+      by build() when few of the other view's points are kept.
+
+      \param source  Index of the other view.
+      \param ids  ID in the other view of each point of this view.  No ID
+        may appear more than once.
+    */
+    void build(const KDIndex& source, const PointIdList& ids)
+    {
+        assert(ids.size() == m_buf.size());
+
+        m_coords.resize(ids.size() * DIM);
+        parallelFor(0, ids.size(), [this, &source, &ids](PointId begin,
+            PointId end)
+            {
+                for (PointId idx = begin; idx < end; ++idx)
+                    std::copy_n(source.coords(ids[idx]), DIM,
+                        m_coords.data() + idx * DIM);
+            });
+        computeScale();
+
+        // Position of each of the source's points in this view.  Points
+        // that aren't in this view are past the end.
+        std::vector<std::size_t> map(source.m_coords.size() / DIM,
+            ids.size());
+        for (PointId idx = 0; idx < ids.size(); ++idx)
+            map[ids[idx]] = idx;
+
+        m_index.reset(new my_kd_tree_t(DIM, *this,
+            nanoflann::KDTreeSingleIndexAdaptorParams(100)));
+        m_index->buildSubsetIndex(*source.m_index, map);
+    }
+
+    /**
+      Find the k nearest neighbors of each point in a range of the view.
+      Each point is returned as its own nearest neighbor.  Queries are run
+      in spatial order, so nearby points search the same parts of the
+      tree one after another.
+
+      \param begin  ID of the first query point.
+      \param end  One past the ID of the last query point.
+      \param k  Number of neighbors to find for each point.
+      \param out  List in which to store the neighbors of each point.
+    */
+    void batchKnnSearch(PointId begin, PointId end, point_count_t k,
+        NeighborList& out) const;
+
+    /**
+      Find the points within a radius of each point in a range of the view.
+      Each point is returned as its own nearest neighbor.  Queries are run
+      in spatial order.
+
+      \param begin  ID of the first query point.
+      \param end  One past the ID of the last query point.
+      \param r  Search radius.
+      \param out  List in which to store the neighbors of each point.
+    */
+    void batchRadius(PointId begin, PointId end, double r,
+        NeighborList& out) const;
+
 protected:
     const PointView& m_buf;
 
@@ -86,7 +246,69 @@ protected:
 
     std::unique_ptr<my_kd_tree_t> m_index;
 
+    // Position of an indexed point.
+    const double *coords(PointId idx) const
+        { return m_coords.data() + idx * DIM; }
+
 private:
+    // Don't bother with extra threads to build small indexes.
+    static const point_count_t ConcurrentBuildSize = 100000;
+
+    // X, Y (and Z) of each point, interleaved.
+    std::vector<double> m_coords;
+    // Origin and scale used to compute Morton codes of points.
+    double m_origin[DIM];
+    double m_scale[DIM];
+
+    void spatialOrder(PointId begin, PointId end, NeighborList& out) const;
+
+    void cacheCoords()
+    {
+        static const Dimension::Id dims[] =
+            { Dimension::Id::X, Dimension::Id::Y, Dimension::Id::Z };
+        const point_count_t ChunkSize = 4096;
+
+        m_coords.resize(m_buf.size() * DIM);
+        std::vector<double> chunk(ChunkSize);
+        for (PointId begin = 0; begin < m_buf.size(); begin += ChunkSize)
+        {
+            point_count_t count =
+                (std::min)(ChunkSize, m_buf.size() - begin);
+            for (int dim = 0; dim < DIM; ++dim)
+            {
+                m_buf.getFieldRange(dims[dim], begin, count, chunk.data());
+                double *dst = m_coords.data() + begin * DIM + dim;
+                for (point_count_t i = 0; i < count; ++i, dst += DIM)
+                    *dst = chunk[i];
+            }
+        }
+        computeScale();
+    }
+
+    // Set the origin and scale of Morton codes from the cached coordinates.
+    void computeScale()
+    {
+        // Morton codes use 21 bits per dimension in 3D, 32 in 2D.
+        const double cells = (double)((1ULL << (64 / DIM)) - 1);
+        double low[DIM], high[DIM];
+        std::fill(low, low + DIM, 0.0);
+        std::fill(high, high + DIM, 0.0);
+        for (PointId idx = 0; idx < m_buf.size(); ++idx)
+        {
+            const double *p = coords(idx);
+            for (int i = 0; i < DIM; ++i)
+            {
+                low[i] = idx ? (std::min)(low[i], p[i]) : p[i];
+                high[i] = idx ? (std::max)(high[i], p[i]) : p[i];
+            }
+        }
+        for (int i = 0; i < DIM; ++i)
+        {
+            m_origin[i] = low[i];
+            m_scale[i] = (high[i] > low[i]) ? cells / (high[i] - low[i]) : 0;
+        }
+    }
+
     KDIndex(const KDIndex&);
     KDIndex& operator=(KDIndex&);
 };
@@ -138,8 +360,9 @@ public:
 
     PointIdList neighbors(PointId idx, point_count_t k) const
     {
-        double x = m_buf.getFieldAs<double>(Dimension::Id::X, idx);
-        double y = m_buf.getFieldAs<double>(Dimension::Id::Y, idx);
+        const double *p = coords(idx);
+        double x = p[0];
+        double y = p[1];
 
         return neighbors(x, y, k);
     }
@@ -169,8 +392,9 @@ public:
     void knnSearch(PointId idx, point_count_t k, PointIdList *indices,
         std::vector<double> *sqr_dists) const
     {
-        double x = m_buf.getFieldAs<double>(Dimension::Id::X, idx);
-        double y = m_buf.getFieldAs<double>(Dimension::Id::Y, idx);
+        const double *p = coords(idx);
+        double x = p[0];
+        double y = p[1];
 
         knnSearch(x, y, k, indices, sqr_dists);
     }
@@ -208,8 +432,9 @@ public:
 
     PointIdList radius(PointId idx, double const& r) const
     {
-        double x = m_buf.getFieldAs<double>(Dimension::Id::X, idx);
-        double y = m_buf.getFieldAs<double>(Dimension::Id::Y, idx);
+        const double *p = coords(idx);
+        double x = p[0];
+        double y = p[1];
 
         return radius(x, y, r);
     }
@@ -291,9 +516,10 @@ public:
 
     PointIdList neighbors(PointId idx, point_count_t k, size_t stride=1) const
     {
-        double x = m_buf.getFieldAs<double>(Dimension::Id::X, idx);
-        double y = m_buf.getFieldAs<double>(Dimension::Id::Y, idx);
-        double z = m_buf.getFieldAs<double>(Dimension::Id::Z, idx);
+        const double *p = coords(idx);
+        double x = p[0];
+        double y = p[1];
+        double z = p[2];
 
         return neighbors(x, y, z, k, stride);
     }
@@ -326,9 +552,10 @@ public:
     void knnSearch(PointId idx, point_count_t k, PointIdList *indices,
         std::vector<double> *sqr_dists) const
     {
-        double x = m_buf.getFieldAs<double>(Dimension::Id::X, idx);
-        double y = m_buf.getFieldAs<double>(Dimension::Id::Y, idx);
-        double z = m_buf.getFieldAs<double>(Dimension::Id::Z, idx);
+        const double *p = coords(idx);
+        double x = p[0];
+        double y = p[1];
+        double z = p[2];
 
         knnSearch(x, y, z, k, indices, sqr_dists);
     }
@@ -367,9 +594,10 @@ public:
 
     PointIdList radius(PointId idx, double r) const
     {
-        double x = m_buf.getFieldAs<double>(Dimension::Id::X, idx);
-        double y = m_buf.getFieldAs<double>(Dimension::Id::Y, idx);
-        double z = m_buf.getFieldAs<double>(Dimension::Id::Z, idx);
+        const double *p = coords(idx);
+        double x = p[0];
+        double y = p[1];
+        double z = p[2];
 
         return radius(x, y, z, r);
     }
@@ -503,128 +731,129 @@ private:
     KDFlexIndex& operator=(KDFlexIndex&);
 };
 
-template<>
-inline
-double KDIndex<2>::kdtree_get_pt(const PointId idx, int dim) const
-{
-    if (idx >= m_buf.size())
-        return 0.0;
-
-    Dimension::Id id = Dimension::Id::Unknown;
-    switch (dim)
-    {
-    case 0:
-        id = Dimension::Id::X;
-        break;
-    case 1:
-        id = Dimension::Id::Y;
-        break;
-    default:
-        throw pdal_error("kdtree_get_pt: Request for invalid dimension "
-            "from nanoflann");
-    }
-    return m_buf.getFieldAs<double>(id, idx);
-}
-
-template<>
-inline
-double KDIndex<3>::kdtree_get_pt(const PointId idx, int dim) const
-{
-    if (idx >= m_buf.size())
-        return 0.0;
-
-    Dimension::Id id = Dimension::Id::Unknown;
-    switch (dim)
-    {
-    case 0:
-        id = Dimension::Id::X;
-        break;
-    case 1:
-        id = Dimension::Id::Y;
-        break;
-    case 2:
-        id = Dimension::Id::Z;
-        break;
-    default:
-        throw pdal_error("kdtree_get_pt: Request for invalid dimension "
-            "from nanoflann");
-    }
-    return m_buf.getFieldAs<double>(id, idx);
-}
-
 // nanoflann hands us a vector that represents the position of p1.  We fetch
 // the position of p2 and and compute the square distance.
-template<>
-inline double KDIndex<2>::kdtree_distance(const double *p1, const PointId idx,
-    size_t /*numDims*/) const
-{
-    double d0 = p1[0] - m_buf.getFieldAs<double>(Dimension::Id::X, idx);
-    double d1 = p1[1] - m_buf.getFieldAs<double>(Dimension::Id::Y, idx);
-
-    return (d0 * d0 + d1 * d1);
-}
-
-template<>
-inline double KDIndex<3>::kdtree_distance(const double *p1, const PointId idx,
-    size_t /*numDims*/) const
+template<int DIM>
+inline double KDIndex<DIM>::kdtree_distance(const double *p1,
+    const PointId idx, size_t /*numDims*/) const
 {
-    double d0 = p1[0] - m_buf.getFieldAs<double>(Dimension::Id::X, idx);
-    double d1 = p1[1] - m_buf.getFieldAs<double>(Dimension::Id::Y, idx);
-    double d2 = p1[2] - m_buf.getFieldAs<double>(Dimension::Id::Z, idx);
-
-    return (d0 * d0 + d1 * d1 + d2 * d2);
+    const double *p2 = coords(idx);
+    double dist = 0;
+    for (int i = 0; i < DIM; ++i)
+    {
+        double d = p1[i] - p2[i];
+        dist += d * d;
+    }
+    return dist;
 }
 
-template<>
+template<int DIM>
 template <class BBOX>
-bool KDIndex<2>::kdtree_get_bbox(BBOX& bb) const
+bool KDIndex<DIM>::kdtree_get_bbox(BBOX& bb) const
 {
-    if (m_buf.empty())
+    for (int i = 0; i < DIM; ++i)
     {
-        bb[0].low = 0.0;
-        bb[0].high = 0.0;
-        bb[1].low = 0.0;
-        bb[1].high = 0.0;
+        bb[i].low = 0.0;
+        bb[i].high = 0.0;
     }
-    else
-    {
-        BOX2D bounds;
-        calculateBounds(m_buf, bounds);
+    if (m_buf.empty())
+        return true;
 
-        bb[0].low = bounds.minx;
-        bb[0].high = bounds.maxx;
-        bb[1].low = bounds.miny;
-        bb[1].high = bounds.maxy;
+    const double *p = coords(0);
+    for (int i = 0; i < DIM; ++i)
+        bb[i].low = bb[i].high = p[i];
+    for (PointId idx = 1; idx < m_buf.size(); ++idx)
+    {
+        p = coords(idx);
+        for (int i = 0; i < DIM; ++i)
+        {
+            bb[i].low = (std::min)(bb[i].low, p[i]);
+            bb[i].high = (std::max)(bb[i].high, p[i]);
+        }
     }
     return true;
 }
 
-template<>
-template <class BBOX>
-bool KDIndex<3>::kdtree_get_bbox(BBOX& bb) const
+template<int DIM>
+void KDIndex<DIM>::batchKnnSearch(PointId begin, PointId end,
+    point_count_t k, NeighborList& out) const
 {
-    if (m_buf.empty())
-    {
-        bb[0].low = 0.0;
-        bb[0].high = 0.0;
-        bb[1].low = 0.0;
-        bb[1].high = 0.0;
-        bb[2].low = 0.0;
-        bb[2].high = 0.0;
+    k = (std::min)(m_buf.size(), k);
+    end = (std::min)(end, (PointId)m_buf.size());
+    begin = (std::min)(begin, end);
+    point_count_t count = end - begin;
+
+    // Every point has k neighbors, so results can be stored directly in
+    // the position for the query point.
+    out.offsets.resize(count + 1);
+    for (point_count_t i = 0; i <= count; ++i)
+        out.offsets[i] = i * k;
+    out.ids.resize(count * k);
+    out.sqrDists.resize(count * k);
+
+    spatialOrder(begin, end, out);
+    for (auto& o : out.order)
+    {
+        std::size_t pos = out.offsets[o.second - begin];
+        nanoflann::KNNResultSet<double, PointId, point_count_t> resultSet(k);
+        resultSet.init(out.ids.data() + pos, out.sqrDists.data() + pos);
+        m_index->findNeighbors(resultSet, coords(o.second),
+            nanoflann::SearchParams(10));
     }
-    else
-    {
-        BOX3D bounds;
-        calculateBounds(m_buf, bounds);
+}
 
-        bb[0].low = bounds.minx;
-        bb[0].high = bounds.maxx;
-        bb[1].low = bounds.miny;
-        bb[1].high = bounds.maxy;
-        bb[2].low = bounds.minz;
-        bb[2].high = bounds.maxz;
+template<int DIM>
+void KDIndex<DIM>::batchRadius(PointId begin, PointId end, double r,
+    NeighborList& out) const
+{
+    end = (std::min)(end, (PointId)m_buf.size());
+    begin = (std::min)(begin, end);
+    point_count_t count = end - begin;
+
+    nanoflann::SearchParams params;
+    params.sorted = true;
+
+    // Find neighbors in spatial order, noting where the results for each
+    // query point start and how many there are.  The results are then
+    // copied to the output in query order.
+    // Our distance metric is square distance, so we use the square of
+    // the radius.
+    spatialOrder(begin, end, out);
+    out.starts.resize(count);
+    out.offsets.resize(count + 1);
+    out.scratchIds.clear();
+    out.scratchDists.clear();
+    for (auto& o : out.order)
+    {
+        PointId i = o.second - begin;
+        out.matches.clear();
+        m_index->radiusSearch(coords(o.second), r * r, out.matches, params);
+        out.starts[i] = out.scratchIds.size();
+        out.offsets[i + 1] = out.matches.size();
+        for (auto& m : out.matches)
+        {
+            out.scratchIds.push_back(m.first);
+            out.scratchDists.push_back(m.second);
+        }
+    }
+
+    out.offsets[0] = 0;
+    for (point_count_t i = 0; i < count; ++i)
+        out.offsets[i + 1] += out.offsets[i];
+
+    out.ids.resize(out.scratchIds.size());
+    out.sqrDists.resize(out.scratchDists.size());
+    for (point_count_t i = 0; i < count; ++i)
+    {
+        std::size_t start = out.starts[i];
+        std::size_t n = out.count(i);
+        std::copy(out.scratchIds.begin() + start,
+            out.scratchIds.begin() + start + n,
+            out.ids.begin() + out.offsets[i]);
+        std::copy(out.scratchDists.begin() + start,
+            out.scratchDists.begin() + start + n,
+            out.sqrDists.begin() + out.offsets[i]);
     }
-    return true;
 }
 
 } // namespace pdal
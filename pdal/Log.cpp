@@ -35,12 +35,77 @@
 #include <pdal/Log.hpp>
 #include <pdal/PDALUtils.hpp>
 
+#include <cstring>
 #include <fstream>
 #include <ostream>
 
 namespace pdal
 {
 
+// Stream to which one thread writes log messages.  Output is held until a
+// line is complete or the stream is flushed and then written to the log's
+// output stream with the write mutex locked.
+class Log::ThreadStream : public std::ostream
+{
+    class Buf : public std::streambuf
+    {
+    public:
+        Buf(std::ostream& out, std::mutex& mutex) : m_out(out),
+            m_mutex(mutex)
+        {}
+
+    protected:
+        virtual int_type overflow(int_type c)
+        {
+            if (traits_type::eq_int_type(c, traits_type::eof()))
+                return traits_type::not_eof(c);
+            m_pending += traits_type::to_char_type(c);
+            if (c == '\n')
+                write(m_pending.size());
+            return c;
+        }
+
+        virtual std::streamsize xsputn(const char *s, std::streamsize n)
+        {
+            m_pending.append(s, (size_t)n);
+            if (std::memchr(s, '\n', (size_t)n))
+                write(m_pending.rfind('\n') + 1);
+            return n;
+        }
+
+        virtual int sync()
+        {
+            write(m_pending.size());
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_out.flush();
+            return 0;
+        }
+
+    private:
+        void write(size_t count)
+        {
+            if (count == 0)
+                return;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_out.write(m_pending.data(), count);
+            m_pending.erase(0, count);
+        }
+
+        std::ostream& m_out;
+        std::mutex& m_mutex;
+        std::string m_pending;
+    };
+
+public:
+    ThreadStream(std::ostream& out, std::mutex& mutex) :
+        std::ostream(nullptr), m_buf(out, mutex)
+    { rdbuf(&m_buf); }
+
+private:
+    Buf m_buf;
+};
+
+
 Log::Log(std::string const& leaderString, std::string const& outputName,
         bool timing)
     : m_level(LogLevel::Warning)
@@ -60,7 +125,9 @@ Log::Log(std::string const& leaderString, std::string const& outputName,
         m_log = Utils::createFile(outputName);
         m_deleteStreamOnCleanup = true;
     }
-    m_leaders.push(leaderString);
+    m_owner = std::this_thread::get_id();
+    m_baseLeader = leaderString;
+    m_leaders[m_owner].push(leaderString);
     if (m_timing)
         m_start = m_clock.now();
 }
@@ -72,7 +139,9 @@ Log::Log(std::string const& leaderString, std::ostream* v, bool timing)
     , m_timing(timing)
 {
     m_log = v;
-    m_leaders.push(leaderString);
+    m_owner = std::this_thread::get_id();
+    m_baseLeader = leaderString;
+    m_leaders[m_owner].push(leaderString);
     if (m_timing)
         m_start = m_clock.now();
 }
@@ -93,6 +162,8 @@ LogPtr Log::makeLog(std::string const& leaderString, std::ostream* v,
 
 Log::~Log()
 {
+    for (auto& sp : m_streams)
+        sp.second->flush();
     if (m_deleteStreamOnCleanup)
     {
         m_log->flush();
@@ -103,6 +174,7 @@ Log::~Log()
 
 void Log::floatPrecision(int level)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_log->setf(std::ios_base::fixed, std::ios_base::floatfield);
     m_log->precision(level);
 }
@@ -110,6 +182,7 @@ void Log::floatPrecision(int level)
 
 void Log::clearFloat()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_log->unsetf(std::ios_base::fixed);
     m_log->unsetf(std::ios_base::floatfield);
 }
@@ -123,22 +196,36 @@ std::ostream& Log::get(LogLevel level)
     if (incoming <= stored)
     {
         const std::string l = leader();
+        std::ostream& out = threadStream();
 
-        *m_log << "(" << l;
+        out << "(" << l;
          if (l.size())
-             *m_log << " ";
-         *m_log << getLevelString(level);
+             out << " ";
+         out << getLevelString(level);
          if (m_timing)
-             *m_log << " " << now();
-         *m_log <<") " <<
+             out << " " << now();
+         out <<") " <<
          std::string(incoming < nativeDebug ? 0 : incoming - nativeDebug,
              '\t');
-        return *m_log;
+        return out;
     }
     return m_nullStream;
 }
 
 
+// Get the calling thread's stream, formatted like the output stream.
+std::ostream& Log::threadStream()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_ptr<ThreadStream>& s = m_streams[std::this_thread::get_id()];
+    if (!s)
+        s.reset(new ThreadStream(*m_log, m_writeMutex));
+    s->flags(m_log->flags());
+    s->precision(m_log->precision());
+    return *s;
+}
+
+
 std::string Log::getLevelString(LogLevel level) const
 {
     switch (level)
@@ -35,9 +35,12 @@
 #pragma once
 
 #include <cassert>
+#include <map>
 #include <memory> // shared_ptr
+#include <mutex>
 #include <stack>
 #include <chrono>
+#include <thread>
 
 #include <pdal/pdal_internal.hpp>
 #include <pdal/util/NullOStream.hpp>
@@ -104,21 +107,40 @@ public:
     void setLeader(const std::string& leader)
         { pushLeader(leader); }
 
-    /// Push the leader string onto the stack.
+    /// Push the leader string onto the stack.  Each thread has its own
+    /// stack of leaders so that stages running in parallel don't
+    /// interfere with one another.
     /// \param  leader  Leader string
     void pushLeader(const std::string& leader)
-        { m_leaders.push(leader); }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_leaders[std::this_thread::get_id()].push(leader);
+    }
 
     /// Get the leader string.
     /// \return  The current leader string.
     std::string leader() const
-        { return m_leaders.empty() ? std::string() : m_leaders.top(); }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_leaders.find(std::this_thread::get_id());
+        if (it == m_leaders.end())
+            return m_baseLeader;
+        return it->second.empty() ? std::string() : it->second.top();
+    }
 
     /// Pop the current leader string.
     void popLeader()
     {
-        if (!m_leaders.empty())
-            m_leaders.pop();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_leaders.find(std::this_thread::get_id());
+        if (it == m_leaders.end())
+            return;
+        if (!it->second.empty())
+            it->second.pop();
+        // Threads other than the one that created the log fall back to
+        // the base leader once they've popped everything they pushed.
+        if (it->second.empty() && it->first != m_owner)
+            m_leaders.erase(it);
     }
 
     /// @return A string representing the LogLevel
@@ -137,6 +159,9 @@ public:
     /// @param level logging level to request
     /// If the logging level asked for with
     /// pdal::Log::get is less than the logging level of the pdal::Log instance
+    /// Each thread is given its own stream, from which complete lines are
+    /// passed to the log's output stream, so that messages from stages
+    /// running in parallel don't interleave.
     std::ostream& get(LogLevel level = LogLevel::Info);
 
     /// Sets the floating point precision
@@ -149,13 +174,21 @@ protected:
     std::ostream *m_log;
 
 private:
+    class ThreadStream;
+
     Log(const Log&) = delete;
     Log& operator =(const Log&) = delete;
     std::string now() const;
+    std::ostream& threadStream();
 
     LogLevel m_level;
     bool m_deleteStreamOnCleanup;
-    std::stack<std::string> m_leaders;
+    std::map<std::thread::id, std::stack<std::string>> m_leaders;
+    std::string m_baseLeader;
+    std::thread::id m_owner;
+    mutable std::mutex m_mutex;
+    std::map<std::thread::id, std::unique_ptr<ThreadStream>> m_streams;
+    std::mutex m_writeMutex;
     NullOStream m_nullStream;
     bool m_timing;
     std::chrono::steady_clock m_clock;
@@ -34,6 +34,8 @@
 
 #include <pdal/PDALUtils.hpp>
 
+#include <random>
+
 #include <arbiter/arbiter.hpp>
 
 #include <pdal/KDIndex.hpp>
@@ -360,6 +362,34 @@ bool fileExists(const std::string& path)
     return FileUtils::fileExists(path);
 }
 
+
+/**
+  Create a directory with a unique name to hold temporary files.
+
+  \param base  Directory in which to create the directory.  The system's
+    temporary directory is used if empty.
+  \param prefix  Prefix of the name of the directory.  A random number
+    is appended.
+  \return  Path of the created directory, or an empty string if no
+    directory could be created.
+*/
+std::string createTempDirectory(const std::string& base,
+    const std::string& prefix)
+{
+    std::string parent = base.size() ? base : arbiter::getTempPath();
+    if (parent.back() != '/' && parent.back() != '\\')
+        parent += '/';
+
+    std::random_device rd;
+    for (int i = 0; i < 100; ++i)
+    {
+        std::string dir = parent + prefix + std::to_string(rd());
+        if (FileUtils::createDirectory(dir))
+            return dir;
+    }
+    return std::string();
+}
+
 double computeHausdorff(PointViewPtr srcView, PointViewPtr candView)
 {
     using namespace Dimension;
@@ -271,6 +271,8 @@ void PDAL_DLL closeFile(std::ostream *out);
 std::string PDAL_DLL fetchRemote(const std::string& path);
 bool PDAL_DLL isRemote(const std::string& path);
 bool PDAL_DLL fileExists(const std::string& path);
+std::string PDAL_DLL createTempDirectory(const std::string& base,
+    const std::string& prefix);
 std::vector<std::string> PDAL_DLL maybeGlob(const std::string& path);
 double PDAL_DLL computeHausdorff(PointViewPtr srcView, PointViewPtr candView);
 
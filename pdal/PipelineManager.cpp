@@ -49,7 +49,7 @@ PipelineManager::PipelineManager(point_count_t streamLimit) :
     m_tablePtr(new PointTable()), m_table(*m_tablePtr),
     m_streamTablePtr(new FixedPointTable(streamLimit)),
     m_streamTable(*m_streamTablePtr),
-    m_progressFd(-1), m_input(nullptr)
+    m_progressFd(-1), m_threads(1), m_input(nullptr)
 {}
 
 
@@ -239,7 +239,7 @@ PipelineManager::ExecResult PipelineManager::execute(ExecMode mode)
             goto next;
         }
         // We can stream.
-        s->execute(m_streamTable);
+        s->execute(m_streamTable, m_threads);
         result.m_mode = ExecMode::Stream;
         return result;
     }
@@ -250,14 +250,14 @@ PipelineManager::ExecResult PipelineManager::execute(ExecMode mode)
         if (s->pipelineStreamable())
         {
             s->prepare(m_streamTable);
-            s->execute(m_streamTable);
+            s->execute(m_streamTable, m_threads);
             result.m_mode = ExecMode::Stream;
         }
     }
     else if (mode == ExecMode::Standard)
     {
         s->prepare(m_table);
-        m_viewSet = s->execute(m_table);
+        m_viewSet = s->execute(m_table, m_threads);
         point_count_t cnt = 0;
         for (auto pi = m_viewSet.begin(); pi != m_viewSet.end(); ++pi)
         {
@@ -284,7 +284,7 @@ void PipelineManager::executeStream(StreamPointTable& table)
         return;
 
     s->prepare(table);
-    s->execute(table);
+    s->execute(table, m_threads);
 }
 
 
@@ -80,6 +80,12 @@ public:
     void setProgressFd(int fd)
         { m_progressFd = fd; }
 
+    // Set the maximum number of threads used to run independent branches
+    // of a pipeline executed in standard mode or to pipeline the stages
+    // of a pipeline executed in stream mode.
+    void setThreads(std::size_t threads)
+        { m_threads = threads; }
+
     void readPipeline(std::istream& input);
     void readPipeline(const std::string& filename);
 
@@ -165,6 +171,7 @@ private:
     PointViewSet m_viewSet;
     std::vector<Stage*> m_stages; // stage observer, never owner
     int m_progressFd;
+    std::size_t m_threads;
     std::istream *m_input;
     LogPtr m_log;
 
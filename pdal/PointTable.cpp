@@ -35,6 +35,8 @@
 #include <pdal/ArtifactManager.hpp>
 #include <pdal/PointTable.hpp>
 
+#include "private/MemoryArena.hpp"
+
 namespace pdal
 {
 
@@ -99,28 +101,124 @@ void SimplePointTable::getFieldInternal(Dimension::Id id, PointId idx,
 }
 
 
+PointTable::PointTable() : SimplePointTable(m_layout), m_dir(nullptr),
+    m_dirSize(0), m_numBlocks(0), m_numPts(0), m_curArena(0),
+    m_sizeHint(0), m_hugePages(false)
+{}
+
+
+PointTable::PointTable(point_count_t sizeHint, bool hugePages) :
+    SimplePointTable(m_layout), m_dir(nullptr), m_dirSize(0),
+    m_numBlocks(0), m_numPts(0), m_curArena(0), m_sizeHint(sizeHint),
+    m_hugePages(hugePages)
+{}
+
+
+// Blocks are owned by the arenas.
 PointTable::~PointTable()
+{}
+
+
+void PointTable::finalize()
+{
+    if (m_layout.finalized())
+        return;
+
+    BasePointTable::finalize();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_sizeHint)
+        reserveBlocks(m_sizeHint);
+    m_sizeHint = 0;
+}
+
+
+void PointTable::reserve(point_count_t count)
 {
-    for (auto vi = m_blocks.begin(); vi != m_blocks.end(); ++vi)
-        delete [] *vi;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_layout.finalized())
+        reserveBlocks(count);
+    else
+        m_sizeHint += count;
 }
 
+
+// Make an arena large enough for the blocks that will hold the next
+// 'count' points, less what's left in the existing arenas.  Call with the
+// mutex held.
+void PointTable::reserveBlocks(point_count_t count)
+{
+    const size_t blockSize = pointsToBytes(m_blockPtCnt);
+    if (!blockSize)
+        return;
+
+    point_count_t end = m_numPts.load() + count;
+    size_t needed = (size_t)((end + m_blockPtCnt - 1) / m_blockPtCnt);
+    size_t have = m_numBlocks.load(std::memory_order_relaxed);
+    for (size_t i = m_curArena; i < m_arenas.size(); ++i)
+        have += m_arenas[i]->available() / blockSize;
+    if (needed > have)
+        m_arenas.emplace_back(
+            new MemoryArena((needed - have) * blockSize, m_hugePages));
+}
+
+
+// Several threads may add points at once when independent pipeline branches
+// are executed in parallel.  Point IDs are handed out atomically and only
+// the thread that finds the block for its ID missing takes the lock.
 PointId PointTable::addPoint()
 {
-    if (m_numPts % m_blockPtCnt == 0)
+    PointId idx = m_numPts++;
+    std::size_t blockNum = idx / m_blockPtCnt;
+    if (blockNum >= m_numBlocks.load(std::memory_order_acquire))
+        addBlocks(blockNum);
+    return idx;
+}
+
+
+// Make sure that blocks up to and including 'blockNum' exist.
+void PointTable::addBlocks(std::size_t blockNum)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::size_t numBlocks = m_numBlocks.load(std::memory_order_relaxed);
+    while (numBlocks <= blockNum)
     {
+        if (numBlocks == m_dirSize)
+        {
+            std::size_t newSize = (std::max)(m_dirSize * 2, (size_t)16);
+            std::unique_ptr<char *[]> dir(new char *[newSize]);
+            std::copy(m_dir.load(), m_dir.load() + m_dirSize, dir.get());
+            m_dir.store(dir.get(), std::memory_order_release);
+            m_dirs.push_back(std::move(dir));
+            m_dirSize = newSize;
+        }
+        // Arena memory is already zeroed.  Use up the arenas in order.
         size_t size = pointsToBytes(m_blockPtCnt);
-        char *buf = new char[size];
-        memset(buf, 0, size);
-        m_blocks.push_back(buf);
+        char *buf = nullptr;
+        while (!buf && m_curArena < m_arenas.size())
+            if (!(buf = m_arenas[m_curArena]->allocate(size)))
+                m_curArena++;
+        if (!buf)
+        {
+            m_arenas.emplace_back(new MemoryArena(size, m_hugePages));
+            buf = m_arenas.back()->allocate(size);
+        }
+        m_dir.load(std::memory_order_relaxed)[numBlocks] = buf;
+        m_numBlocks.store(++numBlocks, std::memory_order_release);
     }
-    return m_numPts++;
+}
+
+
+std::size_t PointTable::memoryRegions()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_arenas.size();
 }
 
 
 char *PointTable::getPoint(PointId idx)
 {
-    char *buf = m_blocks[idx / m_blockPtCnt];
+    char *buf = m_dir.load(std::memory_order_acquire)[idx / m_blockPtCnt];
     return buf + pointsToBytes(idx % m_blockPtCnt);
 }
 
@@ -129,6 +227,26 @@ ContiguousPointTable::~ContiguousPointTable()
 {}
 
 
+void ContiguousPointTable::finalize()
+{
+    if (m_layout.finalized())
+        return;
+
+    BasePointTable::finalize();
+    if (m_sizeHint)
+        m_buf.reserve(pointsToBytes(m_sizeHint));
+}
+
+
+void ContiguousPointTable::reserve(point_count_t count)
+{
+    if (m_layout.finalized())
+        m_buf.reserve(pointsToBytes(m_numPts + count));
+    else
+        m_sizeHint += count;
+}
+
+
 PointId ContiguousPointTable::addPoint()
 {
     m_buf.resize(pointsToBytes(m_numPts + 1));
@@ -142,6 +260,104 @@ char *ContiguousPointTable::getPoint(PointId idx)
 }
 
 
+ColumnPointTable::~ColumnPointTable()
+{}
+
+
+void ColumnPointTable::finalize()
+{
+    if (m_layout.finalized())
+        return;
+
+    BasePointTable::finalize();
+    for (Dimension::Id id : m_layout.dims())
+        column(id);
+}
+
+
+// Columns are sized for m_capacity points.  Dimensions can be registered
+// after points have been added to a table whose layout isn't finalized,
+// so a column is created or grown when it's first touched.
+std::vector<char>& ColumnPointTable::column(Dimension::Id id)
+{
+    size_t col = Utils::toNative(id);
+    if (col >= m_columns.size())
+        m_columns.resize(col + 1);
+    std::vector<char>& c = m_columns[col];
+    size_t size = m_layout.dimSize(id) * m_capacity;
+    if (c.size() < size)
+        c.resize(size);
+    return c;
+}
+
+
+void ColumnPointTable::grow(point_count_t capacity)
+{
+    m_capacity = capacity;
+    for (Dimension::Id id : m_layout.dims())
+        column(id);
+}
+
+
+void ColumnPointTable::reserve(point_count_t count)
+{
+    if (m_numPts + count > m_capacity)
+        grow(m_numPts + count);
+}
+
+
+PointId ColumnPointTable::addPoint()
+{
+    if (m_numPts == m_capacity)
+        grow((std::max)(2 * m_capacity, (point_count_t)1024));
+    return m_numPts++;
+}
+
+
+char *ColumnPointTable::getPoint(PointId idx)
+{
+    throw pdal_error("Packed point data isn't available from a "
+        "ColumnPointTable.");
+}
+
+
+char *ColumnPointTable::columnData(Dimension::Id id)
+{
+    if (!m_layout.hasDim(id))
+        return nullptr;
+    return column(id).data();
+}
+
+
+void ColumnPointTable::setFieldInternal(Dimension::Id id, PointId idx,
+    const void *value)
+{
+    const Dimension::Detail *d = m_layout.dimDetail(id);
+    const char *src = (const char *)value;
+    char *dst = column(id).data() + idx * d->size();
+    std::copy(src, src + d->size(), dst);
+}
+
+
+void ColumnPointTable::getFieldInternal(Dimension::Id id, PointId idx,
+    void *value) const
+{
+    const Dimension::Detail *d = m_layout.dimDetail(id);
+    char *dst = (char *)value;
+    size_t col = Utils::toNative(id);
+    size_t pos = idx * d->size();
+
+    // A column that hasn't been written holds zeros.
+    if (col >= m_columns.size() || m_columns[col].size() < pos + d->size())
+    {
+        std::fill(dst, dst + d->size(), 0);
+        return;
+    }
+    const char *src = m_columns[col].data() + pos;
+    std::copy(src, src + d->size(), dst);
+}
+
+
 MetadataNode BasePointTable::toMetadata() const
 {
     return layout()->toMetadata();
@@ -35,7 +35,10 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "pdal/SpatialReference.hpp"
@@ -48,6 +51,7 @@ namespace pdal
 {
 
 class ArtifactManager;
+class MemoryArena;
 
 class PDAL_DLL BasePointTable : public PointContainer
 {
@@ -91,6 +95,17 @@ public:
     }
     virtual bool supportsView() const
         { return false; }
+    /// Whether points may be added to and accessed in the table from
+    /// several threads at once.  Required for parallel execution of
+    /// independent pipeline branches.
+    virtual bool supportsConcurrentAdd() const
+        { return false; }
+    /// Hint that \ref count more points are about to be added so that the
+    /// table can allocate memory for them at once.  Readers call this
+    /// when they know how many points they will read.
+    /// \param count  Number of points expected to be added.
+    virtual void reserve(point_count_t /*count*/)
+        {}
     MetadataNode privateMetadata(const std::string& name);
     MetadataNode toMetadata() const;
     ArtifactManager& artifactManager();
@@ -101,6 +116,11 @@ private:
 
 protected:
     virtual char *getPoint(PointId idx) = 0;
+    /// Pointer to the values of a dimension for all points in the table,
+    /// stored contiguously in point ID order, or nullptr if the table
+    /// doesn't store dimensions that way.
+    virtual char *columnData(Dimension::Id id)
+        { return nullptr; }
 
 protected:
     MetadataPtr m_metadata;
@@ -144,17 +164,55 @@ private:
 class PDAL_DLL PointTable : public SimplePointTable
 {
 private:
-    // Point storage.
-    std::vector<char *> m_blocks;
-    point_count_t m_numPts;
+    // Point storage.  Blocks are found through a directory of block
+    // pointers.  When the directory needs to grow, a larger copy is made and
+    // published and the old one is retained until the table is destroyed so
+    // that threads reading points through it are never left dangling.
+    std::vector<std::unique_ptr<char *[]>> m_dirs;
+    std::atomic<char **> m_dir;
+    std::size_t m_dirSize;
+    std::atomic<std::size_t> m_numBlocks;
+    std::atomic<point_count_t> m_numPts;
+    std::mutex m_mutex;
     static const point_count_t m_blockPtCnt = 65536;
 
+    // Memory from which blocks are allocated, and the first arena that may
+    // have room for another block.
+    std::vector<std::unique_ptr<MemoryArena>> m_arenas;
+    std::size_t m_curArena;
+    // Points to reserve once the size of a point is known.
+    point_count_t m_sizeHint;
+    bool m_hugePages;
+
 public:
-    PointTable() : SimplePointTable(m_layout), m_numPts(0)
-        {}
+    PointTable();
+
+    /**
+      Create a point table that reserves memory for a number of points.
+      Memory for up to \ref sizeHint points is reserved as a single region
+      when the table's layout is finalized, so adding those points won't
+      allocate.  Memory is left untouched until points are written, so
+      each page is placed on the NUMA node of the thread that fills it.
+
+      \param sizeHint  Number of points for which to reserve memory.
+      \param hugePages  Whether to request transparent huge pages for
+        point memory.
+    */
+    PointTable(point_count_t sizeHint, bool hugePages = false);
     virtual ~PointTable();
     virtual bool supportsView() const
         { return true; }
+    virtual bool supportsConcurrentAdd() const
+        { return true; }
+    virtual void finalize();
+    virtual void reserve(point_count_t count);
+
+    /**
+      Number of separately allocated regions of memory holding points.
+
+      eturn  Number of memory regions.
+    */
+    std::size_t memoryRegions();
 
 protected:
     virtual char *getPoint(PointId idx);
@@ -162,6 +220,8 @@ protected:
 private:
     // Point data operations.
     virtual PointId addPoint();
+    void addBlocks(std::size_t blockNum);
+    void reserveBlocks(point_count_t count);
 
     PointLayout m_layout;
 };
@@ -171,13 +231,22 @@ class PDAL_DLL ContiguousPointTable : public SimplePointTable
 private:
     std::vector<char> m_buf;
     point_count_t m_numPts;
+    point_count_t m_sizeHint;
 
 public:
-    ContiguousPointTable() : SimplePointTable(m_layout), m_numPts(0)
+    ContiguousPointTable() : SimplePointTable(m_layout), m_numPts(0),
+        m_sizeHint(0)
+        {}
+    /// Create a table whose buffer is sized for \ref sizeHint points when
+    /// the layout is finalized.
+    ContiguousPointTable(point_count_t sizeHint) : SimplePointTable(m_layout),
+        m_numPts(0), m_sizeHint(sizeHint)
         {}
     virtual ~ContiguousPointTable();
     virtual bool supportsView() const
         { return true; }
+    virtual void finalize();
+    virtual void reserve(point_count_t count);
 
 protected:
     virtual char *getPoint(PointId idx);
@@ -188,6 +257,45 @@ private:
     PointLayout m_layout;
 };
 
+/// A point table that stores the values of each dimension contiguously
+/// (structure of arrays) rather than storing each point contiguously.
+/// Filters that only touch a few dimensions can get at the values of a
+/// dimension for all points of a view with PointView::dimensionData().
+/// Raw access to a point's packed data (PointView::getPoint() and
+/// PointView::getOrAddPoint()) isn't supported and throws; use
+/// PointView::getPackedPoint() and PointView::setPackedPoint() instead.
+class PDAL_DLL ColumnPointTable : public SimplePointTable
+{
+public:
+    ColumnPointTable() : SimplePointTable(m_layout), m_numPts(0),
+        m_capacity(0)
+        {}
+    virtual ~ColumnPointTable();
+    virtual bool supportsView() const
+        { return true; }
+    virtual void finalize();
+    virtual void reserve(point_count_t count);
+
+protected:
+    virtual char *getPoint(PointId idx);
+    virtual char *columnData(Dimension::Id id);
+
+private:
+    virtual PointId addPoint();
+    virtual void setFieldInternal(Dimension::Id id, PointId idx,
+        const void *value);
+    virtual void getFieldInternal(Dimension::Id id, PointId idx,
+        void *value) const;
+    std::vector<char>& column(Dimension::Id id);
+    void grow(point_count_t capacity);
+
+    // Storage for each dimension, indexed by dimension ID.
+    std::vector<std::vector<char>> m_columns;
+    point_count_t m_numPts;
+    point_count_t m_capacity;
+    PointLayout m_layout;
+};
+
 /// A StreamPointTable must provide storage for point data up to its capacity.
 /// It must implement getPoint() which returns a pointer to a buffer of
 /// sufficient size to contain a point's data.  The minimum size required
@@ -195,6 +303,8 @@ private:
 /// finalize() method.
 class PDAL_DLL StreamPointTable : public SimplePointTable
 {
+    friend class Streamable;
+
 protected:
     StreamPointTable(PointLayout& layout, point_count_t capacity)
         : SimplePointTable(layout)
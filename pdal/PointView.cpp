@@ -38,20 +38,26 @@
 #include <pdal/KDIndex.hpp>
 #include <pdal/PointView.hpp>
 #include <pdal/util/Algorithm.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
 namespace pdal
 {
 
-int PointView::m_lastId = 0;
+std::atomic<int> PointView::m_lastId(0);
 
 PointView::PointView(PointTableRef pointTable) : m_pointTable(pointTable),
-m_size(0), m_id(0)
+m_size(0), m_id(0), m_knnGraphK(0), m_xyChanges(0), m_zChanges(0),
+m_xyNoted(false), m_zNoted(false), m_index2Changes(0), m_index3Changes(0),
+m_knnGraphChanges(0), m_parentChanges(0)
 {
 	m_id = ++m_lastId;
 }
 
 PointView::PointView(PointTableRef pointTable, const SpatialReference& srs) :
-	m_pointTable(pointTable), m_size(0), m_id(0), m_spatialReference(srs)
+	m_pointTable(pointTable), m_size(0), m_id(0), m_spatialReference(srs),
+	m_knnGraphK(0), m_xyChanges(0), m_zChanges(0), m_xyNoted(false),
+	m_zNoted(false), m_index2Changes(0), m_index3Changes(0),
+	m_knnGraphChanges(0), m_parentChanges(0)
 {
 	m_id = ++m_lastId;
 }
@@ -83,6 +89,7 @@ void PointView::setFieldInternal(Dimension::Id dim, PointId idx,
         m_index.push_back(rawId);
         m_size++;
         assert(m_temps.empty());
+        pointsChanged();
     }
     else if (idx > size())
     {
@@ -93,11 +100,20 @@ void PointView::setFieldInternal(Dimension::Id dim, PointId idx,
     else
     {
         rawId = m_index[idx];
+        coordsChanged(dim);
     }
     m_pointTable.setFieldInternal(dim, rawId, buf);
 }
 
 
+// Determine if a range of the view's points is an ordered, unbroken range
+// of the table's points.
+bool PointView::contiguous(PointId begin, point_count_t count) const
+{
+    return m_index.contiguous(begin, count);
+}
+
+
 void PointView::calculateBounds(BOX2D& output) const
 {
     pdal::calculateBounds(*this, output);
@@ -129,6 +145,20 @@ MetadataNode PointView::toMetadata() const
 }
 
 
+void PointView::reorder(const std::vector<PointId>& order)
+{
+    assert(order.size() == size());
+
+    RangeIndex index;
+    for (PointId id : order)
+        index.push_back(m_index[id]);
+    m_index = std::move(index);
+    clearTemps();
+    pointsChanged();
+    invalidateProducts();
+}
+
+
 TriangularMesh *PointView::createMesh(const std::string& name)
 {
     if (Utils::contains(m_meshes, name))
@@ -156,19 +186,81 @@ void PointView::invalidateProducts()
 {
     m_index2.reset();
     m_index3.reset();
+    m_knnGraph.reset();
+    m_knnGraphK = 0;
+    releaseParent();
     // Should all meshes also be invalidated?
 }
 
 
+void PointView::inheritProducts(const PointView& parent)
+{
+    releaseParent();
+    if (&m_pointTable != &parent.m_pointTable || empty())
+        return;
+
+    // Only keep indexes that are up to date with the parent's points.
+    if (parent.m_index2 && parent.m_index2Changes == parent.m_xyChanges)
+        m_parentIndex2 = parent.m_index2;
+    if (parent.m_index3 && parent.m_index3Changes ==
+            parent.m_xyChanges + parent.m_zChanges)
+        m_parentIndex3 = parent.m_index3;
+    if (!m_parentIndex2 && !m_parentIndex3)
+        return;
+
+    // Find our points in the parent.  They must be in the same order.
+    m_parentIds.resize(size());
+    PointId parentId = 0;
+    for (PointId idx = 0; idx < size(); ++idx, ++parentId)
+    {
+        const PointId rawId = m_index[idx];
+        while (parentId < parent.size() && parent.m_index[parentId] != rawId)
+            parentId++;
+        if (parentId == parent.size())
+        {
+            releaseParent();
+            return;
+        }
+        m_parentIds[idx] = parentId;
+    }
+    m_parentChanges = noteChanges();
+}
+
+
+// Return whether indexes can be built from the parent's indexes.  If our
+// points have changed since the parent's indexes were inherited, they're
+// released.
+bool PointView::parentValid()
+{
+    if (m_parentChanges != m_xyChanges + m_zChanges)
+        releaseParent();
+    return !m_parentIds.empty();
+}
+
+
+void PointView::releaseParent()
+{
+    m_parentIndex2.reset();
+    m_parentIndex3.reset();
+    PointIdList().swap(m_parentIds);
+}
+
+
 KD3Index& PointView::build3dIndex()
 {
-    //ABELL
-    // Should we allow a force of point view build - perhaps the index has
-    // changed or the point values have changed.
-    if (!m_index3)
+    const uint64_t changes = noteChanges();
+    if (!m_index3 || m_index3Changes != changes)
     {
-        m_index3.reset(new KD3Index(*this));
-        m_index3->build();
+        std::shared_ptr<KD3Index> index(new KD3Index(*this));
+        if (parentValid() && m_parentIndex3)
+            index->build(*m_parentIndex3, m_parentIds);
+        else
+            index->build();
+        m_index3 = index;
+        m_index3Changes = changes;
+        m_parentIndex3.reset();
+        if (!m_parentIndex2)
+            releaseParent();
     }
     return *m_index3.get();
 }
@@ -176,18 +268,58 @@ KD3Index& PointView::build3dIndex()
 
 KD2Index& PointView::build2dIndex()
 {
-    //ABELL
-    // Should we allow a force of point view build - perhaps the index has
-    // changed or the point values have changed.
-    if (!m_index2)
+    const uint64_t changes = noteXyChanges();
+    if (!m_index2 || m_index2Changes != changes)
     {
-        m_index2.reset(new KD2Index(*this));
-        m_index2->build();
+        std::shared_ptr<KD2Index> index(new KD2Index(*this));
+        if (parentValid() && m_parentIndex2)
+            index->build(*m_parentIndex2, m_parentIds);
+        else
+            index->build();
+        m_index2 = index;
+        m_index2Changes = changes;
+        m_parentIndex2.reset();
+        if (!m_parentIndex3)
+            releaseParent();
     }
     return *m_index2.get();
 }
 
 
+KnnGraph PointView::buildKnnGraph(point_count_t k)
+{
+    const uint64_t changes = noteChanges();
+    if (!m_knnGraph || m_knnGraphK < k || m_knnGraphChanges != changes)
+    {
+        KD3Index& index = build3dIndex();
+        std::shared_ptr<NeighborList> graph(new NeighborList);
+
+        // Every point has the same number of neighbors, so each chunk's
+        // neighbors can be copied straight to their place in the graph.
+        point_count_t n = (std::min)(k, size());
+        graph->offsets.resize(size() + 1);
+        for (PointId i = 0; i <= size(); ++i)
+            graph->offsets[i] = i * n;
+        graph->ids.resize(size() * n);
+        graph->sqrDists.resize(size() * n);
+        parallelFor(0, size(), [&index, &graph, n](PointId begin, PointId end)
+            {
+                NeighborList neighbors;
+                index.batchKnnSearch(begin, end, n, neighbors);
+                std::copy(neighbors.ids.begin(), neighbors.ids.end(),
+                    graph->ids.begin() + begin * n);
+                std::copy(neighbors.sqrDists.begin(),
+                    neighbors.sqrDists.end(),
+                    graph->sqrDists.begin() + begin * n);
+            });
+        m_knnGraph = graph;
+        m_knnGraphK = k;
+        m_knnGraphChanges = changes;
+    }
+    return KnnGraph(m_knnGraph, k);
+}
+
+
 void PointView::dump(std::ostream& ostr) const
 {
     using std::endl;
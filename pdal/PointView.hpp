@@ -41,11 +41,13 @@
 #include <pdal/PointLayout.hpp>
 #include <pdal/PointTable.hpp>
 #include <pdal/PointRef.hpp>
+#include <pdal/RangeIndex.hpp>
 
+#include <atomic>
 #include <memory>
 #include <queue>
 #include <set>
-#include <deque>
+#include <type_traits>
 
 //#pragma warning(disable: 4244)  // conversion from 'type1' to 'type2', possible loss of data
 
@@ -61,12 +63,31 @@ class PointView;
 class PointViewIter;
 class KD2Index;
 class KD3Index;
+class KnnGraph;
+struct NeighborList;
 class BOX2D;
 class BOX3D;
 
 typedef std::shared_ptr<PointView> PointViewPtr;
 typedef std::set<PointViewPtr, PointViewLess> PointViewSet;
 
+// Whether Utils::numericCast() succeeds for every value of T_IN, in which
+// case conversion is a plain cast.
+template<typename T_IN, typename T_OUT>
+struct AlwaysConverts
+{
+    static const bool value = std::is_same<T_IN, T_OUT>::value ||
+        (std::is_floating_point<T_OUT>::value &&
+            !(std::is_same<T_IN, double>::value &&
+                std::is_same<T_OUT, float>::value)) ||
+        (std::is_integral<T_IN>::value && std::is_integral<T_OUT>::value &&
+            sizeof(T_IN) <= 4 &&
+            ((std::is_signed<T_IN>::value == std::is_signed<T_OUT>::value &&
+                sizeof(T_OUT) >= sizeof(T_IN)) ||
+             (std::is_unsigned<T_IN>::value && std::is_signed<T_OUT>::value &&
+                sizeof(T_OUT) > sizeof(T_IN))));
+};
+
 class PDAL_DLL PointView : public PointContainer
 {
     FRIEND_TEST(VoxelTest, center);
@@ -99,13 +120,20 @@ public:
         // We use size() instead of the index end because temp points
         // might have been placed at the end of the buffer.
         // We're essentially ditching temp points.
-        auto thisEnd = m_index.begin() + size();
-        auto bufEnd = buf.m_index.begin() + buf.size();
-        m_index.insert(thisEnd, buf.m_index.begin(), bufEnd);
+        m_index.truncate(size());
+        for (PointId i = 0; i < buf.size(); ++i)
+            m_index.push_back(buf.m_index[i]);
         m_size += buf.size();
         clearTemps();
+        pointsChanged();
     }
 
+    /// Rearrange the points of the view.  Point data isn't moved.  Indexes
+    /// and other products built from the view are discarded.
+    /// \param[in] order  View IDs of the points in their new order.  Each
+    ///   point of the view must appear exactly once.
+    void reorder(const std::vector<PointId>& order);
+
     /// Return a new point view with the same point table as this
     /// point buffer.
     PointViewPtr makeNew() const
@@ -246,11 +274,70 @@ public:
 
     /// Provides access to the memory storing the point data.  Though this
     /// function is public, other access methods are safer and preferred.
+    /// Throws if the table doesn't store packed points (ColumnPointTable).
     char *getPoint(PointId id)
         { return m_pointTable.getPoint(m_index[id]); }
 
+    /// Get the values of a dimension for a range of points, converted to
+    /// type T.  The type conversion is chosen once for the whole range
+    /// rather than for each point.  Values of a dimension that doesn't
+    /// exist are zero.
+    /// \param[in] dim  Dimension to fetch.
+    /// \param[in] begin  ID of the first point.
+    /// \param[in] count  Number of points.
+    /// \param[out] out  Buffer to hold 'count' values.
+    template<typename T>
+    void getFieldRange(Dimension::Id dim, PointId begin, point_count_t count,
+        T *out) const;
+
+    /// Set the values of a dimension for a range of points, converting
+    /// from type T.  Points are added to the view if the range extends
+    /// past the end of the view.
+    /// \param[in] dim  Dimension to set.
+    /// \param[in] begin  ID of the first point.  Must be no greater than
+    ///   the size of the view.
+    /// \param[in] count  Number of points.
+    /// \param[in] in  Buffer holding 'count' values.
+    template<typename T>
+    void setFieldRange(Dimension::Id dim, PointId begin, point_count_t count,
+        const T *in);
+
+    /// Add points to the end of the view.  The points' values are zero.
+    /// \param[in] count  Number of points to add.
+    void addPoints(point_count_t count)
+    {
+        assert(m_temps.empty());
+        for (point_count_t i = 0; i < count; ++i)
+            m_index.push_back(m_pointTable.addPoint());
+        m_size += count;
+        pointsChanged();
+    }
+
+    /// Get a pointer to the values of a dimension for every point in the
+    /// view, stored contiguously in view order.  This is only possible when
+    /// the points are stored in a table that keeps dimensions in columns
+    /// (see ColumnPointTable) and the view refers to an ordered, unbroken
+    /// range of the table's points.  The pointer is invalidated when points
+    /// are added to the table.  Fetching a non-const pointer to X, Y or Z
+    /// values marks the view's indexes as out of date.
+    /// \param[in] dim  Dimension whose values should be accessed.
+    /// \return  Pointer to the value of the first point, or nullptr if the
+    ///   values aren't available contiguously or aren't of type T.
+    template<typename T>
+    T *dimensionData(Dimension::Id dim)
+    {
+        T *data = columnData<T>(dim);
+        if (data)
+            coordsChanged(dim);
+        return data;
+    }
+    template<typename T>
+    const T *dimensionData(Dimension::Id dim) const
+        { return columnData<T>(dim); }
+
     /// Provides access to the memory storing the point data.  Though this
     /// function is public, other access methods are safer and preferred.
+    /// Throws if the table doesn't store packed points (ColumnPointTable).
     char *getOrAddPoint(PointId id)
     {
         if (id == size())
@@ -258,6 +345,7 @@ public:
             m_index.push_back(m_pointTable.addPoint());
             ++m_size;
             assert(m_temps.empty());
+            pointsChanged();
         }
 
         return m_pointTable.getPoint(m_index.at(id));
@@ -273,8 +361,23 @@ public:
     }
     MetadataNode toMetadata() const;
 
+    /// Discard indexes and other products built from the view.  Products
+    /// are rebuilt when they're next requested.  Indexes are also rebuilt
+    /// automatically if X, Y or Z values, or the points of the view, have
+    /// changed since they were built, so calling this is only needed to
+    /// free their memory.
     void invalidateProducts();
 
+    /// Note that the points of this view were selected from another view,
+    /// so that indexes already built for the other view can be used to
+    /// build this view's indexes cheaply.  The points of this view must
+    /// appear in the other view in the same order (as when a filter appends
+    /// the points it keeps from its input).  If they don't, or the other
+    /// view has no index, this does nothing.  The other view's indexes are
+    /// held until this view's indexes are built or its points change.
+    /// \param parent  View from which this view's points were selected.
+    void inheritProducts(const PointView& parent);
+
     /**
       Creates a mesh with the specified name.
 
@@ -295,9 +398,22 @@ public:
     KD3Index& build3dIndex();
     KD2Index& build2dIndex();
 
+    /**
+      Find the k nearest neighbors of every point in the view, or fetch
+      them if a graph for at least k neighbors has already been built.
+      Filters that need the same neighborhoods share the graph rather
+      than each querying the 3D index.  The graph is discarded by
+      invalidateProducts().
+
+      \param k  Number of neighbors of each point, including the point
+        itself.
+      \return  Neighbors of each point.
+    */
+    KnnGraph buildKnnGraph(point_count_t k);
+
 protected:
     PointTableRef m_pointTable;
-    std::deque<PointId> m_index;
+    RangeIndex m_index;
     // The index might be larger than the size to support temporary point
     // references.
     point_count_t m_size;
@@ -305,14 +421,79 @@ protected:
     std::queue<PointId> m_temps;
     SpatialReference m_spatialReference;
     std::map<std::string, std::unique_ptr<TriangularMesh>> m_meshes;
-    std::unique_ptr<KD3Index> m_index3;
-    std::unique_ptr<KD2Index> m_index2;
+    std::shared_ptr<KD3Index> m_index3;
+    std::shared_ptr<KD2Index> m_index2;
+    std::shared_ptr<NeighborList> m_knnGraph;
+    point_count_t m_knnGraphK;
+    // Counts of changes to X/Y values and to Z values.  Changes to the
+    // points of the view count as both.  Products note the counts when
+    // they're built and are rebuilt once the counts differ.  Values may be
+    // set from several threads at once, so the counts are atomic.  Only
+    // whether they've changed matters, so a count is bumped just once
+    // after it has been noted (see countChange()).
+    std::atomic<uint64_t> m_xyChanges;
+    std::atomic<uint64_t> m_zChanges;
+    std::atomic<bool> m_xyNoted;
+    std::atomic<bool> m_zNoted;
+    uint64_t m_index2Changes;
+    uint64_t m_index3Changes;
+    uint64_t m_knnGraphChanges;
+    // Indexes of the view from which this view's points were selected, and
+    // the IDs of this view's points in that view.  See inheritProducts().
+    std::shared_ptr<KD2Index> m_parentIndex2;
+    std::shared_ptr<KD3Index> m_parentIndex3;
+    PointIdList m_parentIds;
+    uint64_t m_parentChanges;
 
 private:
-    static int m_lastId;
+    static std::atomic<int> m_lastId;
 
     template<typename T_IN, typename T_OUT>
     bool convertAndSet(Dimension::Id dim, PointId idx, T_IN in);
+    template<typename T_IN, typename T_OUT>
+    void getFieldRangeAs(Dimension::Id dim, PointId begin,
+        point_count_t count, T_OUT *out) const;
+    template<typename T_IN, typename T_OUT>
+    void setFieldRangeAs(Dimension::Id dim, PointId begin,
+        point_count_t count, const T_IN *in);
+    bool contiguous(PointId begin, point_count_t count) const;
+    template<typename T>
+    T *columnData(Dimension::Id dim) const;
+    bool parentValid();
+    void releaseParent();
+    // The flag is only read by most changes, so threads setting values at
+    // once don't fight over its cache line.
+    static void countChange(std::atomic<uint64_t>& changes,
+        std::atomic<bool>& noted)
+    {
+        if (noted.load(std::memory_order_relaxed))
+        {
+            noted.store(false, std::memory_order_relaxed);
+            changes.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void pointsChanged()
+    {
+        countChange(m_xyChanges, m_xyNoted);
+        countChange(m_zChanges, m_zNoted);
+    }
+    void coordsChanged(Dimension::Id dim)
+    {
+        if (dim == Dimension::Id::X || dim == Dimension::Id::Y)
+            countChange(m_xyChanges, m_xyNoted);
+        else if (dim == Dimension::Id::Z)
+            countChange(m_zChanges, m_zNoted);
+    }
+    uint64_t noteXyChanges()
+    {
+        m_xyNoted.store(true, std::memory_order_relaxed);
+        return m_xyChanges;
+    }
+    uint64_t noteChanges()
+    {
+        m_zNoted.store(true, std::memory_order_relaxed);
+        return noteXyChanges() + m_zChanges;
+    }
 
     virtual void setFieldInternal(Dimension::Id dim, PointId idx,
         const void *buf);
@@ -321,13 +502,13 @@ private:
         { m_pointTable.getFieldInternal(dim, m_index[idx], buf); }
     virtual void swapItems(PointId id1, PointId id2)
     {
-        PointId temp = m_index[id2];
-        m_index[id2] = m_index[id1];
-        m_index[id1] = temp;
+        m_index.swap(id1, id2);
+        pointsChanged();
     }
     virtual void setItem(PointId dst, PointId src)
     {
-        m_index[dst] = m_index[src];
+        m_index.set(dst, m_index[src]);
+        pointsChanged();
     }
 
     template<class T>
@@ -583,6 +764,189 @@ void PointView::setField(Dimension::Id dim, PointId idx, T val)
     }
 }
 
+template<typename T>
+T *PointView::columnData(Dimension::Id dim) const
+{
+    if (layout()->dimType(dim) != Dimension::type<T>())
+        return nullptr;
+    char *data = m_pointTable.columnData(dim);
+    if (!data || !contiguous(0, m_size))
+        return nullptr;
+    T *t = reinterpret_cast<T *>(data);
+    return m_size ? t + m_index[0] : t;
+}
+
+template<typename T>
+void PointView::getFieldRange(Dimension::Id dim, PointId begin,
+    point_count_t count, T *out) const
+{
+    assert(begin + count <= m_size);
+    switch (layout()->dimType(dim))
+    {
+    case Dimension::Type::Float:
+        getFieldRangeAs<float>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Double:
+        getFieldRangeAs<double>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Signed8:
+        getFieldRangeAs<int8_t>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Signed16:
+        getFieldRangeAs<int16_t>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Signed32:
+        getFieldRangeAs<int32_t>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Signed64:
+        getFieldRangeAs<int64_t>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Unsigned8:
+        getFieldRangeAs<uint8_t>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Unsigned16:
+        getFieldRangeAs<uint16_t>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Unsigned32:
+        getFieldRangeAs<uint32_t>(dim, begin, count, out);
+        break;
+    case Dimension::Type::Unsigned64:
+        getFieldRangeAs<uint64_t>(dim, begin, count, out);
+        break;
+    case Dimension::Type::None:
+    default:
+        std::fill(out, out + count, T(0));
+        break;
+    }
+}
+
+
+template<typename T_IN, typename T_OUT>
+void PointView::getFieldRangeAs(Dimension::Id dim, PointId begin,
+    point_count_t count, T_OUT *out) const
+{
+    const T_IN *col =
+        reinterpret_cast<const T_IN *>(m_pointTable.columnData(dim));
+
+    // Values stored contiguously can be converted in a tight loop that
+    // the compiler can vectorize.
+    if (col && AlwaysConverts<T_IN, T_OUT>::value && count &&
+        contiguous(begin, count))
+    {
+        const T_IN *src = col + m_index[begin];
+        for (point_count_t i = 0; i < count; ++i)
+            out[i] = static_cast<T_OUT>(src[i]);
+        return;
+    }
+
+    for (point_count_t i = 0; i < count; ++i)
+    {
+        PointId rawId = m_index[begin + i];
+        T_IN in;
+        if (col)
+            in = col[rawId];
+        else
+            m_pointTable.getFieldInternal(dim, rawId, &in);
+        if (AlwaysConverts<T_IN, T_OUT>::value)
+            out[i] = static_cast<T_OUT>(in);
+        else if (!Utils::numericCast(in, out[i]))
+        {
+            std::ostringstream oss;
+            oss << "Unable to fetch data and convert as requested: ";
+            oss << Dimension::name(dim) << ":" <<
+                Utils::typeidName<T_IN>() << "(" << (double)in << ") -> " <<
+                Utils::typeidName<T_OUT>();
+            throw pdal_error(oss.str());
+        }
+    }
+}
+
+
+template<typename T>
+void PointView::setFieldRange(Dimension::Id dim, PointId begin,
+    point_count_t count, const T *in)
+{
+    assert(begin <= m_size);
+    if (begin + count > m_size)
+        addPoints(begin + count - m_size);
+    coordsChanged(dim);
+
+    switch (layout()->dimType(dim))
+    {
+    case Dimension::Type::Float:
+        setFieldRangeAs<T, float>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Double:
+        setFieldRangeAs<T, double>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Signed8:
+        setFieldRangeAs<T, int8_t>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Signed16:
+        setFieldRangeAs<T, int16_t>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Signed32:
+        setFieldRangeAs<T, int32_t>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Signed64:
+        setFieldRangeAs<T, int64_t>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Unsigned8:
+        setFieldRangeAs<T, uint8_t>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Unsigned16:
+        setFieldRangeAs<T, uint16_t>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Unsigned32:
+        setFieldRangeAs<T, uint32_t>(dim, begin, count, in);
+        break;
+    case Dimension::Type::Unsigned64:
+        setFieldRangeAs<T, uint64_t>(dim, begin, count, in);
+        break;
+    case Dimension::Type::None:
+    default:
+        break;
+    }
+}
+
+
+template<typename T_IN, typename T_OUT>
+void PointView::setFieldRangeAs(Dimension::Id dim, PointId begin,
+    point_count_t count, const T_IN *in)
+{
+    T_OUT *col = reinterpret_cast<T_OUT *>(m_pointTable.columnData(dim));
+
+    if (col && AlwaysConverts<T_IN, T_OUT>::value && count &&
+        contiguous(begin, count))
+    {
+        T_OUT *dst = col + m_index[begin];
+        for (point_count_t i = 0; i < count; ++i)
+            dst[i] = static_cast<T_OUT>(in[i]);
+        return;
+    }
+
+    for (point_count_t i = 0; i < count; ++i)
+    {
+        PointId rawId = m_index[begin + i];
+        T_OUT out;
+        if (AlwaysConverts<T_IN, T_OUT>::value)
+            out = static_cast<T_OUT>(in[i]);
+        else if (!Utils::numericCast(in[i], out))
+        {
+            std::ostringstream oss;
+            oss << "Unable to set data and convert as requested: ";
+            oss << Dimension::name(dim) << ":" <<
+                Utils::typeidName<T_IN>() << "(" << (double)in[i] <<
+                ") -> " << Utils::typeidName<T_OUT>();
+            throw pdal_error(oss.str());
+        }
+        if (col)
+            col[rawId] = out;
+        else
+            m_pointTable.setFieldInternal(dim, rawId, &out);
+    }
+}
+
 inline void PointView::appendPoint(const PointView& buffer, PointId id)
 {
     // Invalid 'id' is a programmer error.
@@ -590,6 +954,7 @@ inline void PointView::appendPoint(const PointView& buffer, PointId id)
     m_index.push_back(rawId);
     m_size++;
     assert(m_temps.empty());
+    pointsChanged();
 }
 
 
@@ -601,7 +966,7 @@ inline PointId PointView::getTemp(PointId id)
     {
         newid = m_temps.front();
         m_temps.pop();
-        m_index[newid] = m_index[id];
+        m_index.set(newid, m_index[id]);
     }
     else
     {
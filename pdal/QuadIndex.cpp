@@ -32,452 +32,46 @@
 * OF SUCH DAMAGE.
 ****************************************************************************/
 
-#include <limits>
+
+#include <algorithm>
 #include <cmath>
-#include <memory>
+#include <limits>
 
 #include <pdal/PointView.hpp>
 #include <pdal/QuadIndex.hpp>
+#include <pdal/private/CurveKey.hpp>
+#include <pdal/private/RadixSort.hpp>
+#include <pdal/util/ThreadPool.hpp>
 #include <pdal/util/Utils.hpp>
 
-namespace
-{
-    using namespace pdal;
-
-    struct BBox
-    {
-        BBox(Point minimum, Point maximum)
-            : minimum(minimum)
-            , maximum(maximum)
-            , center(minimum.x + (maximum.x - minimum.x) / 2,
-                minimum.y + (maximum.y - minimum.y) / 2)
-            , halfWidth(center.x - minimum.x)
-            , halfHeight(center.y - minimum.y)
-        { }
-
-        BBox(const BBox& other)
-            : minimum(other.minimum)
-            , maximum(other.maximum)
-            , center(other.center)
-            , halfWidth(other.halfWidth)
-            , halfHeight(other.halfHeight)
-        { }
-
-        // Returns true if this BBox shares any area in common with another.
-        bool overlaps(const BBox& other) const
-        {
-            return
-                std::abs(center.x - other.center.x) <
-                    halfWidth + other.halfWidth &&
-                std::abs(center.y - other.center.y) <
-                    halfHeight + other.halfHeight;
-        }
-
-        bool overlaps(
-            const double xBegin,
-            const double xEnd,
-            const double yBegin,
-            const double yEnd) const
-        {
-            const BBox other(
-                    Point(xBegin, yBegin),
-                    Point(xEnd, yEnd));
-
-            return overlaps(other);
-        }
-
-        // Returns true if the requested point is contained within this BBox.
-        bool contains(const Point& p) const
-        {
-            return p.x >= minimum.x && p.y >= minimum.y &&
-                p.x < maximum.x && p.y < maximum.y;
-        }
-
-        const Point minimum;
-        const Point maximum;
-
-        // Pre-calculate these properties, rather than exposing functions to
-        // calculate them on-demand, due to the large number of times that
-        // these will be needed when querying the quad tree.
-        const Point center;
-        const double halfWidth;
-        const double halfHeight;
-
-        BBox& operator=(const BBox&); // not implemented
-    };
-
-} // anonymous namespace
-
 namespace pdal
 {
 
-// Recursive quadtree implementation.
-struct Tree
-{
-    Tree(BBox bbox, const QuadPointRef* data = 0)
-        : bbox(bbox)
-        , data(data)
-        , nw()
-        , ne()
-        , se()
-        , sw()
-    { }
-
-    void getFills(std::vector<std::size_t>& fills, std::size_t level = 0) const;
-
-    // Returns depth resulting from the insertion of this point.
-    std::size_t addPoint(const QuadPointRef* toAdd, std::size_t curDepth = 0);
-
-    void getPoints(
-            PointIdList& results,
-            std::size_t depthBegin,
-            std::size_t depthEnd,
-            std::size_t curDepth) const;
-
-    void getPoints(
-            PointIdList& results,
-            std::size_t rasterize,
-            double xBegin,
-            double xEnd,
-            double xStep,
-            double yBegin,
-            double yEnd,
-            double yStep,
-            std::size_t curDepth) const;
-
-    void getPoints(
-            PointIdList& results,
-            double xBegin,
-            double xEnd,
-            double xStep,
-            double yBegin,
-            double yEnd,
-            double yStep) const;
-
-    void getPoints(
-            PointIdList& results,
-            const BBox& query,
-            std::size_t depthBegin,
-            std::size_t depthEnd,
-            std::size_t curDepth) const;
-
-    const BBox bbox;
-    const QuadPointRef* data;
-
-    std::unique_ptr<Tree> nw;
-    std::unique_ptr<Tree> ne;
-    std::unique_ptr<Tree> se;
-    std::unique_ptr<Tree> sw;
-};
-
-std::size_t Tree::addPoint(const QuadPointRef* toAdd, const std::size_t curDepth)
-{
-    if (data)
-    {
-        const Point& center(bbox.center);
-
-        if (toAdd->point.sqDist(center) < data->point.sqDist(center))
-        {
-            std::swap(data, toAdd);
-        }
-
-        const std::size_t nextDepth(curDepth + 1);
-
-        if (toAdd->point.x < center.x)
-        {
-            if (toAdd->point.y < center.y)
-            {
-                if (sw)
-                {
-                    return sw->addPoint(toAdd, nextDepth);
-                }
-                else
-                {
-                    sw.reset(new Tree(
-                            BBox(
-                                Point(bbox.minimum.x, bbox.minimum.y),
-                                Point(center.x, center.y)),
-                            toAdd));
-
-                    return nextDepth;
-                }
-            }
-            else
-            {
-                if (nw)
-                {
-                    return nw->addPoint(toAdd, nextDepth);
-                }
-                else
-                {
-                    nw.reset(new Tree(
-                            BBox(
-                                Point(bbox.minimum.x, center.y),
-                                Point(center.x, bbox.maximum.y)),
-                            toAdd));
-
-                    return nextDepth;
-                }
-            }
-        }
-        else
-        {
-            if (toAdd->point.y < center.y)
-            {
-                if (se)
-                {
-                    return se->addPoint(toAdd, nextDepth);
-                }
-                else
-                {
-                    se.reset(new Tree(
-                            BBox(
-                                Point(center.x, bbox.minimum.y),
-                                Point(bbox.maximum.x, center.y)),
-                            toAdd));
-
-                    return nextDepth;
-                }
-            }
-            else
-            {
-                if (ne)
-                {
-                    return ne->addPoint(toAdd, nextDepth);
-                }
-                else
-                {
-                    ne.reset(new Tree(
-                            BBox(
-                                Point(center.x, center.y),
-                                Point(bbox.maximum.x, bbox.maximum.y)),
-                            toAdd));
-
-                    return nextDepth;
-                }
-            }
-        }
-    }
-    else
-    {
-        data = toAdd;
-        return curDepth;
-    }
-}
-
-// Fills are a count of the number of points at each level of the quad tree.
-void Tree::getFills(std::vector<std::size_t>& fills, std::size_t level) const
-{
-    if (data)
-    {
-        if (level >= fills.size())
-            fills.resize(level + 1);
-        (fills[level])++;
-    }
-
-    ++level;
-    if (nw) nw->getFills(fills, level);
-    if (ne) ne->getFills(fills, level);
-    if (sw) sw->getFills(fills, level);
-    if (se) se->getFills(fills, level);
-}
-
-
-void Tree::getPoints(
-        PointIdList& results,
-        const std::size_t depthBegin,
-        const std::size_t depthEnd,
-        std::size_t curDepth) const
-{
-    if (data && curDepth >= depthBegin)
-    {
-        results.push_back(data->pbIndex);
-    }
-
-    if (++curDepth < depthEnd || depthEnd == 0)
-    {
-        if (nw) nw->getPoints(results, depthBegin, depthEnd, curDepth);
-        if (ne) ne->getPoints(results, depthBegin, depthEnd, curDepth);
-        if (se) se->getPoints(results, depthBegin, depthEnd, curDepth);
-        if (sw) sw->getPoints(results, depthBegin, depthEnd, curDepth);
-    }
-}
-
-void Tree::getPoints(
-        PointIdList& results,
-        const std::size_t rasterize,
-        const double xBegin,
-        const double xEnd,
-        const double xStep,
-        const double yBegin,
-        const double yEnd,
-        const double yStep,
-        std::size_t curDepth) const
+namespace
 {
-    if (curDepth == rasterize)
-    {
-        if (data)
-        {
-            double xOffset(Utils::sround((bbox.center.x - xBegin) / xStep));
-            double yOffset(Utils::sround((bbox.center.y - yBegin) / yStep));
 
-            const std::size_t index(
-                static_cast<size_t>(
-                    Utils::sround(yOffset * (xEnd - xBegin) / xStep +
-                        xOffset)));
+// Levels past this one can't be told apart by the cell codes, so they
+// share the cells of this level.
+const std::size_t MaxLevel = CurveKey::CellBits;
 
-            results.at(index) = data->pbIndex;
-        }
-    }
-    else if (++curDepth <= rasterize)
-    {
-        if (nw) nw->getPoints(
-                results,
-                rasterize,
-                xBegin,
-                xEnd,
-                xStep,
-                yBegin,
-                yEnd,
-                yStep,
-                curDepth);
-
-        if (ne) ne->getPoints(
-                results,
-                rasterize,
-                xBegin,
-                xEnd,
-                xStep,
-                yBegin,
-                yEnd,
-                yStep,
-                curDepth);
-
-        if (se) se->getPoints(
-                results,
-                rasterize,
-                xBegin,
-                xEnd,
-                xStep,
-                yBegin,
-                yEnd,
-                yStep,
-                curDepth);
-
-        if (sw) sw->getPoints(
-                results,
-                rasterize,
-                xBegin,
-                xEnd,
-                xStep,
-                yBegin,
-                yEnd,
-                yStep,
-                curDepth);
-    }
-}
+const point_count_t ChunkSize = 4096;
 
-void Tree::getPoints(
-        PointIdList& results,
-        const double xBegin,
-        const double xEnd,
-        const double xStep,
-        const double yBegin,
-        const double yEnd,
-        const double yStep) const
+// Code of the cell at a level that contains a position with a Morton code
+// at full resolution.
+uint64_t levelCode(uint64_t code, std::size_t level)
 {
-    if (!bbox.overlaps(xBegin, xEnd, yBegin, yEnd))
-    {
-        return;
-    }
-
-    if (nw) nw->getPoints(
-            results,
-            xBegin,
-            xEnd,
-            xStep,
-            yBegin,
-            yEnd,
-            yStep);
-
-    if (ne) ne->getPoints(
-            results,
-            xBegin,
-            xEnd,
-            xStep,
-            yBegin,
-            yEnd,
-            yStep);
-
-    if (se) se->getPoints(
-            results,
-            xBegin,
-            xEnd,
-            xStep,
-            yBegin,
-            yEnd,
-            yStep);
-
-    if (sw) sw->getPoints(
-            results,
-            xBegin,
-            xEnd,
-            xStep,
-            yBegin,
-            yEnd,
-            yStep);
-
-    // Add data after calling child nodes so we prefer upper levels of the tree.
-    if (
-            data &&
-            data->point.x >= xBegin &&
-            data->point.y >= yBegin &&
-            data->point.x < xEnd - xStep &&
-            data->point.y < yEnd - yStep)
-    {
-        double xOffset(Utils::sround((data->point.x - xBegin) / xStep));
-        double yOffset(Utils::sround((data->point.y - yBegin) / yStep));
-
-        std::size_t index(
-            static_cast<size_t>(
-                Utils::sround(yOffset * (xEnd - xBegin) / xStep + xOffset)));
-
-        if (index < results.size())
-        {
-            results.at(index) = data->pbIndex;
-        }
-    }
+    return code >> (2 * (MaxLevel - (std::min)(level, MaxLevel)));
 }
 
-void Tree::getPoints(
-        PointIdList& results,
-        const BBox& query,
-        const std::size_t depthBegin,
-        const std::size_t depthEnd,
-        std::size_t curDepth) const
-{
-    if (!query.overlaps(bbox))
-    {
-        return;
-    }
-
-    if (data &&
-        query.contains(data->point) &&
-        curDepth >= depthBegin &&
-        (curDepth < depthEnd || depthEnd == 0))
-    {
-        results.push_back(data->pbIndex);
-    }
-
-    if (++curDepth < depthEnd || depthEnd == 0)
-    {
-        if (nw) nw->getPoints(results, query, depthBegin, depthEnd, curDepth);
-        if (ne) ne->getPoints(results, query, depthBegin, depthEnd, curDepth);
-        if (se) se->getPoints(results, query, depthBegin, depthEnd, curDepth);
-        if (sw) sw->getPoints(results, query, depthBegin, depthEnd, curDepth);
-    }
-}
+} // unnamed namespace
 
+// The tree is stored flat, a level at a time.  A node at level L is a cell
+// of a grid of 2^L by 2^L cells over the bounds and holds one point: of the
+// points in the cell that aren't held by a shallower node, the one closest
+// to the center of the cell.  These are the nodes that inserting the points
+// in order into a pointer-based quadtree would build.  The nodes of a level
+// are sorted by the Morton codes of their cells, so queries are binary
+// searches and scans of contiguous memory.
 struct QuadIndex::QImpl
 {
     QImpl(const PointView& view, std::size_t topLevel);
@@ -504,7 +98,7 @@ struct QuadIndex::QImpl
 
     std::size_t getDepth() const;
 
-    std::vector<std::size_t> getFills();
+    std::vector<std::size_t> getFills() const;
 
     PointIdList getPoints(
             std::size_t depthBegin,
@@ -535,49 +129,38 @@ struct QuadIndex::QImpl
             std::size_t depthBegin,
             std::size_t depthEnd) const;
 
+    void readPoints(const PointView& view);
+    void build();
+    std::size_t numLevels() const
+        { return m_levels.size() - 1; }
+    void cellCenter(std::size_t level, uint64_t code, double& x,
+        double& y) const;
+    template<typename F>
+    void visit(std::size_t level, double xMin, double yMin, double xMax,
+        double yMax, F f) const;
+
+    BOX2D m_bounds;
     std::size_t m_topLevel;
-    std::vector<std::shared_ptr<QuadPointRef> > m_pointRefVec;
-    std::unique_ptr<Tree> m_tree;
-    std::size_t m_depth;
-    std::vector<std::size_t> m_fills;
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<PointId> m_ids;
+    // Index of the first node of each level, followed by the number of
+    // nodes.
+    std::vector<std::size_t> m_levels;
+    // Code of the cell of each node at the node's level.
+    std::vector<uint64_t> m_codes;
+    // Position in m_x, m_y and m_ids of the point of each node.
+    std::vector<std::size_t> m_points;
 };
 
 QuadIndex::QImpl::QImpl(const PointView& view, std::size_t topLevel)
     : m_topLevel(topLevel)
-    , m_pointRefVec()
-    , m_tree()
-    , m_depth(0)
-    , m_fills()
 {
-    m_pointRefVec.resize(view.size());
+    readPoints(view);
+    for (std::size_t i = 0; i < m_x.size(); ++i)
+        m_bounds.grow(m_x[i], m_y[i]);
 
-    double xMin((std::numeric_limits<double>::max)());
-    double yMin((std::numeric_limits<double>::max)());
-    double xMax((std::numeric_limits<double>::min)());
-    double yMax((std::numeric_limits<double>::min)());
-
-    for (PointId i(0); i < view.size(); ++i)
-    {
-        m_pointRefVec[i].reset(
-                new QuadPointRef(
-                    Point(
-                        view.getFieldAs<double>(Dimension::Id::X, i),
-                        view.getFieldAs<double>(Dimension::Id::Y, i)),
-                i));
-
-        const QuadPointRef* pointRef(m_pointRefVec[i].get());
-        if (pointRef->point.x < xMin) xMin = pointRef->point.x;
-        if (pointRef->point.x > xMax) xMax = pointRef->point.x;
-        if (pointRef->point.y < yMin) yMin = pointRef->point.y;
-        if (pointRef->point.y > yMax) yMax = pointRef->point.y;
-    }
-
-    m_tree.reset(new Tree(BBox(Point(xMin, yMin), Point(xMax, yMax))));
-
-    for (std::size_t i = 0; i < m_pointRefVec.size(); ++i)
-    {
-        m_depth = (std::max)(m_tree->addPoint(m_pointRefVec[i].get()), m_depth);
-    }
+    build();
 }
 
 QuadIndex::QImpl::QImpl(
@@ -587,30 +170,11 @@ QuadIndex::QImpl::QImpl(
         double xMax,
         double yMax,
         std::size_t topLevel)
-    : m_topLevel(topLevel)
-    , m_pointRefVec()
-    , m_tree()
-    , m_depth(0)
-    , m_fills()
+    : m_bounds(xMin, yMin, xMax, yMax)
+    , m_topLevel(topLevel)
 {
-    m_pointRefVec.resize(view.size());
-
-    for (PointId i(0); i < view.size(); ++i)
-    {
-        m_pointRefVec[i].reset(
-                new QuadPointRef(
-                    Point(
-                        view.getFieldAs<double>(Dimension::Id::X, i),
-                        view.getFieldAs<double>(Dimension::Id::Y, i)),
-                i));
-    }
-
-    m_tree.reset(new Tree(BBox(Point(xMin, yMin), Point(xMax, yMax))));
-
-    for (std::size_t i = 0; i < m_pointRefVec.size(); ++i)
-    {
-        m_depth = (std::max)(m_tree->addPoint(m_pointRefVec[i].get()), m_depth);
-    }
+    readPoints(view);
+    build();
 }
 
 QuadIndex::QImpl::QImpl(
@@ -620,49 +184,185 @@ QuadIndex::QImpl::QImpl(
         double xMax,
         double yMax,
         std::size_t topLevel)
-    : m_topLevel(topLevel)
-    , m_pointRefVec(points.size())
-    , m_tree()
-    , m_depth(0)
-    , m_fills()
+    : m_bounds(xMin, yMin, xMax, yMax)
+    , m_topLevel(topLevel)
+{
+    for (const std::shared_ptr<QuadPointRef>& p : points)
+    {
+        m_x.push_back(p->point.x);
+        m_y.push_back(p->point.y);
+        m_ids.push_back(p->pbIndex);
+    }
+    build();
+}
+
+void QuadIndex::QImpl::readPoints(const PointView& view)
+{
+    m_x.resize(view.size());
+    m_y.resize(view.size());
+    m_ids.resize(view.size());
+    parallelFor(0, view.size(), [this, &view](PointId begin, PointId end)
+        {
+            view.getFieldRange(Dimension::Id::X, begin, end - begin,
+                m_x.data() + begin);
+            view.getFieldRange(Dimension::Id::Y, begin, end - begin,
+                m_y.data() + begin);
+            for (PointId i = begin; i < end; ++i)
+                m_ids[i] = i;
+        }, 0, ChunkSize);
+}
+
+void QuadIndex::QImpl::build()
 {
-    m_tree.reset(new Tree(BBox(Point(xMin, yMin), Point(xMax, yMax))));
+    const std::size_t n = m_x.size();
 
-    for (std::size_t i = 0; i < points.size(); ++i)
+    m_levels.assign(1, 0);
+    if (n == 0)
+        return;
+
+    const CurveKey key(m_bounds, CurveKey::Curve::Morton);
+    SortEntries entries(n);
+    parallelFor(0, n, [this, &entries, &key](std::size_t begin,
+        std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                entries[i] = SortEntry(key(m_x[i], m_y[i]), i);
+        }, 0, ChunkSize);
+    radixSort(entries);
+
+    // Ranges of the sorted entries that are in the same cell at the
+    // current level and haven't been placed in a node yet.
+    typedef std::pair<std::size_t, std::size_t> Range;
+    std::vector<Range> ranges { Range(0, n) };
+    std::vector<Range> nextRanges;
+    std::vector<std::size_t> chosen;
+    SortEntries next;
+    for (std::size_t level = 0; ranges.size(); ++level)
     {
-        m_pointRefVec[i] = points[i];
-        m_depth = (std::max)(m_tree->addPoint(m_pointRefVec[i].get()), m_depth);
+        chosen.resize(ranges.size());
+        parallelFor(0, ranges.size(), [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t r = begin; r < end; ++r)
+                {
+                    double cx, cy;
+                    cellCenter(level,
+                        levelCode(entries[ranges[r].first].first, level),
+                        cx, cy);
+
+                    std::size_t best = ranges[r].first;
+                    double bestDist = (std::numeric_limits<double>::max)();
+                    for (std::size_t i = ranges[r].first;
+                        i < ranges[r].second; ++i)
+                    {
+                        const std::size_t p = entries[i].second;
+                        const double dist = (m_x[p] - cx) * (m_x[p] - cx) +
+                            (m_y[p] - cy) * (m_y[p] - cy);
+                        // Ties go to the point that comes first, as if
+                        // the points were inserted in order.
+                        if (dist < bestDist || (dist == bestDist &&
+                                p < entries[best].second))
+                        {
+                            best = i;
+                            bestDist = dist;
+                        }
+                    }
+                    chosen[r] = best;
+                }
+            });
+
+        for (std::size_t r = 0; r < ranges.size(); ++r)
+        {
+            m_codes.push_back(levelCode(entries[chosen[r]].first, level));
+            m_points.push_back(entries[chosen[r]].second);
+        }
+        m_levels.push_back(m_codes.size());
+
+        // Drop the placed points and split the ranges into the cells of
+        // the next level.
+        next.clear();
+        nextRanges.clear();
+        for (std::size_t r = 0; r < ranges.size(); ++r)
+        {
+            // A range never spans the cells of two parents.
+            bool newRange = true;
+            uint64_t lastChild = 0;
+            for (std::size_t i = ranges[r].first; i < ranges[r].second; ++i)
+            {
+                if (i == chosen[r])
+                    continue;
+                const uint64_t child = levelCode(entries[i].first, level + 1);
+                if (newRange || child != lastChild)
+                    nextRanges.push_back(Range(next.size(), next.size()));
+                next.push_back(entries[i]);
+                nextRanges.back().second = next.size();
+                lastChild = child;
+                newRange = false;
+            }
+        }
+        entries.swap(next);
+        ranges.swap(nextRanges);
     }
 }
 
+void QuadIndex::QImpl::cellCenter(std::size_t level, uint64_t code,
+    double& x, double& y) const
+{
+    uint32_t xCell, yCell;
+    CurveKey::decode_morton(code, xCell, yCell);
+
+    const double cells = std::ldexp(1.0, (int)(std::min)(level, MaxLevel));
+    x = m_bounds.minx + (xCell + 0.5) * (m_bounds.maxx - m_bounds.minx) /
+        cells;
+    y = m_bounds.miny + (yCell + 0.5) * (m_bounds.maxy - m_bounds.miny) /
+        cells;
+}
+
+// Call a function with each node at a level whose cell is in the range of
+// Morton codes of the cells that cover a box.  Some of the nodes may lie
+// outside the box.
+template<typename F>
+void QuadIndex::QImpl::visit(std::size_t level, double xMin, double yMin,
+    double xMax, double yMax, F f) const
+{
+    if (level >= numLevels() || xMax < xMin || yMax < yMin)
+        return;
+
+    const CurveKey key(m_bounds, CurveKey::Curve::Morton);
+    const uint64_t lo = levelCode(key(xMin, yMin), level);
+    const uint64_t hi = levelCode(key(xMax, yMax), level);
+
+    auto begin = m_codes.begin() + m_levels[level];
+    auto end = m_codes.begin() + m_levels[level + 1];
+    auto first = std::lower_bound(begin, end, lo);
+    auto last = std::upper_bound(first, end, hi);
+    for (auto it = first; it < last; ++it)
+        f(m_points[it - m_codes.begin()]);
+}
+
 void QuadIndex::QImpl::getBounds(
         double& xMin,
         double& yMin,
         double& xMax,
         double& yMax) const
 {
-    if (m_tree)
-    {
-        xMin = m_tree->bbox.minimum.x;
-        yMin = m_tree->bbox.minimum.y;
-        xMax = m_tree->bbox.maximum.x;
-        yMax = m_tree->bbox.maximum.y;
-    }
+    xMin = m_bounds.minx;
+    yMin = m_bounds.miny;
+    xMax = m_bounds.maxx;
+    yMax = m_bounds.maxy;
 }
 
 std::size_t QuadIndex::QImpl::getDepth() const
 {
-    return m_depth;
+    return numLevels() ? numLevels() - 1 : 0;
 }
 
-std::vector<std::size_t> QuadIndex::QImpl::getFills()
+// Fills are a count of the number of points at each level of the quad tree.
+std::vector<std::size_t> QuadIndex::QImpl::getFills() const
 {
-    if (m_tree && !m_fills.size())
-    {
-        m_tree->getFills(m_fills);
-    }
-
-    return m_fills;
+    std::vector<std::size_t> fills;
+    for (std::size_t level = 0; level < numLevels(); ++level)
+        fills.push_back(m_levels[level + 1] - m_levels[level]);
+    return fills;
 }
 
 PointIdList QuadIndex::QImpl::getPoints(
@@ -671,9 +371,16 @@ PointIdList QuadIndex::QImpl::getPoints(
 {
     PointIdList results;
 
-    if (m_tree)
+    for (std::size_t level = 0; level < numLevels(); ++level)
     {
-        m_tree->getPoints(results, minDepth, maxDepth, m_topLevel);
+        // The top level is always searched.
+        const std::size_t depth = level + m_topLevel;
+        if (level && maxDepth && depth >= maxDepth)
+            break;
+        if (depth < minDepth)
+            continue;
+        for (std::size_t i = m_levels[level]; i < m_levels[level + 1]; ++i)
+            results.push_back(m_ids[m_points[i]]);
     }
 
     return results;
@@ -690,32 +397,44 @@ PointIdList QuadIndex::QImpl::getPoints(
 {
     PointIdList results;
 
-    if (m_tree)
+    if (numLevels())
     {
         const size_t exp(static_cast<size_t>(std::pow(2, rasterize)));
-        const double xWidth(m_tree->bbox.maximum.x - m_tree->bbox.minimum.x);
-        const double yWidth(m_tree->bbox.maximum.y - m_tree->bbox.minimum.y);
+        const double xWidth(m_bounds.maxx - m_bounds.minx);
+        const double yWidth(m_bounds.maxy - m_bounds.miny);
 
         xStep = xWidth / exp;
         yStep = yWidth / exp;
-        xBegin =    m_tree->bbox.minimum.x + (xStep / 2);
-        yBegin =    m_tree->bbox.minimum.y + (yStep / 2);
+        xBegin =    m_bounds.minx + (xStep / 2);
+        yBegin =    m_bounds.miny + (yStep / 2);
         // One tick past the end.
-        xEnd =      m_tree->bbox.maximum.x + (xStep / 2);
-        yEnd =      m_tree->bbox.maximum.y + (yStep / 2);
+        xEnd =      m_bounds.maxx + (xStep / 2);
+        yEnd =      m_bounds.maxy + (yStep / 2);
 
         results.resize(exp * exp, (std::numeric_limits<PointId>::max)());
 
-        m_tree->getPoints(
-                results,
-                rasterize,
-                xBegin,
-                xEnd,
-                xStep,
-                yBegin,
-                yEnd,
-                yStep,
-                m_topLevel);
+        if (rasterize < m_topLevel)
+            return results;
+        const std::size_t level = rasterize - m_topLevel;
+        if (level >= numLevels())
+            return results;
+
+        for (std::size_t i = m_levels[level]; i < m_levels[level + 1]; ++i)
+        {
+            double x, y;
+            cellCenter(level, m_codes[i], x, y);
+
+            double xOffset(Utils::sround((x - xBegin) / xStep));
+            double yOffset(Utils::sround((y - yBegin) / yStep));
+
+            const std::size_t index(
+                static_cast<size_t>(
+                    Utils::sround(yOffset * (xEnd - xBegin) / xStep +
+                        xOffset)));
+
+            if (index < results.size())
+                results[index] = m_ids[m_points[i]];
+        }
     }
 
     return results;
@@ -731,7 +450,7 @@ PointIdList QuadIndex::QImpl::getPoints(
 {
     PointIdList results;
 
-    if (m_tree)
+    if (numLevels())
     {
         size_t width(
             static_cast<size_t>(Utils::sround((xEnd - xBegin) / xStep)));
@@ -739,14 +458,29 @@ PointIdList QuadIndex::QImpl::getPoints(
             static_cast<size_t>(Utils::sround((yEnd - yBegin) / yStep)));
         results.resize(width * height, (std::numeric_limits<PointId>::max)());
 
-        m_tree->getPoints(
-                results,
-                xBegin,
-                xEnd,
-                xStep,
-                yBegin,
-                yEnd,
-                yStep);
+        // Deeper levels are written first so that points of upper levels
+        // of the tree are preferred.
+        const double xLast = xEnd - xStep;
+        const double yLast = yEnd - yStep;
+        for (std::size_t level = numLevels(); level-- > 0;)
+            visit(level, xBegin, yBegin, xLast, yLast,
+                [&](std::size_t p)
+                {
+                    if (m_x[p] < xBegin || m_y[p] < yBegin ||
+                            m_x[p] >= xLast || m_y[p] >= yLast)
+                        return;
+
+                    double xOffset(Utils::sround((m_x[p] - xBegin) / xStep));
+                    double yOffset(Utils::sround((m_y[p] - yBegin) / yStep));
+
+                    std::size_t index(
+                        static_cast<size_t>(
+                            Utils::sround(yOffset * (xEnd - xBegin) / xStep +
+                                xOffset)));
+
+                    if (index < results.size())
+                        results[index] = m_ids[p];
+                });
     }
 
     return results;
@@ -762,17 +496,26 @@ PointIdList QuadIndex::QImpl::getPoints(
 {
     PointIdList results;
 
-    // Making BBox from external parameters here, so do some light validation.
-    if (m_tree)
+    // Making the box from external parameters here, so do some light
+    // validation.
+    const double x0((std::min)(xMin, xMax));
+    const double y0((std::min)(yMin, yMax));
+    const double x1((std::max)(xMin, xMax));
+    const double y1((std::max)(yMin, yMax));
+
+    for (std::size_t level = 0; level < numLevels(); ++level)
     {
-        m_tree->getPoints(
-                results,
-                BBox(
-                    Point((std::min)(xMin, xMax), (std::min)(yMin, yMax)),
-                    Point((std::max)(xMin, xMax), (std::max)(yMin, yMax))),
-                minDepth,
-                maxDepth,
-                m_topLevel);
+        const std::size_t depth = level + m_topLevel;
+        if (maxDepth && depth >= maxDepth)
+            break;
+        if (depth < minDepth)
+            continue;
+        visit(level, x0, y0, x1, y1, [&](std::size_t p)
+            {
+                if (m_x[p] >= x0 && m_y[p] >= y0 &&
+                        m_x[p] < x1 && m_y[p] < y1)
+                    results.push_back(m_ids[p]);
+            });
     }
 
     return results;
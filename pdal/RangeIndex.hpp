@@ -0,0 +1,189 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <pdal/pdal_types.hpp>
+
+namespace pdal
+{
+
+// A list of point IDs with constant-time random access that stores runs of
+// consecutive IDs compactly.  IDs are kept in fixed-size blocks.  A block
+// whose IDs are consecutive is stored as just its first ID.  Only blocks
+// whose IDs aren't consecutive store each ID explicitly, so a view of a
+// contiguous range of a table needs a few bytes per block rather than
+// eight bytes per point.
+class RangeIndex
+{
+    static const size_t BlockShift = 12;
+    static const size_t BlockSize = (size_t)1 << BlockShift;
+    static const size_t BlockMask = BlockSize - 1;
+
+    struct Block
+    {
+        Block(PointId start) : m_start(start)
+        {}
+
+        // First ID of a block of consecutive IDs.
+        PointId m_start;
+        // Explicit IDs, or null if the IDs are consecutive.
+        std::unique_ptr<PointId[]> m_ids;
+    };
+
+public:
+    RangeIndex() : m_size(0)
+    {}
+
+    size_t size() const
+        { return m_size; }
+    bool empty() const
+        { return m_size == 0; }
+
+    PointId operator[](size_t i) const
+    {
+        const Block& b = m_blocks[i >> BlockShift];
+        return b.m_ids ? b.m_ids[i & BlockMask] : b.m_start + (i & BlockMask);
+    }
+
+    PointId at(size_t i) const
+    {
+        if (i >= m_size)
+            throw std::out_of_range("RangeIndex::at");
+        return (*this)[i];
+    }
+
+    void set(size_t i, PointId id)
+    {
+        Block& b = m_blocks[i >> BlockShift];
+        size_t offset = i & BlockMask;
+        if (!b.m_ids)
+        {
+            if (b.m_start + offset == id)
+                return;
+            expand(b, blockCount(i >> BlockShift));
+        }
+        b.m_ids[offset] = id;
+    }
+
+    void swap(size_t i, size_t j)
+    {
+        PointId temp = (*this)[i];
+        set(i, (*this)[j]);
+        set(j, temp);
+    }
+
+    void push_back(PointId id)
+    {
+        size_t offset = m_size & BlockMask;
+        if (offset == 0)
+            m_blocks.emplace_back(id);
+        else
+        {
+            Block& b = m_blocks.back();
+            if (b.m_ids)
+                b.m_ids[offset] = id;
+            else if (b.m_start + offset != id)
+            {
+                expand(b, offset);
+                b.m_ids[offset] = id;
+            }
+        }
+        m_size++;
+    }
+
+    // Remove IDs from the end so that 'count' remain.
+    void truncate(size_t count)
+    {
+        if (count >= m_size)
+            return;
+        m_blocks.erase(m_blocks.begin() + ((count + BlockMask) >> BlockShift),
+            m_blocks.end());
+        m_size = count;
+    }
+
+    // Determine whether the IDs at positions [begin, begin + count) are
+    // consecutive.
+    bool contiguous(size_t begin, size_t count) const
+    {
+        if (count < 2)
+            return true;
+
+        const size_t end = begin + count;
+        PointId expected = (*this)[begin];
+        size_t i = begin;
+        while (i < end)
+        {
+            const Block& b = m_blocks[i >> BlockShift];
+            size_t blockEnd = (std::min)(((i >> BlockShift) + 1) << BlockShift,
+                end);
+            if (b.m_ids)
+            {
+                for (; i < blockEnd; ++i, ++expected)
+                    if (b.m_ids[i & BlockMask] != expected)
+                        return false;
+            }
+            else
+            {
+                if (b.m_start + (i & BlockMask) != expected)
+                    return false;
+                expected += blockEnd - i;
+                i = blockEnd;
+            }
+        }
+        return true;
+    }
+
+private:
+    // Number of IDs in a block.
+    size_t blockCount(size_t blockNum) const
+    {
+        return (std::min)(size_t(BlockSize),
+            m_size - (blockNum << BlockShift));
+    }
+
+    // Store the first 'count' IDs of a block of consecutive IDs explicitly.
+    void expand(Block& b, size_t count)
+    {
+        b.m_ids.reset(new PointId[BlockSize]);
+        for (size_t i = 0; i < count; ++i)
+            b.m_ids[i] = b.m_start + i;
+    }
+
+    std::vector<Block> m_blocks;
+    size_t m_size;
+};
+
+} // namespace pdal
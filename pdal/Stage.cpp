@@ -41,6 +41,7 @@
 #include <pdal/util/ProgramArgs.hpp>
 
 #include "private/StageRunner.hpp"
+#include "private/StageScheduler.hpp"
 
 #include <iterator>
 #include <memory>
@@ -157,9 +158,30 @@ void Stage::prepare(PointTableRef table)
 
 
 PointViewSet Stage::execute(PointTableRef table)
+{
+    return execute(table, 1);
+}
+
+
+PointViewSet Stage::execute(PointTableRef table, std::size_t threads)
 {
     table.finalize();
 
+    if (threads > 1 && !table.supportsConcurrentAdd())
+    {
+        m_log->get(LogLevel::Debug) << "Point table doesn't support "
+            "concurrent point addition.  Not running branches in parallel." <<
+            std::endl;
+        threads = 1;
+    }
+    if (threads > 1)
+    {
+        m_log->get(LogLevel::Debug) << "Executing pipeline in standard mode "
+            "using up to " << threads << " threads." << std::endl;
+        StageScheduler scheduler(table, threads);
+        return scheduler.execute(*this);
+    }
+
     // We store stage instances instead of stages because a stage may get
     // executed more than once.  A stage instance is created for each
     // execution of a stage in a pipeline.  This properly builds out
@@ -225,7 +247,8 @@ PointViewSet Stage::execute(PointTableRef table)
     return outViews;
 }
 
-PointViewSet Stage::execute(PointTableRef table, PointViewSet& views)
+PointViewSet Stage::execute(PointTableRef table, PointViewSet& views,
+    std::unique_lock<std::mutex> *tableLock)
 {
 
     PointViewSet outViews;
@@ -240,11 +263,15 @@ PointViewSet Stage::execute(PointTableRef table, PointViewSet& views)
     //   completed?  Wondering if that would break something where a
     //   writer wants to check a table's SRS.
     SpatialReference srs;
-    table.clearSpatialReferences();
-    // Iterating backwards will ensure that the SRS for the first view is
-    // first on the list for table.
-    for (auto it = views.rbegin(); it != views.rend(); it++)
-        table.addSpatialReference((*it)->spatialReference());
+    auto setTableSrs = [&table, &views]()
+    {
+        table.clearSpatialReferences();
+        // Iterating backwards will ensure that the SRS for the first view
+        // is first on the list for table.
+        for (auto it = views.rbegin(); it != views.rend(); it++)
+            table.addSpatialReference((*it)->spatialReference());
+    };
+    setTableSrs();
 
     // Count the number of views and the number of points and faces so they're
     // available to stages.
@@ -261,12 +288,23 @@ PointViewSet Stage::execute(PointTableRef table, PointViewSet& views)
     // through the stage.
     ready(table);
     prerun(views);
+
+    // Let stages in other branches use the table while this one works.
+    if (tableLock)
+        tableLock->unlock();
     for (auto const& it : views)
     {
         StageRunnerPtr runner(new StageRunner(this, it));
         runners.push_back(runner);
         runner->run();
     }
+    // Stages in other branches may have replaced the table's spatial
+    // references while it was unlocked.
+    if (tableLock)
+    {
+        tableLock->lock();
+        setTableSrs();
+    }
 
     // As the stages complete (synchronously at this time), propagate the
     // spatial reference and merge the output views.
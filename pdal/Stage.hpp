@@ -35,6 +35,7 @@
 #pragma once
 
 #include <list>
+#include <mutex>
 
 #include <pdal/Dimension.hpp>
 #include <pdal/DimType.hpp>
@@ -55,6 +56,7 @@ namespace pdal
 
 class ProgramArgs;
 class StageRunner;
+class StageScheduler;
 class StageWrapper;
 class Streamable;
 
@@ -72,6 +74,7 @@ class PDAL_DLL Stage
     FRIEND_TEST(OptionsTest, conditional);
     friend class StageWrapper;
     friend class StageRunner;
+    friend class StageScheduler;
     friend class Streamable;
 public:
     Stage();
@@ -120,12 +123,33 @@ public:
     */
     PointViewSet execute(PointTableRef table);
 
+    /**
+      Execute a prepared pipeline (linked set of stages), running
+      independent branches of the pipeline in parallel.
+
+      Branches that feed a stage with multiple inputs (for example, several
+      readers feeding filters.merge) are executed concurrently using up
+      to \ref threads threads.  Each stage is still run to completion before
+      stages that depend on it are run.  Parallel execution requires
+      a point table that supports concurrent addition of points.  If the
+      table doesn't, or \ref threads is less than two, the pipeline is
+      executed serially.
+
+      \param table  Point table being used for stage pipeline.  This must be
+        the same \ref table used in the \ref prepare function.
+      \param threads  Maximum number of threads to use.
+    */
+    PointViewSet execute(PointTableRef table, std::size_t threads);
+
     virtual void execute(StreamPointTable& table)
     {
         throw pdal_error("Attempting to use stream mode with a non-streamable "
             "stage.");
     }
 
+    virtual void execute(StreamPointTable& table, std::size_t /*threads*/)
+        { execute(table); }
+
     /**
       Determine if a pipeline with this stage as a sink is streamable.
 
@@ -435,9 +459,12 @@ private:
 
       \param table  PointTable
       \param pvSet  Input PointViewSet
+      \param tableLock  When branches are executed in parallel, lock
+        protecting the table.  It is released while point views are run.
       \return  Output PointViewSet
     */
-    PointViewSet execute(PointTableRef table, PointViewSet& pvSet);
+    PointViewSet execute(PointTableRef table, PointViewSet& pvSet,
+        std::unique_lock<std::mutex> *tableLock = nullptr);
 
     /**
       Functions called after dimensions have been added.  Implement in
@@ -49,6 +49,9 @@ class StreamableWrapper : public StageWrapper
 public:
     static bool processOne(Streamable& s, PointRef& point)
         { return s.processOne(point); }
+    static point_count_t processBatch(Streamable& s, StreamPointTable& table,
+            PointId begin, PointId end)
+        { return s.processBatch(table, begin, end); }
     static void spatialReferenceChanged(Streamable& s,
             const SpatialReference& srs)
         { s.spatialReferenceChanged(srs); }
@@ -32,7 +32,11 @@
 * OF SUCH DAMAGE.
 ****************************************************************************/
 
+#include <condition_variable>
+#include <exception>
 #include <iterator>
+#include <mutex>
+#include <thread>
 
 #include <pdal/Streamable.hpp>
 #include <pdal/Reader.hpp>
@@ -40,6 +44,32 @@
 namespace pdal
 {
 
+namespace
+{
+
+// Storage for a batch of points in flight during pipelined stream
+// execution.  All buffers share the layout of the table passed to execute().
+class BufferPointTable : public StreamPointTable
+{
+public:
+    BufferPointTable(PointLayout& layout, point_count_t capacity) :
+        StreamPointTable(layout, capacity),
+        m_buf(pointsToBytes(capacity + 1))
+    {}
+
+protected:
+    virtual void reset()
+        { std::fill(m_buf.begin(), m_buf.end(), 0); }
+
+    virtual char *getPoint(PointId idx)
+        { return m_buf.data() + pointsToBytes(idx); }
+
+private:
+    std::vector<char> m_buf;
+};
+
+} // unnamed namespace
+
 Streamable::Streamable()
 {}
 
@@ -69,9 +99,18 @@ const Stage *Streamable::findNonstreamable() const
 
 // Streamed execution.
 void Streamable::execute(StreamPointTable& table)
+{
+    execute(table, 1);
+}
+
+
+void Streamable::execute(StreamPointTable& table, std::size_t threads)
 {
     m_log->get(LogLevel::Debug) << "Executing pipeline in stream mode." <<
         std::endl;
+    if (threads > 1)
+        m_log->get(LogLevel::Debug) << "Pipelining stages with up to " <<
+            threads << " threads." << std::endl;
     struct StreamableList : public std::list<Streamable *>
     {
         StreamableList operator - (const StreamableList& other) const
@@ -146,12 +185,17 @@ void Streamable::execute(StreamPointTable& table)
     {
         if (s->m_inputs.empty())
         {
-            // Call done on all the stages we ran last time and aren't
-            // using this time.
-            (lastRunStages - stages).done(table);
+            // Flush and call done on all the stages we ran last time and
+            // aren't using this time.
+            StreamableList finished = lastRunStages - stages;
+            flush(table, lastRunStages, finished.size(), srsMap);
+            finished.done(table);
             // Call ready on all the stages we didn't run last time.
             (stages - lastRunStages).ready(table);
-            execute(table, stages, srsMap);
+            if (threads > 1 && stages.size() > 1)
+                executePipelined(table, stages, srsMap, threads);
+            else
+                execute(table, stages, srsMap);
             lastRunStages = stages;
         }
         else
@@ -165,6 +209,7 @@ void Streamable::execute(StreamPointTable& table)
         }
         if (lists.empty())
         {
+            flush(table, lastRunStages, lastRunStages.size(), srsMap);
             lastRunStages.done(table);
             break;
         }
@@ -203,23 +248,22 @@ void Streamable::execute(StreamPointTable& table,
     {
         // Clear the spatial reference when processing starts.
         table.clearSpatialReferences();
-        PointId idx = 0;
-        PointRef point(table, idx);
         point_count_t pointLimit = (std::min)(count, table.capacity());
 
         reader->startLogging();
-        // When we get false back from a reader, we're done, so set
-        // the point limit to the number of points processed in this loop
-        // of the table.
+        // When a reader returns fewer points than requested, we're done,
+        // so set the point limit to the number of points processed in
+        // this loop of the table.
         if (!pointLimit)
             finished = true;
-
-        for (PointId idx = 0; idx < pointLimit; idx++)
+        else
         {
-            point.setPointId(idx);
-            finished = !reader->processOne(point);
-            if (finished)
-                pointLimit = idx;
+            point_count_t numRead = reader->processBatch(table, 0, pointLimit);
+            if (numRead < pointLimit)
+            {
+                finished = true;
+                pointLimit = numRead;
+            }
         }
         count -= pointLimit;
 
@@ -240,14 +284,7 @@ void Streamable::execute(StreamPointTable& table,
                 srsMap[s] = srs;
             }
             s->startLogging();
-            for (PointId idx = 0; idx < pointLimit; idx++)
-            {
-                if (table.skip(idx))
-                    continue;
-                point.setPointId(idx);
-                if (!s->processOne(point))
-                    table.setSkip(idx);
-            }
+            s->processBatch(table, 0, pointLimit);
             const SpatialReference& tempSrs = s->getSpatialReference();
             if (!tempSrs.empty())
             {
@@ -261,5 +298,291 @@ void Streamable::execute(StreamPointTable& table,
     }
 }
 
+
+// Execute a list of stages with the stages split into groups that each run
+// on their own thread.  Batches of points are passed from group to group
+// through a ring of buffers, one more than the number of groups, so that the
+// reader can fill a buffer while the downstream stages work on earlier
+// ones.  Each group processes the batches in the order they were read, so
+// the output is the same as that of serial execution.  Points are read into
+// buffers sharing the layout and capacity of 'table'.  The last group copies
+// each batch into 'table' and runs its stages there, so a caller that
+// consumes points through its own table sees them as in serial execution.
+void Streamable::executePipelined(StreamPointTable& table,
+    std::list<Streamable *>& stages, SrsMap& srsMap, std::size_t threads)
+{
+    struct Buffer
+    {
+        std::unique_ptr<StreamPointTable> table;
+        SpatialReference srs;
+        point_count_t count;
+        bool last;
+        PointId batch;  // Number of the batch the buffer holds or awaits.
+        size_t group;   // Index of the group that may use the buffer next.
+    };
+
+    std::vector<Streamable *> list(stages.begin(), stages.end());
+    const size_t numGroups = (std::min)(threads, list.size());
+    const size_t numBuffers = numGroups + 1;
+
+    std::vector<Buffer> buffers(numBuffers);
+    for (size_t i = 0; i < numBuffers; ++i)
+    {
+        Buffer& b = buffers[i];
+        b.table.reset(new BufferPointTable(*table.layout(), table.capacity()));
+        b.count = 0;
+        b.last = false;
+        b.batch = i;
+        b.group = 0;
+    }
+
+    // We may be limited in the number of points requested.
+    point_count_t count = (std::numeric_limits<point_count_t>::max)();
+    if (Reader *r = dynamic_cast<Reader *>(list.front()))
+        count = r->count();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool aborted = false;
+    std::exception_ptr error;
+
+    // Spatial reference state is kept per group so that the map isn't
+    // modified by several threads at once.
+    std::vector<SrsMap> groupSrs(numGroups);
+    for (size_t g = 0; g < numGroups; ++g)
+        for (size_t i = g * list.size() / numGroups;
+                i < (g + 1) * list.size() / numGroups; ++i)
+        {
+            auto si = srsMap.find(list[i]);
+            if (si != srsMap.end())
+                groupSrs[g].insert(*si);
+        }
+
+    auto readBatch = [&](Buffer& b)
+    {
+        StreamPointTable& t = *b.table;
+        Streamable *reader = list.front();
+
+        t.clearSpatialReferences();
+        point_count_t pointLimit = (std::min)(count, t.capacity());
+
+        reader->startLogging();
+        bool finished = false;
+        if (!pointLimit)
+            finished = true;
+        else
+        {
+            point_count_t numRead = reader->processBatch(t, 0, pointLimit);
+            if (numRead < pointLimit)
+            {
+                finished = true;
+                pointLimit = numRead;
+            }
+        }
+        count -= pointLimit;
+        reader->stopLogging();
+
+        b.srs = reader->getSpatialReference();
+        if (!b.srs.empty())
+            t.setSpatialReference(b.srs);
+        b.count = pointLimit;
+        b.last = finished;
+    };
+
+    auto filterBatch = [&](Buffer& b, StreamPointTable& t, Streamable *s,
+        SrsMap& localSrs)
+    {
+        auto si = localSrs.find(s);
+        if (si == localSrs.end() || si->second != b.srs)
+        {
+            s->spatialReferenceChanged(b.srs);
+            localSrs[s] = b.srs;
+        }
+        s->startLogging();
+        s->processBatch(t, 0, b.count);
+        const SpatialReference& tempSrs = s->getSpatialReference();
+        if (!tempSrs.empty())
+        {
+            b.srs = tempSrs;
+            t.setSpatialReference(b.srs);
+        }
+        s->stopLogging();
+    };
+
+    auto runGroup = [&](size_t g)
+    {
+        const size_t first = g * list.size() / numGroups;
+        const size_t last = (g + 1) * list.size() / numGroups;
+        const bool lastGroup = (g + 1 == numGroups);
+
+        try
+        {
+            for (PointId batch = 0; ; ++batch)
+            {
+                Buffer& b = buffers[batch % numBuffers];
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&]()
+                    {
+                        return aborted ||
+                            (b.batch == batch && b.group == g);
+                    });
+                    if (aborted)
+                        return;
+                }
+
+                // The last group works on the caller's table, which
+                // reflects the spatial reference of the current batch.
+                StreamPointTable& t = lastGroup ? table : *b.table;
+                if (lastGroup)
+                {
+                    const size_t pointSize = table.layout()->pointSize();
+                    for (PointId idx = 0; idx < b.count; ++idx)
+                    {
+                        const char *src = b.table->getPoint(idx);
+                        std::copy(src, src + pointSize, table.getPoint(idx));
+                        if (b.table->skip(idx))
+                            table.setSkip(idx);
+                    }
+                    table.clearSpatialReferences();
+                    if (!b.srs.empty())
+                        table.setSpatialReference(b.srs);
+                }
+
+                for (size_t i = first; i < last; ++i)
+                {
+                    if (i == 0)
+                        readBatch(b);
+                    else
+                        filterBatch(b, t, list[i], groupSrs[g]);
+                }
+
+                const bool done = b.last;
+                if (lastGroup)
+                {
+                    table.clear(b.count);
+                    b.table->clear(b.count);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (lastGroup)
+                    {
+                        b.group = 0;
+                        b.batch += numBuffers;
+                    }
+                    else
+                        b.group = g + 1;
+                }
+                cv.notify_all();
+                if (done)
+                    break;
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+                error = std::current_exception();
+            aborted = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t g = 1; g < numGroups; ++g)
+        workers.push_back(std::thread(runGroup, g));
+    runGroup(0);
+    for (std::thread& t : workers)
+        t.join();
+
+    for (SrsMap& m : groupSrs)
+        for (auto& entry : m)
+            srsMap[entry.first] = entry.second;
+    if (error)
+        std::rethrow_exception(error);
+}
+
+
+// Pass the points held back by the first 'count' stages of a list, which
+// have seen all of their input, through the stages that follow them.
+// Stages are flushed in order so that points flushed by one stage can be
+// held back by a later one.
+void Streamable::flush(StreamPointTable& table,
+    std::list<Streamable *>& stages, std::size_t count, SrsMap& srsMap)
+{
+    auto si = stages.begin();
+    for (std::size_t i = 0; i < count; ++i, ++si)
+    {
+        Streamable *s = *si;
+        while (true)
+        {
+            table.clearSpatialReferences();
+            s->startLogging();
+            point_count_t numFlushed = s->flushBatch(table, 0,
+                table.capacity());
+            s->stopLogging();
+            if (!numFlushed)
+                break;
+
+            SpatialReference srs = s->getSpatialReference();
+            auto mi = srsMap.find(s);
+            if (srs.empty() && mi != srsMap.end())
+                srs = mi->second;
+            if (!srs.empty())
+                table.setSpatialReference(srs);
+
+            for (auto fi = std::next(si); fi != stages.end(); ++fi)
+            {
+                Streamable *f = *fi;
+                mi = srsMap.find(f);
+                if (mi == srsMap.end() || mi->second != srs)
+                {
+                    f->spatialReferenceChanged(srs);
+                    srsMap[f] = srs;
+                }
+                f->startLogging();
+                f->processBatch(table, 0, numFlushed);
+                const SpatialReference& tempSrs = f->getSpatialReference();
+                if (!tempSrs.empty())
+                {
+                    srs = tempSrs;
+                    table.setSpatialReference(srs);
+                }
+                f->stopLogging();
+            }
+            table.clear(numFlushed);
+        }
+    }
+}
+
+
+point_count_t Streamable::processBatch(StreamPointTable& table,
+    PointId begin, PointId end)
+{
+    PointRef point(table, begin);
+
+    // Readers have no inputs and stop at the first point they can't read.
+    if (m_inputs.empty())
+    {
+        for (PointId idx = begin; idx < end; idx++)
+        {
+            point.setPointId(idx);
+            if (!processOne(point))
+                return idx - begin;
+        }
+        return end - begin;
+    }
+
+    for (PointId idx = begin; idx < end; idx++)
+    {
+        if (table.skip(idx))
+            continue;
+        point.setPointId(idx);
+        if (!processOne(point))
+            table.setSkip(idx);
+    }
+    return end - begin;
+}
+
 } // namespace pdal
 
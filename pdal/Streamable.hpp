@@ -52,7 +52,7 @@ public:
       Execute a prepared pipeline (linked set of stages) in streaming mode.
 
       This performs the action associated with the stage by executing the
-      \ref processOne function of each stage in depth first order.  Points
+      \ref processBatch function of each stage in depth first order.  Points
       are processed up to the capacity of the provided StreamPointTable.
       Not all stages support streaming mode and an exception will be thrown
       when attempting to \ref execute an unsupported stage.
@@ -65,6 +65,24 @@ public:
 
     */
     virtual void execute(StreamPointTable& table);
+
+    /**
+      Execute a prepared pipeline in streaming mode, pipelining the stages.
+
+      The stages of each path from a reader to the end of the pipeline
+      are split into up to \ref threads groups that run on their own
+      threads.  While the reader fills one buffer of points, downstream
+      stages process previously read buffers.  Buffers are processed in
+      the order they were read, so results are the same as those of
+      serial execution.  Memory use is bounded by one buffer the size of
+      \ref table for each group plus one.  The storage of \ref table isn't
+      used for points when \ref threads is greater than one.
+
+      \param table  Streaming point table used for stage pipeline.  This
+        must be the same \ref table used in the \ref prepare function.
+      \param threads  Maximum number of threads to use.
+    */
+    virtual void execute(StreamPointTable& table, std::size_t threads);
     using Stage::execute;
 
     /**
@@ -82,6 +100,10 @@ protected:
 
     void execute(StreamPointTable& table, std::list<Streamable *>& stages,
         SrsMap& srsMap);
+    void executePipelined(StreamPointTable& table,
+        std::list<Streamable *>& stages, SrsMap& srsMap, std::size_t threads);
+    void flush(StreamPointTable& table, std::list<Streamable *>& stages,
+        std::size_t count, SrsMap& srsMap);
 
     /**
       Process a single point (streaming mode).  Implement in subclass.
@@ -92,6 +114,26 @@ protected:
         to subsequent stages).
     */
     virtual bool processOne(PointRef& /*point*/) = 0;
+
+    /**
+      Process a contiguous batch of points in a stream table (streaming
+      mode).  The default implementation calls \ref processOne for each
+      point.  Stages override this to amortize per-point overhead (virtual
+      dispatch, dimension lookup, I/O calls) across a whole batch.
+
+      Filters and writers must ignore points for which table.skip() is
+      true and should call table.setSkip() for points that are to be
+      filtered out.
+
+      \param table  Streaming point table holding the points.
+      \param begin  ID of the first point in the batch.
+      \param end  ID one past the last point in the batch.
+      \return  Readers return the number of points read, which is less
+        than the size of the batch when there are no more points to be
+        read.  The return value of filters and writers is ignored.
+    */
+    virtual point_count_t processBatch(StreamPointTable& table,
+        PointId begin, PointId end);
     /**
     {
         throwStreamingError();
@@ -99,6 +141,22 @@ protected:
     }
     **/
 
+    /**
+      Fill a batch of a stream table with points that the stage held back
+      while processing its input (streaming mode).  This is called
+      repeatedly once all input has been passed to the stage, until it
+      returns zero.  The points are passed to the stages that follow.
+      The default implementation holds back no points.
+
+      \param table  Streaming point table to fill.
+      \param begin  ID of the first point in the batch.
+      \param end  ID one past the last point in the batch.
+      \return  Number of points placed in the table, starting at 'begin'.
+    */
+    virtual point_count_t flushBatch(StreamPointTable& /*table*/,
+        PointId /*begin*/, PointId /*end*/)
+        { return 0; }
+
     /**
       Notification that the points that will follow in processing are from
       a spatial reference different than the previous spatial reference.
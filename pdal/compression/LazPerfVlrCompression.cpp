@@ -54,6 +54,16 @@
 #pragma pop_macro("max")
 #pragma pop_macro("min")
 
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <pdal/util/IStream.hpp>
+
 #include "LazPerfVlrCompression.hpp"
 
 namespace pdal
@@ -76,32 +86,58 @@ class LazPerfVlrCompressorImpl
     typedef laszip::formats::dynamic_compressor Compressor;
     typedef laszip::factory::record_schema Schema;
 
+    // A chunk of points handed to a worker thread and the resulting
+    // compressed bytes.
+    struct Chunk
+    {
+        Chunk() : ready(false)
+        {}
+
+        std::vector<char> points;
+        std::string data;
+        bool ready;
+        std::exception_ptr error;
+    };
+
 public:
     LazPerfVlrCompressorImpl(std::ostream& stream, const Schema& schema,
-            uint32_t chunksize) :
+            uint32_t chunksize, size_t threads) :
         m_stream(stream), m_outputStream(stream), m_schema(schema),
         m_chunksize(chunksize), m_chunkPointsWritten(0), m_chunkInfoPos(0),
-        m_chunkOffset(0)
-    {}
+        m_chunkOffset(0), m_started(false), m_threads(threads),
+        m_pointSize((size_t)schema.size_in_bytes()), m_nextChunk(0),
+        m_stop(false)
+    {
+        // Variable-sized chunks can't be split on a point count.
+        if (m_chunksize == (std::numeric_limits<uint32_t>::max)())
+            m_threads = 1;
+    }
 
     ~LazPerfVlrCompressorImpl()
     {
-        if (m_encoder)
+        if (m_encoder || m_workers.size())
             std::cerr << "LazPerfVlrCompressor destroyed without a call "
                "to done()";
+        stopWorkers();
     }
 
 
     void compress(const char *inbuf)
     {
+        if (m_threads > 1)
+        {
+            if (!m_started)
+                start();
+            m_points.insert(m_points.end(), inbuf, inbuf + m_pointSize);
+            if (m_points.size() == m_chunksize * m_pointSize)
+                submit();
+            return;
+        }
+
         // First time through.
         if (!m_encoder || !m_compressor)
         {
-            // Get the position
-            m_chunkInfoPos = m_stream.tellp();
-            // Seek over the chunk info offset value
-            m_stream.seekp(sizeof(uint64_t), std::ios::cur);
-            m_chunkOffset = m_stream.tellp();
+            start();
             resetCompressor();
         }
         else if (m_chunkPointsWritten == m_chunksize)
@@ -115,11 +151,30 @@ public:
 
     void done()
     {
-        // Close and clear the point encoder.
-        m_encoder->done();
-        m_encoder.reset();
+        if (m_threads > 1)
+        {
+            if (!m_started)
+                start();
+            if (m_points.size())
+                submit();
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_chunks.size())
+            {
+                writeReady(lock);
+                if (m_chunks.size())
+                    m_readyCv.wait(lock);
+            }
+            lock.unlock();
+            stopWorkers();
+        }
+        else
+        {
+            // Close and clear the point encoder.
+            m_encoder->done();
+            m_encoder.reset();
 
-        newChunk();
+            newChunk();
+        }
 
         // Save our current position.  Go to the location where we need
         // to write the chunk table offset at the beginning of the point data.
@@ -152,6 +207,23 @@ public:
     }
 
 private:
+    void start()
+    {
+        // Get the position
+        m_chunkInfoPos = m_stream.tellp();
+        // Seek over the chunk info offset value
+        m_stream.seekp(sizeof(uint64_t), std::ios::cur);
+        m_chunkOffset = m_stream.tellp();
+        m_started = true;
+
+        if (m_threads > 1)
+        {
+            m_points.reserve(m_chunksize * m_pointSize);
+            for (size_t i = 0; i < m_threads; ++i)
+                m_workers.push_back(std::thread([this](){ work(); }));
+        }
+    }
+
     void resetCompressor()
     {
         if (m_encoder)
@@ -168,6 +240,112 @@ private:
         m_chunkPointsWritten = 0;
     }
 
+    // Hand the buffered points to the workers as the next chunk.  At most
+    // two chunks per thread are held in memory, so wait for the oldest to
+    // be written if necessary.
+    void submit()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            writeReady(lock);
+            if (m_chunks.size() < 2 * m_threads)
+                break;
+            m_readyCv.wait(lock);
+        }
+        Chunk& chunk = m_chunks[m_nextChunk];
+        chunk.points.swap(m_points);
+        m_pending.push_back(m_nextChunk++);
+        lock.unlock();
+        m_workCv.notify_one();
+
+        m_points.clear();
+        m_points.reserve(m_chunksize * m_pointSize);
+    }
+
+    // Write compressed chunks to the output stream in order, as long as the
+    // next chunk is available.  Called with the lock held.
+    void writeReady(std::unique_lock<std::mutex>& lock)
+    {
+        while (m_chunks.size() && m_chunks.begin()->second.ready)
+        {
+            auto it = m_chunks.begin();
+            Chunk chunk(std::move(it->second));
+            m_chunks.erase(it);
+            lock.unlock();
+
+            if (chunk.error)
+            {
+                stopWorkers();
+                std::rethrow_exception(chunk.error);
+            }
+            m_stream.write(chunk.data.data(), chunk.data.size());
+            m_chunkTable.push_back((uint32_t)chunk.data.size());
+            lock.lock();
+        }
+    }
+
+    void work()
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workCv.wait(lock, [this](){ return m_stop || m_pending.size(); });
+            if (m_pending.empty())
+                return;
+            Chunk& chunk = m_chunks[m_pending.front()];
+            m_pending.pop_front();
+            lock.unlock();
+
+            std::string data;
+            std::exception_ptr error;
+            try
+            {
+                data = compressChunk(chunk.points);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            chunk.data.swap(data);
+            chunk.error = error;
+            chunk.ready = true;
+            std::vector<char>().swap(chunk.points);
+            lock.unlock();
+            m_readyCv.notify_all();
+        }
+    }
+
+    // Compress a chunk of points with a fresh encoder, exactly as the
+    // serial path does when it starts a new chunk.
+    std::string compressChunk(const std::vector<char>& points)
+    {
+        std::ostringstream out;
+        OutputStream outputStream(out);
+        Encoder encoder(outputStream);
+        Compressor::ptr compressor =
+            laszip::factory::build_compressor(encoder, m_schema);
+        for (size_t pos = 0; pos < points.size(); pos += m_pointSize)
+            compressor->compress(points.data() + pos);
+        encoder.done();
+        return out.str();
+    }
+
+    void stopWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_pending.clear();
+        }
+        m_workCv.notify_all();
+        for (std::thread& t : m_workers)
+            t.join();
+        m_workers.clear();
+    }
+
     std::ostream& m_stream;
     OutputStream m_outputStream;
     std::unique_ptr<Encoder> m_encoder;
@@ -178,12 +356,26 @@ private:
     std::streampos m_chunkInfoPos;
     std::streampos m_chunkOffset;
     std::vector<uint32_t> m_chunkTable;
+    bool m_started;
+
+    // Parallel compression.
+    size_t m_threads;
+    size_t m_pointSize;
+    std::vector<char> m_points;
+    std::map<size_t, Chunk> m_chunks;
+    std::deque<size_t> m_pending;
+    size_t m_nextChunk;
+    bool m_stop;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workCv;
+    std::condition_variable m_readyCv;
 };
 
 
 LazPerfVlrCompressor::LazPerfVlrCompressor(std::ostream& stream,
-        const Schema& schema, uint32_t chunksize) :
-    m_impl(new LazPerfVlrCompressorImpl(stream, schema, chunksize))
+        const Schema& schema, uint32_t chunksize, size_t threads) :
+    m_impl(new LazPerfVlrCompressorImpl(stream, schema, chunksize, threads))
 {}
 
 
@@ -208,8 +400,8 @@ class LazPerfVlrDecompressorImpl
 public:
     LazPerfVlrDecompressorImpl(std::istream& stream, const char *vlrData,
         std::streamoff pointOffset) :
-        m_stream(stream), m_inputStream(stream), m_chunksize(0),
-        m_chunkPointsRead(0)
+        m_stream(stream), m_inputStream(new InputStream(stream)),
+        m_chunksize(0), m_chunkPointsRead(0), m_pointOffset(pointOffset)
     {
         laszip::io::laz_vlr zipvlr(vlrData);
         m_chunksize = zipvlr.chunk_size;
@@ -220,6 +412,9 @@ public:
     size_t pointSize() const
         { return (size_t)m_schema.size_in_bytes(); }
 
+    uint32_t chunkSize() const
+        { return m_chunksize; }
+
     void decompress(char *outbuf)
     {
         if (m_chunkPointsRead == m_chunksize || !m_decoder || !m_decompressor)
@@ -231,10 +426,81 @@ public:
         m_chunkPointsRead++;
     }
 
+    // The chunk table offset is stored at the start of the point data.
+    // Writers that stream their output store -1 there and put the offset
+    // in the last eight bytes of the file instead.  The table consists of
+    // a version, a chunk count and the compressed byte size of each chunk.
+    // See LazPerfVlrCompressorImpl::done().  An empty list is returned if
+    // the table can't be read.
+    std::vector<std::streamoff> chunkOffsets()
+    {
+        std::vector<std::streamoff> offsets;
+
+        m_stream.clear();
+        m_stream.seekg(m_pointOffset);
+        ILeStream in(&m_stream);
+        int64_t tablePos;
+        in >> tablePos;
+        if (m_stream && tablePos == -1)
+        {
+            m_stream.seekg(-(std::streamoff)sizeof(int64_t), std::ios::end);
+            in >> tablePos;
+        }
+
+        const std::streamoff start = m_pointOffset + sizeof(int64_t);
+        uint32_t version;
+        uint32_t numChunks;
+        if (m_stream && tablePos > start)
+        {
+            m_stream.seekg(tablePos);
+            in >> version >> numChunks;
+        }
+        if (!m_stream || tablePos <= start)
+        {
+            seekChunk(start);
+            return offsets;
+        }
+
+        InputStream inputStream(m_stream);
+        Decoder decoder(inputStream);
+        decoder.readInitBytes();
+        laszip::decompressors::integer decompressor(32, 2);
+        decompressor.init();
+
+        // Every chunk lies between the start of the point data and the
+        // table, which bounds a corrupt chunk count.
+        std::streamoff offset = start;
+        int32_t predictor = 0;
+        for (uint32_t i = 0; i < numChunks; ++i)
+        {
+            offsets.push_back(offset);
+            predictor = decompressor.decompress(decoder, predictor, 1);
+            offset += (uint32_t)predictor;
+            if (predictor <= 0 || offset > tablePos)
+            {
+                offsets.clear();
+                break;
+            }
+        }
+        seekChunk(start);
+        return offsets;
+    }
+
+    void seekChunk(std::streamoff offset)
+    {
+        m_decompressor.reset();
+        m_decoder.reset();
+        m_stream.clear();
+        m_stream.seekg(offset);
+        // The input stream wrapper may buffer data, so replace it.
+        m_inputStream.reset(new InputStream(m_stream));
+        m_chunkPointsRead = 0;
+    }
+
 private:
     void resetDecompressor()
     {
-        m_decoder.reset(new Decoder(m_inputStream));
+        m_decoder.reset(new Decoder(*m_inputStream));
         m_decompressor =
             laszip::factory::build_decompressor(*m_decoder, m_schema);
     }
@@ -245,12 +511,13 @@ private:
     typedef laszip::factory::record_schema Schema;
 
     std::istream& m_stream;
-    InputStream m_inputStream;
+    std::unique_ptr<InputStream> m_inputStream;
     std::unique_ptr<Decoder> m_decoder;
     Decompressor::ptr m_decompressor;
     Schema m_schema;
     uint32_t m_chunksize;
     uint32_t m_chunkPointsRead;
+    std::streamoff m_pointOffset;
 };
 
 LazPerfVlrDecompressor::LazPerfVlrDecompressor(std::istream& stream,
@@ -274,5 +541,202 @@ void LazPerfVlrDecompressor::decompress(char *outbuf)
     m_impl->decompress(outbuf);
 }
 
+
+uint32_t LazPerfVlrDecompressor::chunkSize() const
+{
+    return m_impl->chunkSize();
+}
+
+
+std::vector<std::streamoff> LazPerfVlrDecompressor::chunkOffsets()
+{
+    return m_impl->chunkOffsets();
+}
+
+
+void LazPerfVlrDecompressor::seekChunk(std::streamoff offset)
+{
+    m_impl->seekChunk(offset);
+}
+
+
+class LazPerfVlrReadAheadImpl
+{
+public:
+    LazPerfVlrReadAheadImpl(LazPerfVlrReadAhead::StreamFactory factory,
+            const char *vlrData, std::streamoff pointOffset,
+            point_count_t numPoints, size_t threads) :
+        m_factory(factory), m_vlrData(vlrData), m_pointOffset(pointOffset),
+        m_numPoints(numPoints), m_pos(0), m_next(0), m_consumed(0),
+        m_stop(false)
+    {
+        m_stream = m_factory();
+        m_serial.reset(new LazPerfVlrDecompressor(*m_stream, vlrData,
+            pointOffset));
+        m_pointSize = m_serial->pointSize();
+        m_chunkSize = m_serial->chunkSize();
+        m_offsets = m_serial->chunkOffsets();
+
+        threads = (std::max)(threads, (size_t)1);
+        m_maxAhead = 2 * threads;
+        m_numChunks = (size_t)((m_numPoints + m_chunkSize - 1) / m_chunkSize);
+
+        // Without a usable chunk table, decompress serially.
+        if (m_offsets.size() < m_numChunks)
+            return;
+        m_serial.reset();
+        m_stream.reset();
+        for (size_t i = 0; i < threads; ++i)
+            m_threads.emplace_back([this](){ work(); });
+    }
+
+    ~LazPerfVlrReadAheadImpl()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+        lock.unlock();
+        m_claimCv.notify_all();
+        for (std::thread& t : m_threads)
+            t.join();
+    }
+
+    size_t pointSize() const
+        { return m_pointSize; }
+
+    void decompress(char *outbuf)
+    {
+        if (m_serial)
+        {
+            m_serial->decompress(outbuf);
+            return;
+        }
+        if (m_pos == m_current.size())
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_consumed >= m_numChunks)
+                throw pdal_error("Attempt to read past the end of "
+                    "compressed point data.");
+            m_readyCv.wait(lock, [this]()
+                { return m_chunks.count(m_consumed); });
+            Chunk chunk = std::move(m_chunks[m_consumed]);
+            m_chunks.erase(m_consumed++);
+            lock.unlock();
+            m_claimCv.notify_all();
+
+            if (chunk.m_error)
+                std::rethrow_exception(chunk.m_error);
+            m_current = std::move(chunk.m_buf);
+            m_pos = 0;
+        }
+        std::copy(m_current.data() + m_pos,
+            m_current.data() + m_pos + m_pointSize, outbuf);
+        m_pos += m_pointSize;
+    }
+
+private:
+    struct Chunk
+    {
+        std::vector<char> m_buf;
+        std::exception_ptr m_error;
+    };
+
+    void work()
+    {
+        std::shared_ptr<std::istream> stream;
+        std::unique_ptr<LazPerfVlrDecompressor> decompressor;
+
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_claimCv.wait(lock, [this]()
+            {
+                return m_stop || m_next >= m_numChunks ||
+                    m_next < m_consumed + m_maxAhead;
+            });
+            if (m_stop || m_next >= m_numChunks)
+                return;
+            size_t chunkNum = m_next++;
+            lock.unlock();
+
+            Chunk chunk;
+            try
+            {
+                if (!decompressor)
+                {
+                    stream = m_factory();
+                    decompressor.reset(new LazPerfVlrDecompressor(*stream,
+                        m_vlrData, m_pointOffset));
+                }
+                point_count_t first = (point_count_t)chunkNum * m_chunkSize;
+                point_count_t count = (std::min)((point_count_t)m_chunkSize,
+                    m_numPoints - first);
+                chunk.m_buf.resize(count * m_pointSize);
+                decompressor->seekChunk(m_offsets[chunkNum]);
+                for (char *pos = chunk.m_buf.data();
+                        pos < chunk.m_buf.data() + chunk.m_buf.size();
+                        pos += m_pointSize)
+                    decompressor->decompress(pos);
+            }
+            catch (...)
+            {
+                chunk.m_error = std::current_exception();
+            }
+
+            lock.lock();
+            m_chunks[chunkNum] = std::move(chunk);
+            lock.unlock();
+            m_readyCv.notify_all();
+        }
+    }
+
+    LazPerfVlrReadAhead::StreamFactory m_factory;
+    const char *m_vlrData;
+    std::streamoff m_pointOffset;
+    point_count_t m_numPoints;
+    size_t m_pointSize;
+    uint32_t m_chunkSize;
+    std::vector<std::streamoff> m_offsets;
+    size_t m_numChunks;
+    size_t m_maxAhead;
+    std::shared_ptr<std::istream> m_stream;
+    std::unique_ptr<LazPerfVlrDecompressor> m_serial;
+
+    std::vector<char> m_current;
+    size_t m_pos;
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_claimCv;
+    std::condition_variable m_readyCv;
+    std::map<size_t, Chunk> m_chunks;
+    size_t m_next;
+    size_t m_consumed;
+    bool m_stop;
+};
+
+
+LazPerfVlrReadAhead::LazPerfVlrReadAhead(StreamFactory factory,
+        const char *vlrData, std::streamoff pointOffset,
+        point_count_t numPoints, size_t threads) :
+    m_impl(new LazPerfVlrReadAheadImpl(factory, vlrData, pointOffset,
+        numPoints, threads))
+{}
+
+
+LazPerfVlrReadAhead::~LazPerfVlrReadAhead()
+{}
+
+
+size_t LazPerfVlrReadAhead::pointSize() const
+{
+    return m_impl->pointSize();
+}
+
+
+void LazPerfVlrReadAhead::decompress(char *outbuf)
+{
+    m_impl->decompress(outbuf);
+}
+
 } // namespace pdal
 
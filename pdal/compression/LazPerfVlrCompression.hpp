@@ -33,7 +33,12 @@
 ****************************************************************************/
 #pragma once
 
+#include <functional>
+#include <istream>
 #include <memory>
+#include <vector>
+
+#include <pdal/pdal_types.hpp>
 #include <pdal/util/OStream.hpp>
 
 namespace laszip
@@ -58,13 +63,17 @@ namespace pdal
 // The compressor uses the schema of the point data in order to compress
 // the point stream.  The schema is also stored in a VLR that isn't
 // handled as part of the compression process itself.
+// When more than one thread is requested, points are buffered a chunk at
+// a time and chunks are compressed on worker threads.  Compressed chunks
+// are written in order, so the output is identical to that of a single
+// thread.
 class LazPerfVlrCompressor
 {
     typedef laszip::factory::record_schema Schema;
 
 public:
     PDAL_DLL LazPerfVlrCompressor(std::ostream& stream, const Schema& schema,
-        uint32_t chunksize);
+        uint32_t chunksize, size_t threads = 1);
     PDAL_DLL ~LazPerfVlrCompressor();
 
     PDAL_DLL void compress(const char *inbuf);
@@ -87,9 +96,47 @@ public:
     PDAL_DLL size_t pointSize() const;
     PDAL_DLL void decompress(char *outbuf);
 
+    // Number of points in each chunk, or 0xFFFFFFFF if chunks are of
+    // variable size.
+    PDAL_DLL uint32_t chunkSize() const;
+
+    // Read the chunk table and return the stream offset of the start of
+    // each chunk, or an empty list if the table is missing or corrupt.
+    // Decompression restarts at the first point.
+    PDAL_DLL std::vector<std::streamoff> chunkOffsets();
+
+    // Position the decompressor at the start of the chunk beginning at
+    // 'offset'.
+    PDAL_DLL void seekChunk(std::streamoff offset);
+
 private:
     std::unique_ptr<LazPerfVlrDecompressorImpl> m_impl;
 };
 
+
+class LazPerfVlrReadAheadImpl;
+
+// Since chunks are compressed independently, they can be decompressed
+// independently.  This decompressor hands out points in file order, like
+// LazPerfVlrDecompressor, but decompresses chunks on several threads, each
+// with its own stream, ahead of their consumption.  A bounded number of
+// decompressed chunks are held at once.
+class LazPerfVlrReadAhead
+{
+public:
+    typedef std::function<std::shared_ptr<std::istream>()> StreamFactory;
+
+    PDAL_DLL LazPerfVlrReadAhead(StreamFactory factory, const char *vlrData,
+        std::streamoff pointOffset, point_count_t numPoints,
+        size_t threads);
+    PDAL_DLL ~LazPerfVlrReadAhead();
+
+    PDAL_DLL size_t pointSize() const;
+    PDAL_DLL void decompress(char *outbuf);
+
+private:
+    std::unique_ptr<LazPerfVlrReadAheadImpl> m_impl;
+};
+
 } // namespace pdal
 
@@ -0,0 +1,170 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include <pdal/util/Bounds.hpp>
+
+namespace pdal
+{
+
+// Computes the position of points along a space-filling curve through a
+// grid of 2^CellBits by 2^CellBits cells that covers a bounding box.
+// Positions outside of the box are placed in the cells at its edges.
+class CurveKey
+{
+public:
+    // Number of bits of a cell position along each axis.
+    static const int CellBits = 31;
+
+    enum class Curve
+    {
+        Morton,
+        Hilbert
+    };
+
+    CurveKey(const BOX2D& bounds, Curve curve) : m_bounds(bounds),
+        m_curve(curve), m_cells((double)(1u << CellBits))
+    {
+        m_xscale = (bounds.maxx > bounds.minx) ?
+            m_cells / (bounds.maxx - bounds.minx) : 0;
+        m_yscale = (bounds.maxy > bounds.miny) ?
+            m_cells / (bounds.maxy - bounds.miny) : 0;
+    }
+
+    uint64_t operator()(double x, double y) const
+    {
+        uint32_t xcell = cell((x - m_bounds.minx) * m_xscale);
+        uint32_t ycell = cell((y - m_bounds.miny) * m_yscale);
+        return (m_curve == Curve::Hilbert) ?
+            encode_hilbert(xcell, ycell) : encode_morton(xcell, ycell);
+    }
+
+    // Interleave the bits of the cell positions.  X takes the more
+    // significant bit of each pair.
+    static uint64_t encode_morton(uint32_t x, uint32_t y)
+    {
+        return (part1_by1(x) << 1) | part1_by1(y);
+    }
+
+    // Split a Morton code into the positions of its cell.
+    static void decode_morton(uint64_t code, uint32_t& x, uint32_t& y)
+    {
+        x = (uint32_t)compact1_by1(code >> 1);
+        y = (uint32_t)compact1_by1(code);
+    }
+
+    // Position of the cell along the Hilbert curve.
+    static uint64_t encode_hilbert(uint32_t x, uint32_t y)
+    {
+        const uint32_t n = 1u << CellBits;
+
+        uint64_t d = 0;
+        for (uint32_t s = n / 2; s > 0; s /= 2)
+        {
+            uint32_t rx = (x & s) ? 1 : 0;
+            uint32_t ry = (y & s) ? 1 : 0;
+            d += (uint64_t)s * s * ((3 * rx) ^ ry);
+
+            // Rotate the quadrant so that the curve in it has the
+            // standard orientation.
+            if (ry == 0)
+            {
+                if (rx == 1)
+                {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+private:
+    BOX2D m_bounds;
+    Curve m_curve;
+    double m_cells;
+    double m_xscale;
+    double m_yscale;
+
+    uint32_t cell(double pos) const
+    {
+        if (pos <= 0)
+            return 0;
+        return (uint32_t)(std::min)(pos, m_cells - 1);
+    }
+
+public:
+    // Spread the low 32 bits of a value so that there is a zero bit
+    // between each.  Used for 2D Morton codes.
+    static uint64_t part1_by1(uint64_t x)
+    {
+        x &= 0xFFFFFFFF;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFF;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FF;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0F;
+        x = (x | (x << 2)) & 0x3333333333333333;
+        x = (x | (x << 1)) & 0x5555555555555555;
+        return x;
+    }
+
+    // Spread the low 21 bits of a value so that there are two zero bits
+    // between each.  Used for 3D Morton codes.
+    static uint64_t part1_by2(uint64_t x)
+    {
+        x &= 0x1FFFFF;
+        x = (x | (x << 32)) & 0x1F00000000FFFF;
+        x = (x | (x << 16)) & 0x1F0000FF0000FF;
+        x = (x | (x << 8)) & 0x100F00F00F00F00F;
+        x = (x | (x << 4)) & 0x10C30C30C30C30C3;
+        x = (x | (x << 2)) & 0x1249249249249249;
+        return x;
+    }
+
+private:
+
+    static uint64_t compact1_by1(uint64_t x)
+    {
+        x &= 0x5555555555555555;
+        x = (x | (x >> 1)) & 0x3333333333333333;
+        x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0F;
+        x = (x | (x >> 4)) & 0x00FF00FF00FF00FF;
+        x = (x | (x >> 8)) & 0x0000FFFF0000FFFF;
+        x = (x | (x >> 16)) & 0x00000000FFFFFFFF;
+        return x;
+    }
+};
+
+} // namespace pdal
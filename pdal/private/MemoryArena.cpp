@@ -0,0 +1,110 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include "MemoryArena.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace pdal
+{
+
+MemoryArena::MemoryArena(std::size_t size, bool hugePages) :
+    m_base(nullptr), m_size(size), m_used(0), m_mapped(false)
+{
+    if (!size)
+        return;
+
+#ifdef _WIN32
+    (void)hugePages;
+    void *addr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT,
+        PAGE_READWRITE);
+    if (addr)
+    {
+        m_base = (char *)addr;
+        m_mapped = true;
+    }
+#else
+    // Address space is reserved without committing swap.  Pages are
+    // backed as they're first written.
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    void *addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (addr != MAP_FAILED)
+    {
+        m_base = (char *)addr;
+        m_mapped = true;
+#ifdef MADV_HUGEPAGE
+        if (hugePages)
+            ::madvise(addr, size, MADV_HUGEPAGE);
+#else
+        (void)hugePages;
+#endif
+    }
+#endif
+
+    // If the OS won't map memory, fall back to the heap.
+    if (!m_base)
+        m_base = new char[size]();
+}
+
+
+MemoryArena::~MemoryArena()
+{
+    if (!m_base)
+        return;
+    if (m_mapped)
+    {
+#ifdef _WIN32
+        VirtualFree(m_base, 0, MEM_RELEASE);
+#else
+        ::munmap(m_base, m_size);
+#endif
+    }
+    else
+        delete [] m_base;
+}
+
+
+char *MemoryArena::allocate(std::size_t size)
+{
+    if (size > available())
+        return nullptr;
+    char *p = m_base + m_used;
+    m_used += size;
+    return p;
+}
+
+} // namespace pdal
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+namespace pdal
+{
+
+/**
+  A region of memory obtained from the operating system from which
+  blocks are handed out sequentially.  The memory is zeroed by the OS and
+  isn't touched by the arena, so with a first-touch placement policy each
+  page lands on the NUMA node of the thread that first writes it.
+  Transparent huge pages can be requested for the region where the OS
+  supports them.  Memory is released when the arena is destroyed.
+*/
+class MemoryArena
+{
+public:
+    MemoryArena(std::size_t size, bool hugePages);
+    ~MemoryArena();
+
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    /**
+      Allocate zeroed memory from the arena.
+
+      \param size  Number of bytes to allocate.
+      \return  Pointer to the memory or nullptr if the arena doesn't have
+        \ref size bytes available.
+    */
+    char *allocate(std::size_t size);
+
+    /**
+      \return  Number of bytes that can still be allocated.
+    */
+    std::size_t available() const
+        { return m_size - m_used; }
+
+private:
+    char *m_base;
+    std::size_t m_size;
+    std::size_t m_used;
+    bool m_mapped;
+};
+
+} // namespace pdal
@@ -0,0 +1,112 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include "RadixSort.hpp"
+
+#include <algorithm>
+
+#include <pdal/util/ThreadPool.hpp>
+
+namespace pdal
+{
+
+void radixSort(SortEntries& entries)
+{
+    const size_t Buckets = 256;
+    const size_t MinChunkSize = 65536;
+
+    const size_t count = entries.size();
+    if (count < 2)
+        return;
+
+    // Use a few chunks per thread so that threads stay busy, but keep
+    // chunks large enough that counting isn't dominated by overhead.
+    size_t chunkSize = (std::max)(MinChunkSize,
+        count / (ThreadPool::threadLimit() * 4) + 1);
+    size_t numChunks = (count + chunkSize - 1) / chunkSize;
+
+    // Find the bits that differ between keys.
+    uint64_t diff = 0;
+    const uint64_t first = entries.front().first;
+    for (const SortEntry& e : entries)
+        diff |= e.first ^ first;
+
+    SortEntries temp(count);
+    SortEntries *src = &entries;
+    SortEntries *dst = &temp;
+    std::vector<size_t> offsets(numChunks * Buckets);
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        if (((diff >> shift) & 0xFF) == 0)
+            continue;
+
+        parallelFor(0, numChunks, [&](size_t begin, size_t end)
+            {
+                for (size_t c = begin; c < end; ++c)
+                {
+                    size_t *counts = offsets.data() + c * Buckets;
+                    std::fill(counts, counts + Buckets, 0);
+                    size_t last = (std::min)(count, (c + 1) * chunkSize);
+                    for (size_t i = c * chunkSize; i < last; ++i)
+                        counts[((*src)[i].first >> shift) & 0xFF]++;
+                }
+            }, 0, 1);
+
+        // Entries go to the buckets in order and, within a bucket, in the
+        // order of the chunks, which keeps the sort stable.
+        size_t offset = 0;
+        for (size_t b = 0; b < Buckets; ++b)
+            for (size_t c = 0; c < numChunks; ++c)
+            {
+                size_t n = offsets[c * Buckets + b];
+                offsets[c * Buckets + b] = offset;
+                offset += n;
+            }
+
+        parallelFor(0, numChunks, [&](size_t begin, size_t end)
+            {
+                for (size_t c = begin; c < end; ++c)
+                {
+                    size_t *pos = offsets.data() + c * Buckets;
+                    size_t last = (std::min)(count, (c + 1) * chunkSize);
+                    for (size_t i = c * chunkSize; i < last; ++i)
+                    {
+                        const SortEntry& e = (*src)[i];
+                        (*dst)[pos[(e.first >> shift) & 0xFF]++] = e;
+                    }
+                }
+            }, 0, 1);
+        std::swap(src, dst);
+    }
+    if (src != &entries)
+        entries.swap(temp);
+}
+
+} // namespace pdal
@@ -102,11 +102,25 @@ bool SrsTransform::transform(double& x, double& y, double& z)
 bool SrsTransform::transform(std::vector<double>& x, std::vector<double>& y,
     std::vector<double>& z)
 {
-    if (x.size() != y.size() && y.size() != z.size())
-        throw pdal_error("SrsTransform::called with vectors of different "
-            "sizes.");
+    if (x.size() != y.size() || y.size() != z.size())
+        throw pdal_error("SrsTransform::transform() called with vectors "
+            "of different sizes.");
     int err = m_transform->Transform(x.size(), x.data(), y.data(), z.data());
     return (err == OGRERR_NONE);
 }
 
+
+bool SrsTransform::transform(std::vector<double>& x, std::vector<double>& y,
+    std::vector<double>& z, std::vector<int>& ok)
+{
+    if (x.size() != y.size() || y.size() != z.size())
+        throw pdal_error("SrsTransform::transform() called with vectors "
+            "of different sizes.");
+    ok.assign(x.size(), 0);
+    if (!m_transform || x.empty())
+        return false;
+    return m_transform->Transform((int)x.size(), x.data(), y.data(),
+        z.data(), ok.data());
+}
+
 } // namespace pdal
@@ -69,6 +69,17 @@ public:
     bool transform(std::vector<double>& x, std::vector<double>& y,
         std::vector<double>& z);
 
+    /// Transform a set of points in place, noting the success of the
+    /// transformation of each point.
+    /// \param x  X coordinates
+    /// \param y  Y coordinates
+    /// \param z  Z coordinates
+    /// \param ok  Set to a nonzero value for each point that was
+    ///     successfully transformed.
+    /// \return  True if any point was successfully transformed.
+    bool transform(std::vector<double>& x, std::vector<double>& y,
+        std::vector<double>& z, std::vector<int>& ok);
+
 private:
     std::unique_ptr<OGRCoordinateTransformation> m_transform;
 };
@@ -0,0 +1,177 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <exception>
+#include <stack>
+#include <system_error>
+#include <thread>
+
+#include "StageScheduler.hpp"
+
+namespace pdal
+{
+
+StageScheduler::StageScheduler(PointTableRef table, std::size_t threads) :
+    m_table(table), m_availThreads((int)threads - 1)
+{}
+
+
+StageScheduler::~StageScheduler()
+{}
+
+
+PointViewSet StageScheduler::execute(Stage& stage)
+{
+    Instance root(&stage);
+    build(root);
+
+    // Create the initial views for stages without inputs in the order that
+    // serial execution would have so that view IDs, and hence the order
+    // in which views are merged, don't depend on thread timing.
+    std::vector<Instance *> order;
+    std::stack<Instance *> pending;
+    pending.push(&root);
+    while (pending.size())
+    {
+        Instance *inst = pending.top();
+        pending.pop();
+        order.push_back(inst);
+        for (auto& in : inst->m_inputs)
+            pending.push(in.get());
+    }
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+        if ((*it)->m_inputs.empty())
+            (*it)->m_initialView.reset(new PointView(m_table));
+
+    return run(root);
+}
+
+
+void StageScheduler::build(Instance& inst)
+{
+    std::unique_ptr<std::mutex>& mutex = m_stageMutexes[inst.m_stage];
+    if (!mutex)
+        mutex.reset(new std::mutex);
+
+    for (Stage *s : inst.m_stage->getInputs())
+    {
+        std::unique_ptr<Instance> in(new Instance(s));
+        build(*in);
+        inst.m_inputs.push_back(std::move(in));
+    }
+}
+
+
+bool StageScheduler::acquireThread()
+{
+    int avail = m_availThreads;
+    while (avail > 0)
+        if (m_availThreads.compare_exchange_weak(avail, avail - 1))
+            return true;
+    return false;
+}
+
+
+void StageScheduler::releaseThread()
+{
+    m_availThreads++;
+}
+
+
+PointViewSet StageScheduler::run(Instance& inst)
+{
+    PointViewSet inViews;
+
+    const std::size_t numInputs = inst.m_inputs.size();
+    if (numInputs)
+    {
+        std::vector<PointViewSet> results(numInputs);
+        std::vector<std::exception_ptr> errors(numInputs);
+        std::atomic<std::size_t> next(0);
+
+        // Each participating thread claims the next unexecuted input
+        // branch until all have been claimed.
+        auto work = [&]()
+        {
+            std::size_t i;
+            while ((i = next++) < numInputs)
+            {
+                try
+                {
+                    results[i] = run(*inst.m_inputs[i]);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < numInputs && acquireThread(); ++i)
+        {
+            try
+            {
+                threads.emplace_back([&]()
+                {
+                    work();
+                    releaseThread();
+                });
+            }
+            catch (const std::system_error&)
+            {
+                releaseThread();
+                break;
+            }
+        }
+        work();
+        for (std::thread& t : threads)
+            t.join();
+
+        for (std::exception_ptr& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+        for (PointViewSet& s : results)
+            inViews.insert(s.begin(), s.end());
+    }
+
+    if (inViews.empty())
+    {
+        if (!inst.m_initialView)
+            inst.m_initialView.reset(new PointView(m_table));
+        inViews.insert(inst.m_initialView);
+    }
+
+    std::lock_guard<std::mutex> stageLock(*m_stageMutexes.at(inst.m_stage));
+    std::unique_lock<std::mutex> tableLock(m_tableMutex);
+    return inst.m_stage->execute(m_table, inViews, &tableLock);
+}
+
+} // namespace pdal
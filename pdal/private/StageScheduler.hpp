@@ -0,0 +1,83 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <pdal/Stage.hpp>
+
+namespace pdal
+{
+
+/**
+  Executes a prepared pipeline in standard mode, running independent
+  branches (the inputs of a stage such as filters.merge) concurrently.
+
+  As in the serial case, a stage instance is created for each execution of
+  a stage so that diamond-shaped pipelines are built out.  Executions of
+  the same stage are still serialized, as is the bookkeeping done on the
+  point table before and after a stage runs.  At most 'threads' threads are
+  used to run branches.
+*/
+class StageScheduler
+{
+public:
+    StageScheduler(PointTableRef table, std::size_t threads);
+    ~StageScheduler();
+
+    PointViewSet execute(Stage& stage);
+
+private:
+    struct Instance
+    {
+        Instance(Stage *stage) : m_stage(stage)
+        {}
+
+        Stage *m_stage;
+        std::vector<std::unique_ptr<Instance>> m_inputs;
+        PointViewPtr m_initialView;
+    };
+
+    void build(Instance& inst);
+    PointViewSet run(Instance& inst);
+    bool acquireThread();
+    void releaseThread();
+
+    PointTableRef m_table;
+    std::mutex m_tableMutex;
+    std::map<Stage *, std::unique_ptr<std::mutex>> m_stageMutexes;
+    std::atomic<int> m_availThreads;
+};
+
+} // namespace pdal
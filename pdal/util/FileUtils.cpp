@@ -37,7 +37,10 @@
 #include <iostream>
 #include <sstream>
 #ifndef _WIN32
+#include <fcntl.h>
 #include <glob.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #else
 #include <codecvt>
 #include <Windows.h>
@@ -444,6 +447,88 @@ std::vector<std::string> glob(std::string path)
     return filenames;
 }
 
+
+MapContext mapFile(const std::string& filename)
+{
+    MapContext ctx;
+
+    if (isStdin(filename) || !fileExists(filename))
+    {
+        ctx.m_error = "File '" + filename + "' can't be mapped.";
+        return ctx;
+    }
+    ctx.m_size = fileSize(filename);
+    if (ctx.m_size == 0)
+    {
+        ctx.m_error = "Can't map empty file '" + filename + "'.";
+        return ctx;
+    }
+
+#ifndef _WIN32
+    ctx.m_fd = ::open(filename.c_str(), O_RDONLY);
+    if (ctx.m_fd == -1)
+    {
+        ctx.m_error = "Unable to open '" + filename + "' for mapping.";
+        return ctx;
+    }
+    void *addr = ::mmap(0, ctx.m_size, PROT_READ, MAP_SHARED, ctx.m_fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        ::close(ctx.m_fd);
+        ctx.m_fd = -1;
+        ctx.m_error = "Unable to map file '" + filename + "'.";
+        return ctx;
+    }
+    ctx.m_addr = addr;
+#else
+    HANDLE file = CreateFileW(toNative(filename).c_str(), GENERIC_READ,
+        FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        ctx.m_error = "Unable to open '" + filename + "' for mapping.";
+        return ctx;
+    }
+    ctx.m_handle = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (ctx.m_handle == NULL)
+    {
+        ctx.m_error = "Unable to map file '" + filename + "'.";
+        return ctx;
+    }
+    ctx.m_addr = MapViewOfFile(ctx.m_handle, FILE_MAP_READ, 0, 0, 0);
+    if (ctx.m_addr == NULL)
+    {
+        CloseHandle(ctx.m_handle);
+        ctx.m_handle = nullptr;
+        ctx.m_error = "Unable to map file '" + filename + "'.";
+        return ctx;
+    }
+#endif
+    return ctx;
+}
+
+
+MapContext unmapFile(MapContext ctx)
+{
+    if (!ctx.m_addr)
+        return ctx;
+
+#ifndef _WIN32
+    if (::munmap(ctx.m_addr, ctx.m_size) == -1)
+        ctx.m_error = "Couldn't unmap file.";
+    ::close(ctx.m_fd);
+    ctx.m_fd = -1;
+#else
+    if (!UnmapViewOfFile(ctx.m_addr))
+        ctx.m_error = "Couldn't unmap file.";
+    CloseHandle(ctx.m_handle);
+    ctx.m_handle = nullptr;
+#endif
+    ctx.m_addr = nullptr;
+    ctx.m_size = 0;
+    return ctx;
+}
+
 } // namespace FileUtils
 
 } // namespace pdal
@@ -258,6 +258,54 @@ namespace FileUtils
       \return  List of files that correspond to provided file specification.
     */
     PDAL_DLL std::vector<std::string> glob(std::string filespec);
+
+    /**
+      State of a memory-mapped file.
+    */
+    struct MapContext
+    {
+    public:
+        MapContext() : m_fd(-1), m_size(0), m_addr(nullptr)
+#ifdef _WIN32
+            , m_handle(nullptr)
+#endif
+        {}
+
+        /// \return  Address of the mapped data or nullptr if the map failed.
+        void *addr() const
+            { return m_addr; }
+        /// \return  Number of bytes mapped.
+        uintmax_t size() const
+            { return m_size; }
+        /// \return  Description of the error if the map failed.
+        std::string what() const
+            { return m_error; }
+
+        int m_fd;
+        uintmax_t m_size;
+        void *m_addr;
+        std::string m_error;
+#ifdef _WIN32
+        void *m_handle;
+#endif
+    };
+
+    /**
+      Map a file into memory for reading.
+
+      \param filename  Filename to map.
+      \return  Context of the mapping.  addr() is nullptr and what() describes
+        the error if the file couldn't be mapped.
+    */
+    PDAL_DLL MapContext mapFile(const std::string& filename);
+
+    /**
+      Unmap a file mapped with mapFile().
+
+      \param ctx  Context of the mapping.
+      \return  Context with the address reset.  what() describes any error.
+    */
+    PDAL_DLL MapContext unmapFile(MapContext ctx);
 }
 
 } // namespace pdal
@@ -0,0 +1,320 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#include "ThreadPool.hpp"
+#include "Utils.hpp"
+
+namespace pdal
+{
+
+void ThreadPool::go()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running)
+        return;
+    m_running = true;
+
+    for (std::size_t i(0); i < m_numThreads; ++i)
+        m_threads.emplace_back([this]() { work(); });
+}
+
+
+void ThreadPool::join()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_running)
+        return;
+    m_running = false;
+    lock.unlock();
+
+    m_consumeCv.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+    m_threads.clear();
+}
+
+
+void ThreadPool::await()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_produceCv.wait(lock, [this]()
+    {
+        return !m_outstanding && m_tasks.empty();
+    });
+}
+
+
+void ThreadPool::add(std::function<void()> task)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_running)
+        throw std::runtime_error("Attempted to add a task to a stopped "
+            "ThreadPool");
+
+    m_produceCv.wait(lock, [this]()
+    {
+        return m_tasks.size() < m_queueSize;
+    });
+
+    m_tasks.emplace(task);
+
+    // Notify worker that a task is available.
+    lock.unlock();
+    m_consumeCv.notify_all();
+}
+
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_consumeCv.wait(lock, [this]()
+        {
+            return m_tasks.size() || !m_running;
+        });
+
+        if (m_tasks.size())
+        {
+            ++m_outstanding;
+            auto task(std::move(m_tasks.front()));
+            m_tasks.pop();
+
+            lock.unlock();
+
+            // Notify add(), which may be waiting for a spot in the queue.
+            m_produceCv.notify_all();
+
+            std::string err;
+            try
+            {
+                task();
+            }
+            catch (std::exception& e)
+            {
+                err = e.what();
+            }
+            catch (...)
+            {
+                err = "Unknown error";
+            }
+
+            lock.lock();
+            --m_outstanding;
+            if (err.size())
+            {
+                if (m_verbose)
+                    std::cout << "Exception in pool task: " << err << std::endl;
+                m_errors.push_back(err);
+            }
+            lock.unlock();
+
+            // Notify await(), which may be waiting for a running task.
+            m_produceCv.notify_all();
+        }
+        else if (!m_running)
+        {
+            return;
+        }
+    }
+}
+
+
+namespace
+{
+
+// Pool shared by all parallel loops.  It has one less worker than the
+// thread limit since the thread running a loop works on it as well.
+std::mutex s_sharedMutex;
+std::size_t s_threadLimit(0);
+std::unique_ptr<ThreadPool> s_sharedPool;
+
+std::size_t defaultThreadLimit()
+{
+    std::string s;
+    long limit(0);
+    if (Utils::getenv("PDAL_NUM_THREADS", s) == 0 &&
+            Utils::fromString(s, limit) && limit > 0)
+        return (std::size_t)limit;
+    return (std::max)(std::thread::hardware_concurrency(), 1U);
+}
+
+// Call with s_sharedMutex held.
+std::size_t lockedThreadLimit()
+{
+    if (s_threadLimit == 0)
+        s_threadLimit = defaultThreadLimit();
+    return s_threadLimit;
+}
+
+ThreadPool& sharedPool()
+{
+    std::lock_guard<std::mutex> lock(s_sharedMutex);
+    if (!s_sharedPool)
+    {
+        std::size_t workers = lockedThreadLimit() - 1;
+        s_sharedPool.reset(new ThreadPool(workers,
+            (std::numeric_limits<std::size_t>::max)(), false));
+    }
+    return *s_sharedPool;
+}
+
+// State of a parallel loop, shared with the pool tasks that help with it.
+// Tasks may start after the loop is finished, in which case they find no
+// chunks left and return.
+struct Loop
+{
+    Loop(std::size_t begin, std::size_t end, std::size_t chunkSize,
+            const std::function<void(std::size_t, std::size_t)>& func) :
+        m_begin(begin), m_end(end), m_chunkSize(chunkSize),
+        m_numChunks((end - begin + chunkSize - 1) / chunkSize),
+        m_func(func), m_next(0), m_done(0), m_failed(false)
+    {}
+
+    // Run chunks until there are none left.
+    void run()
+    {
+        std::size_t done(0);
+        while (true)
+        {
+            std::size_t chunk = m_next++;
+            if (chunk >= m_numChunks)
+                break;
+            if (!m_failed)
+            {
+                std::size_t start = m_begin + chunk * m_chunkSize;
+                std::size_t stop = (std::min)(start + m_chunkSize, m_end);
+                try
+                {
+                    m_func(start, stop);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (!m_failed)
+                        m_error = std::current_exception();
+                    m_failed = true;
+                }
+            }
+            done++;
+        }
+        if (done)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done += done;
+            if (m_done == m_numChunks)
+                m_cv.notify_all();
+        }
+    }
+
+    // Wait for chunks being run by other threads.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this](){ return m_done == m_numChunks; });
+        if (m_error)
+            std::rethrow_exception(m_error);
+    }
+
+    const std::size_t m_begin;
+    const std::size_t m_end;
+    const std::size_t m_chunkSize;
+    const std::size_t m_numChunks;
+    // The caller's function outlives any task that calls it, since no
+    // chunk is started after the loop finishes.
+    const std::function<void(std::size_t, std::size_t)>& m_func;
+    std::atomic<std::size_t> m_next;
+    std::size_t m_done;
+    std::atomic<bool> m_failed;
+    std::exception_ptr m_error;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
+
+} // unnamed namespace
+
+
+void ThreadPool::setThreadLimit(std::size_t numThreads)
+{
+    std::lock_guard<std::mutex> lock(s_sharedMutex);
+    s_threadLimit = (std::max)(numThreads, std::size_t(1));
+    if (s_sharedPool)
+        s_sharedPool->resize(s_threadLimit - 1);
+}
+
+
+std::size_t ThreadPool::threadLimit()
+{
+    std::lock_guard<std::mutex> lock(s_sharedMutex);
+    return lockedThreadLimit();
+}
+
+
+void parallelFor(std::size_t begin, std::size_t end,
+    const std::function<void(std::size_t, std::size_t)>& func,
+    std::size_t maxThreads, std::size_t chunkSize)
+{
+    if (begin >= end)
+        return;
+
+    std::size_t count = end - begin;
+    std::size_t threads = ThreadPool::threadLimit();
+    if (maxThreads)
+        threads = (std::min)(threads, maxThreads);
+
+    // Aim for several chunks per thread so that threads that are slowed
+    // down or start late don't hold up the loop.
+    if (chunkSize == 0)
+        chunkSize = (std::max)(count / (threads * 16), std::size_t(1));
+    std::size_t numChunks = (count + chunkSize - 1) / chunkSize;
+    threads = (std::min)(threads, numChunks);
+    if (threads <= 1)
+    {
+        for (std::size_t start = begin; start < end; start += chunkSize)
+            func(start, (std::min)(start + chunkSize, end));
+        return;
+    }
+
+    std::shared_ptr<Loop> loop(new Loop(begin, end, chunkSize, func));
+    ThreadPool& pool = sharedPool();
+    for (std::size_t i = 1; i < threads; ++i)
+        pool.add([loop](){ loop->run(); });
+    loop->run();
+    loop->wait();
+}
+
+} // namespace pdal
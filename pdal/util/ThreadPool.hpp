@@ -1,5 +1,5 @@
 /******************************************************************************
- * Copyright (c) 2018, Connor Manning
+ * Copyright (c) 2020, Hobu Inc.
  *
  * All rights reserved.
  *
@@ -13,10 +13,6 @@
  *       notice, this list of conditions and the following disclaimer in
  *       the documentation and/or other materials provided
  *       with the distribution.
- *     * Neither the name of the Martin Isenburg or Iowa Department
- *       of Natural Resources nor the names of its contributors may be
- *       used to endorse or promote products derived from this software
- *       without specific prior written permission.
  *
  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
  * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
@@ -33,74 +29,51 @@
  ****************************************************************************/
 
 #pragma once
+
+#include <algorithm>
 #include <condition_variable>
-#include <queue>
 #include <functional>
-#include <vector>
 #include <mutex>
+#include <queue>
+#include <string>
 #include <thread>
-#include <iostream>
+#include <vector>
+
+#include "pdal_util_export.hpp"
 
 namespace pdal
 {
 
-class PDAL_DLL Pool
+class PDAL_DLL ThreadPool
 {
 public:
     // After numThreads tasks are actively running, and queueSize tasks have
     // been enqueued to wait for an available worker thread, subsequent calls
-    // to Pool::add will block until an enqueued task has been popped from the
-    // queue.
-    Pool(
+    // to ThreadPool::add will block until an enqueued task has been popped
+    // from the queue.
+    ThreadPool(
             std::size_t numThreads,
             std::size_t queueSize = 1,
             bool verbose = true)
         : m_verbose(verbose)
-        , m_numThreads(std::max<std::size_t>(numThreads, 1))
-        , m_queueSize(std::max<std::size_t>(queueSize, 1))
+        , m_numThreads((std::max)(numThreads, std::size_t(1)))
+        , m_queueSize((std::max)(queueSize, std::size_t(1)))
     {
         go();
     }
 
-    ~Pool() { join(); }
+    ~ThreadPool() { join(); }
 
     // Start worker threads.
-    void go()
-    {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_running) return;
-        m_running = true;
-
-        for (std::size_t i(0); i < m_numThreads; ++i)
-        {
-            m_threads.emplace_back([this]() { work(); });
-        }
-    }
+    void go();
 
     // Disallow the addition of new tasks and wait for all currently running
     // tasks to complete.
-    void join()
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        if (!m_running) return;
-        m_running = false;
-        lock.unlock();
-
-        m_consumeCv.notify_all();
-        for (auto& t : m_threads) t.join();
-        m_threads.clear();
-    }
+    void join();
 
     // Wait for all current tasks to complete.  As opposed to join, tasks may
     // continue to be added while a thread is await()-ing the queue to empty.
-    void await()
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_produceCv.wait(lock, [this]()
-        {
-            return !m_outstanding && m_tasks.empty();
-        });
-    }
+    void await();
 
     // Join and restart.
     void cycle() { join(); go(); }
@@ -109,7 +82,7 @@ public:
     void resize(const std::size_t numThreads)
     {
         join();
-        m_numThreads = numThreads;
+        m_numThreads = (std::max)(numThreads, std::size_t(1));
         go();
     }
 
@@ -118,82 +91,22 @@ public:
 
     // Add a threaded task, blocking until a thread is available.  If join() is
     // called, add() may not be called again until go() is called and completes.
-    void add(std::function<void()> task)
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        if (!m_running)
-        {
-            throw std::runtime_error(
-                    "Attempted to add a task to a stopped Pool");
-        }
-
-        m_produceCv.wait(lock, [this]()
-        {
-            return m_tasks.size() < m_queueSize;
-        });
-
-        m_tasks.emplace(task);
-
-        // Notify worker that a task is available.
-        lock.unlock();
-        m_consumeCv.notify_all();
-    }
-
+    void add(std::function<void()> task);
 
     std::size_t size() const { return m_numThreads; }
     std::size_t numThreads() const { return m_numThreads; }
 
+    // Limit on the number of threads that run parallelFor() loops at once,
+    // including the calling threads.  Defaults to the value of the
+    // PDAL_NUM_THREADS environment variable, or the number of hardware
+    // threads.  Set the limit before starting any loops.
+    static void setThreadLimit(std::size_t numThreads);
+    static std::size_t threadLimit();
+
 private:
     // Worker thread function.  Wait for a task and run it - or if stop() is
     // called, complete any outstanding task and return.
-    void work()
-    {
-        while (true)
-        {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            m_consumeCv.wait(lock, [this]()
-            {
-                return m_tasks.size() || !m_running;
-            });
-
-            if (m_tasks.size())
-            {
-                ++m_outstanding;
-                auto task(std::move(m_tasks.front()));
-                m_tasks.pop();
-
-                lock.unlock();
-
-                // Notify add(), which may be waiting for a spot in the queue.
-                m_produceCv.notify_all();
-
-                std::string err;
-                try { task(); }
-                catch (std::exception& e) { err = e.what(); }
-                catch (...) { err = "Unknown error"; }
-
-                lock.lock();
-                --m_outstanding;
-                if (err.size())
-                {
-                    if (m_verbose)
-                    {
-                        std::cout << "Exception in pool task: " << err <<
-                            std::endl;
-                    }
-                    m_errors.push_back(err);
-                }
-                lock.unlock();
-
-                // Notify await(), which may be waiting for a running task.
-                m_produceCv.notify_all();
-            }
-            else if (!m_running)
-            {
-                return;
-            }
-        }
-    }
+    void work();
 
     bool m_verbose;
     std::size_t m_numThreads;
@@ -202,7 +115,6 @@ private:
     std::queue<std::function<void()>> m_tasks;
 
     std::vector<std::string> m_errors;
-    std::mutex m_errorMutex;
 
     std::size_t m_outstanding = 0;
     bool m_running = false;
@@ -212,8 +124,33 @@ private:
     std::condition_variable m_consumeCv;
 
     // Disable copy/assignment.
-    Pool(const Pool& other);
-    Pool& operator=(const Pool& other);
+    ThreadPool(const ThreadPool& other);
+    ThreadPool& operator=(const ThreadPool& other);
 };
 
+/**
+  Call \ref func for consecutive chunks of the range [begin, end), in
+  parallel.  Chunks are handed out one at a time to the calling thread
+  and to workers of a process-wide pool, so threads that finish early
+  take on more of the range.  All parallel loops share the pool, so
+  running several at once won't use more than ThreadPool::threadLimit()
+  threads in total.  Loops may be nested.
+
+  \param begin  First index of the range.
+  \param end  One past the last index of the range.
+  \param func  Function called with the first and one past the last index
+    of each chunk.  Called concurrently for different chunks.
+  \param maxThreads  Maximum number of threads, including the calling
+    thread, to use for this loop.  0 means no limit beyond the
+    thread limit.
+  \param chunkSize  Number of indices in each chunk.  0 picks a size
+    based on the size of the range.
+
+  If \ref func throws, chunks not yet started are skipped and the first
+  exception is rethrown once running chunks complete.
+*/
+PDAL_DLL void parallelFor(std::size_t begin, std::size_t end,
+    const std::function<void(std::size_t, std::size_t)>& func,
+    std::size_t maxThreads = 0, std::size_t chunkSize = 0);
+
 } // namespace pdal
@@ -34,8 +34,8 @@
 
 #include "SlpkReader.hpp"
 #include <pdal/util/FileUtils.hpp>
+#include <pdal/util/ThreadPool.hpp>
 
-#include "pool.hpp"
 #include "EsriUtil.hpp"
 #include "SlpkExtractor.hpp"
 
@@ -125,6 +125,7 @@ class PDAL_DLL NitfReader : public LasReader
     public:
         NitfStreamIf(const std::string& filename, ShiftStream::off_type off)
         {
+            m_offset = off;
             m_istream = new ShiftStream(filename, off);
             // This makes sure that the stream is positioned at the beginning
             // of the embedded (LAS/LAZ) data.
@@ -155,6 +156,8 @@ protected:
             std::cerr << "Attempt to create stream twice!\n";
         m_streamIf.reset(new NitfStreamIf(m_filename, m_offset));
     }
+    virtual LasStreamIf *createWorkerStream()
+        { return new NitfStreamIf(m_filename, m_offset); }
 
 private:
     uint64_t m_offset;
@@ -39,8 +39,10 @@
 
 #include <Eigen/Dense>
 
+#include <cstdlib>
 #include <limits>
 #include <numeric>
+#include <random>
 
 using namespace pdal;
 
@@ -162,6 +164,48 @@ TEST(EigenTest, Morphological)
     EXPECT_EQ(0, Fv2[12]);
 }
 
+// Larger diamonds match the best value within the city block distance,
+// including at the edges of thin rasters.
+TEST(EigenTest, MorphologicalRadius)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(-50, 50);
+
+    for (auto dims : std::vector<std::pair<size_t, size_t>>
+            { {1, 12}, {9, 1}, {6, 11}, {20, 17} })
+    {
+        size_t rows = dims.first;
+        size_t cols = dims.second;
+        std::vector<double> data(rows * cols);
+        for (double& d : data)
+            d = dist(gen);
+
+        for (int radius = 0; radius <= 7; ++radius)
+        {
+            std::vector<double> dil = dilateDiamond(data, rows, cols, radius);
+            std::vector<double> ero = erodeDiamond(data, rows, cols, radius);
+            for (size_t c = 0; c < cols; ++c)
+                for (size_t r = 0; r < rows; ++r)
+                {
+                    double max = std::numeric_limits<double>::lowest();
+                    double min = (std::numeric_limits<double>::max)();
+                    for (size_t cc = 0; cc < cols; ++cc)
+                        for (size_t rr = 0; rr < rows; ++rr)
+                        {
+                            long d = std::abs((long)cc - (long)c) +
+                                std::abs((long)rr - (long)r);
+                            if (d > radius)
+                                continue;
+                            max = (std::max)(max, data[cc * rows + rr]);
+                            min = (std::min)(min, data[cc * rows + rr]);
+                        }
+                    EXPECT_EQ(max, dil[c * rows + r]);
+                    EXPECT_EQ(min, ero[c * rows + r]);
+                }
+        }
+    }
+}
+
 TEST(EigenTest, RoundtripString)
 {
     Eigen::MatrixXd identity = Eigen::MatrixXd::Identity(4, 4);
@@ -82,6 +82,33 @@ TEST(FileUtilsTest, test_file_ops)
     EXPECT_NO_THROW(FileUtils::openFile("foo~1.glob"));
 }
 
+TEST(FileUtilsTest, map)
+{
+    std::string tmp(Support::temppath("unittest_map.tmp"));
+    FileUtils::deleteFile(tmp);
+
+    FileUtils::MapContext ctx = FileUtils::mapFile(tmp);
+    EXPECT_EQ(ctx.addr(), nullptr);
+    EXPECT_FALSE(ctx.what().empty());
+
+    std::ostream* ostr = FileUtils::createFile(tmp);
+    *ostr << "mapped data";
+    FileUtils::closeFile(ostr);
+
+    ctx = FileUtils::mapFile(tmp);
+    ASSERT_NE(ctx.addr(), nullptr);
+    EXPECT_EQ(ctx.size(), 11U);
+    EXPECT_EQ(std::string((const char *)ctx.addr(), ctx.size()),
+        "mapped data");
+
+    ctx = FileUtils::unmapFile(ctx);
+    EXPECT_EQ(ctx.addr(), nullptr);
+    EXPECT_TRUE(ctx.what().empty());
+
+    FileUtils::deleteFile(tmp);
+}
+
+
 TEST(FileUtilsTest, test_readFileIntoString)
 {
     const std::string filename = Support::datapath("text/text.txt");
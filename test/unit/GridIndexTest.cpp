@@ -0,0 +1,511 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <pdal/pdal_test_main.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <random>
+
+#include <pdal/GridIndex.hpp>
+#include <pdal/PointView.hpp>
+#include <pdal/QuadIndex.hpp>
+#include <pdal/util/Utils.hpp>
+
+using namespace pdal;
+
+namespace
+{
+
+PointViewPtr makeView(PointTableRef table)
+{
+    table.layout()->registerDim(Dimension::Id::X);
+    table.layout()->registerDim(Dimension::Id::Y);
+    return PointViewPtr(new PointView(table));
+}
+
+
+// Cell of a level of a quadtree over bounds that contains a position,
+// found by halving the bounds as a pointer-based tree would.
+struct TreeCell
+{
+    uint64_t col;
+    uint64_t row;
+    double cx;
+    double cy;
+};
+
+TreeCell treeCell(double x, double y, std::size_t level, double xMin,
+    double yMin, double xMax, double yMax)
+{
+    TreeCell c { 0, 0, xMin + (xMax - xMin) / 2, yMin + (yMax - yMin) / 2 };
+    for (std::size_t l = 0; l < level; ++l)
+    {
+        c.col *= 2;
+        c.row *= 2;
+        if (x < c.cx)
+            xMax = c.cx;
+        else
+        {
+            xMin = c.cx;
+            c.col++;
+        }
+        if (y < c.cy)
+            yMax = c.cy;
+        else
+        {
+            yMin = c.cy;
+            c.row++;
+        }
+        c.cx = xMin + (xMax - xMin) / 2;
+        c.cy = yMin + (yMax - yMin) / 2;
+    }
+    return c;
+}
+
+// Check that each node of a QuadIndex holds a point of its cell that is as
+// close to the center of the cell as any point not held by a shallower
+// node, then check the queries against brute force over the depths of the
+// points.  Equally close points may be held in either order.
+void checkQuadIndex(const PointView& view, const QuadIndex& index,
+    std::mt19937& gen)
+{
+    const PointId NoPoint = (std::numeric_limits<PointId>::max)();
+    double xMin, yMin, xMax, yMax;
+    index.getBounds(xMin, yMin, xMax, yMax);
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    for (PointId id = 0; id < view.size(); ++id)
+    {
+        xs.push_back(view.getFieldAs<double>(Dimension::Id::X, id));
+        ys.push_back(view.getFieldAs<double>(Dimension::Id::Y, id));
+    }
+
+    const std::size_t depth = index.getDepth();
+    const std::vector<std::size_t> fills = index.getFills();
+    ASSERT_EQ(fills.size(), depth + 1);
+    // Duplicates past this depth share the cells of the deepest level.
+    ASSERT_LT(depth, 31U);
+
+    std::vector<std::size_t> depths(view.size(), NoPoint);
+    for (std::size_t level = 0; level <= depth; ++level)
+    {
+        PointIdList ids = index.getPoints(level, level + 1);
+        EXPECT_EQ(ids.size(), fills[level]);
+        for (PointId id : ids)
+        {
+            ASSERT_EQ(depths.at(id), NoPoint) << id;
+            depths[id] = level;
+        }
+    }
+    for (PointId id = 0; id < view.size(); ++id)
+        ASSERT_NE(depths[id], NoPoint) << id;
+
+    for (std::size_t level = 0; level <= depth; ++level)
+    {
+        // Closest point to the center of each cell of the level and the
+        // point of the node of the cell.
+        typedef std::pair<uint64_t, uint64_t> Key;
+        std::map<Key, double> closest;
+        std::map<Key, PointId> held;
+        for (PointId id = 0; id < view.size(); ++id)
+        {
+            if (depths[id] < level)
+                continue;
+            TreeCell c = treeCell(xs[id], ys[id], level, xMin, yMin,
+                xMax, yMax);
+            Key key(c.col, c.row);
+            double dist = (xs[id] - c.cx) * (xs[id] - c.cx) +
+                (ys[id] - c.cy) * (ys[id] - c.cy);
+            auto it = closest.find(key);
+            if (it == closest.end() || dist < it->second)
+                closest[key] = dist;
+            if (depths[id] == level)
+            {
+                EXPECT_TRUE(held.insert(std::make_pair(key, id)).second) <<
+                    level << ": " << id;
+            }
+        }
+        EXPECT_EQ(held.size(), closest.size()) << level;
+        for (auto& h : held)
+        {
+            TreeCell c = treeCell(xs[h.second], ys[h.second], level, xMin,
+                yMin, xMax, yMax);
+            double dist = (xs[h.second] - c.cx) * (xs[h.second] - c.cx) +
+                (ys[h.second] - c.cy) * (ys[h.second] - c.cy);
+            EXPECT_EQ(dist, closest[h.first]) << level << ": " << h.second;
+        }
+    }
+
+    auto inDepth = [&depths](PointId id, std::size_t begin, std::size_t end)
+    {
+        return depths[id] >= begin && (end == 0 || depths[id] < end);
+    };
+
+    // Depth ranges.
+    for (std::size_t begin = 0; begin <= depth + 1; ++begin)
+        for (std::size_t end : { (std::size_t)0, begin, begin + 1,
+                begin + 3, depth + 1 })
+        {
+            PointIdList expected;
+            for (PointId id = 0; id < view.size(); ++id)
+                if (inDepth(id, begin, end))
+                    expected.push_back(id);
+
+            PointIdList ids = index.getPoints(begin, end);
+            std::sort(ids.begin(), ids.end());
+            EXPECT_EQ(ids, expected) << begin << " - " << end;
+            if (begin == 0)
+            {
+                ids = index.getPoints(end);
+                std::sort(ids.begin(), ids.end());
+                EXPECT_EQ(ids, expected) << end;
+            }
+        }
+
+    // Boxes.  Half of the box edges lie on the grid the points are on and
+    // some boxes are given with their corners swapped.
+    std::uniform_int_distribution<int> lattice(-40, 440);
+    std::uniform_real_distribution<double> real(-10, 110);
+    std::uniform_int_distribution<int> coin(0, 1);
+    auto coord = [&]()
+        { return coin(gen) ? lattice(gen) / 4.0 : real(gen); };
+    for (int i = 0; i < 200; ++i)
+    {
+        const double x0 = coord();
+        const double y0 = coord();
+        const double x1 = coord();
+        const double y1 = coord();
+        const std::size_t begin = i % 4 ? 0 : i % 3;
+        const std::size_t end = i % 5 ? 0 : begin + 1 + i % 7;
+
+        PointIdList expected;
+        for (PointId id = 0; id < view.size(); ++id)
+            if (xs[id] >= (std::min)(x0, x1) && xs[id] < (std::max)(x0, x1) &&
+                ys[id] >= (std::min)(y0, y1) && ys[id] < (std::max)(y0, y1) &&
+                inDepth(id, begin, end))
+                expected.push_back(id);
+
+        PointIdList ids = index.getPoints(x0, y0, x1, y1, begin, end);
+        std::sort(ids.begin(), ids.end());
+        EXPECT_EQ(ids, expected) << x0 << ", " << y0 << " - " <<
+            x1 << ", " << y1 << " : " << begin << " - " << end;
+        if (begin == 0)
+        {
+            ids = index.getPoints(x0, y0, x1, y1, end);
+            std::sort(ids.begin(), ids.end());
+            EXPECT_EQ(ids, expected);
+        }
+    }
+
+    // Rasterized levels.
+    for (std::size_t level = 0; level <= (std::min)(depth, (std::size_t)7);
+        ++level)
+    {
+        const std::size_t cells = (std::size_t)1 << level;
+        const double xStep = (xMax - xMin) / cells;
+        const double yStep = (yMax - yMin) / cells;
+        const double xBegin = xMin + xStep / 2;
+        const double xEnd = xMax + xStep / 2;
+        const double yBegin = yMin + yStep / 2;
+
+        PointIdList expected(cells * cells, NoPoint);
+        for (PointId id = 0; id < view.size(); ++id)
+            if (depths[id] == level)
+            {
+                TreeCell c = treeCell(xs[id], ys[id], level, xMin, yMin,
+                    xMax, yMax);
+                double col = Utils::sround((c.cx - xBegin) / xStep);
+                double row = Utils::sround((c.cy - yBegin) / yStep);
+                expected.at((size_t)Utils::sround(row * (xEnd - xBegin) /
+                    xStep + col)) = id;
+            }
+
+        double xb, xe, xs, yb, ye, ys;
+        EXPECT_EQ(index.getPoints(level, xb, xe, xs, yb, ye, ys), expected)
+            << level;
+        EXPECT_DOUBLE_EQ(xb, xBegin);
+        EXPECT_DOUBLE_EQ(xe, xEnd);
+        EXPECT_DOUBLE_EQ(xs, xStep);
+        EXPECT_DOUBLE_EQ(yb, yBegin);
+        EXPECT_DOUBLE_EQ(ye, yMax + yStep / 2);
+        EXPECT_DOUBLE_EQ(ys, yStep);
+    }
+
+    // Custom rasters.  Each cell holds one of the shallowest points that
+    // fall in it.
+    for (int i = 0; i < 20; ++i)
+    {
+        const double xStep = (i % 2 ? 0.25 : 0.1) * (1 + i % 5);
+        const double yStep = xStep * (i % 3 ? 1 : 2);
+        const double xBegin = coord();
+        const double yBegin = coord();
+        const std::size_t width = 10 + i * 7;
+        const std::size_t height = 5 + i * 11;
+        const double xEnd = xBegin + width * xStep;
+        const double yEnd = yBegin + height * yStep;
+
+        PointIdList raster = index.getPoints(xBegin, xEnd, xStep,
+            yBegin, yEnd, yStep);
+        ASSERT_EQ(raster.size(), width * height);
+
+        std::vector<std::size_t> best(raster.size(), NoPoint);
+        std::vector<PointIdList> cellIds(raster.size());
+        for (PointId id = 0; id < view.size(); ++id)
+        {
+            if (xs[id] < xBegin || ys[id] < yBegin ||
+                    xs[id] >= xEnd - xStep || ys[id] >= yEnd - yStep)
+                continue;
+            double col = Utils::sround((xs[id] - xBegin) / xStep);
+            double row = Utils::sround((ys[id] - yBegin) / yStep);
+            size_t cell = (size_t)Utils::sround(row * (xEnd - xBegin) /
+                xStep + col);
+            if (cell >= raster.size())
+                continue;
+            if (depths[id] < best[cell])
+            {
+                best[cell] = depths[id];
+                cellIds[cell].clear();
+            }
+            if (depths[id] == best[cell])
+                cellIds[cell].push_back(id);
+        }
+
+        for (size_t cell = 0; cell < raster.size(); ++cell)
+            if (cellIds[cell].empty())
+                EXPECT_EQ(raster[cell], NoPoint) << i << ": " << cell;
+            else
+                EXPECT_NE(std::find(cellIds[cell].begin(),
+                    cellIds[cell].end(), raster[cell]),
+                    cellIds[cell].end()) << i << ": " << cell;
+    }
+}
+
+} // unnamed namespace
+
+TEST(GridIndex, cells)
+{
+    PointTable table;
+    PointViewPtr view = makeView(table);
+
+    // Points in reverse order so that cell order differs from ID order.
+    PointId id = 0;
+    for (int y = 9; y >= 0; --y)
+        for (int x = 9; x >= 0; --x)
+        {
+            view->setField(Dimension::Id::X, id, x);
+            view->setField(Dimension::Id::Y, id++, y);
+        }
+
+    GridIndex grid(*view, 2.0);
+    EXPECT_EQ(grid.cols(), 5U);
+    EXPECT_EQ(grid.rows(), 5U);
+    EXPECT_EQ(grid.col(3.5), 1U);
+    EXPECT_EQ(grid.row(-20), 0U);
+    EXPECT_EQ(grid.row(100), 4U);
+
+    for (size_t r = 0; r < grid.rows(); ++r)
+        for (size_t c = 0; c < grid.cols(); ++c)
+        {
+            GridIndex::Cell cell = grid.points(c, r);
+            ASSERT_EQ(cell.size(), 4U);
+            EXPECT_TRUE(std::is_sorted(cell.begin(), cell.end()));
+            for (PointId id : cell)
+            {
+                EXPECT_EQ(grid.col(view->getFieldAs<double>(
+                    Dimension::Id::X, id)), c);
+                EXPECT_EQ(grid.row(view->getFieldAs<double>(
+                    Dimension::Id::Y, id)), r);
+            }
+        }
+}
+
+TEST(GridIndex, tooManyCells)
+{
+    PointTable table;
+    PointViewPtr view = makeView(table);
+    view->setField(Dimension::Id::X, 0, 0);
+    view->setField(Dimension::Id::Y, 0, 0);
+    view->setField(Dimension::Id::X, 1, 1e6);
+    view->setField(Dimension::Id::Y, 1, 1e6);
+
+    EXPECT_THROW(GridIndex(*view, 1e-3), pdal_error);
+    EXPECT_THROW(GridIndex(*view, 0.0), pdal_error);
+    EXPECT_THROW(GridIndex(*view, BOX2D(0, 0, 1, 1), (size_t)1 << 20,
+        (size_t)1 << 20), pdal_error);
+    EXPECT_NO_THROW(GridIndex(*view, 1000.0));
+}
+
+TEST(GridIndex, queries)
+{
+    PointTable table;
+    PointViewPtr view = makeView(table);
+
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(-100, 100);
+    for (PointId id = 0; id < 10000; ++id)
+    {
+        view->setField(Dimension::Id::X, id, dist(gen));
+        view->setField(Dimension::Id::Y, id, dist(gen));
+    }
+
+    GridIndex grid(*view, BOX2D(-50, -50, 50, 50), 16, 8);
+    for (int i = 0; i < 20; ++i)
+    {
+        double x = dist(gen);
+        double y = dist(gen);
+        double r = std::abs(dist(gen)) / 4;
+
+        BOX2D box(x - r, y - r, x + r / 2, y + r / 2);
+        PointIdList inBox;
+        PointIdList inRadius;
+        for (PointId id = 0; id < view->size(); ++id)
+        {
+            double px = view->getFieldAs<double>(Dimension::Id::X, id);
+            double py = view->getFieldAs<double>(Dimension::Id::Y, id);
+            if (box.contains(px, py))
+                inBox.push_back(id);
+            if ((px - x) * (px - x) + (py - y) * (py - y) <= r * r)
+                inRadius.push_back(id);
+        }
+
+        PointIdList ids = grid.boxQuery(box);
+        std::sort(ids.begin(), ids.end());
+        EXPECT_EQ(ids, inBox);
+
+        ids = grid.radius(x, y, r);
+        std::sort(ids.begin(), ids.end());
+        EXPECT_EQ(ids, inRadius);
+    }
+}
+
+TEST(QuadIndex, levels)
+{
+    PointTable table;
+    PointViewPtr view = makeView(table);
+
+    // The point at the center of the bounds takes the top level; the
+    // points nearest the quadrant centers take the second level.
+    const double pts[][2] = { {1, 1}, {9, 1}, {1, 9}, {9, 9}, {5, 5},
+        {2, 2} };
+    for (PointId id = 0; id < 6; ++id)
+    {
+        view->setField(Dimension::Id::X, id, pts[id][0]);
+        view->setField(Dimension::Id::Y, id, pts[id][1]);
+    }
+
+    QuadIndex index(*view, 0, 0, 10, 10);
+    EXPECT_EQ(index.getDepth(), 2U);
+    EXPECT_EQ(index.getFills(), std::vector<size_t>({ 1, 4, 1 }));
+    EXPECT_EQ(index.getPoints(1), PointIdList({ 4 }));
+
+    // (2, 2) is closer than (1, 1) to the center of the southwest cell.
+    PointIdList ids = index.getPoints(1, 2);
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(ids, PointIdList({ 1, 2, 3, 5 }));
+    EXPECT_EQ(index.getPoints(2, 3), PointIdList({ 0 }));
+
+    ids = index.getPoints(0, 0, 6, 6);
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(ids, PointIdList({ 0, 4, 5 }));
+    EXPECT_EQ(index.getPoints(0.0, 0.0, 6.0, 6.0, 2), PointIdList({ 4, 5 }));
+
+    // Rasterize the second level: one point per quadrant.
+    double xBegin, xEnd, xStep, yBegin, yEnd, yStep;
+    EXPECT_EQ(index.getPoints(1, xBegin, xEnd, xStep, yBegin, yEnd, yStep),
+        PointIdList({ 5, 1, 2, 3 }));
+    EXPECT_DOUBLE_EQ(xStep, 5.0);
+    EXPECT_DOUBLE_EQ(yBegin, 2.5);
+}
+
+// Compare the queries with brute force over a few thousand points, many of
+// them on the bounds or on the edges of the cells and some duplicated.
+TEST(QuadIndex, random)
+{
+    std::mt19937 gen(2020);
+    std::uniform_int_distribution<int> lattice(0, 400);
+    std::uniform_real_distribution<double> real(0, 100);
+    std::uniform_int_distribution<int> kind(0, 3);
+
+    PointTable table;
+    PointViewPtr view = makeView(table);
+    const double edges[] = { 0, 50, 100 };
+    PointId id = 0;
+    for (double x : edges)
+        for (double y : edges)
+        {
+            view->setField(Dimension::Id::X, id, x);
+            view->setField(Dimension::Id::Y, id++, y);
+        }
+    for (; id < 3000; ++id)
+    {
+        double x, y;
+        switch (kind(gen))
+        {
+        case 0:
+            x = real(gen);
+            y = real(gen);
+            break;
+        case 1:
+        {
+            // A copy of an earlier point.
+            std::uniform_int_distribution<PointId> prev(0, id - 1);
+            PointId p = prev(gen);
+            x = view->getFieldAs<double>(Dimension::Id::X, p);
+            y = view->getFieldAs<double>(Dimension::Id::Y, p);
+            break;
+        }
+        case 2:
+            // On the bounds.
+            x = lattice(gen) / 4.0;
+            y = edges[id % 2 * 2];
+            if (id % 3)
+                std::swap(x, y);
+            break;
+        default:
+            x = lattice(gen) / 4.0;
+            y = lattice(gen) / 4.0;
+            break;
+        }
+        view->setField(Dimension::Id::X, id, x);
+        view->setField(Dimension::Id::Y, id, y);
+    }
+
+    {
+        QuadIndex index(*view);
+        checkQuadIndex(*view, index, gen);
+    }
+    {
+        QuadIndex index(*view, -28, -12, 164, 116);
+        checkQuadIndex(*view, index, gen);
+    }
+}
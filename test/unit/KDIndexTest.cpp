@@ -33,6 +33,8 @@
 
 #include <pdal/pdal_test_main.hpp>
 
+#include <random>
+
 #include <pdal/KDIndex.hpp>
 
 using namespace pdal;
@@ -378,3 +380,292 @@ TEST(KDIndex, radius3D)
     EXPECT_EQ(ids[2], 2u);
 }
 
+
+// Make sure an index large enough to be built with multiple threads finds
+// the same neighbors as a brute-force search.
+TEST(KDIndex, large)
+{
+    PointTable table;
+    PointLayoutPtr layout = table.layout();
+    layout->registerDim(Dimension::Id::X);
+    layout->registerDim(Dimension::Id::Y);
+    layout->registerDim(Dimension::Id::Z);
+    table.finalize();
+    PointView view(table);
+
+    const PointId NumPoints = 200000;
+    for (PointId i = 0; i < NumPoints; ++i)
+    {
+        view.setField(Dimension::Id::X, i, (i * 7919) % 1000);
+        view.setField(Dimension::Id::Y, i, (i * 104729) % 997);
+        view.setField(Dimension::Id::Z, i, i / 1000.0);
+    }
+
+    KD3Index index(view);
+    index.build();
+
+    for (PointId q = 0; q < NumPoints; q += 9973)
+    {
+        double x = view.getFieldAs<double>(Dimension::Id::X, q);
+        double y = view.getFieldAs<double>(Dimension::Id::Y, q);
+        double z = view.getFieldAs<double>(Dimension::Id::Z, q);
+
+        double nearest = (std::numeric_limits<double>::max)();
+        for (PointId i = 0; i < NumPoints; ++i)
+        {
+            if (i == q)
+                continue;
+            double dx = x - view.getFieldAs<double>(Dimension::Id::X, i);
+            double dy = y - view.getFieldAs<double>(Dimension::Id::Y, i);
+            double dz = z - view.getFieldAs<double>(Dimension::Id::Z, i);
+            nearest = (std::min)(nearest, dx * dx + dy * dy + dz * dz);
+        }
+
+        PointIdList ids(2);
+        std::vector<double> dists(2);
+        index.knnSearch(q, 2, &ids, &dists);
+        EXPECT_EQ(ids[0], q);
+        EXPECT_DOUBLE_EQ(dists[1], nearest);
+    }
+}
+
+TEST(KDIndex, batch)
+{
+    PointTable table;
+    PointLayoutPtr layout = table.layout();
+    layout->registerDim(Dimension::Id::X);
+    layout->registerDim(Dimension::Id::Y);
+    layout->registerDim(Dimension::Id::Z);
+    table.finalize();
+    PointView view(table);
+
+    const PointId NumPoints = 5000;
+    for (PointId i = 0; i < NumPoints; ++i)
+    {
+        view.setField(Dimension::Id::X, i, (i * 7919) % 100);
+        view.setField(Dimension::Id::Y, i, (i * 104729) % 97);
+        view.setField(Dimension::Id::Z, i, i / 100.0);
+    }
+
+    KD3Index index(view);
+    index.build();
+    KD2Index index2(view);
+    index2.build();
+
+    // Batch results should match single queries, in query order.
+    NeighborList neighbors;
+    index.batchKnnSearch(100, 1100, 8, neighbors);
+    ASSERT_EQ(neighbors.size(), 1000U);
+    for (PointId i = 100; i < 1100; ++i)
+    {
+        PointIdList ids(8);
+        std::vector<double> dists(8);
+        index.knnSearch(i, 8, &ids, &dists);
+        ASSERT_EQ(neighbors.count(i - 100), 8U);
+        for (size_t j = 0; j < 8; ++j)
+        {
+            EXPECT_EQ(neighbors.neighbors(i - 100)[j], ids[j]);
+            EXPECT_DOUBLE_EQ(neighbors.distances(i - 100)[j], dists[j]);
+        }
+    }
+
+    PointIdList ids;
+    index.batchRadius(0, NumPoints, 5.0, neighbors);
+    ASSERT_EQ(neighbors.size(), NumPoints);
+    for (PointId i = 0; i < NumPoints; ++i)
+    {
+        neighbors.neighbors(i, ids);
+        EXPECT_EQ(ids, index.radius(i, 5.0));
+    }
+
+    index2.batchRadius(10, 20, 3.0, neighbors);
+    ASSERT_EQ(neighbors.size(), 10U);
+    for (PointId i = 10; i < 20; ++i)
+    {
+        neighbors.neighbors(i - 10, ids);
+        EXPECT_EQ(ids, index2.radius(i, 3.0));
+    }
+
+    // Requesting more neighbors than there are points.
+    PointTable smallTable;
+    smallTable.layout()->registerDim(Dimension::Id::X);
+    smallTable.layout()->registerDim(Dimension::Id::Y);
+    smallTable.finalize();
+    PointView smallView(smallTable);
+    for (PointId i = 0; i < 3; ++i)
+    {
+        smallView.setField(Dimension::Id::X, i, i);
+        smallView.setField(Dimension::Id::Y, i, i);
+    }
+    KD2Index smallIndex(smallView);
+    smallIndex.build();
+    smallIndex.batchKnnSearch(0, 3, 10, neighbors);
+    ASSERT_EQ(neighbors.size(), 3U);
+    EXPECT_EQ(neighbors.count(0), 3U);
+    EXPECT_EQ(neighbors.neighbors(2)[0], 2U);
+}
+
+TEST(KDIndex, knnGraph)
+{
+    PointTable table;
+    PointLayoutPtr layout = table.layout();
+    layout->registerDim(Dimension::Id::X);
+    layout->registerDim(Dimension::Id::Y);
+    layout->registerDim(Dimension::Id::Z);
+    table.finalize();
+    PointView view(table);
+
+    const PointId NumPoints = 2000;
+    for (PointId i = 0; i < NumPoints; ++i)
+    {
+        view.setField(Dimension::Id::X, i, (i * 7919) % 100);
+        view.setField(Dimension::Id::Y, i, (i * 104729) % 97);
+        view.setField(Dimension::Id::Z, i, i / 10.0);
+    }
+
+    KnnGraph graph = view.buildKnnGraph(8);
+    EXPECT_EQ(graph.k(), 8U);
+    KD3Index& index = view.build3dIndex();
+    PointIdList ids;
+    for (PointId i = 0; i < NumPoints; ++i)
+    {
+        PointIdList expected(8);
+        std::vector<double> dists(8);
+        index.knnSearch(i, 8, &expected, &dists);
+        ASSERT_EQ(graph.count(i), 8U);
+        graph.neighbors(i, ids);
+        EXPECT_EQ(ids, expected);
+        for (size_t j = 0; j < 8; ++j)
+            EXPECT_DOUBLE_EQ(graph.distances(i)[j], dists[j]);
+    }
+
+    // A smaller k is served from the existing graph.
+    KnnGraph small = view.buildKnnGraph(4);
+    EXPECT_EQ(small.count(0), 4U);
+    EXPECT_EQ(small.neighbors(0), graph.neighbors(0));
+
+    // A larger k, or invalidation, rebuilds the graph.
+    KnnGraph large = view.buildKnnGraph(12);
+    EXPECT_EQ(large.count(0), 12U);
+    EXPECT_NE(large.neighbors(0), graph.neighbors(0));
+    view.invalidateProducts();
+    KnnGraph rebuilt = view.buildKnnGraph(4);
+    EXPECT_NE(rebuilt.neighbors(0), large.neighbors(0));
+    EXPECT_EQ(rebuilt.count(0), 4U);
+}
+
+TEST(KDIndex, invalidation)
+{
+    PointTable table;
+    PointLayoutPtr layout = table.layout();
+    layout->registerDim(Dimension::Id::X);
+    layout->registerDim(Dimension::Id::Y);
+    layout->registerDim(Dimension::Id::Z);
+    layout->registerDim(Dimension::Id::Classification);
+    table.finalize();
+    PointView view(table);
+
+    for (PointId i = 0; i < 100; ++i)
+    {
+        view.setField(Dimension::Id::X, i, i % 10);
+        view.setField(Dimension::Id::Y, i, i / 10);
+        view.setField(Dimension::Id::Z, i, 0);
+    }
+
+    KD3Index *index3 = &view.build3dIndex();
+    KD2Index *index2 = &view.build2dIndex();
+    KnnGraph graph = view.buildKnnGraph(4);
+
+    // Changing other dimensions keeps the indexes.
+    for (PointId i = 0; i < 100; ++i)
+        view.setField(Dimension::Id::Classification, i, 2);
+    EXPECT_EQ(&view.build3dIndex(), index3);
+    EXPECT_EQ(&view.build2dIndex(), index2);
+    EXPECT_EQ(view.buildKnnGraph(4).neighbors(0), graph.neighbors(0));
+
+    // Changing Z only rebuilds the 3D products.
+    view.setField(Dimension::Id::Z, 1, 100);
+    EXPECT_EQ(&view.build2dIndex(), index2);
+    PointIdList ids = view.build3dIndex().neighbors(0, 5);
+    EXPECT_EQ(std::count(ids.begin(), ids.end(), 1U), 0);
+    view.buildKnnGraph(4).neighbors(0, ids);
+    EXPECT_EQ(std::count(ids.begin(), ids.end(), 1U), 0);
+
+    // So does changing it again.
+    view.setField(Dimension::Id::Z, 1, 0);
+    EXPECT_EQ(&view.build2dIndex(), index2);
+    ids = view.build3dIndex().neighbors(0, 5);
+    EXPECT_EQ(std::count(ids.begin(), ids.end(), 1U), 1);
+
+    // Moving a point rebuilds both.
+    view.setField(Dimension::Id::X, 99, 0.5);
+    view.setField(Dimension::Id::Y, 99, 0);
+    view.setField(Dimension::Id::Z, 99, 0);
+    EXPECT_EQ(view.build3dIndex().neighbors(0, 2)[1], 99U);
+    EXPECT_EQ(view.build2dIndex().neighbors(0, 2)[1], 99U);
+
+    // Adding points rebuilds the indexes.
+    view.setField(Dimension::Id::X, 100, 0.1);
+    view.setField(Dimension::Id::Y, 100, 0);
+    view.setField(Dimension::Id::Z, 100, 0);
+    EXPECT_EQ(view.build3dIndex().neighbors(0, 2)[1], 100U);
+    EXPECT_EQ(view.build2dIndex().neighbors(0, 2)[1], 100U);
+    EXPECT_EQ(view.buildKnnGraph(4).count(100), 4U);
+}
+
+TEST(KDIndex, subset)
+{
+    PointTable table;
+    PointLayoutPtr layout = table.layout();
+    layout->registerDim(Dimension::Id::X);
+    layout->registerDim(Dimension::Id::Y);
+    layout->registerDim(Dimension::Id::Z);
+    table.finalize();
+    PointViewPtr view(new PointView(table));
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> dist(0, 100);
+    for (PointId i = 0; i < 20000; ++i)
+    {
+        view->setField(Dimension::Id::X, i, dist(gen));
+        view->setField(Dimension::Id::Y, i, dist(gen));
+        view->setField(Dimension::Id::Z, i, dist(gen));
+    }
+    view->build3dIndex();
+    view->build2dIndex();
+
+    // A crop of half of the points and a thinned copy of the rest, as
+    // filters.crop and filters.range would produce.
+    PointViewPtr cropped = view->makeNew();
+    PointViewPtr thinned = view->makeNew();
+    for (PointId i = 0; i < view->size(); ++i)
+        if (view->getFieldAs<double>(Dimension::Id::X, i) < 50)
+            cropped->appendPoint(*view, i);
+        else if (i % 3 == 0)
+            thinned->appendPoint(*view, i);
+    cropped->inheritProducts(*view);
+    thinned->inheritProducts(*view);
+    view.reset();
+
+    for (PointViewPtr subset : { cropped, thinned })
+    {
+        PointViewPtr copy = subset->makeNew();
+        copy->append(*subset);
+
+        KD3Index& index3 = subset->build3dIndex();
+        KD2Index& index2 = subset->build2dIndex();
+        KD3Index& expected3 = copy->build3dIndex();
+        KD2Index& expected2 = copy->build2dIndex();
+        for (PointId i = 0; i < subset->size(); i += 7)
+        {
+            EXPECT_EQ(index3.neighbors(i, 10), expected3.neighbors(i, 10));
+            EXPECT_EQ(index2.neighbors(i, 10), expected2.neighbors(i, 10));
+
+            PointIdList ids = index3.radius(i, 5.0);
+            PointIdList expectedIds = expected3.radius(i, 5.0);
+            std::sort(ids.begin(), ids.end());
+            std::sort(expectedIds.begin(), expectedIds.end());
+            EXPECT_EQ(ids, expectedIds);
+        }
+    }
+}
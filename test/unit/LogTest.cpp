@@ -33,6 +33,10 @@
 ****************************************************************************/
 
 #include <pdal/pdal_test_main.hpp>
+
+#include <sstream>
+#include <thread>
+
 #include <pdal/Log.hpp>
 #include <pdal/util/FileUtils.hpp>
 #include "Support.hpp"
@@ -86,4 +90,39 @@ TEST(Log, t2)
     FileUtils::deleteFile(out);
 }
 
+// Make sure that lines logged from several threads at once don't
+// interleave.
+TEST(Log, threads)
+{
+    std::ostringstream oss;
+    {
+        LogPtr l(Log::makeLog("", &oss));
+        l->setLevel(LogLevel::Debug);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+            threads.emplace_back([&l, t]()
+            {
+                for (int i = 0; i < 1000; ++i)
+                    l->get(LogLevel::Debug) << "thread " << t << " line " <<
+                        i << std::endl;
+            });
+        for (std::thread& t : threads)
+            t.join();
+    }
+
+    std::istringstream in(oss.str());
+    std::string line;
+    std::vector<int> next(4);
+    while (std::getline(in, line))
+    {
+        int t, i;
+        ASSERT_EQ(sscanf(line.c_str(), "(Debug) thread %d line %d", &t, &i),
+            2) << line;
+        ASSERT_TRUE(t >= 0 && t < 4);
+        EXPECT_EQ(i, next[t]++);
+    }
+    EXPECT_EQ(next, std::vector<int>(4, 1000));
+}
+
 }
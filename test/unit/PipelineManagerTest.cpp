@@ -238,3 +238,70 @@ TEST(PipelineManagerTest, replace)
     EXPECT_EQ(w2->getInputs().size(), 1U);
     EXPECT_EQ(w2->getInputs().front(), f2);
 }
+
+// Make sure that running independent branches in parallel produces the
+// same result as running them serially.
+TEST(PipelineManagerTest, threads)
+{
+    auto run = [](std::size_t threads)
+    {
+        PipelineManager mgr;
+
+        Stage& merge = mgr.makeFilter("filters.merge");
+        for (int i = 0; i < 8; ++i)
+        {
+            Options opts;
+            opts.add("mode", "ramp");
+            opts.add("count", 100000 + i);
+            opts.add("bounds", BOX3D(i, i, i, i + 1, i + 1, i + 1));
+            Stage& r = mgr.makeReader("", "readers.faux", opts);
+            merge.setInput(r);
+        }
+        mgr.setThreads(threads);
+        point_count_t cnt = mgr.execute();
+        EXPECT_EQ(cnt, 800028U);
+        EXPECT_EQ(mgr.views().size(), 1U);
+
+        std::vector<double> xs;
+        PointViewPtr v = *mgr.views().begin();
+        for (PointId idx = 0; idx < v->size(); ++idx)
+            xs.push_back(v->getFieldAs<double>(Dimension::Id::X, idx));
+        return xs;
+    };
+
+    std::vector<double> serial = run(1);
+    std::vector<double> parallel = run(4);
+    EXPECT_TRUE(serial == parallel);
+}
+
+// Branches running in parallel share the point table.  Make sure each
+// stage sees the spatial reference of its own branch when it finishes.
+TEST(PipelineManagerTest, threadsSrs)
+{
+    const std::string srs[] = { "EPSG:4326", "EPSG:2029" };
+
+    PipelineManager mgr;
+
+    Stage& merge = mgr.makeFilter("filters.merge");
+    std::vector<Stage *> infos;
+    for (int i = 0; i < 8; ++i)
+    {
+        Options opts;
+        opts.add("mode", "ramp");
+        opts.add("count", 100000);
+        opts.add("bounds", BOX3D(i, i, i, i + 1, i + 1, i + 1));
+        opts.add("override_srs", srs[i % 2]);
+        Stage& r = mgr.makeReader("", "readers.faux", opts);
+        Stage& info = mgr.makeFilter("filters.info", r);
+        merge.setInput(info);
+        infos.push_back(&info);
+    }
+    mgr.setThreads(4);
+    mgr.execute();
+
+    for (size_t i = 0; i < infos.size(); ++i)
+    {
+        MetadataNode m = infos[i]->getMetadata().findChild("srs:compoundwkt");
+        EXPECT_EQ(m.value(), SpatialReference(srs[i % 2]).getWKT()) << i;
+    }
+}
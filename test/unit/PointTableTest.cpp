@@ -34,6 +34,8 @@
 
 #include <pdal/pdal_test_main.hpp>
 
+#include <thread>
+
 #include <pdal/PointTable.hpp>
 #include <io/LasReader.hpp>
 #include "Support.hpp"
@@ -255,6 +257,189 @@ TEST(PointTable, simple)
 
     ContiguousPointTable t2;
     simpleTest(t2);
+
+    ColumnPointTable t3;
+    simpleTest(t3);
+}
+
+TEST(PointTable, columns)
+{
+    using namespace Dimension;
+
+    ColumnPointTable t;
+    PointLayoutPtr layout = t.layout();
+    layout->registerDim(Id::X);
+    layout->registerDim(Id::Y);
+    layout->registerDim(Id::Classification);
+    t.finalize();
+
+    PointView v(t);
+    for (PointId id = 0; id < 1000; ++id)
+    {
+        v.setField(Id::X, id, id * 2);
+        v.setField(Id::Y, id, id * 3);
+        v.setField(Id::Classification, id, id % 32);
+    }
+
+    const double *xs = v.dimensionData<double>(Id::X);
+    const double *ys = v.dimensionData<double>(Id::Y);
+    const uint8_t *cs = v.dimensionData<uint8_t>(Id::Classification);
+    ASSERT_NE(xs, nullptr);
+    ASSERT_NE(ys, nullptr);
+    ASSERT_NE(cs, nullptr);
+    for (PointId id = 0; id < 1000; ++id)
+    {
+        EXPECT_EQ(xs[id], id * 2);
+        EXPECT_EQ(ys[id], id * 3);
+        EXPECT_EQ(cs[id], id % 32);
+    }
+
+    // Wrong type.
+    EXPECT_EQ(v.dimensionData<float>(Id::X), nullptr);
+
+    // A view of an unbroken range of points starts at its first point.
+    PointView v2(t);
+    for (PointId id = 500; id < 600; ++id)
+        v2.appendPoint(v, id);
+    xs = v2.dimensionData<double>(Id::X);
+    ASSERT_NE(xs, nullptr);
+    EXPECT_EQ(xs[0], 1000);
+    EXPECT_EQ(xs[99], 1198);
+
+    BOX3D bounds;
+    v2.calculateBounds(bounds);
+    EXPECT_EQ(bounds.minx, 1000);
+    EXPECT_EQ(bounds.maxy, 1797);
+
+    // Out of order.
+    v2.appendPoint(v, 0);
+    EXPECT_EQ(v2.dimensionData<double>(Id::X), nullptr);
+
+    // Row-oriented tables don't provide columns.
+    PointTable rowTable;
+    rowTable.layout()->registerDim(Id::X);
+    rowTable.finalize();
+    PointView rowView(rowTable);
+    rowView.setField(Id::X, 0, 1.0);
+    EXPECT_EQ(rowView.dimensionData<double>(Id::X), nullptr);
+}
+
+// Add points to separate views of the same table from several threads.
+TEST(PointTable, concurrentAdd)
+{
+    PointTable t;
+    EXPECT_TRUE(t.supportsConcurrentAdd());
+
+    PointLayoutPtr layout = t.layout();
+    layout->registerDim(Dimension::Id::X);
+    layout->registerDim(Dimension::Id::Y);
+    t.finalize();
+
+    const int NumThreads = 4;
+    const PointId NumPoints = 200000;
+    std::vector<PointViewPtr> views;
+    for (int i = 0; i < NumThreads; ++i)
+        views.push_back(PointViewPtr(new PointView(t)));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < NumThreads; ++i)
+        threads.emplace_back([&views, i, NumPoints]()
+        {
+            PointView& v = *views[i];
+            for (PointId id = 0; id < NumPoints; ++id)
+            {
+                v.setField(Dimension::Id::X, id, i);
+                v.setField(Dimension::Id::Y, id, id);
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+
+    for (int i = 0; i < NumThreads; ++i)
+    {
+        PointView& v = *views[i];
+        EXPECT_EQ(v.size(), NumPoints);
+        for (PointId id = 0; id < NumPoints; ++id)
+        {
+            EXPECT_EQ(v.getFieldAs<int>(Dimension::Id::X, id), i);
+            EXPECT_EQ(v.getFieldAs<PointId>(Dimension::Id::Y, id), id);
+        }
+    }
+}
+
+TEST(PointTable, sizeHint)
+{
+    auto check = [](BasePointTable& t, point_count_t count)
+    {
+        PointLayoutPtr layout = t.layout();
+        layout->registerDim(Dimension::Id::X);
+        layout->registerDim(Dimension::Id::Intensity);
+        t.finalize();
+
+        PointView v(t);
+        for (PointId id = 0; id < count; ++id)
+        {
+            // New points start zeroed.
+            v.setField(Dimension::Id::Intensity, id, id % 65536);
+            EXPECT_EQ(v.getFieldAs<int>(Dimension::Id::X, id), 0);
+            v.setField(Dimension::Id::X, id, id);
+        }
+        // Reserving more after points have been added must not disturb
+        // existing data.
+        t.reserve(count);
+        for (PointId id = count; id < 2 * count; ++id)
+        {
+            v.setField(Dimension::Id::X, id, id);
+            v.setField(Dimension::Id::Intensity, id, id % 65536);
+        }
+        EXPECT_EQ(v.size(), 2 * count);
+        for (PointId id = 0; id < 2 * count; ++id)
+        {
+            EXPECT_EQ(v.getFieldAs<PointId>(Dimension::Id::X, id), id);
+            EXPECT_EQ(v.getFieldAs<PointId>(Dimension::Id::Intensity, id),
+                id % 65536);
+        }
+    };
+
+    // Fewer points than the hint, more than the hint and a hint that
+    // isn't a multiple of the block size.
+    PointTable t1(100000);
+    check(t1, 50000);
+    PointTable t2(1000);
+    check(t2, 150000);
+    PointTable t3(70000, true);
+    check(t3, 70000);
+
+    ContiguousPointTable t4(1000);
+    check(t4, 5000);
+    ColumnPointTable t5;
+    check(t5, 5000);
+
+    // Hints given before the layout is finalized are accumulated.
+    PointTable t6;
+    t6.reserve(10000);
+    t6.reserve(10000);
+    check(t6, 20000);
+}
+
+// Memory reserved by several calls must be used up before more is
+// allocated.
+TEST(PointTable, reserveTwice)
+{
+    PointTable t;
+    t.layout()->registerDim(Dimension::Id::X);
+    t.finalize();
+
+    PointView v(t);
+    t.reserve(100000);
+    v.setField(Dimension::Id::X, 0, 0);
+    t.reserve(400000);
+    EXPECT_EQ(t.memoryRegions(), 2U);
+    for (PointId id = 0; id < 400000; ++id)
+        v.setField(Dimension::Id::X, id, id);
+    EXPECT_EQ(t.memoryRegions(), 2U);
+    for (PointId id = 0; id < 400000; ++id)
+        EXPECT_EQ(v.getFieldAs<PointId>(Dimension::Id::X, id), id);
 }
 
 } // namespace
@@ -290,6 +290,67 @@ TEST(PointViewTest, getFloatNan)
     EXPECT_NO_THROW(view->getFieldAs<float>(Dimension::Id::ScanAngleRank, 0));
 }
 
+// Bulk access must match per-point access for both row and column tables,
+// including views whose points aren't in table order.
+template<typename TABLE>
+void fieldRangeTest()
+{
+    TABLE table;
+    PointViewPtr view = makeTestView(table);
+
+    std::vector<uint8_t> cls(10);
+    std::vector<double> xs(10);
+    std::vector<float> ys(10);
+    view->getFieldRange(Dimension::Id::Classification, 5, 10, cls.data());
+    view->getFieldRange(Dimension::Id::X, 5, 10, xs.data());
+    view->getFieldRange(Dimension::Id::Y, 5, 10, ys.data());
+    for (PointId i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(cls[i], view->getFieldAs<uint8_t>(
+            Dimension::Id::Classification, i + 5));
+        EXPECT_EQ(xs[i], view->getFieldAs<double>(Dimension::Id::X, i + 5));
+        EXPECT_EQ(ys[i], view->getFieldAs<float>(Dimension::Id::Y, i + 5));
+    }
+
+    // Values of a missing dimension are zero.
+    std::vector<int> zs(10, 1);
+    view->getFieldRange(Dimension::Id::Z, 0, 10, zs.data());
+    EXPECT_EQ(zs, std::vector<int>(10, 0));
+
+    // X is stored as double.  Values that don't fit the requested type throw.
+    std::vector<double> big { 1, 2, 1000 };
+    view->setFieldRange(Dimension::Id::X, 0, 3, big.data());
+    EXPECT_THROW(view->getFieldRange(Dimension::Id::X, 0, 3, cls.data()),
+        pdal_error);
+
+    // Setting past the end adds points.
+    std::vector<double> vals { 1.4, 2.6, 3.5, 4.4 };
+    view->setFieldRange(Dimension::Id::Classification, 15, 4, vals.data());
+    EXPECT_EQ(view->size(), 19u);
+    EXPECT_EQ(view->getFieldAs<int>(Dimension::Id::Classification, 15), 1);
+    EXPECT_EQ(view->getFieldAs<int>(Dimension::Id::Classification, 16), 3);
+    EXPECT_EQ(view->getFieldAs<int>(Dimension::Id::Classification, 17), 4);
+    EXPECT_EQ(view->getFieldAs<int>(Dimension::Id::Classification, 18), 4);
+    EXPECT_EQ(view->getFieldAs<double>(Dimension::Id::X, 18), 0);
+
+    // Out of table order.
+    PointViewPtr reversed = view->makeNew();
+    for (PointId i = view->size(); i > 0; --i)
+        reversed->appendPoint(*view, i - 1);
+    std::vector<uint8_t> rcls(reversed->size());
+    reversed->getFieldRange(Dimension::Id::Classification, 0,
+        reversed->size(), rcls.data());
+    for (PointId i = 0; i < reversed->size(); ++i)
+        EXPECT_EQ(rcls[i], view->getFieldAs<uint8_t>(
+            Dimension::Id::Classification, view->size() - i - 1));
+}
+
+TEST(PointViewTest, fieldRange)
+{
+    fieldRangeTest<PointTable>();
+    fieldRangeTest<ColumnPointTable>();
+}
+
 // Per discussions with @abellgithub (https://github.com/gadomski/PDAL/commit/c1d54e56e2de841d37f2a1b1c218ed723053f6a9#commitcomment-14415138)
 // we only do bounds checking on `PointView`s when in debug mode.
 #ifndef NDEBUG
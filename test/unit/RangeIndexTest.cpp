@@ -0,0 +1,115 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <pdal/pdal_test_main.hpp>
+
+#include <pdal/RangeIndex.hpp>
+
+namespace pdal
+{
+
+TEST(RangeIndexTest, consecutive)
+{
+    RangeIndex idx;
+    EXPECT_TRUE(idx.empty());
+
+    for (PointId i = 0; i < 10000; ++i)
+        idx.push_back(i + 100);
+    EXPECT_EQ(idx.size(), 10000u);
+    for (PointId i = 0; i < 10000; ++i)
+        EXPECT_EQ(idx[i], i + 100);
+    EXPECT_TRUE(idx.contiguous(0, 10000));
+    EXPECT_TRUE(idx.contiguous(4000, 5000));
+    EXPECT_EQ(idx.at(9999), 10099u);
+    EXPECT_THROW(idx.at(10000), std::out_of_range);
+}
+
+TEST(RangeIndexTest, explicitIds)
+{
+    RangeIndex idx;
+
+    // Reversed IDs.
+    for (PointId i = 0; i < 10000; ++i)
+        idx.push_back(10000 - i);
+    for (PointId i = 0; i < 10000; ++i)
+        EXPECT_EQ(idx[i], 10000 - i);
+    EXPECT_FALSE(idx.contiguous(0, 2));
+    EXPECT_TRUE(idx.contiguous(5, 1));
+
+    // Break a run in the middle of a block and restore it.
+    RangeIndex idx2;
+    for (PointId i = 0; i < 10000; ++i)
+        idx2.push_back(i);
+    idx2.swap(10, 5000);
+    EXPECT_EQ(idx2[10], 5000u);
+    EXPECT_EQ(idx2[5000], 10u);
+    EXPECT_EQ(idx2[11], 11u);
+    EXPECT_EQ(idx2[5001], 5001u);
+    EXPECT_FALSE(idx2.contiguous(0, 10000));
+    EXPECT_TRUE(idx2.contiguous(11, 4989));
+    idx2.swap(10, 5000);
+    EXPECT_TRUE(idx2.contiguous(0, 10000));
+
+    // Setting an ID that matches the run leaves it alone.
+    idx2.set(20, 20);
+    EXPECT_EQ(idx2[20], 20u);
+
+    // A run broken by push_back.
+    RangeIndex idx3;
+    idx3.push_back(5);
+    idx3.push_back(6);
+    idx3.push_back(1);
+    idx3.push_back(2);
+    EXPECT_EQ(idx3[0], 5u);
+    EXPECT_EQ(idx3[1], 6u);
+    EXPECT_EQ(idx3[2], 1u);
+    EXPECT_EQ(idx3[3], 2u);
+    EXPECT_TRUE(idx3.contiguous(2, 2));
+    EXPECT_FALSE(idx3.contiguous(1, 2));
+}
+
+TEST(RangeIndexTest, truncate)
+{
+    RangeIndex idx;
+    for (PointId i = 0; i < 9000; ++i)
+        idx.push_back(i * 2);
+    idx.truncate(4100);
+    EXPECT_EQ(idx.size(), 4100u);
+    idx.push_back(1);
+    EXPECT_EQ(idx[4099], 8198u);
+    EXPECT_EQ(idx[4100], 1u);
+
+    idx.truncate(0);
+    EXPECT_TRUE(idx.empty());
+    idx.push_back(7);
+    EXPECT_EQ(idx[0], 7u);
+}
+
+} // namespace pdal
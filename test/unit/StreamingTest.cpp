@@ -39,6 +39,8 @@
 #include <pdal/StageFactory.hpp>
 #include <filters/MergeFilter.hpp>
 #include <filters/StreamCallbackFilter.hpp>
+#include <io/LasReader.hpp>
+#include <pdal/util/FileUtils.hpp>
 #include "Support.hpp"
 
 using namespace pdal;
@@ -528,3 +530,205 @@ R"(
         EXPECT_NE(output.find("DBDCA"), std::string::npos);
     }
 }
+
+// Make sure that stages that process a batch of points at once in stream
+// mode produce the same points as in standard mode.
+TEST(Streaming, batch)
+{
+    auto pipeline = [](const std::string& outfile)
+    {
+        return
+R"json(
+{
+    "pipeline" : [
+        ")json" + Support::datapath("las/autzen_trim.las") + R"json(",
+        {
+            "type": "filters.range",
+            "limits": "Z[400:500],Classification[1:2]"
+        },
+        {
+            "type": "filters.assign",
+            "assignment": "Classification[1:1]=3",
+            "condition": "ReturnNumber[1:1]"
+        },
+        {
+            "type": "filters.crop",
+            "bounds": "([636200, 637000], [849000, 849400])"
+        },
+        {
+            "type": "filters.reprojection",
+            "out_srs": "EPSG:4326"
+        },
+        {
+            "type": "writers.las",
+            "scale_x": 1e-7,
+            "scale_y": 1e-7,
+            "filename": ")json" + outfile + R"json("
+        }
+    ]
+}
+)json";
+    };
+
+    std::string standardFile(Support::temppath("batch_standard.las"));
+    std::string streamFile(Support::temppath("batch_stream.las"));
+    FileUtils::deleteFile(standardFile);
+    FileUtils::deleteFile(streamFile);
+
+    {
+        std::istringstream iss(pipeline(standardFile));
+        PipelineManager mgr;
+        mgr.readPipeline(iss);
+        mgr.execute();
+    }
+    {
+        // Use a table size that doesn't divide the number of points.
+        std::istringstream iss(pipeline(streamFile));
+        PipelineManager mgr;
+        mgr.readPipeline(iss);
+        FixedPointTable t(777);
+        mgr.executeStream(t);
+    }
+
+    auto readFile = [](PointTable& table, const std::string& filename)
+    {
+        Options opts;
+        opts.add("filename", filename);
+        LasReader r;
+        r.setOptions(opts);
+        r.prepare(table);
+        return *r.execute(table).begin();
+    };
+
+    PointTable t1;
+    PointViewPtr v1 = readFile(t1, standardFile);
+    PointTable t2;
+    PointViewPtr v2 = readFile(t2, streamFile);
+
+    EXPECT_GT(v1->size(), 0u);
+    ASSERT_EQ(v1->size(), v2->size());
+    for (PointId i = 0; i < v1->size(); ++i)
+    {
+        using namespace Dimension;
+
+        EXPECT_EQ(v1->getFieldAs<int32_t>(Id::X, i),
+            v2->getFieldAs<int32_t>(Id::X, i));
+        EXPECT_EQ(v1->getFieldAs<int32_t>(Id::Y, i),
+            v2->getFieldAs<int32_t>(Id::Y, i));
+        EXPECT_EQ(v1->getFieldAs<int32_t>(Id::Z, i),
+            v2->getFieldAs<int32_t>(Id::Z, i));
+        EXPECT_EQ(v1->getFieldAs<uint8_t>(Id::Classification, i),
+            v2->getFieldAs<uint8_t>(Id::Classification, i));
+    }
+}
+
+// Make sure that pipelined stream execution processes all points in order.
+TEST(Streaming, pipelined)
+{
+    for (size_t threads = 2; threads <= 4; ++threads)
+    {
+        Options ro;
+        ro.add("bounds", BOX3D(0, 0, 0, 999, 999, 999));
+        ro.add("mode", "ramp");
+        ro.add("count", 1000);
+        FauxReader r;
+        r.setOptions(ro);
+
+        StageFactory factory;
+        Stage *range = factory.createStage("filters.range");
+        Options rangeOpts;
+        rangeOpts.add("limits", "X[100:899]");
+        range->setOptions(rangeOpts);
+        range->setInput(r);
+
+        StreamCallbackFilter f;
+        int cnt = 0;
+        int x = 100;
+        auto cb = [&cnt, &x](PointRef& point)
+        {
+            EXPECT_EQ(point.getFieldAs<int>(Dimension::Id::X), x++);
+            cnt++;
+            return true;
+        };
+        f.setCallback(cb);
+        f.setInput(*range);
+
+        // Use a table size that doesn't divide the number of points.
+        FixedPointTable t(30);
+        f.prepare(t);
+        f.execute(t, threads);
+        EXPECT_EQ(cnt, 800);
+    }
+}
+
+// Pipelined execution must hand points to a caller's own table as serial
+// execution does.
+TEST(Streaming, pipelinedCustomTable)
+{
+    // A table that collects the X values of the points that weren't
+    // filtered out each time it's cleared.
+    class TestPointTable : public StreamPointTable
+    {
+    public:
+        TestPointTable() : StreamPointTable(m_layout, 30)
+        {}
+
+        virtual void finalize()
+        {
+            if (!m_layout.finalized())
+            {
+                BasePointTable::finalize();
+                m_buf.resize(pointsToBytes(capacity() + 1));
+            }
+        }
+
+        std::vector<int> m_xs;
+
+    protected:
+        virtual void reset()
+        {
+            for (PointId idx = 0; idx < numPoints(); ++idx)
+                if (!skip(idx))
+                {
+                    PointRef point(*this, idx);
+                    m_xs.push_back(point.getFieldAs<int>(Dimension::Id::X));
+                }
+            std::fill(m_buf.begin(), m_buf.end(), 0);
+        }
+
+        virtual char *getPoint(PointId idx)
+            { return m_buf.data() + pointsToBytes(idx); }
+
+    private:
+        std::vector<char> m_buf;
+        PointLayout m_layout;
+    };
+
+    for (size_t threads = 1; threads <= 4; ++threads)
+    {
+        Options ro;
+        ro.add("bounds", BOX3D(0, 0, 0, 999, 999, 999));
+        ro.add("mode", "ramp");
+        ro.add("count", 1000);
+        FauxReader r;
+        r.setOptions(ro);
+
+        StageFactory factory;
+        Stage *range = factory.createStage("filters.range");
+        Options rangeOpts;
+        rangeOpts.add("limits", "X[100:899]");
+        range->setOptions(rangeOpts);
+        range->setInput(r);
+
+        StreamCallbackFilter f;
+        f.setCallback([](PointRef&){ return true; });
+        f.setInput(*range);
+
+        TestPointTable t;
+        f.prepare(t);
+        f.execute(t, threads);
+        ASSERT_EQ(t.m_xs.size(), 800u);
+        for (size_t i = 0; i < t.m_xs.size(); ++i)
+            EXPECT_EQ(t.m_xs[i], (int)i + 100);
+    }
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <pdal/pdal_test_main.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <pdal/util/ThreadPool.hpp>
+
+using namespace pdal;
+
+TEST(ThreadPoolTest, pool)
+{
+    ThreadPool pool(3, 10);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 100; ++i)
+        pool.add([&count](){ count++; });
+    pool.await();
+    EXPECT_EQ(count, 100);
+
+    pool.add([](){ throw std::runtime_error("Task failed"); });
+    pool.join();
+    ASSERT_EQ(pool.errors().size(), 1U);
+    EXPECT_EQ(pool.errors()[0], "Task failed");
+}
+
+TEST(ThreadPoolTest, parallelFor)
+{
+    std::vector<int> v(100000);
+    parallelFor(0, v.size(), [&v](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                v[i] += (int)i;
+        });
+    for (size_t i = 0; i < v.size(); ++i)
+        EXPECT_EQ(v[i], (int)i);
+
+    // Chunk boundaries.
+    std::atomic<size_t> total(0);
+    parallelFor(10, 1013, [&total](size_t begin, size_t end)
+        {
+            EXPECT_LE(end - begin, 100U);
+            total += end - begin;
+        }, 0, 100);
+    EXPECT_EQ(total, 1003U);
+
+    // Empty range.
+    parallelFor(5, 5, [](size_t, size_t){ FAIL(); });
+}
+
+TEST(ThreadPoolTest, nested)
+{
+    std::atomic<size_t> total(0);
+    parallelFor(0, 50, [&total](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                parallelFor(0, 1000, [&total](size_t b, size_t e)
+                    { total += e - b; }, 0, 10);
+        }, 0, 1);
+    EXPECT_EQ(total, 50000U);
+}
+
+TEST(ThreadPoolTest, exception)
+{
+    auto fail = [](size_t begin, size_t)
+    {
+        if (begin == 500)
+            throw std::runtime_error("Chunk failed");
+    };
+    EXPECT_THROW(parallelFor(0, 1000, fail, 0, 10), std::runtime_error);
+
+    // A single thread runs the loop in the calling thread.
+    EXPECT_THROW(parallelFor(0, 1000, fail, 1, 10), std::runtime_error);
+}
@@ -0,0 +1,126 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <pdal/pdal_test_main.hpp>
+
+#include <pdal/PointTable.hpp>
+#include <pdal/util/FileUtils.hpp>
+#include <filters/StreamCallbackFilter.hpp>
+#include <io/FauxReader.hpp>
+#include <kernels/private/sort/ExternalSortFilter.hpp>
+
+#include "Support.hpp"
+
+using namespace pdal;
+
+namespace
+{
+
+void checkExternalSort(bool stream, size_t memoryLimit)
+{
+    const point_count_t count = 10000;
+    const BOX2D bounds(0, 0, 100, 100);
+    const std::string tempDir(Support::temppath("sort"));
+
+    FileUtils::deleteDirectory(tempDir);
+    FileUtils::createDirectory(tempDir);
+
+    Options ro;
+    ro.add("mode", "random");
+    ro.add("bounds", BOX3D(0, 0, 0, 100, 100, 100));
+    ro.add("count", count);
+    FauxReader r;
+    r.setOptions(ro);
+
+    ExternalSortFilter f(bounds, CurveKey::Curve::Morton, memoryLimit,
+        tempDir);
+    f.setInput(r);
+
+    const CurveKey key(bounds, CurveKey::Curve::Morton);
+    point_count_t seen = 0;
+    uint64_t lastKey = 0;
+    uint32_t lastTime = 0;
+    StreamCallbackFilter c;
+    c.setCallback([&](PointRef& point)
+        {
+            uint64_t k = key(point.getFieldAs<double>(Dimension::Id::X),
+                point.getFieldAs<double>(Dimension::Id::Y));
+            uint32_t t = point.getFieldAs<uint32_t>(Dimension::Id::OffsetTime);
+            if (seen)
+            {
+                EXPECT_LE(lastKey, k);
+                // Points with the same key keep their input order.
+                if (lastKey == k)
+                    EXPECT_LT(lastTime, t);
+            }
+            lastKey = k;
+            lastTime = t;
+            seen++;
+            return true;
+        });
+    c.setInput(f);
+
+    if (stream)
+    {
+        FixedPointTable t(1000);
+        c.prepare(t);
+        c.execute(t);
+    }
+    else
+    {
+        PointTable t;
+        c.prepare(t);
+        c.execute(t);
+    }
+    EXPECT_EQ(seen, count);
+
+    // Run files are removed once the sort is done.
+    EXPECT_EQ(FileUtils::directoryList(tempDir).size(), 0U);
+}
+
+} // unnamed namespace
+
+// Small enough to write a few dozen runs.
+TEST(SortTest, externalStream)
+{
+    checkExternalSort(true, 20000);
+}
+
+TEST(SortTest, externalStandard)
+{
+    checkExternalSort(false, 20000);
+}
+
+// Writes hundreds of runs, which are merged in more than one pass.
+TEST(SortTest, externalManyRuns)
+{
+    checkExternalSort(true, 2000);
+    checkExternalSort(false, 2000);
+}
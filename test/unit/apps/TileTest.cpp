@@ -89,6 +89,32 @@ TEST(Tile, test1)
 }
 
 
+// Read several inputs at once and force all but one tile through the
+// temporary spill files.  Two of the five files are left for inputs and
+// two for the spill files of the tiles being written.
+TEST(Tile, threads)
+{
+    std::string inSpec(Support::datapath("text/file*.txt"));
+    std::string outSpec(Support::temppath("tile/out#.txt"));
+
+    std::string baseCmd = Support::binpath("pdal") + " tile \"" +
+        inSpec + "\" \"" + outSpec + "\" ";
+
+    FileUtils::deleteDirectory(Support::temppath("tile"));
+    FileUtils::createDirectory(Support::temppath("tile"));
+
+    std::string output;
+    std::string cmd = baseCmd + " --origin_x=0 --origin_y=0 --length=10 "
+        "--threads=2 --max_open=5";
+    Utils::run_shell_command(cmd, output);
+
+    EXPECT_EQ(FileUtils::directoryList(Support::temppath("tile")).size(), 9U);
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            checkFile(i, j, 3);
+}
+
+
 TEST(Tile, test2)
 {
     std::string inSpec(Support::datapath("las/tile/*"));
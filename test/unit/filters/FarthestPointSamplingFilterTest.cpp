@@ -0,0 +1,184 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+#include <pdal/pdal_test_main.hpp>
+#include <pdal/StageFactory.hpp>
+#include <io/BufferReader.hpp>
+
+using namespace pdal;
+
+namespace
+{
+
+// Farthest point sampling by computing the distance from each sample to
+// every point.
+PointIdList bruteForce(const PointView& view, point_count_t count)
+{
+    using namespace Dimension;
+
+    std::vector<double> dist(view.size(),
+        (std::numeric_limits<double>::max)());
+    PointIdList ids;
+    PointId idx = 0;
+    while (ids.size() < count)
+    {
+        ids.push_back(idx);
+        double x = view.getFieldAs<double>(Id::X, idx);
+        double y = view.getFieldAs<double>(Id::Y, idx);
+        double z = view.getFieldAs<double>(Id::Z, idx);
+        for (PointId i = 0; i < view.size(); ++i)
+        {
+            double dx = view.getFieldAs<double>(Id::X, i) - x;
+            double dy = view.getFieldAs<double>(Id::Y, i) - y;
+            double dz = view.getFieldAs<double>(Id::Z, i) - z;
+            dist[i] = (std::min)(dist[i], dx * dx + dy * dy + dz * dz);
+        }
+        idx = std::max_element(dist.begin(), dist.end()) - dist.begin();
+    }
+    return ids;
+}
+
+PointViewPtr sample(PointTableRef table, PointViewPtr view,
+    point_count_t count)
+{
+    BufferReader reader;
+    reader.addView(view);
+
+    StageFactory factory;
+    Stage *filter = factory.createStage("filters.fps");
+    Options opts;
+    opts.add("count", count);
+    filter->setOptions(opts);
+    filter->setInput(reader);
+    filter->prepare(table);
+    PointViewSet s = filter->execute(table);
+    return s.empty() ? nullptr : *s.begin();
+}
+
+} // unnamed namespace
+
+// Sampling matches the brute force method, including the choice among
+// points that are equally far, which the integer positions make common.
+TEST(FarthestPointSamplingFilterTest, bruteForce)
+{
+    using namespace Dimension;
+
+    for (int zRange : { 0, 50 })
+    {
+        PointTable table;
+        table.layout()->registerDims({ Id::X, Id::Y, Id::Z });
+        PointViewPtr view(new PointView(table));
+
+        std::mt19937 gen(zRange);
+        std::uniform_int_distribution<int> xy(0, 300);
+        std::uniform_int_distribution<int> z(0, zRange);
+        for (PointId i = 0; i < 5000; ++i)
+        {
+            view->setField(Id::X, i, xy(gen));
+            view->setField(Id::Y, i, xy(gen) / 3);
+            view->setField(Id::Z, i, z(gen));
+        }
+
+        PointIdList expected = bruteForce(*view, 400);
+        PointViewPtr out = sample(table, view, 400);
+        ASSERT_TRUE((bool)out);
+        ASSERT_EQ(out->size(), expected.size());
+        for (PointId i = 0; i < out->size(); ++i)
+        {
+            EXPECT_EQ(out->getFieldAs<double>(Id::X, i),
+                view->getFieldAs<double>(Id::X, expected[i]));
+            EXPECT_EQ(out->getFieldAs<double>(Id::Y, i),
+                view->getFieldAs<double>(Id::Y, expected[i]));
+            EXPECT_EQ(out->getFieldAs<double>(Id::Z, i),
+                view->getFieldAs<double>(Id::Z, expected[i]));
+        }
+    }
+}
+
+// Points that are all in the same place, or on a line, are sampled.
+TEST(FarthestPointSamplingFilterTest, degenerate)
+{
+    using namespace Dimension;
+
+    PointTable table;
+    table.layout()->registerDims({ Id::X, Id::Y, Id::Z });
+    PointViewPtr same(new PointView(table));
+    PointViewPtr line(new PointView(table));
+    for (PointId i = 0; i < 100; ++i)
+    {
+        same->setField(Id::X, i, 5);
+        same->setField(Id::Y, i, 5);
+        same->setField(Id::Z, i, 5);
+        line->setField(Id::X, i, i);
+        line->setField(Id::Y, i, 1);
+        line->setField(Id::Z, i, 0);
+    }
+
+    PointViewPtr out = sample(table, same, 10);
+    ASSERT_TRUE((bool)out);
+    EXPECT_EQ(out->size(), 10U);
+
+    out = sample(table, line, 3);
+    ASSERT_TRUE((bool)out);
+    ASSERT_EQ(out->size(), 3U);
+    EXPECT_EQ(out->getFieldAs<int>(Id::X, 0), 0);
+    EXPECT_EQ(out->getFieldAs<int>(Id::X, 1), 99);
+    EXPECT_EQ(out->getFieldAs<int>(Id::X, 2), 49);
+
+    EXPECT_FALSE((bool)sample(table, line, 101));
+}
+
+// The seed point is always kept, even when no points are asked for.
+TEST(FarthestPointSamplingFilterTest, seed)
+{
+    using namespace Dimension;
+
+    PointTable table;
+    table.layout()->registerDims({ Id::X, Id::Y, Id::Z });
+    PointViewPtr view(new PointView(table));
+    for (PointId i = 0; i < 10; ++i)
+    {
+        view->setField(Id::X, i, i + 3);
+        view->setField(Id::Y, i, 0);
+        view->setField(Id::Z, i, 0);
+    }
+
+    for (point_count_t count : { 0, 1 })
+    {
+        PointViewPtr out = sample(table, view, count);
+        ASSERT_TRUE((bool)out);
+        ASSERT_EQ(out->size(), 1U);
+        EXPECT_EQ(out->getFieldAs<int>(Id::X, 0), 3);
+    }
+}
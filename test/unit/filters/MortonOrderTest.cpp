@@ -34,8 +34,12 @@
 
 #include <pdal/pdal_test_main.hpp>
 
+#include <algorithm>
+#include <random>
+
 #include <io/BufferReader.hpp>
 #include <filters/MortonOrderFilter.hpp>
+#include <pdal/private/RadixSort.hpp>
 
 #include "Support.hpp"
 
@@ -113,3 +117,125 @@ TEST(MortonOrderTest, test_code)
     EXPECT_EQ(outView->getFieldAs<double>(Dimension::Id::X, 5), 3);
     EXPECT_EQ(outView->getFieldAs<double>(Dimension::Id::Y, 5), 2);
 }
+
+namespace
+{
+
+// An 8x8 grid of points in reverse order, plus a point at (8, 8) so that
+// the grid points fall on the corners of curve cells.
+PointViewSet orderGrid(PointTableRef table, Options opts)
+{
+    table.layout()->registerDim(Dimension::Id::X);
+    table.layout()->registerDim(Dimension::Id::Y);
+    table.layout()->registerDim(Dimension::Id::Intensity);
+    PointViewPtr view(new PointView(table));
+
+    PointId id = 0;
+    view->setField(Dimension::Id::X, id, 8);
+    view->setField(Dimension::Id::Y, id++, 8);
+    for (int i = 63; i >= 0; --i)
+    {
+        view->setField(Dimension::Id::X, id, i / 8);
+        view->setField(Dimension::Id::Y, id, i % 8);
+        view->setField(Dimension::Id::Intensity, id++, i);
+    }
+
+    BufferReader r;
+    r.addView(view);
+
+    MortonOrderFilter filter;
+    filter.setInput(r);
+    filter.setOptions(opts);
+    filter.prepare(table);
+    return filter.execute(table);
+}
+
+} // unnamed namespace
+
+TEST(MortonOrderTest, morton)
+{
+    PointTable table;
+    PointViewSet s = orderGrid(table, Options());
+    PointViewPtr v = *s.begin();
+    ASSERT_EQ(v->size(), 65U);
+
+    // X takes the more significant bit of each pair of bits.
+    int expected[][2] = { {0, 0}, {0, 1}, {1, 0}, {1, 1},
+        {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 0} };
+    for (PointId i = 0; i < 9; ++i)
+    {
+        EXPECT_EQ(v->getFieldAs<int>(Dimension::Id::X, i), expected[i][0]);
+        EXPECT_EQ(v->getFieldAs<int>(Dimension::Id::Y, i), expected[i][1]);
+    }
+}
+
+TEST(MortonOrderTest, hilbert)
+{
+    Options opts;
+    opts.add("curve", "hilbert");
+    opts.add("compact", true);
+
+    PointTable table;
+    PointViewSet s = orderGrid(table, opts);
+    PointViewPtr v = *s.begin();
+    ASSERT_EQ(v->size(), 65U);
+
+    // Successive grid points on a Hilbert curve are neighbors.
+    int lastX = -1;
+    int lastY = -1;
+    for (PointId i = 0; i < v->size(); ++i)
+    {
+        int x = v->getFieldAs<int>(Dimension::Id::X, i);
+        int y = v->getFieldAs<int>(Dimension::Id::Y, i);
+        if (x == 8)
+            continue;
+        if (lastX >= 0)
+            EXPECT_EQ(std::abs(x - lastX) + std::abs(y - lastY), 1);
+        EXPECT_EQ(v->getFieldAs<int>(Dimension::Id::Intensity, i),
+            x * 8 + y);
+        lastX = x;
+        lastY = y;
+    }
+    EXPECT_EQ(v->getFieldAs<int>(Dimension::Id::X, 0), 0);
+    EXPECT_EQ(v->getFieldAs<int>(Dimension::Id::Y, 0), 0);
+
+    // Compacted points are new points stored in curve order.
+    for (PointId i = 0; i < v->size(); ++i)
+    {
+        PointRef p(table, 65 + i);
+        EXPECT_EQ(p.getFieldAs<int>(Dimension::Id::Intensity),
+            v->getFieldAs<int>(Dimension::Id::Intensity, i));
+    }
+
+    Options bad;
+    bad.add("curve", "hilbert");
+    bad.add("reverse", true);
+    PointTable table2;
+    EXPECT_THROW(orderGrid(table2, bad), pdal_error);
+}
+
+TEST(MortonOrderTest, radixSort)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint64_t> dist;
+
+    for (size_t count : { 0, 1, 1000, 300000 })
+    {
+        SortEntries entries;
+        for (PointId i = 0; i < count; ++i)
+        {
+            // Use few distinct values in the high bits to check stability.
+            uint64_t key = dist(gen);
+            if (i % 2)
+                key &= 0xFF000000000000FF;
+            entries.push_back(SortEntry(key, i));
+        }
+        SortEntries expected(entries);
+        std::stable_sort(expected.begin(), expected.end(),
+            [](const SortEntry& e1, const SortEntry& e2)
+            { return e1.first < e2.first; });
+
+        radixSort(entries);
+        EXPECT_TRUE(entries == expected);
+    }
+}
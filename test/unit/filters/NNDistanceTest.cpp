@@ -33,6 +33,7 @@
 ****************************************************************************/
 
 #include <filters/NNDistanceFilter.hpp>
+#include <io/BufferReader.hpp>
 #include <pdal/pdal_test_main.hpp>
 #include <pdal/StageFactory.hpp>
 
@@ -122,3 +123,52 @@ TEST(NNDistanceTest, kdist)
     }
 }
 
+
+// Views with fewer than k + 1 points average the neighbors that exist.
+TEST(NNDistanceTest, avgSmallView)
+{
+    auto run = [](const std::vector<double>& xs)
+    {
+        BufferReader r;
+        Options opts;
+        opts.add("mode", "avg");
+        opts.add("k", 10);
+        NNDistanceFilter f;
+        f.setOptions(opts);
+        f.setInput(r);
+
+        PointTable t;
+        t.layout()->registerDim(Dimension::Id::X);
+        t.layout()->registerDim(Dimension::Id::Y);
+        t.layout()->registerDim(Dimension::Id::Z);
+        f.prepare(t);
+
+        PointViewPtr v(new PointView(t));
+        for (PointId i = 0; i < xs.size(); ++i)
+        {
+            v->setField(Dimension::Id::X, i, xs[i]);
+            v->setField(Dimension::Id::Y, i, 0);
+            v->setField(Dimension::Id::Z, i, 0);
+        }
+        r.addView(v);
+
+        PointViewSet s = f.execute(t);
+        PointViewPtr out = *s.begin();
+
+        std::vector<double> dists;
+        for (PointId i = 0; i < out->size(); ++i)
+            dists.push_back(
+                out->getFieldAs<double>(Dimension::Id::NNDistance, i));
+        return dists;
+    };
+
+    std::vector<double> d = run({ 0, 1, 3 });
+    ASSERT_EQ(d.size(), 3U);
+    EXPECT_DOUBLE_EQ(d[0], 2);
+    EXPECT_DOUBLE_EQ(d[1], 1.5);
+    EXPECT_DOUBLE_EQ(d[2], 2.5);
+
+    d = run({ 5 });
+    ASSERT_EQ(d.size(), 1U);
+    EXPECT_EQ(d[0], 0);
+}
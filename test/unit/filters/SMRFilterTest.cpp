@@ -35,6 +35,7 @@
 #include <pdal/pdal_test_main.hpp>
 #include <pdal/StageFactory.hpp>
 #include <filters/SMRFilter.hpp>
+#include <io/BufferReader.hpp>
 
 #include "Support.hpp"
 
@@ -94,3 +95,80 @@ TEST(SMRFFilterTest, noreturns)
     EXPECT_EQ(classCount.size(), 1U);
     EXPECT_EQ(classCount[ClassLabel::Ground], 10);
 }
+
+// Running SMRF through filters.tiled, with a buffer at least as wide as the
+// window, finds the same ground as running it on all points at once, even
+// for a building that straddles the tiles.
+TEST(SMRFilterTest, tiled)
+{
+    auto run = [](bool tiled)
+    {
+        PointTable table;
+        table.layout()->registerDims(
+            { Dimension::Id::X, Dimension::Id::Y, Dimension::Id::Z });
+
+        BufferReader reader;
+        StageFactory factory;
+        Stage *filter;
+        if (tiled)
+        {
+            filter = factory.createStage("filters.tiled");
+            Options opts;
+            opts.add("filter", "filters.smrf");
+            opts.add("length", 100);
+            opts.add("buffer", 30);
+            opts.add("origin_x", 0);
+            opts.add("origin_y", 0);
+            filter->setOptions(opts);
+        }
+        else
+            filter = factory.createStage("filters.smrf");
+        filter->setInput(reader);
+        filter->prepare(table);
+
+        // A sloped plane with a 20m square building where four tiles meet.
+        PointViewPtr view(new PointView(table));
+        PointId idx = 0;
+        for (int x = 0; x < 200; ++x)
+            for (int y = 0; y < 200; ++y)
+            {
+                bool roof = x >= 90 && x < 110 && y >= 90 && y < 110;
+                view->setField(Dimension::Id::X, idx, x + .5);
+                view->setField(Dimension::Id::Y, idx, y + .5);
+                view->setField(Dimension::Id::Z, idx,
+                    .05 * x + (roof ? 10 : 0));
+                idx++;
+            }
+        reader.addView(view);
+
+        PointViewSet s = filter->execute(table);
+        PointViewPtr out = *s.begin();
+
+        std::map<std::pair<double, double>, uint8_t> classes;
+        for (PointId i = 0; i < out->size(); ++i)
+        {
+            double x = out->getFieldAs<double>(Dimension::Id::X, i);
+            double y = out->getFieldAs<double>(Dimension::Id::Y, i);
+            classes[{x, y}] = out->getFieldAs<uint8_t>(
+                Dimension::Id::Classification, i);
+        }
+        return classes;
+    };
+
+    auto whole = run(false);
+    auto tiles = run(true);
+    ASSERT_EQ(whole.size(), 40000U);
+    EXPECT_EQ(whole, tiles);
+
+    size_t ground = 0;
+    for (auto& c : whole)
+    {
+        bool roof = c.first.first > 90 && c.first.first < 110 &&
+            c.first.second > 90 && c.first.second < 110;
+        EXPECT_EQ(c.second, roof ? ClassLabel::Unclassified :
+            ClassLabel::Ground);
+        if (c.second == ClassLabel::Ground)
+            ground++;
+    }
+    EXPECT_EQ(ground, 40000U - 400U);
+}
@@ -35,6 +35,7 @@
 #include <pdal/pdal_test_main.hpp>
 
 #include <random>
+#include <tuple>
 
 #include <pdal/PipelineManager.hpp>
 #include <pdal/StageWrapper.hpp>
@@ -169,3 +170,99 @@ TEST(SortFilterTest, issue1121_simpleSortOrderDesc)
     }
 }
 
+
+TEST(SortFilterTest, multiKey)
+{
+    Options opts;
+    opts.add("dimension", "Classification, Intensity, X");
+    opts.add("order", "DESC");
+    opts.add("order", "ASC");
+    opts.add("order", "DESC");
+
+    SortFilter filter;
+    filter.setOptions(opts);
+
+    PointTable table;
+    table.layout()->registerDim(Dimension::Id::X);
+    table.layout()->registerDim(Dimension::Id::Intensity);
+    table.layout()->registerDim(Dimension::Id::Classification);
+    table.layout()->registerDim(Dimension::Id::OffsetTime);
+    PointViewPtr view(new PointView(table));
+
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int> classDist(0, 3);
+    std::uniform_int_distribution<int> intensityDist(0, 5);
+    std::uniform_real_distribution<double> xDist(-10.0, 10.0);
+
+    const point_count_t count = 100000;
+    for (PointId i = 0; i < count; ++i)
+    {
+        view->setField(Dimension::Id::Classification, i, classDist(generator));
+        view->setField(Dimension::Id::Intensity, i, intensityDist(generator));
+        // Repeat X values to check that the sort is stable.
+        view->setField(Dimension::Id::X, i, std::round(xDist(generator)));
+        view->setField(Dimension::Id::OffsetTime, i, i);
+    }
+
+    filter.prepare(table);
+    FilterWrapper::ready(filter, table);
+    FilterWrapper::filter(filter, *view.get());
+    FilterWrapper::done(filter, table);
+
+    ASSERT_EQ(count, view->size());
+    auto key = [&view](PointId i)
+    {
+        return std::make_tuple(
+            -view->getFieldAs<int>(Dimension::Id::Classification, i),
+            view->getFieldAs<int>(Dimension::Id::Intensity, i),
+            -view->getFieldAs<double>(Dimension::Id::X, i),
+            view->getFieldAs<PointId>(Dimension::Id::OffsetTime, i));
+    };
+    for (PointId i = 1; i < count; ++i)
+        EXPECT_TRUE(key(i - 1) < key(i));
+}
+
+TEST(SortFilterTest, signed)
+{
+    Options opts;
+    opts.add("dimension", "ScanAngleRank");
+
+    SortFilter filter;
+    filter.setOptions(opts);
+
+    PointTable table;
+    table.layout()->registerDim(Dimension::Id::ScanAngleRank,
+        Dimension::Type::Signed16);
+    PointViewPtr view(new PointView(table));
+
+    std::vector<int> vals { 5, -3, 0, -32768, 32767, -1, 1, 0 };
+    for (PointId i = 0; i < vals.size(); ++i)
+        view->setField(Dimension::Id::ScanAngleRank, i, vals[i]);
+
+    filter.prepare(table);
+    FilterWrapper::ready(filter, table);
+    FilterWrapper::filter(filter, *view.get());
+    FilterWrapper::done(filter, table);
+
+    std::sort(vals.begin(), vals.end());
+    for (PointId i = 0; i < vals.size(); ++i)
+        EXPECT_EQ(view->getFieldAs<int>(Dimension::Id::ScanAngleRank, i),
+            vals[i]);
+}
+
+TEST(SortFilterTest, badOrderCount)
+{
+    Options opts;
+    opts.add("dimension", "X,Y,Z");
+    opts.add("order", "ASC");
+    opts.add("order", "DESC");
+
+    SortFilter filter;
+    filter.setOptions(opts);
+
+    PointTable table;
+    table.layout()->registerDim(Dimension::Id::X);
+    table.layout()->registerDim(Dimension::Id::Y);
+    table.layout()->registerDim(Dimension::Id::Z);
+    EXPECT_THROW(filter.prepare(table), pdal_error);
+}
@@ -0,0 +1,189 @@
+/******************************************************************************
+ * Copyright (c) 2020, Hobu Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following
+ * conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ ****************************************************************************/
+
+#include <map>
+#include <tuple>
+
+#include <pdal/pdal_test_main.hpp>
+#include <pdal/StageFactory.hpp>
+#include <filters/StreamCallbackFilter.hpp>
+
+using namespace pdal;
+
+namespace
+{
+
+using Key = std::tuple<double, double, double>;
+
+Key key(PointRef& p)
+{
+    return Key(p.getFieldAs<double>(Dimension::Id::X),
+        p.getFieldAs<double>(Dimension::Id::Y),
+        p.getFieldAs<double>(Dimension::Id::Z));
+}
+
+Options readerOptions()
+{
+    // Make a 20x20x2 grid of points.
+    Options opts;
+    opts.add("mode", "grid");
+    opts.add("bounds", "([0, 20],[0,20],[0,2])");
+    return opts;
+}
+
+// NNDistance of each point when all points are filtered at once.
+std::map<Key, double> expected()
+{
+    StageFactory f;
+    Stage *reader(f.createStage("readers.faux"));
+    reader->setOptions(readerOptions());
+    Stage *filter(f.createStage("filters.nndistance"));
+    Options opts;
+    opts.add("mode", "avg");
+    opts.add("k", 6);
+    filter->setOptions(opts);
+    filter->setInput(*reader);
+
+    PointTable t;
+    filter->prepare(t);
+    PointViewSet s = filter->execute(t);
+    PointViewPtr v = *s.begin();
+
+    std::map<Key, double> dists;
+    for (PointId i = 0; i < v->size(); ++i)
+    {
+        PointRef p(*v, i);
+        dists[key(p)] = p.getFieldAs<double>(Dimension::Id::NNDistance);
+    }
+    return dists;
+}
+
+Options tiledOptions(int spillCount)
+{
+    Options opts;
+    opts.add("filter",
+        "{ \"type\": \"filters.nndistance\", \"mode\": \"avg\", \"k\": 6 }");
+    opts.add("length", 6);
+    opts.add("buffer", 3);
+    opts.add("origin_x", 0);
+    opts.add("origin_y", 0);
+    opts.add("threads", 3);
+    opts.add("spill_count", spillCount);
+    return opts;
+}
+
+} // unnamed namespace
+
+TEST(TiledFilterTest, standard)
+{
+    std::map<Key, double> dists = expected();
+    ASSERT_EQ(dists.size(), 800U);
+
+    for (int spillCount : { 50, 10000 })
+    {
+        StageFactory f;
+        Stage *reader(f.createStage("readers.faux"));
+        reader->setOptions(readerOptions());
+        Stage *filter(f.createStage("filters.tiled"));
+        filter->setOptions(tiledOptions(spillCount));
+        filter->setInput(*reader);
+
+        PointTable t;
+        filter->prepare(t);
+        PointViewSet s = filter->execute(t);
+        ASSERT_EQ(s.size(), 1U);
+        PointViewPtr v = *s.begin();
+
+        // Each point is passed on once, with the distance computed with
+        // all of its neighbors.
+        ASSERT_EQ(v->size(), dists.size());
+        std::map<Key, int> seen;
+        for (PointId i = 0; i < v->size(); ++i)
+        {
+            PointRef p(*v, i);
+            Key k = key(p);
+            EXPECT_EQ(++seen[k], 1);
+            EXPECT_DOUBLE_EQ(p.getFieldAs<double>(Dimension::Id::NNDistance),
+                dists[k]);
+        }
+    }
+}
+
+TEST(TiledFilterTest, stream)
+{
+    std::map<Key, double> dists = expected();
+
+    StageFactory f;
+    Stage *reader(f.createStage("readers.faux"));
+    reader->setOptions(readerOptions());
+    Stage *filter(f.createStage("filters.tiled"));
+    filter->setOptions(tiledOptions(100));
+    filter->setInput(*reader);
+
+    point_count_t count = 0;
+    auto cb = [&dists, &count](PointRef& p)
+    {
+        EXPECT_DOUBLE_EQ(p.getFieldAs<double>(Dimension::Id::NNDistance),
+            dists[key(p)]);
+        count++;
+        return true;
+    };
+    StreamCallbackFilter callback;
+    callback.setCallback(cb);
+    callback.setInput(*filter);
+
+    FixedPointTable t(64);
+    callback.prepare(t);
+    callback.execute(t);
+    EXPECT_EQ(count, dists.size());
+}
+
+TEST(TiledFilterTest, options)
+{
+    StageFactory f;
+    Stage *reader(f.createStage("readers.faux"));
+    reader->setOptions(readerOptions());
+    Stage *filter(f.createStage("filters.tiled"));
+    filter->setInput(*reader);
+
+    Options opts;
+    opts.add("filter", "filters.nndistance");
+    opts.add("length", 10);
+    opts.add("buffer", 10);
+    filter->setOptions(opts);
+    PointTable t;
+    EXPECT_THROW(filter->prepare(t), pdal_error);
+
+    Options opts2;
+    opts2.add("filter", "readers.faux");
+    filter->setOptions(opts2);
+    PointTable t2;
+    EXPECT_THROW(filter->prepare(t2), pdal_error);
+}
@@ -750,6 +750,51 @@ TEST(GDALWriterTest, issue_2095)
     EXPECT_EQ(grid.verticalIndex(4.5), 0);
 }
 
+// Points added in a batch, which are split among tiles and added in
+// parallel, give the same grid as points added one at a time.  Expanding
+// the grid keeps existing data in place.
+TEST(GDALWriterTest, tiledGrid)
+{
+    const size_t Width = 600;
+    const size_t Height = 520;
+    GDALGrid single(Width, Height, 1, 1.5, ~0, 0, 1.0);
+    GDALGrid batch(Width, Height, 1, 1.5, ~0, 0, 1.0);
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<double> zs;
+    for (size_t i = 0; i < 50000; ++i)
+    {
+        xs.push_back(((i * 7919) % (Width * 10)) / 10.0);
+        ys.push_back(((i * 104729) % (Height * 10)) / 10.0);
+        zs.push_back(i % 100);
+        single.addPoint(xs.back(), ys.back(), zs.back());
+    }
+    batch.addPoints(xs.data(), ys.data(), zs.data(), xs.size());
+
+    // Add cells to the left of and below the batch grid.
+    batch.expand(Width + 300, Height + 10, 300, 10);
+    single.finalize();
+    batch.finalize();
+
+    for (std::string name : { "min", "max", "mean", "idw", "count", "stdev" })
+    {
+        GDALGrid::BandIter s = single.data(name);
+        size_t mismatches = 0;
+        for (size_t j = 0; j < Height; ++j)
+        {
+            GDALGrid::BandIter b = batch.data(name) + j * (Width + 300) + 300;
+            for (size_t i = 0; i < Width; ++i, ++s, ++b)
+                if (!(*s == *b || (std::isnan(*s) && std::isnan(*b))))
+                    mismatches++;
+        }
+        EXPECT_EQ(mismatches, 0U) << name;
+    }
+    EXPECT_EQ(*batch.data("count"), 0);
+    EXPECT_TRUE(std::isnan(
+        *(batch.data("min") + (Height + 5) * (Width + 300))));
+}
+
 // If the radius is sufficiently large, make sure the grid is filled.
 TEST(GDALWriterTest, issue_2545)
 {
@@ -868,4 +913,63 @@ TEST(GDALWriterTest, alternate_grid)
     }
 }
 
+// Writing rows of the raster as ordered input arrives gives the same raster
+// as writing it once all points have been added.
+TEST(GDALWriterTest, inputOrder)
+{
+    auto run = [](const std::string& order, const std::string& outfile)
+    {
+        // Points on a grid arrive in rows of increasing Y.
+        Options ro;
+        ro.add("mode", "grid");
+        ro.add("bounds", "([0, 20], [0, 600], [0, 0])");
+
+        FauxReader r;
+        r.setOptions(ro);
+
+        Options wo;
+        wo.add("filename", outfile);
+        wo.add("resolution", 1);
+        wo.add("radius", 1.2);
+        wo.add("window_size", 2);
+        wo.add("dimension", "X");
+        wo.add("bounds", "([0, 30], [0, 620])");
+        wo.add("gdalopts", "TILED=YES,BLOCKXSIZE=16,BLOCKYSIZE=16");
+        wo.add("input_order", order);
+
+        GDALWriter w;
+        w.setOptions(wo);
+        w.setInput(r);
+
+        FixedPointTable t(100);
+        w.prepare(t);
+        w.execute(t);
+    };
+
+    std::string outfile1(Support::temppath("ordered1.tif"));
+    std::string outfile2(Support::temppath("ordered2.tif"));
+    FileUtils::deleteFile(outfile1);
+    FileUtils::deleteFile(outfile2);
+    run("none", outfile1);
+    run("ascending_y", outfile2);
+
+    gdal::registerDrivers();
+    gdal::Raster raster1(outfile1, "GTiff");
+    gdal::Raster raster2(outfile2, "GTiff");
+    ASSERT_EQ(raster1.open(), gdal::GDALError::None);
+    ASSERT_EQ(raster2.open(), gdal::GDALError::None);
+    ASSERT_EQ(raster1.bandCount(), 6);
+    for (int band = 1; band <= 6; ++band)
+    {
+        std::vector<double> data1;
+        std::vector<double> data2;
+        raster1.readBand(data1, band);
+        raster2.readBand(data2, band);
+        EXPECT_EQ(data1, data2) << "Band " << band;
+    }
+
+    // Points arriving out of order are an error.
+    EXPECT_THROW(run("descending_y", outfile2), pdal_error);
+}
+
 } // namespace pdal
@@ -34,11 +34,14 @@
 
 #include <pdal/pdal_test_main.hpp>
 
+#include <fstream>
+
 #include <pdal/pdal_features.hpp>
 #include <pdal/Filter.hpp>
 #include <pdal/PointView.hpp>
 #include <pdal/StageFactory.hpp>
 #include <pdal/Streamable.hpp>
+#include <pdal/util/FileUtils.hpp>
 #include <io/LasReader.hpp>
 #include "Support.hpp"
 
@@ -400,6 +403,99 @@ TEST(LasReaderTest, lazperf)
 }
 #endif
 
+// Decompressing chunks in parallel must produce the same points in the
+// same order as a serial read.
+void threadsTest(const std::string compression,
+    const std::string filename = Support::datapath("laz/autzen_trim.laz"))
+{
+    auto readView = [&compression, &filename](PointTable& t, size_t threads)
+    {
+        Options ops;
+        ops.add("filename", filename);
+        ops.add("compression", compression);
+        ops.add("threads", threads);
+
+        LasReader r;
+        r.setOptions(ops);
+        r.prepare(t);
+        PointViewSet s = r.execute(t);
+        EXPECT_EQ(s.size(), 1UL);
+        return *s.begin();
+    };
+
+    PointTable t1;
+    PointViewPtr v1 = readView(t1, 1);
+    PointTable t2;
+    PointViewPtr v2 = readView(t2, 4);
+    ASSERT_EQ(v1->size(), (point_count_t)110000);
+    ASSERT_EQ(v2->size(), v1->size());
+
+    DimTypeList dims = v1->dimTypes();
+    size_t pointSize = v1->pointSize();
+    std::vector<char> buf1(pointSize);
+    std::vector<char> buf2(pointSize);
+    for (PointId i = 0; i < v1->size(); ++i)
+    {
+        v1->getPackedPoint(dims, i, buf1.data());
+        v2->getPackedPoint(dims, i, buf2.data());
+        EXPECT_EQ(memcmp(buf1.data(), buf2.data(), pointSize), 0);
+    }
+}
+
+TEST(LasReaderTest, threads)
+{
+#ifdef PDAL_HAVE_LASZIP
+    threadsTest("laszip");
+#endif
+#ifdef PDAL_HAVE_LAZPERF
+    threadsTest("lazperf");
+#endif
+}
+
+#ifdef PDAL_HAVE_LAZPERF
+// Files written as a stream store -1 as the chunk table offset and put the
+// real offset at the end of the file.  A corrupt table offset should fall
+// back to serial decompression.
+TEST(LasReaderTest, chunkTable)
+{
+    std::string src(Support::datapath("laz/autzen_trim.laz"));
+    std::string streamed(Support::temppath("streamed.laz"));
+    std::string corrupt(Support::temppath("corrupt.laz"));
+
+    FileUtils::deleteFile(streamed);
+    FileUtils::deleteFile(corrupt);
+    std::ifstream in(src, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)),
+        std::istreambuf_iterator<char>());
+    ASSERT_GT(data.size(), 104U);
+
+    // Offset to point data is at byte 96 of the header.
+    uint32_t pointOffset;
+    memcpy(&pointOffset, data.data() + 96, sizeof(pointOffset));
+    int64_t tablePos;
+    memcpy(&tablePos, data.data() + pointOffset, sizeof(tablePos));
+
+    std::string out(data);
+    int64_t streamedPos(-1);
+    memcpy(&out[pointOffset], &streamedPos, sizeof(streamedPos));
+    out.append((const char *)&tablePos, sizeof(tablePos));
+    {
+        std::ofstream f(streamed, std::ios::binary);
+        f << out;
+    }
+    threadsTest("lazperf", streamed);
+
+    out = data;
+    int64_t badPos((int64_t)data.size() * 2);
+    memcpy(&out[pointOffset], &badPos, sizeof(badPos));
+    {
+        std::ofstream f(corrupt, std::ios::binary);
+        f << out;
+    }
+    threadsTest("lazperf", corrupt);
+}
+#endif
+
 void streamTest(const std::string src, const std::string compression)
 {
     Options ops1;
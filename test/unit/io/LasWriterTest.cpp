@@ -727,6 +727,44 @@ TEST(LasWriterTest, lazperf)
 }
 #endif
 
+#if defined(PDAL_HAVE_LAZPERF)
+// Chunks compressed on several threads must be stitched together into the
+// same file a single thread would write.
+TEST(LasWriterTest, lazperfThreads)
+{
+    auto write = [](const std::string& filename, size_t threads)
+    {
+        Options readerOps;
+        readerOps.add("filename", Support::datapath("las/autzen_trim.las"));
+
+        LasReader r;
+        r.setOptions(readerOps);
+
+        FileUtils::deleteFile(filename);
+
+        Options writerOps;
+        writerOps.add("filename", filename);
+        writerOps.add("compression", "lazperf");
+        writerOps.add("threads", threads);
+
+        LasWriter w;
+        w.setOptions(writerOps);
+        w.setInput(r);
+
+        PointTable t;
+        w.prepare(t);
+        w.execute(t);
+    };
+
+    std::string serial(Support::temppath("serial.laz"));
+    std::string parallel(Support::temppath("parallel.laz"));
+    write(serial, 1);
+    write(parallel, 4);
+
+    EXPECT_EQ(Support::diff_files(serial, parallel), 0u);
+}
+#endif
+
 #if defined(PDAL_HAVE_LASZIP)
 // LAZ files are normally written in chunks of 50,000, so a file of size
 // 110,000 ensures we read some whole chunks and a partial.